@@ -0,0 +1,1638 @@
+#include "Capture.h"
+
+#include "JobPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CAPTURE_SSE2 1
+#include <emmintrin.h>
+#else
+#define CAPTURE_SSE2 0
+#endif
+
+#include "../External_libs/stb/image/stb_image_write.h"
+
+namespace Engine_
+{
+    namespace
+    {
+        // Encoder threads report from the background; keep lines whole.
+        std::mutex g_log_mutex;
+    }
+
+    // ------------------------------------------------------------
+    // Formats
+    // ------------------------------------------------------------
+    namespace
+    {
+        std::string lower_ext(const std::string& ext)
+        {
+            std::string e = ext;
+            std::transform(e.begin(), e.end(), e.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            return e;
+        }
+
+        inline void put_be32(std::vector<uint8_t>& out, uint32_t v)
+        {
+            out.push_back((uint8_t)(v >> 24));
+            out.push_back((uint8_t)(v >> 16));
+            out.push_back((uint8_t)(v >> 8));
+            out.push_back((uint8_t)v);
+        }
+
+        inline void patch_be32(uint8_t* p, uint32_t v)
+        {
+            p[0] = (uint8_t)(v >> 24);
+            p[1] = (uint8_t)(v >> 16);
+            p[2] = (uint8_t)(v >> 8);
+            p[3] = (uint8_t)v;
+        }
+
+        // -------------------------
+        // CRC-32 / Adler-32
+        // -------------------------
+        struct Crc32Table
+        {
+            uint32_t t[256];
+            Crc32Table()
+            {
+                for (uint32_t i = 0; i < 256; ++i)
+                {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; ++k) c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                    t[i] = c;
+                }
+            }
+        };
+
+        uint32_t crc32(const uint8_t* p, size_t n, uint32_t crc = 0)
+        {
+            static const Crc32Table table;
+            crc = ~crc;
+            for (size_t i = 0; i < n; ++i) crc = table.t[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+            return ~crc;
+        }
+
+        constexpr uint32_t ADLER_BASE = 65521;
+
+        uint32_t adler32(const uint8_t* p, size_t n)
+        {
+            uint32_t a = 1, b = 0;
+            while (n > 0)
+            {
+                const size_t chunk = std::min<size_t>(n, 5552); // largest run without overflow
+                for (size_t i = 0; i < chunk; ++i) { a += p[i]; b += a; }
+                a %= ADLER_BASE;
+                b %= ADLER_BASE;
+                p += chunk;
+                n -= chunk;
+            }
+            return (b << 16) | a;
+        }
+
+        // adler32 of A||B from adler32(A), adler32(B), len(B) (same math as zlib's adler32_combine)
+        uint32_t adler32_combine(uint32_t a1, uint32_t a2, size_t len2)
+        {
+            const uint32_t rem = (uint32_t)(len2 % ADLER_BASE);
+            uint32_t sum1 = a1 & 0xFFFF;
+            uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % ADLER_BASE);
+            sum1 += (a2 & 0xFFFF) + ADLER_BASE - 1;
+            sum2 += (a1 >> 16) + (a2 >> 16) + ADLER_BASE - rem;
+            if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+            if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+            if (sum2 >= (ADLER_BASE << 1)) sum2 -= (ADLER_BASE << 1);
+            if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+            return sum1 | (sum2 << 16);
+        }
+
+        // -------------------------
+        // Fast deflate: greedy LZ77 (single hash probe) + fixed Huffman codes.
+        // -------------------------
+        struct BitWriter
+        {
+            std::vector<uint8_t>& out;
+            uint64_t bits = 0;
+            int count = 0;
+
+            explicit BitWriter(std::vector<uint8_t>& o) : out(o) {}
+
+            // n <= 32; flushes whole 32-bit words to keep the per-symbol cost low
+            inline void put(uint32_t v, int n)
+            {
+                bits |= (uint64_t)v << count;
+                count += n;
+                if (count >= 32)
+                {
+                    const uint8_t w[4] = { (uint8_t)bits, (uint8_t)(bits >> 8), (uint8_t)(bits >> 16), (uint8_t)(bits >> 24) };
+                    out.insert(out.end(), w, w + 4);
+                    bits >>= 32;
+                    count -= 32;
+                }
+            }
+
+            void align()
+            {
+                while (count > 0)
+                {
+                    out.push_back((uint8_t)bits);
+                    bits >>= 8;
+                    count -= 8;
+                }
+                bits = 0;
+                count = 0;
+            }
+        };
+
+        inline uint32_t bit_reverse(uint32_t code, int len)
+        {
+            uint32_t r = 0;
+            for (int i = 0; i < len; ++i) { r = (r << 1) | (code & 1); code >>= 1; }
+            return r;
+        }
+
+        struct FixedHuffman
+        {
+            // literal/length symbols 0..287 (already bit-reversed for LSB-first output)
+            uint16_t lit_code[288];
+            uint8_t  lit_len[288];
+
+            // match length 3..258 -> code + extra bits in one word
+            uint32_t len_bits[259];
+            uint8_t  len_nbits[259];
+
+            // distance symbol (5-bit fixed code) + extra bits, via the usual two lookup tables
+            uint8_t dist_sym_lo[512];  // dist-1 < 512
+            uint8_t dist_sym_hi[256];  // (dist-1) >> 7
+
+            static constexpr uint16_t LEN_BASE[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+            static constexpr uint8_t  LEN_EXTRA[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+            static constexpr uint16_t DIST_BASE[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+            static constexpr uint8_t  DIST_EXTRA[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+
+            FixedHuffman()
+            {
+                for (int s = 0; s < 288; ++s)
+                {
+                    uint32_t code; int len;
+                    if (s <= 143)      { code = 0x30 + s;          len = 8; }
+                    else if (s <= 255) { code = 0x190 + (s - 144); len = 9; }
+                    else if (s <= 279) { code = s - 256;           len = 7; }
+                    else               { code = 0xC0 + (s - 280);  len = 8; }
+                    lit_code[s] = (uint16_t)bit_reverse(code, len);
+                    lit_len[s] = (uint8_t)len;
+                }
+
+                for (int sym = 0; sym < 29; ++sym)
+                {
+                    const int lo = LEN_BASE[sym];
+                    const int hi = (sym == 28) ? 258 : LEN_BASE[sym + 1] - 1;
+                    for (int l = lo; l <= hi && l <= 258; ++l)
+                    {
+                        const int s = 257 + sym;
+                        len_bits[l] = lit_code[s] | ((uint32_t)(l - lo) << lit_len[s]);
+                        len_nbits[l] = (uint8_t)(lit_len[s] + LEN_EXTRA[sym]);
+                    }
+                }
+
+                for (int sym = 0; sym < 30; ++sym)
+                {
+                    const int lo = DIST_BASE[sym];
+                    const int hi = (sym == 29) ? 32768 : DIST_BASE[sym + 1] - 1;
+                    for (int d = lo; d <= hi; ++d)
+                    {
+                        if (d - 1 < 512) dist_sym_lo[d - 1] = (uint8_t)sym;
+                        if (((d - 1) & 127) == 0 && ((d - 1) >> 7) < 256) dist_sym_hi[(d - 1) >> 7] = (uint8_t)sym;
+                    }
+                }
+            }
+
+            inline void put_dist(BitWriter& bw, int d) const
+            {
+                const int sym = (d <= 512) ? dist_sym_lo[d - 1] : dist_sym_hi[(d - 1) >> 7];
+                bw.put(bit_reverse((uint32_t)sym, 5) | ((uint32_t)(d - DIST_BASE[sym]) << 5), 5 + DIST_EXTRA[sym]);
+            }
+        };
+
+        const FixedHuffman& fixed_huffman()
+        {
+            static const FixedHuffman fh;
+            return fh;
+        }
+
+        // Compresses `data` as one fixed-Huffman block. Non-final blocks end with an empty
+        // stored block so the output stops on a byte boundary and can be concatenated.
+        void deflate_fast(const uint8_t* data, size_t n, bool final_block, std::vector<uint8_t>& out)
+        {
+            const FixedHuffman& fh = fixed_huffman();
+
+            constexpr int HASH_BITS = 15;
+            constexpr size_t WINDOW = 32768;
+            thread_local std::vector<uint32_t> table;
+            table.assign((size_t)1 << HASH_BITS, 0);
+
+            BitWriter bw(out);
+            bw.put(final_block ? 1u : 0u, 1);
+            bw.put(1, 2); // BTYPE = 01, fixed Huffman
+
+            auto lit = [&](uint8_t c) { bw.put(fh.lit_code[c], fh.lit_len[c]); };
+
+            size_t i = 0;
+            while (i + 4 <= n)
+            {
+                uint32_t v;
+                std::memcpy(&v, data + i, 4);
+                const uint32_t h = (v * 2654435761u) >> (32 - HASH_BITS);
+                const size_t cand = table[h]; // stored as pos + 1
+                table[h] = (uint32_t)(i + 1);
+
+                if (cand != 0 && i - (cand - 1) <= WINDOW)
+                {
+                    const uint8_t* a = data + (cand - 1);
+                    const uint8_t* b = data + i;
+                    uint32_t av;
+                    std::memcpy(&av, a, 4);
+                    if (av == v)
+                    {
+                        size_t len = 4;
+                        const size_t max_len = std::min<size_t>(258, n - i);
+                        while (len < max_len && a[len] == b[len]) ++len;
+
+                        bw.put(fh.len_bits[len], fh.len_nbits[len]);
+                        fh.put_dist(bw, (int)(b - a));
+                        i += len;
+                        continue;
+                    }
+                }
+
+                lit(data[i]);
+                ++i;
+            }
+            for (; i < n; ++i) lit(data[i]);
+
+            bw.put(fh.lit_code[256], fh.lit_len[256]); // end of block
+
+            if (!final_block)
+            {
+                bw.put(0, 3); // BFINAL = 0, BTYPE = 00 (stored)
+                bw.align();
+                out.push_back(0x00); out.push_back(0x00);
+                out.push_back(0xFF); out.push_back(0xFF);
+            }
+            else
+            {
+                bw.align();
+            }
+        }
+
+        void png_chunk_begin(std::vector<uint8_t>& out, const char* type, size_t& start)
+        {
+            start = out.size();
+            put_be32(out, 0);
+            out.insert(out.end(), type, type + 4);
+        }
+
+        void png_chunk_end(std::vector<uint8_t>& out, size_t start)
+        {
+            const size_t data_len = out.size() - start - 8;
+            patch_be32(&out[start], (uint32_t)data_len);
+            put_be32(out, crc32(&out[start + 4], data_len + 4));
+        }
+    }
+
+    CaptureFormat capture_format_for(const std::string& extension)
+    {
+        const std::string e = lower_ext(extension);
+        if (e == ".fpng") return CaptureFormat::PngFast;
+        if (e == ".qoi")  return CaptureFormat::Qoi;
+        return CaptureFormat::Png;
+    }
+
+    std::string capture_output_extension(const std::string& extension)
+    {
+        if (extension.empty()) return ".png";
+        if (lower_ext(extension) == ".fpng") return ".png";
+        return extension;
+    }
+
+    bool encode_png(const uint8_t* rgba, int w, int h, std::vector<uint8_t>& out)
+    {
+        out.clear();
+        auto append = [](void* ctx, void* data, int size)
+            {
+                auto* v = static_cast<std::vector<uint8_t>*>(ctx);
+                const uint8_t* p = static_cast<const uint8_t*>(data);
+                v->insert(v->end(), p, p + size);
+            };
+        return stbi_write_png_to_func(append, &out, w, h, 4, rgba, w * 4) != 0;
+    }
+
+    bool encode_png_fast(const uint8_t* rgba, int w, int h, std::vector<uint8_t>& out)
+    {
+        out.clear();
+        if (w <= 0 || h <= 0) return false;
+
+        static const uint8_t SIG[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        out.insert(out.end(), SIG, SIG + 8);
+
+        size_t chunk;
+        png_chunk_begin(out, "IHDR", chunk);
+        put_be32(out, (uint32_t)w);
+        put_be32(out, (uint32_t)h);
+        out.push_back(8);  // bit depth
+        out.push_back(6);  // RGBA
+        out.push_back(0);  // deflate
+        out.push_back(0);  // adaptive filtering
+        out.push_back(0);  // no interlace
+        png_chunk_end(out, chunk);
+
+        // Bands of rows are filtered + compressed independently and land in their own
+        // IDAT chunks; together they form one zlib stream.
+        const size_t row_bytes = (size_t)w * 4 + 1;
+        constexpr int BAND_ROWS = 64;
+        const int bands = (h + BAND_ROWS - 1) / BAND_ROWS;
+
+        struct Band
+        {
+            std::vector<uint8_t> chunk;
+            uint32_t adler = 1;
+            size_t raw_len = 0;
+        };
+        std::vector<Band> results((size_t)bands);
+
+        JobPool::shared().parallel_for(bands, [&](int bi)
+            {
+                const int y0 = bi * BAND_ROWS;
+                const int y1 = std::min(h, y0 + BAND_ROWS);
+
+                // Filter: Sub on the first image row, Up everywhere else.
+                thread_local std::vector<uint8_t> raw;
+                raw.resize((size_t)(y1 - y0) * row_bytes);
+                for (int y = y0; y < y1; ++y)
+                {
+                    uint8_t* dst = &raw[(size_t)(y - y0) * row_bytes];
+                    const uint8_t* cur = rgba + (size_t)y * w * 4;
+                    if (y == 0)
+                    {
+                        dst[0] = 1;
+                        std::memcpy(dst + 1, cur, 4);
+                        for (size_t i = 4; i < (size_t)w * 4; ++i) dst[1 + i] = (uint8_t)(cur[i] - cur[i - 4]);
+                    }
+                    else
+                    {
+                        const uint8_t* up = cur - (size_t)w * 4;
+                        dst[0] = 2;
+                        for (size_t i = 0; i < (size_t)w * 4; ++i) dst[1 + i] = (uint8_t)(cur[i] - up[i]);
+                    }
+                }
+
+                Band& b = results[(size_t)bi];
+                b.raw_len = raw.size();
+                b.adler = adler32(raw.data(), raw.size());
+
+                b.chunk.reserve(raw.size() / 4 + 64);
+                size_t start;
+                png_chunk_begin(b.chunk, "IDAT", start);
+                if (bi == 0) { b.chunk.push_back(0x78); b.chunk.push_back(0x01); } // zlib header, fastest
+                deflate_fast(raw.data(), raw.size(), bi == bands - 1, b.chunk);
+                png_chunk_end(b.chunk, start);
+            });
+
+        uint32_t adler = 1;
+        for (const Band& b : results)
+        {
+            out.insert(out.end(), b.chunk.begin(), b.chunk.end());
+            adler = adler32_combine(adler, b.adler, b.raw_len);
+        }
+
+        png_chunk_begin(out, "IDAT", chunk);
+        put_be32(out, adler);
+        png_chunk_end(out, chunk);
+
+        png_chunk_begin(out, "IEND", chunk);
+        png_chunk_end(out, chunk);
+        return true;
+    }
+
+    bool encode_qoi(const uint8_t* rgba, int w, int h, std::vector<uint8_t>& out)
+    {
+        out.clear();
+        if (w <= 0 || h <= 0) return false;
+
+        const size_t px_count = (size_t)w * h;
+        out.reserve(14 + px_count * 5 / 2 + 8);
+
+        out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+        put_be32(out, (uint32_t)w);
+        put_be32(out, (uint32_t)h);
+        out.push_back(4); // channels
+        out.push_back(0); // sRGB with linear alpha
+
+        enum : uint8_t { OP_INDEX = 0x00, OP_DIFF = 0x40, OP_LUMA = 0x80, OP_RUN = 0xC0, OP_RGB = 0xFE, OP_RGBA = 0xFF };
+
+        uint32_t index[64] = {};
+        uint8_t prev[4] = { 0, 0, 0, 255 };
+        uint32_t prev_word;
+        std::memcpy(&prev_word, prev, 4);
+        int run = 0;
+
+        for (size_t i = 0; i < px_count; ++i)
+        {
+            const uint8_t* p = rgba + i * 4;
+            uint32_t word;
+            std::memcpy(&word, p, 4);
+
+            if (word == prev_word)
+            {
+                if (++run == 62 || i + 1 == px_count)
+                {
+                    out.push_back((uint8_t)(OP_RUN | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0)
+            {
+                out.push_back((uint8_t)(OP_RUN | (run - 1)));
+                run = 0;
+            }
+
+            const int h6 = (p[0] * 3 + p[1] * 5 + p[2] * 7 + p[3] * 11) & 63;
+            if (index[h6] == word)
+            {
+                out.push_back((uint8_t)(OP_INDEX | h6));
+            }
+            else
+            {
+                index[h6] = word;
+                const uint8_t* q = reinterpret_cast<const uint8_t*>(&prev_word);
+                if (p[3] == q[3])
+                {
+                    const int vr = (int8_t)(p[0] - q[0]);
+                    const int vg = (int8_t)(p[1] - q[1]);
+                    const int vb = (int8_t)(p[2] - q[2]);
+                    const int vg_r = vr - vg;
+                    const int vg_b = vb - vg;
+
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                    {
+                        out.push_back((uint8_t)(OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+                    }
+                    else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8)
+                    {
+                        out.push_back((uint8_t)(OP_LUMA | (vg + 32)));
+                        out.push_back((uint8_t)((vg_r + 8) << 4 | (vg_b + 8)));
+                    }
+                    else
+                    {
+                        out.push_back(OP_RGB);
+                        out.insert(out.end(), p, p + 3);
+                    }
+                }
+                else
+                {
+                    out.push_back(OP_RGBA);
+                    out.insert(out.end(), p, p + 4);
+                }
+            }
+            prev_word = word;
+        }
+
+        out.insert(out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+        return true;
+    }
+
+    bool encode_frame(CaptureFormat format, const uint8_t* rgba, int w, int h, std::vector<uint8_t>& out)
+    {
+        switch (format)
+        {
+        case CaptureFormat::PngFast: return encode_png_fast(rgba, w, h, out);
+        case CaptureFormat::Qoi:     return encode_qoi(rgba, w, h, out);
+        case CaptureFormat::Png:
+        default:                     return encode_png(rgba, w, h, out);
+        }
+    }
+
+    bool write_capture_frame(const CaptureFrame& frame)
+    {
+        thread_local std::vector<uint8_t> encoded;
+
+        bool ok = encode_frame(frame.format, frame.rgba.data(), frame.w, frame.h, encoded);
+        if (ok)
+        {
+            std::ofstream f(frame.path, std::ios::binary);
+            ok = (bool)f && (bool)f.write(reinterpret_cast<const char*>(encoded.data()), (std::streamsize)encoded.size());
+        }
+
+        std::lock_guard<std::mutex> lk(g_log_mutex);
+        if (!ok)
+            std::cerr << "[Engine] Capture write failed: " << frame.path << "\n";
+        else
+            std::cout << "[Engine] Saved: " << frame.path << "\n";
+        return ok;
+    }
+
+    struct CaptureQueue::Impl
+    {
+        std::mutex m;
+        std::condition_variable cv_work;  // frames queued / stop
+        std::condition_variable cv_space; // a frame finished (space + flush)
+
+        std::deque<CaptureFrame> queue;
+        std::vector<std::vector<uint8_t>> free_buffers;
+        std::vector<std::thread> threads;
+        Writer writer;
+
+        int max_pending = 1;
+        int in_flight = 0; // queued + being encoded
+        bool stop = false;
+
+        void worker_loop()
+        {
+            for (;;)
+            {
+                CaptureFrame frame;
+                {
+                    std::unique_lock<std::mutex> lk(m);
+                    cv_work.wait(lk, [&] { return stop || !queue.empty(); });
+                    if (queue.empty()) return; // stop requested and nothing left
+                    frame = std::move(queue.front());
+                    queue.pop_front();
+                }
+
+                writer(frame);
+
+                {
+                    std::lock_guard<std::mutex> lk(m);
+                    if ((int)free_buffers.size() < max_pending)
+                        free_buffers.push_back(std::move(frame.rgba));
+                    in_flight--;
+                }
+                cv_space.notify_all();
+            }
+        }
+    };
+
+    CaptureQueue::CaptureQueue(int encoder_threads, int max_pending, Writer writer)
+        : impl_(new Impl())
+    {
+        impl_->writer = writer ? std::move(writer) : Writer(write_capture_frame);
+        encoder_threads = std::max(1, encoder_threads);
+        impl_->max_pending = std::max(encoder_threads, max_pending);
+
+        impl_->threads.reserve((size_t)encoder_threads);
+        for (int i = 0; i < encoder_threads; ++i)
+            impl_->threads.emplace_back([this] { impl_->worker_loop(); });
+    }
+
+    CaptureQueue::~CaptureQueue()
+    {
+        flush();
+        {
+            std::lock_guard<std::mutex> lk(impl_->m);
+            impl_->stop = true;
+        }
+        impl_->cv_work.notify_all();
+        for (auto& t : impl_->threads)
+            if (t.joinable()) t.join();
+        delete impl_;
+    }
+
+    std::vector<uint8_t> CaptureQueue::acquire_buffer(size_t bytes)
+    {
+        std::vector<uint8_t> buf;
+        {
+            std::lock_guard<std::mutex> lk(impl_->m);
+            if (!impl_->free_buffers.empty())
+            {
+                buf = std::move(impl_->free_buffers.back());
+                impl_->free_buffers.pop_back();
+            }
+        }
+        buf.resize(bytes);
+        return buf;
+    }
+
+    void CaptureQueue::submit(CaptureFrame&& frame)
+    {
+        {
+            std::unique_lock<std::mutex> lk(impl_->m);
+            impl_->cv_space.wait(lk, [&] { return impl_->in_flight < impl_->max_pending; });
+            impl_->in_flight++;
+            impl_->queue.push_back(std::move(frame));
+        }
+        impl_->cv_work.notify_one();
+    }
+
+    void CaptureQueue::flush()
+    {
+        std::unique_lock<std::mutex> lk(impl_->m);
+        impl_->cv_space.wait(lk, [&] { return impl_->in_flight == 0; });
+    }
+
+    // ------------------------------------------------------------
+    // Video streams
+    // ------------------------------------------------------------
+    bool stream_format_for(const std::string& extension, StreamFormat& out)
+    {
+        const std::string e = lower_ext(extension);
+        if (e == ".rgba") { out = StreamFormat::RawRgba; return true; }
+        if (e == ".y4m")  { out = StreamFormat::Y4m; return true; }
+        if (e == ".frames") { out = StreamFormat::Archive; return true; }
+        return false;
+    }
+
+    namespace
+    {
+        // BT.601 limited range, 8-bit fixed point:
+        //   Y = ((  66R + 129G +  25B + 128) >> 8) + 16
+        //   U = (( -38R -  74G + 112B + 128) >> 8) + 128
+        //   V = (( 112R -  94G -  18B + 128) >> 8) + 128
+        // The SSE2 path computes exactly the same integers.
+        inline uint8_t yuv_y(int r, int g, int b) { return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16); }
+        inline uint8_t yuv_u(int r, int g, int b) { return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128); }
+        inline uint8_t yuv_v(int r, int g, int b) { return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128); }
+
+#if CAPTURE_SSE2
+        // 4 RGBA pixels -> R, G, B in 32-bit lanes
+        inline void split_rgb(__m128i px, __m128i& r, __m128i& g, __m128i& b)
+        {
+            const __m128i m = _mm_set1_epi32(0xFF);
+            r = _mm_and_si128(px, m);
+            g = _mm_and_si128(_mm_srli_epi32(px, 8), m);
+            b = _mm_and_si128(_mm_srli_epi32(px, 16), m);
+        }
+
+        // 8 lanes of 16-bit R, G, B (0..255) -> 8 luma bytes in the low half
+        inline __m128i luma8(__m128i r, __m128i g, __m128i b)
+        {
+            __m128i y = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+            y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+            y = _mm_add_epi16(y, _mm_set1_epi16(128));
+            y = _mm_add_epi16(_mm_srli_epi16(y, 8), _mm_set1_epi16(16)); // unsigned: max 56228
+            return _mm_packus_epi16(y, y);
+        }
+
+        // signed 16-bit chroma: ((cr*R + cg*G + cb*B + 128) >> 8) + 128, |sum| < 2^15
+        inline __m128i chroma8(__m128i r, __m128i g, __m128i b, short cr, short cg, short cb)
+        {
+            __m128i c = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)), _mm_mullo_epi16(g, _mm_set1_epi16(cg)));
+            c = _mm_add_epi16(c, _mm_mullo_epi16(b, _mm_set1_epi16(cb)));
+            c = _mm_add_epi16(c, _mm_set1_epi16(128));
+            c = _mm_add_epi16(_mm_srai_epi16(c, 8), _mm_set1_epi16(128));
+            return _mm_packus_epi16(c, c);
+        }
+#endif
+
+        // Rows [y0, y1) of luma, y0 even.
+        void yuv420_rows(const uint8_t* rgba, int w, int h, int y0, int y1, uint8_t* yp, uint8_t* up, uint8_t* vp)
+        {
+            const int cw = (w + 1) / 2;
+
+            for (int y = y0; y < y1; y += 2)
+            {
+                const uint8_t* row0 = rgba + (size_t)y * w * 4;
+                const uint8_t* row1 = (y + 1 < h) ? row0 + (size_t)w * 4 : row0;
+                uint8_t* yrow0 = yp + (size_t)y * w;
+                uint8_t* yrow1 = (y + 1 < h) ? yrow0 + w : nullptr;
+                uint8_t* urow = up + (size_t)(y / 2) * cw;
+                uint8_t* vrow = vp + (size_t)(y / 2) * cw;
+
+                int x = 0;
+#if CAPTURE_SSE2
+                for (; x + 8 <= w; x += 8)
+                {
+                    __m128i r0a, g0a, b0a, r0b, g0b, b0b, r1a, g1a, b1a, r1b, g1b, b1b;
+                    split_rgb(_mm_loadu_si128((const __m128i*)(row0 + x * 4)), r0a, g0a, b0a);
+                    split_rgb(_mm_loadu_si128((const __m128i*)(row0 + x * 4 + 16)), r0b, g0b, b0b);
+                    split_rgb(_mm_loadu_si128((const __m128i*)(row1 + x * 4)), r1a, g1a, b1a);
+                    split_rgb(_mm_loadu_si128((const __m128i*)(row1 + x * 4 + 16)), r1b, g1b, b1b);
+
+                    const __m128i r0 = _mm_packs_epi32(r0a, r0b), g0 = _mm_packs_epi32(g0a, g0b), b0 = _mm_packs_epi32(b0a, b0b);
+                    const __m128i r1 = _mm_packs_epi32(r1a, r1b), g1 = _mm_packs_epi32(g1a, g1b), b1 = _mm_packs_epi32(b1a, b1b);
+
+                    _mm_storel_epi64((__m128i*)(yrow0 + x), luma8(r0, g0, b0));
+                    if (yrow1) _mm_storel_epi64((__m128i*)(yrow1 + x), luma8(r1, g1, b1));
+
+                    // 2x2 sums: add rows, then adjacent pairs (madd by 1), average with rounding
+                    const __m128i one = _mm_set1_epi16(1);
+                    const __m128i two = _mm_set1_epi32(2);
+                    __m128i rs = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_add_epi16(r0, r1), one), two), 2);
+                    __m128i gs = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_add_epi16(g0, g1), one), two), 2);
+                    __m128i bs = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_add_epi16(b0, b1), one), two), 2);
+                    rs = _mm_packs_epi32(rs, rs);
+                    gs = _mm_packs_epi32(gs, gs);
+                    bs = _mm_packs_epi32(bs, bs);
+
+                    const int u4 = _mm_cvtsi128_si32(chroma8(rs, gs, bs, -38, -74, 112));
+                    const int v4 = _mm_cvtsi128_si32(chroma8(rs, gs, bs, 112, -94, -18));
+                    std::memcpy(urow + x / 2, &u4, 4);
+                    std::memcpy(vrow + x / 2, &v4, 4);
+                }
+#endif
+                for (; x < w; x += 2)
+                {
+                    const int x1 = std::min(x + 1, w - 1);
+                    const uint8_t* p00 = row0 + x * 4;
+                    const uint8_t* p01 = row0 + x1 * 4;
+                    const uint8_t* p10 = row1 + x * 4;
+                    const uint8_t* p11 = row1 + x1 * 4;
+
+                    yrow0[x] = yuv_y(p00[0], p00[1], p00[2]);
+                    if (x + 1 < w) yrow0[x + 1] = yuv_y(p01[0], p01[1], p01[2]);
+                    if (yrow1)
+                    {
+                        yrow1[x] = yuv_y(p10[0], p10[1], p10[2]);
+                        if (x + 1 < w) yrow1[x + 1] = yuv_y(p11[0], p11[1], p11[2]);
+                    }
+
+                    const int r = (p00[0] + p01[0] + p10[0] + p11[0] + 2) >> 2;
+                    const int g = (p00[1] + p01[1] + p10[1] + p11[1] + 2) >> 2;
+                    const int b = (p00[2] + p01[2] + p10[2] + p11[2] + 2) >> 2;
+                    urow[x / 2] = yuv_u(r, g, b);
+                    vrow[x / 2] = yuv_v(r, g, b);
+                }
+            }
+        }
+    }
+
+    void rgba_to_yuv420(const uint8_t* rgba, int w, int h, uint8_t* y, uint8_t* u, uint8_t* v)
+    {
+        if (!rgba || w <= 0 || h <= 0) return;
+
+        // Bands of row pairs so chroma rows never straddle two jobs.
+        const int pairs = (h + 1) / 2;
+        parallel_rows(pairs, 16, [&](int p0, int p1)
+            {
+                yuv420_rows(rgba, w, h, p0 * 2, std::min(h, p1 * 2), y, u, v);
+            });
+    }
+
+    // ------------------------------------------------------------
+    // Frame archive
+    // Little-endian throughout.
+    //   file header  : "RFRAMES\0", u32 version, u32 reserved
+    //   per frame    : u32 'FRME', u32 codec, u64 frame index, u32 w, u32 h, u32 payload bytes, payload
+    //   index        : per frame { u64 frame index, u64 record offset, u32 codec, u32 w, u32 h, u32 payload bytes }
+    //   footer       : u64 index offset, u32 frame count, u32 'FIDX'
+    // A run that dies before the footer is written is still readable (records are rescanned).
+    // ------------------------------------------------------------
+    namespace
+    {
+        constexpr char     ARCHIVE_MAGIC[8] = { 'R', 'F', 'R', 'A', 'M', 'E', 'S', 0 };
+        constexpr uint32_t ARCHIVE_VERSION = 1;
+        constexpr uint32_t RECORD_MAGIC = 0x454D5246; // "FRME"
+        constexpr uint32_t INDEX_MAGIC = 0x58444946;  // "FIDX"
+        constexpr size_t   FILE_HEADER_BYTES = 16;
+        constexpr size_t   RECORD_HEADER_BYTES = 32;
+        constexpr size_t   INDEX_ENTRY_BYTES = 32;
+        constexpr size_t   FOOTER_BYTES = 16;
+
+        // Rows per independently compressed band (parallel encode + decode).
+        constexpr int LZ_BAND_ROWS = 32;
+
+        inline void put_le32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (8 * i)); }
+        inline void put_le64(uint8_t* p, uint64_t v) { for (int i = 0; i < 8; ++i) p[i] = (uint8_t)(v >> (8 * i)); }
+        inline uint32_t get_le32(const uint8_t* p) { uint32_t v = 0; for (int i = 3; i >= 0; --i) v = (v << 8) | p[i]; return v; }
+        inline uint64_t get_le64(const uint8_t* p) { uint64_t v = 0; for (int i = 7; i >= 0; --i) v = (v << 8) | p[i]; return v; }
+
+        // -------------------------
+        // LZ: LZ4-style sequences (token = literal count << 4 | match length - 4,
+        // 255-run length extensions, u16 offset). The last sequence is literals only.
+        // -------------------------
+        inline void lz_put_length(std::vector<uint8_t>& out, size_t n)
+        {
+            while (n >= 255) { out.push_back(255); n -= 255; }
+            out.push_back((uint8_t)n);
+        }
+
+        void lz_compress(const uint8_t* src, size_t n, std::vector<uint8_t>& out)
+        {
+            constexpr int HASH_BITS = 14;
+            constexpr size_t MAX_OFFSET = 65535;
+            thread_local std::vector<uint32_t> table;
+            table.assign((size_t)1 << HASH_BITS, 0);
+
+            auto emit = [&](size_t lit_from, size_t lit_to, size_t offset, size_t match_len)
+                {
+                    const size_t lit = lit_to - lit_from;
+                    const size_t ml = match_len ? match_len - 4 : 0;
+                    out.push_back((uint8_t)((std::min<size_t>(lit, 15) << 4) | std::min<size_t>(ml, 15)));
+                    if (lit >= 15) lz_put_length(out, lit - 15);
+                    out.insert(out.end(), src + lit_from, src + lit_to);
+                    if (!match_len) return;
+                    out.push_back((uint8_t)offset);
+                    out.push_back((uint8_t)(offset >> 8));
+                    if (ml >= 15) lz_put_length(out, ml - 15);
+                };
+
+            size_t anchor = 0;
+            size_t i = 0;
+            while (i + 4 <= n)
+            {
+                uint32_t v;
+                std::memcpy(&v, src + i, 4);
+                const uint32_t h = (v * 2654435761u) >> (32 - HASH_BITS);
+                const size_t cand = table[h]; // pos + 1
+                table[h] = (uint32_t)(i + 1);
+
+                if (cand != 0 && i - (cand - 1) <= MAX_OFFSET)
+                {
+                    const size_t m = cand - 1;
+                    uint32_t mv;
+                    std::memcpy(&mv, src + m, 4);
+                    if (mv == v)
+                    {
+                        size_t len = 4;
+                        while (i + len < n && src[m + len] == src[i + len]) ++len;
+                        emit(anchor, i, i - m, len);
+                        i += len;
+                        anchor = i;
+                        continue;
+                    }
+                }
+
+                // Step faster through data that keeps missing (noise, gradients).
+                i += 1 + ((i - anchor) >> 6);
+            }
+            emit(anchor, n, 0, 0);
+        }
+
+        bool lz_decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t dst_n)
+        {
+            const uint8_t* s = src;
+            const uint8_t* s_end = src + n;
+            size_t o = 0;
+
+            auto read_length = [&](size_t& len) -> bool
+                {
+                    for (;;)
+                    {
+                        if (s >= s_end) return false;
+                        const uint8_t b = *s++;
+                        len += b;
+                        if (b != 255) return true;
+                    }
+                };
+
+            while (s < s_end)
+            {
+                const uint8_t token = *s++;
+
+                size_t lit = token >> 4;
+                if (lit == 15 && !read_length(lit)) return false;
+                if ((size_t)(s_end - s) < lit || dst_n - o < lit) return false;
+                std::memcpy(dst + o, s, lit);
+                s += lit;
+                o += lit;
+
+                if (s == s_end) break; // final literal-only sequence
+
+                if (s_end - s < 2) return false;
+                const size_t offset = (size_t)s[0] | ((size_t)s[1] << 8);
+                s += 2;
+
+                size_t len = token & 15;
+                if (len == 15 && !read_length(len)) return false;
+                len += 4;
+
+                if (offset == 0 || offset > o || dst_n - o < len) return false;
+                const uint8_t* from = dst + o - offset;
+                if (offset >= len)
+                {
+                    std::memcpy(dst + o, from, len);
+                }
+                else
+                {
+                    for (size_t k = 0; k < len; ++k) dst[o + k] = from[k]; // overlapping run
+                }
+                o += len;
+            }
+            return o == dst_n;
+        }
+
+        // Codec payloads. LZ: u32 band rows, u32 band count, u32 size per band, band data.
+        // Each band is Up-filtered (row minus the row above, first row of the band as-is)
+        // so bands stay independent.
+        void encode_lz_frame(const uint8_t* rgba, int w, int h, std::vector<uint8_t>& payload)
+        {
+            const size_t row_bytes = (size_t)w * 4;
+            const int bands = (h + LZ_BAND_ROWS - 1) / LZ_BAND_ROWS;
+            std::vector<std::vector<uint8_t>> packed((size_t)bands);
+
+            JobPool::shared().parallel_for(bands, [&](int bi)
+                {
+                    const int y0 = bi * LZ_BAND_ROWS;
+                    const int y1 = std::min(h, y0 + LZ_BAND_ROWS);
+
+                    thread_local std::vector<uint8_t> filtered;
+                    filtered.resize((size_t)(y1 - y0) * row_bytes);
+                    std::memcpy(filtered.data(), rgba + (size_t)y0 * row_bytes, row_bytes);
+                    for (int y = y0 + 1; y < y1; ++y)
+                    {
+                        const uint8_t* cur = rgba + (size_t)y * row_bytes;
+                        const uint8_t* up = cur - row_bytes;
+                        uint8_t* dst = &filtered[(size_t)(y - y0) * row_bytes];
+                        for (size_t i = 0; i < row_bytes; ++i) dst[i] = (uint8_t)(cur[i] - up[i]);
+                    }
+
+                    std::vector<uint8_t>& out = packed[(size_t)bi];
+                    out.clear();
+                    out.reserve(filtered.size() / 2);
+                    lz_compress(filtered.data(), filtered.size(), out);
+                });
+
+            payload.resize(8 + (size_t)bands * 4);
+            put_le32(&payload[0], (uint32_t)LZ_BAND_ROWS);
+            put_le32(&payload[4], (uint32_t)bands);
+            for (int bi = 0; bi < bands; ++bi)
+                put_le32(&payload[8 + (size_t)bi * 4], (uint32_t)packed[(size_t)bi].size());
+            for (const auto& b : packed)
+                payload.insert(payload.end(), b.begin(), b.end());
+        }
+
+        bool decode_lz_frame(const uint8_t* payload, size_t n, int w, int h, uint8_t* rgba)
+        {
+            if (n < 8) return false;
+            const int band_rows = (int)get_le32(payload);
+            const int bands = (int)get_le32(payload + 4);
+            if (band_rows <= 0 || bands != (h + band_rows - 1) / band_rows) return false;
+            if (n < 8 + (size_t)bands * 4) return false;
+
+            std::vector<size_t> offsets((size_t)bands + 1);
+            offsets[0] = 8 + (size_t)bands * 4;
+            for (int bi = 0; bi < bands; ++bi)
+                offsets[(size_t)bi + 1] = offsets[(size_t)bi] + get_le32(payload + 8 + (size_t)bi * 4);
+            if (offsets.back() > n) return false;
+
+            const size_t row_bytes = (size_t)w * 4;
+            std::atomic<bool> ok{ true };
+
+            JobPool::shared().parallel_for(bands, [&](int bi)
+                {
+                    const int y0 = bi * band_rows;
+                    const int y1 = std::min(h, y0 + band_rows);
+                    uint8_t* dst = rgba + (size_t)y0 * row_bytes;
+
+                    if (!lz_decompress(payload + offsets[(size_t)bi], offsets[(size_t)bi + 1] - offsets[(size_t)bi],
+                        dst, (size_t)(y1 - y0) * row_bytes))
+                    {
+                        ok = false;
+                        return;
+                    }
+
+                    for (int y = y0 + 1; y < y1; ++y)
+                    {
+                        uint8_t* cur = rgba + (size_t)y * row_bytes;
+                        const uint8_t* up = cur - row_bytes;
+                        for (size_t i = 0; i < row_bytes; ++i) cur[i] = (uint8_t)(cur[i] + up[i]);
+                    }
+                });
+
+            return ok.load();
+        }
+
+        // -------------------------
+        // Tile deltas (Repeat / Tiles records)
+        // Tiles payload: u32 tile size, u32 changed count, u32 tile id per changed tile
+        // (row-major), then the changed tiles' pixels (edge tiles clipped) as one LZ block.
+        // -------------------------
+        constexpr int DELTA_TILE = 32;
+
+        inline uint64_t hash_bytes(const uint8_t* p, size_t n, uint64_t h)
+        {
+            constexpr uint64_t K = 0x9E3779B97F4A7C15ull;
+            for (; n >= 8; p += 8, n -= 8)
+            {
+                uint64_t v;
+                std::memcpy(&v, p, 8);
+                h = (h ^ v) * K;
+                h ^= h >> 29;
+            }
+            for (; n > 0; ++p, --n)
+            {
+                h = (h ^ *p) * K;
+                h ^= h >> 29;
+            }
+            return h;
+        }
+
+        struct TileGrid
+        {
+            int tiles_x = 0, tiles_y = 0;
+            int count() const { return tiles_x * tiles_y; }
+            TileGrid(int w, int h) : tiles_x((w + DELTA_TILE - 1) / DELTA_TILE), tiles_y((h + DELTA_TILE - 1) / DELTA_TILE) {}
+        };
+
+        void hash_tiles(const uint8_t* rgba, int w, int h, std::vector<uint64_t>& out)
+        {
+            const TileGrid grid(w, h);
+            out.resize((size_t)grid.count());
+
+            parallel_rows(grid.tiles_y, 1, [&](int ty0, int ty1)
+                {
+                    for (int ty = ty0; ty < ty1; ++ty)
+                    {
+                        const int y0 = ty * DELTA_TILE;
+                        const int y1 = std::min(h, y0 + DELTA_TILE);
+                        for (int tx = 0; tx < grid.tiles_x; ++tx)
+                        {
+                            const int x0 = tx * DELTA_TILE;
+                            const size_t bytes = (size_t)(std::min(w, x0 + DELTA_TILE) - x0) * 4;
+                            uint64_t hv = 0x243F6A8885A308D3ull;
+                            for (int y = y0; y < y1; ++y)
+                                hv = hash_bytes(rgba + ((size_t)y * w + x0) * 4, bytes, hv);
+                            out[(size_t)ty * grid.tiles_x + tx] = hv;
+                        }
+                    }
+                });
+        }
+
+        struct TileRect
+        {
+            int x0, y0, y1;
+            size_t row_bytes;
+            size_t bytes() const { return row_bytes * (size_t)(y1 - y0); }
+        };
+
+        TileRect tile_rect(int w, int h, int id)
+        {
+            const TileGrid grid(w, h);
+            TileRect r;
+            r.x0 = (id % grid.tiles_x) * DELTA_TILE;
+            r.y0 = (id / grid.tiles_x) * DELTA_TILE;
+            r.y1 = std::min(h, r.y0 + DELTA_TILE);
+            r.row_bytes = (size_t)(std::min(w, r.x0 + DELTA_TILE) - r.x0) * 4;
+            return r;
+        }
+
+        size_t pack_tile(const uint8_t* frame, int w, int h, int id, uint8_t* packed)
+        {
+            const TileRect r = tile_rect(w, h, id);
+            for (int y = r.y0; y < r.y1; ++y, packed += r.row_bytes)
+                std::memcpy(packed, frame + ((size_t)y * w + r.x0) * 4, r.row_bytes);
+            return r.bytes();
+        }
+
+        size_t unpack_tile(uint8_t* frame, int w, int h, int id, const uint8_t* packed)
+        {
+            const TileRect r = tile_rect(w, h, id);
+            for (int y = r.y0; y < r.y1; ++y, packed += r.row_bytes)
+                std::memcpy(frame + ((size_t)y * w + r.x0) * 4, packed, r.row_bytes);
+            return r.bytes();
+        }
+
+        void encode_tiles_frame(const uint8_t* rgba, int w, int h, const std::vector<int>& changed, std::vector<uint8_t>& payload)
+        {
+            thread_local std::vector<uint8_t> packed;
+            packed.resize((size_t)changed.size() * DELTA_TILE * DELTA_TILE * 4);
+            size_t n = 0;
+            for (int id : changed)
+                n += pack_tile(rgba, w, h, id, packed.data() + n);
+
+            payload.resize(8 + changed.size() * 4);
+            put_le32(&payload[0], (uint32_t)DELTA_TILE);
+            put_le32(&payload[4], (uint32_t)changed.size());
+            for (size_t i = 0; i < changed.size(); ++i)
+                put_le32(&payload[8 + i * 4], (uint32_t)changed[i]);
+            lz_compress(packed.data(), n, payload);
+        }
+
+        // Applies a Tiles payload on top of the previous frame in `rgba`.
+        bool apply_tiles_frame(const uint8_t* payload, size_t n, int w, int h, uint8_t* rgba)
+        {
+            if (n < 8 || get_le32(payload) != (uint32_t)DELTA_TILE) return false;
+            const size_t changed = get_le32(payload + 4);
+            const TileGrid grid(w, h);
+            if (changed > (size_t)grid.count() || n < 8 + changed * 4) return false;
+
+            size_t unpacked = 0;
+            for (size_t i = 0; i < changed; ++i)
+            {
+                const uint32_t id = get_le32(payload + 8 + i * 4);
+                if (id >= (uint32_t)grid.count()) return false;
+                unpacked += tile_rect(w, h, (int)id).bytes();
+            }
+
+            thread_local std::vector<uint8_t> packed;
+            packed.resize(unpacked);
+            const size_t head = 8 + changed * 4;
+            if (!lz_decompress(payload + head, n - head, packed.data(), unpacked)) return false;
+
+            size_t off = 0;
+            for (size_t i = 0; i < changed; ++i)
+                off += unpack_tile(rgba, w, h, (int)get_le32(payload + 8 + i * 4), packed.data() + off);
+            return true;
+        }
+    }
+
+    namespace
+    {
+        FILE* g_stream_stdout = nullptr; // the original stdout, see reserve_stdout_for_streams
+    }
+
+    bool reserve_stdout_for_streams()
+    {
+        if (g_stream_stdout) return true;
+        std::fflush(stdout);
+#ifdef _WIN32
+        const int fd = _dup(_fileno(stdout));
+        if (fd < 0) return false;
+        _setmode(fd, _O_BINARY);
+        FILE* f = _fdopen(fd, "wb");
+        if (!f) { _close(fd); return false; }
+        if (_dup2(_fileno(stderr), _fileno(stdout)) != 0) { std::fclose(f); return false; }
+#else
+        const int fd = dup(fileno(stdout));
+        if (fd < 0) return false;
+        FILE* f = fdopen(fd, "wb");
+        if (!f) { close(fd); return false; }
+        if (dup2(fileno(stderr), fileno(stdout)) < 0) { std::fclose(f); return false; }
+#endif
+        g_stream_stdout = f;
+        return true;
+    }
+
+    struct CaptureStream::Impl
+    {
+        std::string path;
+        StreamFormat format = StreamFormat::RawRgba;
+        int w = 0, h = 0;
+        StreamOptions options;
+        FILE* file = nullptr;
+        bool to_stdout = false;
+        std::atomic<bool> failed{ false };
+
+        // writer thread only
+        std::vector<uint8_t> yuv;
+        std::vector<uint8_t> record;
+        std::vector<FrameArchiveEntry> index;
+        uint64_t offset = 0;
+
+        // tile hashes of the last archived frame (delta mode)
+        std::vector<uint64_t> prev_hashes, cur_hashes;
+        std::vector<int> changed;
+        int since_keyframe = 0;
+        bool have_prev = false;
+
+        std::unique_ptr<CaptureQueue> queue;
+
+        bool put(const void* data, size_t bytes)
+        {
+            if (std::fwrite(data, 1, bytes, file) != bytes)
+            {
+                failed = true;
+                std::lock_guard<std::mutex> lk(g_log_mutex);
+                std::cerr << "[Engine] Capture stream write failed, dropping further frames: " << path << "\n";
+                return false;
+            }
+            offset += bytes;
+            return true;
+        }
+
+        bool write_archive_record(const CaptureFrame& frame)
+        {
+            FrameArchiveEntry e;
+            e.frame_index = frame.index;
+            e.offset = offset;
+            e.w = frame.w;
+            e.h = frame.h;
+
+            // Payload after a header-sized gap, so one fwrite covers the record.
+            record.resize(RECORD_HEADER_BYTES);
+
+            // Delta mode: compare tile hashes with the previous frame; unchanged frames become
+            // Repeat records, small changes Tiles records. Keyframes bound the replay on seek.
+            bool keyframe = true;
+            if (options.delta)
+            {
+                hash_tiles(frame.rgba.data(), frame.w, frame.h, cur_hashes);
+
+                if (have_prev && since_keyframe < options.keyframe_interval && cur_hashes.size() == prev_hashes.size()
+                    && !index.empty() && index.back().w == frame.w && index.back().h == frame.h)
+                {
+                    changed.clear();
+                    for (size_t t = 0; t < cur_hashes.size(); ++t)
+                        if (cur_hashes[t] != prev_hashes[t]) changed.push_back((int)t);
+
+                    if (changed.empty())
+                    {
+                        e.codec = ArchiveCodec::Repeat;
+                        keyframe = false;
+                    }
+                    else if (changed.size() * 2 <= cur_hashes.size())
+                    {
+                        e.codec = ArchiveCodec::Tiles;
+                        thread_local std::vector<uint8_t> payload;
+                        encode_tiles_frame(frame.rgba.data(), frame.w, frame.h, changed, payload);
+                        record.insert(record.end(), payload.begin(), payload.end());
+                        keyframe = false;
+                    }
+                }
+
+                prev_hashes.swap(cur_hashes);
+                have_prev = true;
+                since_keyframe = keyframe ? 0 : since_keyframe + 1;
+            }
+
+            if (keyframe && options.compress)
+            {
+                e.codec = ArchiveCodec::Lz;
+                thread_local std::vector<uint8_t> payload;
+                encode_lz_frame(frame.rgba.data(), frame.w, frame.h, payload);
+                record.insert(record.end(), payload.begin(), payload.end());
+            }
+            else if (keyframe)
+            {
+                e.codec = ArchiveCodec::Raw;
+                record.insert(record.end(), frame.rgba.begin(), frame.rgba.end());
+            }
+            e.payload_bytes = (uint32_t)(record.size() - RECORD_HEADER_BYTES);
+
+            uint8_t* p = record.data();
+            put_le32(p, RECORD_MAGIC);
+            put_le32(p + 4, (uint32_t)e.codec);
+            put_le64(p + 8, e.frame_index);
+            put_le32(p + 16, (uint32_t)e.w);
+            put_le32(p + 20, (uint32_t)e.h);
+            put_le32(p + 24, e.payload_bytes);
+            put_le32(p + 28, 0);
+
+            if (!put(record.data(), record.size())) return false;
+            index.push_back(e);
+            return true;
+        }
+
+        void write_archive_index()
+        {
+            std::vector<uint8_t> tail(index.size() * INDEX_ENTRY_BYTES + FOOTER_BYTES);
+            uint8_t* p = tail.data();
+            for (const FrameArchiveEntry& e : index)
+            {
+                put_le64(p, e.frame_index);
+                put_le64(p + 8, e.offset);
+                put_le32(p + 16, (uint32_t)e.codec);
+                put_le32(p + 20, (uint32_t)e.w);
+                put_le32(p + 24, (uint32_t)e.h);
+                put_le32(p + 28, e.payload_bytes);
+                p += INDEX_ENTRY_BYTES;
+            }
+            put_le64(p, offset);
+            put_le32(p + 8, (uint32_t)index.size());
+            put_le32(p + 12, INDEX_MAGIC);
+            put(tail.data(), tail.size());
+        }
+
+        bool write(const CaptureFrame& frame)
+        {
+            if (failed.load()) return false;
+
+            if (format == StreamFormat::Archive)
+                return write_archive_record(frame);
+
+            const uint8_t* data = frame.rgba.data();
+            size_t bytes = frame.rgba.size();
+
+            if (format == StreamFormat::Y4m)
+            {
+                static const char tag[] = "FRAME\n";
+                const size_t luma = (size_t)w * h;
+                const size_t chroma = (size_t)((w + 1) / 2) * ((h + 1) / 2);
+                yuv.resize(sizeof(tag) - 1 + luma + chroma * 2);
+                std::memcpy(yuv.data(), tag, sizeof(tag) - 1);
+
+                uint8_t* yp = yuv.data() + sizeof(tag) - 1;
+                rgba_to_yuv420(data, w, h, yp, yp + luma, yp + luma + chroma);
+                data = yuv.data();
+                bytes = yuv.size();
+            }
+
+            return put(data, bytes);
+        }
+    };
+
+    CaptureStream::CaptureStream(const std::string& p, StreamFormat format, int w, int h, const StreamOptions& options)
+        : impl_(new Impl())
+    {
+        impl_->path = p;
+        impl_->format = format;
+        impl_->w = w;
+        impl_->h = h;
+        impl_->options = options;
+        impl_->options.keyframe_interval = std::max(1, options.keyframe_interval);
+
+        impl_->to_stdout = std::filesystem::path(p).stem() == "-";
+        if (impl_->to_stdout && g_stream_stdout)
+        {
+            impl_->file = g_stream_stdout;
+        }
+        else if (impl_->to_stdout)
+        {
+#ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            impl_->file = stdout;
+        }
+        else
+        {
+            impl_->file = std::fopen(p.c_str(), "wb");
+        }
+
+        if (!impl_->file || w <= 0 || h <= 0)
+        {
+            std::cerr << "[Engine] Failed to open capture stream: " << p << "\n";
+            impl_->failed = true;
+            return;
+        }
+
+        if (format == StreamFormat::Y4m)
+        {
+            char header[96];
+            const int n = std::snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", w, h, std::max(1, options.fps));
+            impl_->put(header, (size_t)n);
+        }
+        else if (format == StreamFormat::Archive)
+        {
+            uint8_t header[FILE_HEADER_BYTES] = {};
+            std::memcpy(header, ARCHIVE_MAGIC, 8);
+            put_le32(header + 8, ARCHIVE_VERSION);
+            impl_->put(header, sizeof(header));
+        }
+
+        impl_->queue = std::make_unique<CaptureQueue>(1, 3, [impl = impl_](const CaptureFrame& f) { return impl->write(f); });
+
+        // stderr: stdout may be the stream itself.
+        static const char* const names[] = { "raw RGBA", "Y4M", "frame archive" };
+        std::cerr << "[Engine] Streaming " << names[(int)format]
+                  << " " << w << "x" << h << " to " << (impl_->to_stdout ? std::string("stdout") : p) << "\n";
+    }
+
+    CaptureStream::~CaptureStream()
+    {
+        impl_->queue.reset(); // drains pending frames
+        if (impl_->file)
+        {
+            if (impl_->format == StreamFormat::Archive && !impl_->failed.load())
+                impl_->write_archive_index();
+
+            if (impl_->to_stdout) std::fflush(impl_->file);
+            else std::fclose(impl_->file);
+        }
+        delete impl_;
+    }
+
+    bool CaptureStream::ok() const { return impl_->queue && !impl_->failed.load(); }
+    int CaptureStream::width() const { return impl_->w; }
+    int CaptureStream::height() const { return impl_->h; }
+
+    std::vector<uint8_t> CaptureStream::acquire_buffer()
+    {
+        const size_t bytes = (size_t)impl_->w * impl_->h * 4;
+        if (!impl_->queue) return std::vector<uint8_t>(bytes);
+        return impl_->queue->acquire_buffer(bytes);
+    }
+
+    void CaptureStream::submit(std::vector<uint8_t>&& rgba, uint64_t frame_index)
+    {
+        if (!ok()) return;
+
+        CaptureFrame frame;
+        frame.index = frame_index;
+        frame.path = impl_->path;
+        frame.w = impl_->w;
+        frame.h = impl_->h;
+        frame.rgba = std::move(rgba);
+        impl_->queue->submit(std::move(frame));
+    }
+
+    void CaptureStream::flush()
+    {
+        if (!impl_->queue) return;
+        impl_->queue->flush();
+        std::fflush(impl_->file);
+    }
+
+    // ------------------------------------------------------------
+    // Frame archive reading
+    // ------------------------------------------------------------
+    struct FrameArchiveReader::Impl
+    {
+        std::ifstream file;
+        std::vector<FrameArchiveEntry> entries;
+
+        // Last frame produced by read_frame(), so sequential reads of delta frames
+        // apply one record each instead of replaying from the keyframe.
+        size_t cached = SIZE_MAX;
+        std::vector<uint8_t> cached_rgba;
+
+        bool decode_record(size_t i, std::vector<uint8_t>& rgba)
+        {
+            const FrameArchiveEntry& e = entries[i];
+            if (e.w <= 0 || e.h <= 0) return false;
+
+            thread_local std::vector<uint8_t> payload;
+            payload.resize(e.payload_bytes);
+            if (!read_at(e.offset + RECORD_HEADER_BYTES, payload.data(), payload.size())) return false;
+
+            const size_t bytes = (size_t)e.w * e.h * 4;
+
+            switch (e.codec)
+            {
+            case ArchiveCodec::Raw:
+                if (payload.size() != bytes) return false;
+                rgba.assign(payload.begin(), payload.end());
+                return true;
+            case ArchiveCodec::Lz:
+                rgba.resize(bytes);
+                return decode_lz_frame(payload.data(), payload.size(), e.w, e.h, rgba.data());
+            case ArchiveCodec::Repeat:
+                return rgba.size() == bytes;
+            case ArchiveCodec::Tiles:
+                return rgba.size() == bytes && apply_tiles_frame(payload.data(), payload.size(), e.w, e.h, rgba.data());
+            default:
+                return false;
+            }
+        }
+
+        bool read_at(uint64_t offset, uint8_t* dst, size_t n)
+        {
+            file.clear();
+            file.seekg((std::streamoff)offset);
+            return (bool)file.read(reinterpret_cast<char*>(dst), (std::streamsize)n);
+        }
+
+        bool load_index(uint64_t file_size)
+        {
+            if (file_size < FILE_HEADER_BYTES + FOOTER_BYTES) return false;
+
+            uint8_t footer[FOOTER_BYTES];
+            if (!read_at(file_size - FOOTER_BYTES, footer, FOOTER_BYTES)) return false;
+            if (get_le32(footer + 12) != INDEX_MAGIC) return false;
+
+            const uint64_t index_offset = get_le64(footer);
+            const uint32_t count = get_le32(footer + 8);
+            if (index_offset + (uint64_t)count * INDEX_ENTRY_BYTES + FOOTER_BYTES != file_size) return false;
+
+            std::vector<uint8_t> raw((size_t)count * INDEX_ENTRY_BYTES);
+            if (count && !read_at(index_offset, raw.data(), raw.size())) return false;
+
+            entries.resize(count);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const uint8_t* p = &raw[(size_t)i * INDEX_ENTRY_BYTES];
+                FrameArchiveEntry& e = entries[i];
+                e.frame_index = get_le64(p);
+                e.offset = get_le64(p + 8);
+                e.codec = (ArchiveCodec)get_le32(p + 16);
+                e.w = (int)get_le32(p + 20);
+                e.h = (int)get_le32(p + 24);
+                e.payload_bytes = get_le32(p + 28);
+            }
+            return true;
+        }
+
+        // No footer (interrupted run): walk the records.
+        void scan_records(uint64_t file_size)
+        {
+            entries.clear();
+            uint64_t off = FILE_HEADER_BYTES;
+            uint8_t hdr[RECORD_HEADER_BYTES];
+            while (off + RECORD_HEADER_BYTES <= file_size && read_at(off, hdr, RECORD_HEADER_BYTES))
+            {
+                if (get_le32(hdr) != RECORD_MAGIC) break;
+
+                FrameArchiveEntry e;
+                e.offset = off;
+                e.codec = (ArchiveCodec)get_le32(hdr + 4);
+                e.frame_index = get_le64(hdr + 8);
+                e.w = (int)get_le32(hdr + 16);
+                e.h = (int)get_le32(hdr + 20);
+                e.payload_bytes = get_le32(hdr + 24);
+
+                const uint64_t next = off + RECORD_HEADER_BYTES + e.payload_bytes;
+                if (next > file_size) break; // truncated last frame
+                entries.push_back(e);
+                off = next;
+            }
+        }
+    };
+
+    FrameArchiveReader::FrameArchiveReader() : impl_(new Impl()) {}
+    FrameArchiveReader::~FrameArchiveReader() { delete impl_; }
+
+    bool FrameArchiveReader::open(const std::string& path)
+    {
+        impl_->entries.clear();
+        impl_->file = std::ifstream(path, std::ios::binary | std::ios::ate);
+        if (!impl_->file) return false;
+
+        const uint64_t file_size = (uint64_t)impl_->file.tellg();
+
+        uint8_t hdr[FILE_HEADER_BYTES];
+        if (file_size < FILE_HEADER_BYTES || !impl_->read_at(0, hdr, FILE_HEADER_BYTES)) return false;
+        if (std::memcmp(hdr, ARCHIVE_MAGIC, 8) != 0 || get_le32(hdr + 8) != ARCHIVE_VERSION) return false;
+
+        if (!impl_->load_index(file_size))
+        {
+            std::cerr << "[Engine] Frame archive has no index (interrupted run?), scanning: " << path << "\n";
+            impl_->scan_records(file_size);
+        }
+        return true;
+    }
+
+    size_t FrameArchiveReader::frame_count() const { return impl_->entries.size(); }
+    const FrameArchiveEntry& FrameArchiveReader::entry(size_t i) const { return impl_->entries[i]; }
+
+    bool FrameArchiveReader::read_frame(size_t i, std::vector<uint8_t>& rgba)
+    {
+        if (i >= impl_->entries.size()) return false;
+
+        // Replay from the closest keyframe at or before i (or from the cached frame).
+        size_t start = i;
+        while (start > 0 && !archive_codec_is_keyframe(impl_->entries[start].codec)) --start;
+
+        size_t from = start;
+        if (impl_->cached != SIZE_MAX && impl_->cached >= start && impl_->cached <= i)
+            from = impl_->cached + 1;
+        else
+            impl_->cached = SIZE_MAX;
+
+        std::vector<uint8_t>& cur = impl_->cached_rgba;
+        for (size_t k = from; k <= i; ++k)
+        {
+            if (!impl_->decode_record(k, cur))
+            {
+                impl_->cached = SIZE_MAX;
+                return false;
+            }
+            impl_->cached = k;
+        }
+
+        rgba.assign(cur.begin(), cur.end());
+        return true;
+    }
+
+    bool extract_frame_archive(const std::string& archive_path, const std::string& out_dir, size_t first, size_t count)
+    {
+        FrameArchiveReader reader;
+        if (!reader.open(archive_path))
+        {
+            std::cerr << "[Engine] Not a frame archive: " << archive_path << "\n";
+            return false;
+        }
+
+        const size_t end = std::min(reader.frame_count(), first + std::min(count, reader.frame_count()));
+        std::cout << "[Engine] " << archive_path << ": " << reader.frame_count() << " frames, extracting ["
+                  << first << ", " << end << ")\n";
+
+        std::error_code ec;
+        std::filesystem::create_directories(out_dir, ec);
+
+        const int threads = std::clamp((int)std::thread::hardware_concurrency(), 1, 8);
+        CaptureQueue queue(threads, threads * 2);
+
+        bool ok = true;
+        for (size_t i = first; i < end; ++i)
+        {
+            const FrameArchiveEntry& e = reader.entry(i);
+
+            CaptureFrame frame;
+            frame.w = e.w;
+            frame.h = e.h;
+            frame.rgba = queue.acquire_buffer((size_t)e.w * e.h * 4);
+            if (!reader.read_frame(i, frame.rgba))
+            {
+                std::cerr << "[Engine] Corrupt frame " << i << " in " << archive_path << "\n";
+                ok = false;
+                continue;
+            }
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "frame_%06llu.png", (unsigned long long)e.frame_index);
+            frame.path = (std::filesystem::path(out_dir) / name).string();
+            queue.submit(std::move(frame));
+        }
+        queue.flush();
+        return ok;
+    }
+}
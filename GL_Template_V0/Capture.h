@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Engine_
+{
+    // ------------------------------------------------------------
+    // Capture file formats
+    // ------------------------------------------------------------
+    enum class CaptureFormat
+    {
+        Png,     // stb_image_write (smallest files, slowest)
+        PngFast, // banded parallel deflate, fixed Huffman ("name.fpng" hint, writes .png)
+        Qoi      // "name.qoi"
+    };
+
+    // Format selected by a capture hint's extension, and the extension files get on disk.
+    CaptureFormat capture_format_for(const std::string& extension);
+    std::string capture_output_extension(const std::string& extension);
+
+    // Encoders append a complete file image to `out` (cleared first). RGBA8, tightly packed.
+    bool encode_png(const uint8_t* rgba, int w, int h, std::vector<uint8_t>& out);
+    bool encode_png_fast(const uint8_t* rgba, int w, int h, std::vector<uint8_t>& out);
+    bool encode_qoi(const uint8_t* rgba, int w, int h, std::vector<uint8_t>& out);
+    bool encode_frame(CaptureFormat format, const uint8_t* rgba, int w, int h, std::vector<uint8_t>& out);
+
+    // ------------------------------------------------------------
+    // Background frame capture.
+    // The render thread copies the finished frame into a recycled buffer and
+    // queues it; encoder threads write the files. submit() blocks while
+    // max_pending frames are in flight (backpressure), and flush() / the
+    // destructor wait until every queued frame is on disk.
+    // ------------------------------------------------------------
+    struct CaptureFrame
+    {
+        CaptureFormat format = CaptureFormat::Png;
+        std::string path;
+        uint64_t index = 0; // frame_index() at save time
+        int w = 0;
+        int h = 0;
+        std::vector<uint8_t> rgba; // w*h*4, owned by the frame
+    };
+
+    // Synchronous encode + write (what the encoder threads run). Logs the result.
+    bool write_capture_frame(const CaptureFrame& frame);
+
+    class CaptureQueue
+    {
+    public:
+        using Writer = std::function<bool(const CaptureFrame&)>;
+
+        // With one encoder thread frames are written in submit order.
+        CaptureQueue(int encoder_threads, int max_pending, Writer writer = write_capture_frame);
+        ~CaptureQueue();
+
+        CaptureQueue(const CaptureQueue&) = delete;
+        CaptureQueue& operator=(const CaptureQueue&) = delete;
+
+        // Pixel buffer for the next frame, reused from finished frames when possible.
+        std::vector<uint8_t> acquire_buffer(size_t bytes);
+
+        void submit(CaptureFrame&& frame);
+        void flush();
+
+    private:
+        struct Impl;
+        Impl* impl_ = nullptr;
+    };
+
+    // ------------------------------------------------------------
+    // Video streams: every frame appended to one file / named pipe / stdout,
+    // ready for ffmpeg without per-frame files or PNG round trips.
+    //   .rgba -> raw RGBA8 (ffmpeg -f rawvideo -pix_fmt rgba -s WxH -r FPS -i ...)
+    //   .y4m  -> YUV4MPEG2, 4:2:0, BT.601 limited range (ffmpeg -i ...)
+    //   .frames -> indexed frame archive (below), lossless, optionally LZ compressed
+    // A path whose stem is "-" ("-.y4m") writes to stdout.
+    // ------------------------------------------------------------
+    enum class StreamFormat
+    {
+        RawRgba,
+        Y4m,
+        Archive
+    };
+
+    bool stream_format_for(const std::string& extension, StreamFormat& out);
+
+    // For "-" streams: keeps the process's stdout for the stream and points fd 1
+    // at stderr, so log lines and Lua print() cannot end up inside the video.
+    // Call before anything is printed. False if the descriptors could not be moved.
+    bool reserve_stdout_for_streams();
+
+    // Planar 4:2:0 (chroma planes are ((w+1)/2) x ((h+1)/2), 2x2 averaged).
+    void rgba_to_yuv420(const uint8_t* rgba, int w, int h, uint8_t* y, uint8_t* u, uint8_t* v);
+
+    struct StreamOptions
+    {
+        int  fps = 60;               // Y4M header
+        bool compress = true;        // archives: LZ keyframes (raw otherwise)
+        bool delta = true;           // archives: Repeat / changed-tile records between keyframes
+        int  keyframe_interval = 120; // archives: max delta records in a row (bounds seek replay)
+    };
+
+    class CaptureStream
+    {
+    public:
+        CaptureStream(const std::string& path, StreamFormat format, int w, int h, const StreamOptions& options = {});
+        ~CaptureStream(); // writes pending frames, closes the file
+
+        CaptureStream(const CaptureStream&) = delete;
+        CaptureStream& operator=(const CaptureStream&) = delete;
+
+        bool ok() const; // opened, and no write has failed
+        int width() const;
+        int height() const;
+
+        std::vector<uint8_t> acquire_buffer();   // w*h*4
+        void submit(std::vector<uint8_t>&& rgba, uint64_t frame_index = 0); // frames keep their order
+        void flush();
+
+    private:
+        struct Impl;
+        Impl* impl_ = nullptr;
+    };
+
+    // ------------------------------------------------------------
+    // Frame archive (.frames): one append-only file per capture run.
+    // Every frame is a self-describing record; closing the stream appends an
+    // index + footer so any frame can be located without scanning. Layout in
+    // Capture.cpp.
+    // ------------------------------------------------------------
+    enum class ArchiveCodec : uint32_t
+    {
+        Raw = 0,    // RGBA8 as-is
+        Lz = 1,     // row-delta + LZ, in independently decodable bands
+        Repeat = 2, // identical to the previous frame (no payload)
+        Tiles = 3   // only the 32x32 tiles that changed since the previous frame
+    };
+
+    inline bool archive_codec_is_keyframe(ArchiveCodec c) { return c == ArchiveCodec::Raw || c == ArchiveCodec::Lz; }
+
+    struct FrameArchiveEntry
+    {
+        uint64_t frame_index = 0; // engine frame index when saved
+        uint64_t offset = 0;      // record position in the file
+        ArchiveCodec codec = ArchiveCodec::Raw;
+        int w = 0;
+        int h = 0;
+        uint32_t payload_bytes = 0;
+    };
+
+    class FrameArchiveReader
+    {
+    public:
+        FrameArchiveReader();
+        ~FrameArchiveReader();
+
+        FrameArchiveReader(const FrameArchiveReader&) = delete;
+        FrameArchiveReader& operator=(const FrameArchiveReader&) = delete;
+
+        // Uses the trailing index; archives from interrupted runs are rescanned.
+        bool open(const std::string& path);
+
+        size_t frame_count() const;
+        const FrameArchiveEntry& entry(size_t i) const;
+
+        // i-th stored frame (not frame_index) as RGBA8, w*h*4. Delta records replay from
+        // their keyframe; reading in order costs one record per frame.
+        bool read_frame(size_t i, std::vector<uint8_t>& rgba);
+
+    private:
+        struct Impl;
+        Impl* impl_ = nullptr;
+    };
+
+    // Writes frames [first, first + count) as out_dir/frame_<frame_index>.png.
+    bool extract_frame_archive(const std::string& archive_path, const std::string& out_dir,
+        size_t first = 0, size_t count = SIZE_MAX);
+}
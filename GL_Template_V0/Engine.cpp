@@ -3,14 +3,28 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cctype>
 #include <cmath>
 #include <chrono>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <sstream>
+#include <thread>
 #include <cstring>
 
+#include "JobPool.h"
+#include "Capture.h"
+
+// SSE2 is baseline on x64; the scalar path keeps other targets building.
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENGINE_SSE2 1
+#include <emmintrin.h>
+#else
+#define ENGINE_SSE2 0
+#endif
 
 // -----------------------------
 // OpenGL / GLFW / GLEW
@@ -28,6 +42,8 @@
 
 namespace fs = std::filesystem;
 
+namespace Engine_ { class Context; }
+
 namespace
 {
     // -------------------------
@@ -42,8 +58,60 @@ namespace
         return (uint8_t)clampi(v, 0, 255);
     }
 
+    // -------------------------
+    // 4-wide float ops (one RGBA texel per register)
+    // -------------------------
+#if ENGINE_SSE2
+    using f4 = __m128;
+    static inline f4 f4_zero() { return _mm_setzero_ps(); }
+    static inline f4 f4_set1(float s) { return _mm_set1_ps(s); }
+    static inline f4 f4_load(const float* p) { return _mm_loadu_ps(p); }
+    static inline void f4_store(float* p, f4 v) { _mm_storeu_ps(p, v); }
+    static inline f4 f4_add(f4 a, f4 b) { return _mm_add_ps(a, b); }
+    static inline f4 f4_sub(f4 a, f4 b) { return _mm_sub_ps(a, b); }
+    static inline f4 f4_mul(f4 a, f4 b) { return _mm_mul_ps(a, b); }
+    static inline f4 f4_sqrt01(f4 a) { return _mm_sqrt_ps(_mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f))); }
+
+    static inline f4 f4_from_rgba8(const uint8_t* p)
+    {
+        int32_t packed;
+        std::memcpy(&packed, p, 4);
+        const __m128i z = _mm_setzero_si128();
+        __m128i v = _mm_cvtsi32_si128(packed);
+        v = _mm_unpacklo_epi8(v, z);
+        v = _mm_unpacklo_epi16(v, z);
+        return _mm_cvtepi32_ps(v);
+    }
+
+    // Same result as to_u8() per channel (round half up on the clamped value).
+    static inline void f4_to_rgba8(f4 v01, uint8_t* p)
+    {
+        v01 = _mm_min_ps(_mm_max_ps(v01, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        __m128i i = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v01, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+        i = _mm_packs_epi32(i, i);
+        i = _mm_packus_epi16(i, i);
+        const int32_t packed = _mm_cvtsi128_si32(i);
+        std::memcpy(p, &packed, 4);
+    }
+#else
+    struct f4 { float v[4]; };
+    static inline f4 f4_zero() { return { { 0, 0, 0, 0 } }; }
+    static inline f4 f4_set1(float s) { return { { s, s, s, s } }; }
+    static inline f4 f4_load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    static inline void f4_store(float* p, f4 v) { std::memcpy(p, v.v, sizeof(v.v)); }
+    static inline f4 f4_add(f4 a, f4 b) { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+    static inline f4 f4_sub(f4 a, f4 b) { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+    static inline f4 f4_mul(f4 a, f4 b) { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+    static inline f4 f4_sqrt01(f4 a) { for (int i = 0; i < 4; ++i) a.v[i] = std::sqrt(clampf(a.v[i], 0.0f, 1.0f)); return a; }
+    static inline f4 f4_from_rgba8(const uint8_t* p) { return { { (float)p[0], (float)p[1], (float)p[2], (float)p[3] } }; }
+    static inline void f4_to_rgba8(f4 v01, uint8_t* p) { for (int i = 0; i < 4; ++i) p[i] = to_u8(v01.v[i]); }
+#endif
+    static inline f4 f4_madd(f4 acc, f4 a, f4 b) { return f4_add(acc, f4_mul(a, b)); }
+
     static inline float srgb_to_lin(float c) { return c; } // keep simple; tone controls handle look
-    static inline float lin_to_srgb(float c) { return c; } // (you can upgrade later)
+
+    // Display encode after tone mapping. Only evaluated while building the tone LUT.
+    static inline float lin_to_srgb(float c, float inv_gamma) { return std::pow(clampf(c, 0.0f, 1.0f), inv_gamma); }
 
     // CPU framebuffer is top-left origin: y=0 at top.
     static inline size_t idx_rgba(int w, int x, int y) { return (size_t)((y * w + x) * 4); }
@@ -113,15 +181,112 @@ namespace
     struct BloomBuffers
     {
         int w = 0, h = 0;
-        std::vector<float> a; // RGB float
-        std::vector<float> b; // RGB float
-        std::vector<float> tmp; // optional working
         std::vector<float> kernel;
         int radius = 0;
 
-        void reset() { w = 0; h = 0; a.clear(); b.clear(); tmp.clear(); kernel.clear(); radius = 0; }
+        // upsample taps per framebuffer column (rebuilt when fb width / downsample change)
+        int col_ds = 0;
+        std::vector<int> col_x0, col_x1;
+        std::vector<float> col_tx;
+
+        void reset()
+        {
+            w = 0; h = 0; kernel.clear(); radius = 0;
+            col_ds = 0; col_x0.clear(); col_x1.clear(); col_tx.clear();
+        }
+    };
+
+    // Float scratch images for neighborhood passes. Buffers go back to the pool at the
+    // end of the frame, so steady state allocates nothing.
+    struct PostBufferPool
+    {
+        std::vector<std::vector<float>> free_list;
+
+        std::vector<float> acquire(size_t n)
+        {
+            for (size_t i = 0; i < free_list.size(); ++i)
+            {
+                if (free_list[i].capacity() >= n)
+                {
+                    std::vector<float> v = std::move(free_list[i]);
+                    free_list.erase(free_list.begin() + (std::ptrdiff_t)i);
+                    v.resize(n);
+                    return v;
+                }
+            }
+            return std::vector<float>(n);
+        }
+
+        void release(std::vector<float>&& v) { if (!v.empty()) free_list.push_back(std::move(v)); }
+        void clear() { free_list.clear(); }
     };
 
+    // -------------------------
+    // Tone curve LUT (exposure + gamma), rebuilt when ToneSettings change
+    // -------------------------
+    struct ToneLut
+    {
+        static constexpr int HDR_SIZE = 4096;
+
+        bool valid = false;
+        float exposure = 0.0f;
+        float gamma = 0.0f;
+        float inv_gamma = 1.0f;
+
+        // Input can exceed 1.0 once bloom is added, so sample the curve on a sqrt-spaced grid
+        // over [0, hdr_max] (dense near black where the gamma curve is steep) and lerp.
+        std::vector<float> hdr;
+        float hdr_inv_max = 1.0f; // past hdr_max the curve rounds to 255
+    };
+
+    // -------------------------
+    // Postprocess chain
+    // Neighborhood passes (bloom) each run over the whole image into pooled buffers.
+    // All per-pixel stages are fused into one row loop: load u8 -> stages -> pack u8,
+    // so adding a per-pixel effect adds no memory traffic.
+    // -------------------------
+    struct PostFrame
+    {
+        // bloom (valid when the bloom pass ran)
+        const float* bloom = nullptr; // RGBx float, BloomBuffers::w * h texels
+        int bloom_ds = 2;
+        float bloom_intensity = 0.0f;
+    };
+
+    struct PixelStage
+    {
+        const char* name = "";
+        // px: one row of RGBx floats (w texels), modified in place
+        void (*run)(const PostFrame& f, int y, float* px, int w) = nullptr;
+        // optional scalar per-channel form; lets a chain made only of curves bake to bytes
+        float (*curve)(float c) = nullptr;
+    };
+
+    struct PostChain
+    {
+        bool compiled = false;
+        bool bloom_pass = false;
+        bool aa_pass = false;
+        std::vector<PixelStage> stages;
+
+        // set when every stage is a per-channel curve and there are no neighborhood passes
+        bool byte_lut = false;
+        std::array<uint8_t, 256> lut{};
+
+        // grade: LUT repacked to RGBx floats, plus input domain remap and blend amount
+        int grade_size = 0;
+        std::vector<float> grade_lut;
+        float grade_in_offset[4]{};
+        float grade_in_scale[4]{};
+        float grade_strength = 1.0f;
+    };
+
+    static inline float tone_curve(float c, float exposure, float inv_gamma)
+    {
+        // exposure curve: 1 - exp(-c*exposure), then gamma
+        return lin_to_srgb(1.0f - std::exp(-c * exposure), inv_gamma);
+    }
+
     // -------------------------
     // Engine state
     // -------------------------
@@ -129,6 +294,7 @@ namespace
     {
         Engine_::Config cfg{};
         bool initialized = false;
+        Engine_::Context* owner = nullptr; // null for the default context
 
         // window / GL
         GLFWwindow* window = nullptr;
@@ -167,12 +333,26 @@ namespace
 
         // output buffer (postprocess result)
         std::vector<uint8_t> post_out; // RGBA (only allocated if needed)
+        std::vector<uint8_t> post_aa_in; // RGBA composite before AA (only with AA on)
         BloomBuffers bloom;
+        ToneLut tone_lut;
+        PostBufferPool post_pool;
+        PostChain post_chain;
 
         // capture
         fs::path capture_dir;
         fs::path capture_hint_png;
+        Engine_::CaptureFormat capture_format = Engine_::CaptureFormat::Png; // from the hint's extension
         uint64_t frame_idx = 0;
+        std::unique_ptr<Engine_::CaptureQueue> capture_queue; // created on first save
+
+        // streaming capture (.rgba / .y4m hint): one file, opened on first save
+        bool capture_streaming = false;
+        Engine_::StreamFormat capture_stream_format = Engine_::StreamFormat::Y4m;
+        Engine_::StreamOptions capture_stream_options;
+
+        Engine_::PresentListener present_listener;
+        std::unique_ptr<Engine_::CaptureStream> capture_stream;
 
         // timing
         double last_time = 0.0;
@@ -212,17 +392,57 @@ namespace
         // headless timer fallback
         std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
 
+        // fixed timestep (offline renders): simulated clock instead of wall time
+        double fixed_dt = 0.0;
+        double sim_time = 0.0;
+
         // present filter
         bool present_linear = false;
     };
 
-    static State g;
+    // Every engine call works on the calling thread's current context: the default
+    // one, unless set_current_context() picked another. Functions bind it once as `g`.
+    static State g_default_state;
+    static thread_local State* t_current = nullptr;
+
+    static inline State& ctx() { return t_current ? *t_current : g_default_state; }
+
+    // GLFW callbacks belong to whichever context owns the window.
+    static inline State& window_state(GLFWwindow* win)
+    {
+        State* s = static_cast<State*>(glfwGetWindowUserPointer(win));
+        return s ? *s : g_default_state;
+    }
+
+    // Makes `s` current on this thread for the scope (used by pool jobs).
+    struct StateBinding
+    {
+        State* prev;
+        explicit StateBinding(State* s) : prev(t_current) { t_current = s; }
+        ~StateBinding() { t_current = prev; }
+    };
+
+    // Pool threads don't share the caller's thread_local context; pass it along.
+    template <class Fn>
+    static void ctx_parallel_rows(int rows, int min_rows, const Fn& fn)
+    {
+        State* s = &ctx();
+        Engine_::parallel_rows(rows, min_rows, [&](int y0, int y1) { StateBinding b(s); fn(y0, y1); });
+    }
+
+    template <class Fn>
+    static void ctx_parallel_for(int count, const Fn& fn)
+    {
+        State* s = &ctx();
+        Engine_::JobPool::shared().parallel_for(count, [&](int i) { StateBinding b(s); fn(i); });
+    }
 
     // -------------------------
     // Input callback
     // -------------------------
-    static void glfw_key_cb(GLFWwindow*, int key, int, int action, int)
+    static void glfw_key_cb(GLFWwindow* win, int key, int, int action, int)
     {
+        State& g = window_state(win);
         if (key < 0 || key >= State::KEY_MAX) return;
 
         if (action == GLFW_PRESS)
@@ -237,14 +457,16 @@ namespace
         }
     }
 
-    static void glfw_window_size_cb(GLFWwindow*, int w, int h)
+    static void glfw_window_size_cb(GLFWwindow* win, int w, int h)
     {
+        State& g = window_state(win);
         g.display_w = std::max(1, w);
         g.display_h = std::max(1, h);
     }
 
-    static void glfw_cursor_pos_cb(GLFWwindow*, double x, double y)
+    static void glfw_cursor_pos_cb(GLFWwindow* win, double x, double y)
     {
+        State& g = window_state(win);
         const double prev_x = g.mouse_x;
         const double prev_y = g.mouse_y;
 
@@ -260,8 +482,9 @@ namespace
         if (dx != 0.0 || dy != 0.0) g.mouse_moved = true;
     }
 
-    static void glfw_mouse_button_cb(GLFWwindow*, int button, int action, int)
+    static void glfw_mouse_button_cb(GLFWwindow* win, int button, int action, int)
     {
+        State& g = window_state(win);
         if (button < 0 || button >= State::MOUSE_BUTTON_MAX) return;
 
         if (action == GLFW_PRESS)
@@ -276,15 +499,17 @@ namespace
         }
     }
 
-    static void glfw_scroll_cb(GLFWwindow*, double xoffset, double yoffset)
+    static void glfw_scroll_cb(GLFWwindow* win, double xoffset, double yoffset)
     {
+        State& g = window_state(win);
         g.mouse_scroll_x += xoffset;
         g.mouse_scroll_y += yoffset;
         if (xoffset != 0.0 || yoffset != 0.0) g.mouse_scrolled = true;
     }
 
-    static void glfw_cursor_enter_cb(GLFWwindow*, int entered)
+    static void glfw_cursor_enter_cb(GLFWwindow* win, int entered)
     {
+        State& g = window_state(win);
         const bool is_in = (entered == GLFW_TRUE);
         if (is_in)
         {
@@ -301,7 +526,7 @@ namespace
     // -------------------------
     // Dirty rect helpers
     // -------------------------
-    static inline void dirty_add(int x, int y)
+    static inline void dirty_add(State& g, int x, int y)
     {
         if (!g.dirty_on) return;
         if (x < 0 || y < 0 || x >= g.fb_w || y >= g.fb_h) return;
@@ -321,19 +546,19 @@ namespace
         }
     }
 
-    static inline void dirty_add_rect(int x, int y, int w, int h)
+    static inline void dirty_add_rect(State& g, int x, int y, int w, int h)
     {
         if (!g.dirty_on) return;
-        dirty_add(x, y);
-        dirty_add(x + w - 1, y);
-        dirty_add(x, y + h - 1);
-        dirty_add(x + w - 1, y + h - 1);
+        dirty_add(g, x, y);
+        dirty_add(g, x + w - 1, y);
+        dirty_add(g, x, y + h - 1);
+        dirty_add(g, x + w - 1, y + h - 1);
     }
 
     // -------------------------
     // Clip test
     // -------------------------
-    static inline bool in_clip(int x, int y)
+    static inline bool in_clip(const State& g, int x, int y)
     {
         if (!g.clip_on) return true;
         return (x >= g.clip_x && y >= g.clip_y &&
@@ -344,22 +569,17 @@ namespace
     // -------------------------
     // Blend write
     // -------------------------
-    static inline void write_pixel(int x, int y, const Engine_::Color& src)
+    static inline void blend_into(uint8_t* d, const Engine_::Color& src, Engine_::BlendMode mode)
     {
-        if (x < 0 || y < 0 || x >= g.fb_w || y >= g.fb_h) return;
-        if (!in_clip(x, y)) return;
-
-        const size_t i = idx_rgba(g.fb_w, x, y);
-
         Engine_::Color dst;
-        dst.r = g.color[i + 0];
-        dst.g = g.color[i + 1];
-        dst.b = g.color[i + 2];
-        dst.a = g.color[i + 3];
+        dst.r = d[0];
+        dst.g = d[1];
+        dst.b = d[2];
+        dst.a = d[3];
 
         Engine_::Color out = src;
 
-        switch (g.blend)
+        switch (mode)
         {
         case Engine_::BlendMode::Overwrite:
             out = src;
@@ -405,19 +625,44 @@ namespace
         }
         }
 
-        g.color[i + 0] = out.r;
-        g.color[i + 1] = out.g;
-        g.color[i + 2] = out.b;
-        g.color[i + 3] = out.a;
+        d[0] = out.r;
+        d[1] = out.g;
+        d[2] = out.b;
+        d[3] = out.a;
+    }
+
+    static inline void write_pixel(State& g, int x, int y, const Engine_::Color& src)
+    {
+        if (x < 0 || y < 0 || x >= g.fb_w || y >= g.fb_h) return;
+        if (!in_clip(g, x, y)) return;
+
+        blend_into(&g.color[idx_rgba(g.fb_w, x, y)], src, g.blend);
 
-        dirty_add(x, y);
+        dirty_add(g, x, y);
+    }
+
+    // Intersect [x0, x1) x [y0, y1) with the framebuffer and the clip rect.
+    static inline bool clip_write_rect(const State& g, int& x0, int& y0, int& x1, int& y1)
+    {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, g.fb_w);
+        y1 = std::min(y1, g.fb_h);
+        if (g.clip_on)
+        {
+            x0 = std::max(x0, g.clip_x);
+            y0 = std::max(y0, g.clip_y);
+            x1 = std::min(x1, g.clip_x + g.clip_w);
+            y1 = std::min(y1, g.clip_y + g.clip_h);
+        }
+        return x0 < x1 && y0 < y1;
     }
 
     // -------------------------
     // Depth test
     // z in [0..1], smaller = closer
     // -------------------------
-    static inline bool depth_test_write(int x, int y, float z01)
+    static inline bool depth_test_write(State& g, int x, int y, float z01)
     {
         if (!g.depth_on) return true;
 
@@ -425,7 +670,7 @@ namespace
         if (x < 0 || y < 0 || x >= g.fb_w || y >= g.fb_h) return false;
 
         // IMPORTANT: keep depth consistent with the same clip rules as color writes
-        if (!in_clip(x, y)) return false;
+        if (!in_clip(g, x, y)) return false;
 
         // Reject NaN (NaN comparisons always false, so without this you can get stuck depth)
         if (!(z01 == z01)) return false;
@@ -443,7 +688,7 @@ namespace
     // -------------------------
     // Line drawing (thick)
     // -------------------------
-    static void draw_line_bres(int x0, int y0, int x1, int y1, const Engine_::Color& c, int thickness)
+    static void draw_line_bres(State& g, int x0, int y0, int x1, int y1, const Engine_::Color& c, int thickness)
     {
         if (thickness < 1) thickness = 1;
         int dx = std::abs(x1 - x0);
@@ -458,7 +703,7 @@ namespace
         {
             for (int oy = -rad; oy <= rad; ++oy)
                 for (int ox = -rad; ox <= rad; ++ox)
-                    write_pixel(x0 + ox, y0 + oy, c);
+                    write_pixel(g, x0 + ox, y0 + oy, c);
 
             if (x0 == x1 && y0 == y1) break;
             int e2 = 2 * err;
@@ -470,7 +715,7 @@ namespace
     // -------------------------
     // Circle helpers
     // -------------------------
-    static void draw_circle_outline(int cx, int cy, int r, const Engine_::Color& c, int thickness)
+    static void draw_circle_outline(State& g, int cx, int cy, int r, const Engine_::Color& c, int thickness)
     {
         if (r <= 0) return;
         if (thickness < 1) thickness = 1;
@@ -485,14 +730,14 @@ namespace
 
             while (x >= y)
             {
-                write_pixel(cx + x, cy + y, c);
-                write_pixel(cx + y, cy + x, c);
-                write_pixel(cx - y, cy + x, c);
-                write_pixel(cx - x, cy + y, c);
-                write_pixel(cx - x, cy - y, c);
-                write_pixel(cx - y, cy - x, c);
-                write_pixel(cx + y, cy - x, c);
-                write_pixel(cx + x, cy - y, c);
+                write_pixel(g, cx + x, cy + y, c);
+                write_pixel(g, cx + y, cy + x, c);
+                write_pixel(g, cx - y, cy + x, c);
+                write_pixel(g, cx - x, cy + y, c);
+                write_pixel(g, cx - x, cy - y, c);
+                write_pixel(g, cx - y, cy - x, c);
+                write_pixel(g, cx + y, cy - x, c);
+                write_pixel(g, cx + x, cy - y, c);
 
                 if (err <= 0) { y++; err += 2 * y + 1; }
                 if (err > 0) { x--; err -= 2 * x + 1; }
@@ -500,7 +745,7 @@ namespace
         }
     }
 
-    static void draw_circle_filled(int cx, int cy, int r, const Engine_::Color& c)
+    static void draw_circle_filled(State& g, int cx, int cy, int r, const Engine_::Color& c)
     {
         if (r <= 0) return;
         for (int y = -r; y <= r; ++y)
@@ -510,7 +755,7 @@ namespace
             int x0 = cx - hh;
             int x1 = cx + hh;
             for (int x = x0; x <= x1; ++x)
-                write_pixel(x, y0, c);
+                write_pixel(g, x, y0, c);
         }
     }
 
@@ -523,7 +768,7 @@ namespace
         return (p.x - a.x) * (b.y - a.y) - (p.y - a.y) * (b.x - a.x);
     }
 
-    static void tri_bounds(const Engine_::Vec2& a, const Engine_::Vec2& b, const Engine_::Vec2& c,
+    static void tri_bounds(const State& g, const Engine_::Vec2& a, const Engine_::Vec2& b, const Engine_::Vec2& c,
         int& minx, int& miny, int& maxx, int& maxy)
     {
         float fx0 = std::min({ a.x, b.x, c.x });
@@ -542,10 +787,10 @@ namespace
         maxy = clampi(maxy, 0, g.fb_h - 1);
     }
 
-    static void draw_tri_flat(const Engine_::Vec2& a, const Engine_::Vec2& b, const Engine_::Vec2& c, Engine_::Color col)
+    static void draw_tri_flat(State& g, const Engine_::Vec2& a, const Engine_::Vec2& b, const Engine_::Vec2& c, Engine_::Color col)
     {
         int minx, miny, maxx, maxy;
-        tri_bounds(a, b, c, minx, miny, maxx, maxy);
+        tri_bounds(g, a, b, c, minx, miny, maxx, maxy);
 
         Engine_::Vec2 p;
         float area = edge_fn(a, b, c);
@@ -566,15 +811,15 @@ namespace
                 float w2 = edge_fn(A, B, p);
                 if (w0 >= 0 && w1 >= 0 && w2 >= 0)
                 {
-                    write_pixel(x, y, col);
+                    write_pixel(g, x, y, col);
                 }
             }
         }
 
-        dirty_add_rect(minx, miny, (maxx - minx + 1), (maxy - miny + 1));
+        dirty_add_rect(g, minx, miny, (maxx - minx + 1), (maxy - miny + 1));
     }
 
-    static void draw_tri_grad(const Engine_::Vec2& a, Engine_::Color ca,
+    static void draw_tri_grad(State& g, const Engine_::Vec2& a, Engine_::Color ca,
         const Engine_::Vec2& b, Engine_::Color cb,
         const Engine_::Vec2& c, Engine_::Color cc)
     {
@@ -594,7 +839,7 @@ namespace
         }
 
         int minx, miny, maxx, maxy;
-        tri_bounds(A, B, C, minx, miny, maxx, maxy);
+        tri_bounds(g, A, B, C, minx, miny, maxx, maxy);
 
         const float invA = 1.0f / area;
 
@@ -625,12 +870,12 @@ namespace
                     out.g = to_u8(gch);
                     out.b = to_u8(bch);
                     out.a = 255;
-                    write_pixel(x, y, out);
+                    write_pixel(g, x, y, out);
                 }
             }
         }
 
-        dirty_add_rect(minx, miny, (maxx - minx + 1), (maxy - miny + 1));
+        dirty_add_rect(g, minx, miny, (maxx - minx + 1), (maxy - miny + 1));
     }
 
 
@@ -652,7 +897,7 @@ namespace
         return c;
     }
 
-    static void draw_tri_tex(const Engine_::Vec2& a, const Engine_::Vec2& ua,
+    static void draw_tri_tex(State& g, const Engine_::Vec2& a, const Engine_::Vec2& ua,
         const Engine_::Vec2& b, const Engine_::Vec2& ub,
         const Engine_::Vec2& c, const Engine_::Vec2& uc,
         const Engine_::Image& tex, Engine_::Color tint)
@@ -674,7 +919,7 @@ namespace
         }
 
         int minx, miny, maxx, maxy;
-        tri_bounds(A, B, C, minx, miny, maxx, maxy);
+        tri_bounds(g, A, B, C, minx, miny, maxx, maxy);
 
         const float invA = 1.0f / area;
 
@@ -698,12 +943,12 @@ namespace
                     float v = UA.y * l0 + UB.y * l1 + UC.y * l2;
 
                     Engine_::Color sc = sample_tex_nearest(tex, u, v, tint);
-                    write_pixel(x, y, sc);
+                    write_pixel(g, x, y, sc);
                 }
             }
         }
 
-        dirty_add_rect(minx, miny, (maxx - minx + 1), (maxy - miny + 1));
+        dirty_add_rect(g, minx, miny, (maxx - minx + 1), (maxy - miny + 1));
     }
 
 
@@ -719,7 +964,7 @@ namespace
         Engine_::Vec2 uv;  // 0..1
     };
 
-    static bool project_vertex(const Engine_::Vertex3D& vin, const Engine_::Mat4& mvp, VOut& out)
+    static bool project_vertex(const State& g, const Engine_::Vertex3D& vin, const Engine_::Mat4& mvp, VOut& out)
     {
         Engine_::Vec4 p = { vin.pos.x, vin.pos.y, vin.pos.z, 1.0f };
         Engine_::Vec4 clip = Engine_::mat4_mul(mvp, p);
@@ -745,13 +990,13 @@ namespace
         return true;
     }
 
-    static void draw_tri_3d(const VOut& a, const VOut& b, const VOut& c,
+    static void draw_tri_3d(State& g, const VOut& a, const VOut& b, const VOut& c,
         const Engine_::Image* tex, bool depth_test)
     {
         Engine_::Vec2 AA{ a.x, a.y }, BB{ b.x, b.y }, CC{ c.x, c.y };
 
         int minx, miny, maxx, maxy;
-        tri_bounds(AA, BB, CC, minx, miny, maxx, maxy);
+        tri_bounds(g, AA, BB, CC, minx, miny, maxx, maxy);
 
         float area = edge_fn(AA, BB, CC);
         if (std::abs(area) < 1e-8f) return;
@@ -798,7 +1043,7 @@ namespace
 
                     if (depth_test && g.depth_on)
                     {
-                        if (!depth_test_write(x, y, z))
+                        if (!depth_test_write(g, x, y, z))
                             continue;
                     }
 
@@ -831,12 +1076,12 @@ namespace
                         out.a = 255;
                     }
 
-                    write_pixel(x, y, out);
+                    write_pixel(g, x, y, out);
                 }
             }
         }
 
-        dirty_add_rect(minx, miny, (maxx - minx + 1), (maxy - miny + 1));
+        dirty_add_rect(g, minx, miny, (maxx - minx + 1), (maxy - miny + 1));
     }
 
 
@@ -864,253 +1109,633 @@ namespace
 
     static void bloom_ensure_buffers(int w, int h)
     {
-        if (g.bloom.w == w && g.bloom.h == h && !g.bloom.a.empty() && !g.bloom.b.empty())
+        State& g = ctx();
+        if (g.bloom.w == w && g.bloom.h == h)
             return;
 
         g.bloom.w = w;
         g.bloom.h = h;
-        g.bloom.a.assign((size_t)w * h * 3, 0.0f);
-        g.bloom.b.assign((size_t)w * h * 3, 0.0f);
+        g.bloom.col_ds = 0; // force column table rebuild
     }
 
-    static void bloom_brightpass_downsample(const Engine_::BloomSettings& bs)
+    static void bloom_brightpass_downsample(const Engine_::BloomSettings& bs, float* out)
     {
-        int ds = std::max(2, bs.downsample);
-        int bw = (g.fb_w + ds - 1) / ds;
-        int bh = (g.fb_h + ds - 1) / ds;
-
-        bloom_ensure_buffers(bw, bh);
+        State& g = ctx();
+        const int ds = std::max(2, bs.downsample);
+        const int bw = g.bloom.w;
+        const int bh = g.bloom.h;
 
         const float thr = clampf(bs.threshold, 0.0f, 1.0f);
+        const float inv_range = 1.0f / std::max(1e-6f, (1.0f - thr));
+        const f4 inv255 = f4_set1(1.0f / 255.0f);
 
         // For each bloom pixel, average ds*ds block from framebuffer
-        for (int by = 0; by < bh; ++by)
-        {
-            for (int bx = 0; bx < bw; ++bx)
+        ctx_parallel_rows(bh, 4, [&](int by0, int by1)
             {
-                float r = 0, gc = 0, b = 0;
-                int count = 0;
+                for (int by = by0; by < by1; ++by)
+                {
+                    const int y0 = by * ds;
+                    const int y1 = std::min(g.fb_h, y0 + ds);
+
+                    for (int bx = 0; bx < bw; ++bx)
+                    {
+                        const int x0 = bx * ds;
+                        const int x1 = std::min(g.fb_w, x0 + ds);
 
-                int x0 = bx * ds;
-                int y0 = by * ds;
+                        f4 acc = f4_zero();
+                        for (int y = y0; y < y1; ++y)
+                        {
+                            const uint8_t* src = &g.color[idx_rgba(g.fb_w, x0, y)];
+                            for (int x = x0; x < x1; ++x, src += 4)
+                            {
+                                // luminance + bright pass
+                                const float lum = (0.2126f * src[0] + 0.7152f * src[1] + 0.0722f * src[2]) * (1.0f / 255.0f);
+                                const float k = lum - thr;
+                                if (k > 0.0f)
+                                    acc = f4_madd(acc, f4_mul(f4_from_rgba8(src), inv255), f4_set1(k * inv_range));
+                            }
+                        }
+
+                        const int count = (x1 - x0) * (y1 - y0);
+                        if (count > 0) acc = f4_mul(acc, f4_set1(1.0f / (float)count));
 
-                for (int oy = 0; oy < ds; ++oy)
+                        f4_store(&out[((size_t)by * bw + bx) * 4], acc);
+                    }
+                }
+            });
+    }
+
+    // Blurs `img` in place, using `tmp` (same size) for the horizontal result.
+    static void bloom_blur_separable(const Engine_::BloomSettings& bs, float* img, float* tmp)
+    {
+        State& g = ctx();
+        const int bw = g.bloom.w;
+        const int bh = g.bloom.h;
+        if (bw <= 0 || bh <= 0) return;
+
+        build_gaussian_kernel(bs.sigma, g.bloom.kernel, g.bloom.radius);
+        const int R = g.bloom.radius;
+        const auto& K = g.bloom.kernel;
+
+        // Horizontal: img -> tmp
+        ctx_parallel_rows(bh, 8, [&](int y0, int y1)
+            {
+                for (int y = y0; y < y1; ++y)
                 {
-                    int y = y0 + oy;
-                    if (y >= g.fb_h) break;
-                    for (int ox = 0; ox < ds; ++ox)
+                    const float* src = &img[(size_t)y * bw * 4];
+                    float* dst = &tmp[(size_t)y * bw * 4];
+
+                    for (int x = 0; x < bw; ++x)
                     {
-                        int x = x0 + ox;
-                        if (x >= g.fb_w) break;
-                        size_t i = idx_rgba(g.fb_w, x, y);
-                        float fr = g.color[i + 0] / 255.0f;
-                        float fg = g.color[i + 1] / 255.0f;
-                        float fb = g.color[i + 2] / 255.0f;
-
-                        // luminance
-                        float lum = 0.2126f * fr + 0.7152f * fg + 0.0722f * fb;
-
-                        // bright pass
-                        float k = (lum - thr);
-                        if (k > 0.0f)
+                        f4 acc = f4_zero();
+                        for (int k = -R; k <= R; ++k)
                         {
-                            k = k / std::max(1e-6f, (1.0f - thr)); // normalize
-                            r += fr * k;
-                            gc += fg * k;
-                            b += fb * k;
+                            const int sx = clampi(x + k, 0, bw - 1);
+                            acc = f4_madd(acc, f4_load(src + (size_t)sx * 4), f4_set1(K[(size_t)(k + R)]));
                         }
-
-                        count++;
+                        f4_store(dst + (size_t)x * 4, acc);
                     }
                 }
+            });
 
-                if (count > 0)
+        // Vertical: tmp -> img, accumulated a whole row at a time so reads stay sequential
+        ctx_parallel_rows(bh, 8, [&](int y0, int y1)
+            {
+                const size_t row_floats = (size_t)bw * 4;
+                for (int y = y0; y < y1; ++y)
                 {
-                    r /= (float)count;
-                    gc /= (float)count;
-                    b /= (float)count;
+                    float* dst = &img[(size_t)y * row_floats];
+                    std::fill(dst, dst + row_floats, 0.0f);
+
+                    for (int k = -R; k <= R; ++k)
+                    {
+                        const int sy = clampi(y + k, 0, bh - 1);
+                        const float* src = &tmp[(size_t)sy * row_floats];
+                        const f4 w = f4_set1(K[(size_t)(k + R)]);
+                        for (size_t i = 0; i < row_floats; i += 4)
+                            f4_store(dst + i, f4_madd(f4_load(dst + i), f4_load(src + i), w));
+                    }
                 }
+            });
+    }
 
-                size_t bi = (size_t)((by * bw + bx) * 3);
-                g.bloom.a[bi + 0] = r;
-                g.bloom.a[bi + 1] = gc;
-                g.bloom.a[bi + 2] = b;
-            }
+    // Per-column bilinear taps for upsampling bloom -> framebuffer (depend only on fb width and ds).
+    static void bloom_ensure_column_taps(int ds)
+    {
+        State& g = ctx();
+        if (g.bloom.col_ds == ds && (int)g.bloom.col_x0.size() == g.fb_w)
+            return;
+
+        g.bloom.col_ds = ds;
+        g.bloom.col_x0.resize((size_t)g.fb_w);
+        g.bloom.col_x1.resize((size_t)g.fb_w);
+        g.bloom.col_tx.resize((size_t)g.fb_w);
+
+        const int bw = g.bloom.w;
+        for (int x = 0; x < g.fb_w; ++x)
+        {
+            float u = ((float)x + 0.5f) / (float)ds - 0.5f;
+            u = clampf(u, 0.0f, (float)(bw - 1));
+            const int x0 = (int)std::floor(u);
+            g.bloom.col_x0[(size_t)x] = x0;
+            g.bloom.col_x1[(size_t)x] = clampi(x0 + 1, 0, bw - 1);
+            g.bloom.col_tx[(size_t)x] = u - (float)x0;
         }
     }
 
-    static void bloom_blur_separable(const Engine_::BloomSettings& bs)
+    static void tone_lut_ensure(const Engine_::ToneSettings& ts)
     {
-        int bw = g.bloom.w;
-        int bh = g.bloom.h;
-        if (bw <= 0 || bh <= 0) return;
+        State& g = ctx();
+        const float exposure = std::max(0.0001f, ts.exposure);
+        const float gamma = std::max(0.1f, ts.gamma);
 
-        build_gaussian_kernel(bs.sigma, g.bloom.kernel, g.bloom.radius);
-        const int R = g.bloom.radius;
-        const auto& K = g.bloom.kernel;
+        ToneLut& lut = g.tone_lut;
+        if (lut.valid && lut.exposure == exposure && lut.gamma == gamma)
+            return;
+
+        lut.valid = true;
+        lut.exposure = exposure;
+        lut.gamma = gamma;
+        lut.inv_gamma = 1.0f / gamma;
+
+        // Smallest input whose output already rounds to 255.
+        const double q = std::pow(254.9 / 255.0, (double)gamma);
+        const double hdr_max = -std::log(std::max(1e-12, 1.0 - q)) / (double)exposure;
+        lut.hdr_inv_max = (float)(1.0 / std::max(1e-4, hdr_max));
 
-        // Horizontal: a -> b
-        for (int y = 0; y < bh; ++y)
+        lut.hdr.resize(ToneLut::HDR_SIZE);
+        for (int i = 0; i < ToneLut::HDR_SIZE; ++i)
         {
-            for (int x = 0; x < bw; ++x)
+            const double s = (double)i / (double)(ToneLut::HDR_SIZE - 1);
+            lut.hdr[(size_t)i] = tone_curve((float)(s * s * hdr_max), exposure, lut.inv_gamma);
+        }
+    }
+
+    // -------------------------
+    // Per-pixel stages
+    // -------------------------
+    static void stage_bloom_add(const PostFrame& f, int y, float* px, int w)
+    {
+        State& g = ctx();
+        const int bw = g.bloom.w;
+        const int bh = g.bloom.h;
+
+        // Bloom row blended vertically once, then sampled horizontally per pixel.
+        thread_local std::vector<float> bloom_row;
+        bloom_row.resize((size_t)bw * 4);
+
+        float v = ((float)y + 0.5f) / (float)f.bloom_ds - 0.5f;
+        v = clampf(v, 0.0f, (float)(bh - 1));
+        const int y0 = (int)std::floor(v);
+        const int y1 = clampi(y0 + 1, 0, bh - 1);
+        const f4 ty = f4_set1(v - (float)y0);
+        const f4 one_minus_ty = f4_set1(1.0f - (v - (float)y0));
+
+        const float* r0 = &f.bloom[(size_t)y0 * bw * 4];
+        const float* r1 = &f.bloom[(size_t)y1 * bw * 4];
+        for (size_t i = 0; i < (size_t)bw * 4; i += 4)
+            f4_store(&bloom_row[i], f4_add(f4_mul(f4_load(r0 + i), one_minus_ty), f4_mul(f4_load(r1 + i), ty)));
+
+        const f4 intensity = f4_set1(f.bloom_intensity);
+        for (int x = 0; x < w; ++x, px += 4)
+        {
+            const float tx = g.bloom.col_tx[(size_t)x];
+            const f4 b0 = f4_load(&bloom_row[(size_t)g.bloom.col_x0[(size_t)x] * 4]);
+            const f4 b1 = f4_load(&bloom_row[(size_t)g.bloom.col_x1[(size_t)x] * 4]);
+            const f4 bl = f4_add(f4_mul(b0, f4_set1(1.0f - tx)), f4_mul(b1, f4_set1(tx)));
+            f4_store(px, f4_madd(f4_load(px), bl, intensity));
+        }
+    }
+
+    static void stage_tone(const PostFrame&, int, float* px, int w)
+    {
+        State& g = ctx();
+        // HDR LUT lookup (sqrt-spaced grid, linear between samples)
+        const ToneLut& lut = g.tone_lut;
+        const f4 inv_max = f4_set1(lut.hdr_inv_max);
+        const f4 scale = f4_set1((float)(ToneLut::HDR_SIZE - 1));
+
+        for (int x = 0; x < w; ++x, px += 4)
+        {
+            float s[4];
+            f4_store(s, f4_mul(f4_sqrt01(f4_mul(f4_load(px), inv_max)), scale));
+            for (int ch = 0; ch < 3; ++ch)
             {
-                float rr = 0, gg = 0, bb = 0;
-                for (int k = -R; k <= R; ++k)
-                {
-                    int sx = clampi(x + k, 0, bw - 1);
-                    size_t si = (size_t)((y * bw + sx) * 3);
-                    float w = K[(size_t)(k + R)];
-                    rr += g.bloom.a[si + 0] * w;
-                    gg += g.bloom.a[si + 1] * w;
-                    bb += g.bloom.a[si + 2] * w;
-                }
-                size_t di = (size_t)((y * bw + x) * 3);
-                g.bloom.b[di + 0] = rr;
-                g.bloom.b[di + 1] = gg;
-                g.bloom.b[di + 2] = bb;
+                const int i = (int)s[ch];
+                if (i >= ToneLut::HDR_SIZE - 1) { px[ch] = lut.hdr[ToneLut::HDR_SIZE - 1]; continue; }
+                const float t = s[ch] - (float)i;
+                px[ch] = lut.hdr[(size_t)i] + (lut.hdr[(size_t)i + 1] - lut.hdr[(size_t)i]) * t;
             }
         }
+    }
+
+    static float curve_tone(float c) { return tone_curve(c, ctx().tone_lut.exposure, ctx().tone_lut.inv_gamma); }
+
+    // 3D LUT grade. Input is remapped by the LUT domain into lattice units [0, N-1].
+    template <bool Tetrahedral>
+    static void stage_grade(const PostFrame&, int, float* px, int w)
+    {
+        State& g = ctx();
+        const PostChain& pc = g.post_chain;
+        const int N = pc.grade_size;
+        const float* L = pc.grade_lut.data();
+        const size_t sy = (size_t)N * 4;
+        const size_t sz = (size_t)N * N * 4;
+
+        const f4 in_off = f4_load(pc.grade_in_offset);
+        const f4 in_scale = f4_load(pc.grade_in_scale);
+        const f4 strength = f4_set1(pc.grade_strength);
 
-        // Vertical: b -> a
-        for (int y = 0; y < bh; ++y)
+        for (int x = 0; x < w; ++x, px += 4)
         {
-            for (int x = 0; x < bw; ++x)
+            const f4 c = f4_load(px);
+
+            float u[4];
+            f4_store(u, f4_mul(f4_add(c, in_off), in_scale));
+
+            int i0[3];
+            float t[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                const float v = clampf(u[k], 0.0f, (float)(N - 1));
+                i0[k] = std::min((int)v, N - 2);
+                t[k] = v - (float)i0[k];
+            }
+
+            const float* p000 = L + (size_t)i0[0] * 4 + (size_t)i0[1] * sy + (size_t)i0[2] * sz;
+            const f4 c000 = f4_load(p000);
+            const f4 c111 = f4_load(p000 + 4 + sy + sz);
+            f4 out;
+
+            if constexpr (Tetrahedral)
             {
-                float rr = 0, gg = 0, bb = 0;
-                for (int k = -R; k <= R; ++k)
+                // Walk c000 -> c111 through the two corners of the tetrahedron that contains t.
+                const float tr = t[0], tg = t[1], tb = t[2];
+                const float* pa;
+                const float* pb;
+                float w0, w1, w2;
+                if (tr > tg)
                 {
-                    int sy = clampi(y + k, 0, bh - 1);
-                    size_t si = (size_t)((sy * bw + x) * 3);
-                    float w = K[(size_t)(k + R)];
-                    rr += g.bloom.b[si + 0] * w;
-                    gg += g.bloom.b[si + 1] * w;
-                    bb += g.bloom.b[si + 2] * w;
+                    if (tg > tb)      { pa = p000 + 4;  pb = p000 + 4 + sy;  w0 = tr; w1 = tg; w2 = tb; } // r > g > b
+                    else if (tr > tb) { pa = p000 + 4;  pb = p000 + 4 + sz;  w0 = tr; w1 = tb; w2 = tg; } // r > b > g
+                    else              { pa = p000 + sz; pb = p000 + 4 + sz;  w0 = tb; w1 = tr; w2 = tg; } // b > r > g
                 }
-                size_t di = (size_t)((y * bw + x) * 3);
-                g.bloom.a[di + 0] = rr;
-                g.bloom.a[di + 1] = gg;
-                g.bloom.a[di + 2] = bb;
+                else
+                {
+                    if (tb > tg)      { pa = p000 + sz; pb = p000 + sy + sz; w0 = tb; w1 = tg; w2 = tr; } // b > g > r
+                    else if (tb > tr) { pa = p000 + sy; pb = p000 + sy + sz; w0 = tg; w1 = tb; w2 = tr; } // g > b > r
+                    else              { pa = p000 + sy; pb = p000 + 4 + sy;  w0 = tg; w1 = tr; w2 = tb; } // g > r > b
+                }
+                const f4 ca = f4_load(pa);
+                const f4 cb = f4_load(pb);
+                out = f4_madd(c000, f4_sub(ca, c000), f4_set1(w0));
+                out = f4_madd(out, f4_sub(cb, ca), f4_set1(w1));
+                out = f4_madd(out, f4_sub(c111, cb), f4_set1(w2));
+            }
+            else
+            {
+                const f4 tr = f4_set1(t[0]), tg = f4_set1(t[1]), tb = f4_set1(t[2]);
+                auto lerp = [&](f4 a, f4 b, f4 tt) { return f4_madd(a, f4_sub(b, a), tt); };
+                const f4 c00 = lerp(c000, f4_load(p000 + 4), tr);
+                const f4 c10 = lerp(f4_load(p000 + sy), f4_load(p000 + 4 + sy), tr);
+                const f4 c01 = lerp(f4_load(p000 + sz), f4_load(p000 + 4 + sz), tr);
+                const f4 c11 = lerp(f4_load(p000 + sy + sz), c111, tr);
+                out = lerp(lerp(c00, c10, tg), lerp(c01, c11, tg), tb);
             }
+
+            out = f4_madd(c, f4_sub(out, c), strength);
+            f4_store(px, out);
         }
     }
 
-    static inline void bloom_sample_bilinear(float u, float v, float& r, float& gch, float& b)
+    // -------------------------
+    // Chain compile (once per settings change)
+    // -------------------------
+    static void post_chain_compile()
     {
-        int bw = g.bloom.w;
-        int bh = g.bloom.h;
-        if (bw <= 0 || bh <= 0) { r = gch = b = 0; return; }
+        State& g = ctx();
+        PostChain& pc = g.post_chain;
+        pc = PostChain{};
+        pc.compiled = true;
 
-        u = clampf(u, 0.0f, (float)(bw - 1));
-        v = clampf(v, 0.0f, (float)(bh - 1));
+        const Engine_::PostProcessSettings& ps = g.post;
+
+        pc.bloom_pass = ps.bloom.enabled;
+        if (ps.bloom.enabled)
+            pc.stages.push_back({ "bloom", &stage_bloom_add, nullptr });
 
-        int x0 = (int)std::floor(u);
-        int y0 = (int)std::floor(v);
-        int x1 = clampi(x0 + 1, 0, bw - 1);
-        int y1 = clampi(y0 + 1, 0, bh - 1);
+        if (ps.tone.enabled)
+        {
+            tone_lut_ensure(ps.tone);
+            pc.stages.push_back({ "tone", &stage_tone, &curve_tone });
+        }
 
-        float tx = u - (float)x0;
-        float ty = v - (float)y0;
+        if (ps.grade.enabled && ps.grade.lut && ps.grade.lut->valid() && ps.grade.strength > 0.0f)
+        {
+            const Engine_::ColorLut3D& lut = *ps.grade.lut;
+            const size_t n = (size_t)lut.size * lut.size * lut.size;
 
-        auto fetch = [&](int x, int y, float& rr, float& gg, float& bb)
+            pc.grade_size = lut.size;
+            pc.grade_lut.resize(n * 4);
+            for (size_t i = 0; i < n; ++i)
             {
-                size_t i = (size_t)((y * bw + x) * 3);
-                rr = g.bloom.a[i + 0];
-                gg = g.bloom.a[i + 1];
-                bb = g.bloom.a[i + 2];
-            };
+                pc.grade_lut[i * 4 + 0] = lut.rgb[i * 3 + 0];
+                pc.grade_lut[i * 4 + 1] = lut.rgb[i * 3 + 1];
+                pc.grade_lut[i * 4 + 2] = lut.rgb[i * 3 + 2];
+                pc.grade_lut[i * 4 + 3] = 1.0f;
+            }
 
-        float r00, g00, b00, r10, g10, b10, r01, g01, b01, r11, g11, b11;
-        fetch(x0, y0, r00, g00, b00);
-        fetch(x1, y0, r10, g10, b10);
-        fetch(x0, y1, r01, g01, b01);
-        fetch(x1, y1, r11, g11, b11);
+            for (int k = 0; k < 3; ++k)
+            {
+                const float span = lut.domain_max[k] - lut.domain_min[k];
+                pc.grade_in_offset[k] = -lut.domain_min[k];
+                pc.grade_in_scale[k] = (float)(lut.size - 1) / (std::fabs(span) > 1e-6f ? span : 1.0f);
+            }
+            pc.grade_strength = clampf(ps.grade.strength, 0.0f, 1.0f);
 
-        float r0 = r00 * (1 - tx) + r10 * tx;
-        float g0 = g00 * (1 - tx) + g10 * tx;
-        float b0 = b00 * (1 - tx) + b10 * tx;
+            if (ps.grade.interp == Engine_::LutInterp::Trilinear)
+                pc.stages.push_back({ "grade", &stage_grade<false>, nullptr });
+            else
+                pc.stages.push_back({ "grade", &stage_grade<true>, nullptr });
+        }
 
-        float r1 = r01 * (1 - tx) + r11 * tx;
-        float g1 = g01 * (1 - tx) + g11 * tx;
-        float b1 = b01 * (1 - tx) + b11 * tx;
+        // Pure per-channel chains on 8-bit input collapse into one byte -> byte table.
+        pc.byte_lut = !pc.bloom_pass && !pc.stages.empty() &&
+            std::all_of(pc.stages.begin(), pc.stages.end(), [](const PixelStage& st) { return st.curve != nullptr; });
 
-        r = r0 * (1 - ty) + r1 * ty;
-        gch = g0 * (1 - ty) + g1 * ty;
-        b = b0 * (1 - ty) + b1 * ty;
+        if (pc.byte_lut)
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                float c = (float)i / 255.0f;
+                for (const PixelStage& st : pc.stages) c = st.curve(c);
+                pc.lut[(size_t)i] = to_u8(c);
+            }
+        }
+
+        // Runs last, on the display-referred result
+        pc.aa_pass = ps.aa.enabled;
     }
 
-    static const uint8_t* build_postprocess_output(bool apply_post)
+    // Runs the per-pixel part of the chain from g.color into `out` (RGBA8, fb size).
+    static void post_composite(const PostChain& pc, uint8_t* out)
     {
-        if (!apply_post) return g.color.data();
-
-        const bool bloom_on = g.post.bloom.enabled;
-        const bool tone_on = g.post.tone.enabled;
-
-        if (!bloom_on && !tone_on)
-            return g.color.data();
+        State& g = ctx();
+        if (pc.byte_lut)
+        {
+            ctx_parallel_rows(g.fb_h, 32, [&](int y_begin, int y_end)
+                {
+                    const uint8_t* src = &g.color[idx_rgba(g.fb_w, 0, y_begin)];
+                    uint8_t* dst = out + idx_rgba(g.fb_w, 0, y_begin);
+                    const size_t n = (size_t)(y_end - y_begin) * g.fb_w;
+                    for (size_t i = 0; i < n; ++i, src += 4, dst += 4)
+                    {
+                        dst[0] = pc.lut[src[0]];
+                        dst[1] = pc.lut[src[1]];
+                        dst[2] = pc.lut[src[2]];
+                        dst[3] = 255;
+                    }
+                });
+            return;
+        }
 
-        // Ensure output buffer
-        g.post_out.resize((size_t)g.fb_w * g.fb_h * 4);
+        // Neighborhood passes
+        PostFrame frame;
+        std::vector<float> bloom_img;
 
-        // Bloom pipeline at reduced res
-        if (bloom_on)
+        if (pc.bloom_pass)
         {
-            bloom_brightpass_downsample(g.post.bloom);
-            bloom_blur_separable(g.post.bloom);
+            const Engine_::BloomSettings& bs = g.post.bloom;
+            const int ds = std::max(2, bs.downsample);
+            bloom_ensure_buffers((g.fb_w + ds - 1) / ds, (g.fb_h + ds - 1) / ds);
+
+            const size_t n = (size_t)g.bloom.w * g.bloom.h * 4;
+            bloom_img = g.post_pool.acquire(n);
+            std::vector<float> tmp = g.post_pool.acquire(n);
+
+            bloom_brightpass_downsample(bs, bloom_img.data());
+            bloom_blur_separable(bs, bloom_img.data(), tmp.data());
+            bloom_ensure_column_taps(ds);
+            g.post_pool.release(std::move(tmp));
+
+            frame.bloom = bloom_img.data();
+            frame.bloom_ds = ds;
+            frame.bloom_intensity = bs.intensity;
         }
 
-        const float exposure = std::max(0.0001f, g.post.tone.exposure);
-        const float gamma = std::max(0.1f, g.post.tone.gamma);
-        const float invGamma = 1.0f / gamma;
+        // Fused per-pixel stages, one row at a time
+        const f4 inv255 = f4_set1(1.0f / 255.0f);
+        ctx_parallel_rows(g.fb_h, 16, [&](int y_begin, int y_end)
+            {
+                thread_local std::vector<float> row;
+                row.resize((size_t)g.fb_w * 4);
 
-        const int ds = std::max(2, g.post.bloom.downsample);
-        const float bloom_intensity = g.post.bloom.intensity;
+                for (int y = y_begin; y < y_end; ++y)
+                {
+                    const uint8_t* src = &g.color[idx_rgba(g.fb_w, 0, y)];
+                    for (int x = 0; x < g.fb_w; ++x)
+                        f4_store(&row[(size_t)x * 4], f4_mul(f4_from_rgba8(src + (size_t)x * 4), inv255));
 
-        for (int y = 0; y < g.fb_h; ++y)
-        {
-            for (int x = 0; x < g.fb_w; ++x)
-            {
-                size_t i = idx_rgba(g.fb_w, x, y);
+                    for (const PixelStage& st : pc.stages)
+                        st.run(frame, y, row.data(), g.fb_w);
 
-                float r = g.color[i + 0] / 255.0f;
-                float gch = g.color[i + 1] / 255.0f;
-                float b = g.color[i + 2] / 255.0f;
+                    uint8_t* dst = out + idx_rgba(g.fb_w, 0, y);
+                    for (int x = 0; x < g.fb_w; ++x, dst += 4)
+                    {
+                        f4_to_rgba8(f4_load(&row[(size_t)x * 4]), dst);
+                        dst[3] = 255;
+                    }
+                }
+            });
 
-                // Add bloom (upsample)
-                if (bloom_on)
-                {
-                    // map framebuffer pixel -> bloom pixel coords
-                    float bu = ((float)x + 0.5f) / (float)ds - 0.5f;
-                    float bv = ((float)y + 0.5f) / (float)ds - 0.5f;
+        g.post_pool.release(std::move(bloom_img));
+    }
 
-                    float br, bg, bb;
-                    bloom_sample_bilinear(bu, bv, br, bg, bb);
+    // -------------------------
+    // FXAA-style anti-aliasing (on the final display-referred image)
+    // Edge detect on luma contrast, find the edge span along its direction,
+    // then blend each edge pixel toward its neighbor across the edge.
+    // -------------------------
+    static void fxaa_pass(const Engine_::AntiAliasSettings& as, const uint8_t* src, uint8_t* dst)
+    {
+        State& g = ctx();
+        const int W = g.fb_w;
+        const int H = g.fb_h;
 
-                    r += br * bloom_intensity;
-                    gch += bg * bloom_intensity;
-                    b += bb * bloom_intensity;
+        std::vector<float> luma = g.post_pool.acquire((size_t)W * H);
+        ctx_parallel_rows(H, 32, [&](int y0, int y1)
+            {
+                for (int y = y0; y < y1; ++y)
+                {
+                    const uint8_t* p = src + idx_rgba(W, 0, y);
+                    float* l = &luma[(size_t)y * W];
+                    for (int x = 0; x < W; ++x, p += 4)
+                        l[x] = (0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]) * (1.0f / 255.0f);
                 }
+            });
+
+        const float edge_thr = std::max(0.0f, as.edge_threshold);
+        const float edge_thr_min = std::max(0.0f, as.edge_threshold_min);
+        const float subpix_amount = clampf(as.subpixel, 0.0f, 1.0f);
+
+        // Search steps along the edge (pixels), growing as we get further out.
+        static constexpr int STEPS[] = { 1, 1, 1, 1, 1, 2, 2, 2, 2, 4, 8 };
 
-                // Tone (simple film-ish exposure + gamma)
-                if (tone_on)
+        auto L = [&](int x, int y) { return luma[(size_t)clampi(y, 0, H - 1) * W + clampi(x, 0, W - 1)]; };
+
+        constexpr int TILE = 64;
+        const int tiles_x = (W + TILE - 1) / TILE;
+        const int tiles_y = (H + TILE - 1) / TILE;
+
+        ctx_parallel_for(tiles_x * tiles_y, [&](int t)
+            {
+                const int tx0 = (t % tiles_x) * TILE;
+                const int ty0 = (t / tiles_x) * TILE;
+                const int tx1 = std::min(W, tx0 + TILE);
+                const int ty1 = std::min(H, ty0 + TILE);
+
+                for (int y = ty0; y < ty1; ++y)
                 {
-                    // exposure curve: 1 - exp(-c*exposure)
-                    r = 1.0f - std::exp(-r * exposure);
-                    gch = 1.0f - std::exp(-gch * exposure);
-                    b = 1.0f - std::exp(-b * exposure);
-
-                    // gamma
-                    r = std::pow(clampf(r, 0, 1), invGamma);
-                    gch = std::pow(clampf(gch, 0, 1), invGamma);
-                    b = std::pow(clampf(b, 0, 1), invGamma);
+                    const float* rowN = &luma[(size_t)std::max(0, y - 1) * W];
+                    const float* rowM = &luma[(size_t)y * W];
+                    const float* rowS = &luma[(size_t)std::min(H - 1, y + 1) * W];
+
+                    for (int x = tx0; x < tx1; ++x)
+                    {
+                        const size_t i = idx_rgba(W, x, y);
+                        const int xw = x > 0 ? x - 1 : 0;
+                        const int xe = x < W - 1 ? x + 1 : x;
+
+                        const float lM = rowM[x];
+                        const float lN = rowN[x];
+                        const float lS = rowS[x];
+                        const float lW = rowM[xw];
+                        const float lE = rowM[xe];
+
+                        const float lmin = std::min(lM, std::min(std::min(lN, lS), std::min(lW, lE)));
+                        const float lmax = std::max(lM, std::max(std::max(lN, lS), std::max(lW, lE)));
+                        const float range = lmax - lmin;
+
+                        if (range < std::max(edge_thr_min, lmax * edge_thr))
+                        {
+                            std::memcpy(dst + i, src + i, 4);
+                            dst[i + 3] = 255;
+                            continue;
+                        }
+
+                        const float lNW = rowN[xw];
+                        const float lNE = rowN[xe];
+                        const float lSW = rowS[xw];
+                        const float lSE = rowS[xe];
+
+                        // Sub-pixel aliasing (isolated pixels / thin features)
+                        const float lavg = (2.0f * (lN + lS + lW + lE) + (lNW + lNE + lSW + lSE)) / 12.0f;
+                        float subpix = clampf(std::fabs(lavg - lM) / range, 0.0f, 1.0f);
+                        subpix = (-2.0f * subpix + 3.0f) * subpix * subpix;
+                        subpix = subpix * subpix * subpix_amount;
+
+                        // Edge orientation
+                        // (a horizontal edge shows up as a vertical second derivative)
+                        const float edge_h = std::fabs(lNW - 2.0f * lW + lSW) + 2.0f * std::fabs(lN - 2.0f * lM + lS) + std::fabs(lNE - 2.0f * lE + lSE);
+                        const float edge_v = std::fabs(lNW - 2.0f * lN + lNE) + 2.0f * std::fabs(lW - 2.0f * lM + lE) + std::fabs(lSW - 2.0f * lS + lSE);
+                        const bool horizontal = edge_h >= edge_v;
+
+                        // Which side of the pixel the edge is on
+                        const float l_neg = horizontal ? lN : lW;
+                        const float l_pos = horizontal ? lS : lE;
+                        const float grad_neg = std::fabs(l_neg - lM);
+                        const float grad_pos = std::fabs(l_pos - lM);
+                        const bool neg_side = grad_neg >= grad_pos;
+                        const int side = neg_side ? -1 : 1;
+                        const float l_side = neg_side ? l_neg : l_pos;
+                        const float grad_scaled = 0.25f * std::max(grad_neg, grad_pos);
+                        const float l_local = 0.5f * (lM + l_side);
+
+                        // Luma halfway between this pixel row/column and the other side, at offset s along the edge
+                        auto edge_luma = [&](int s)
+                            {
+                                return horizontal
+                                    ? 0.5f * (L(x + s, y) + L(x + s, y + side))
+                                    : 0.5f * (L(x, y + s) + L(x + side, y + s));
+                            };
+
+                        int d_neg = 0, d_pos = 0;
+                        float end_neg = 0.0f, end_pos = 0.0f;
+                        bool done_neg = false, done_pos = false;
+                        for (int step : STEPS)
+                        {
+                            if (!done_neg)
+                            {
+                                d_neg += step;
+                                end_neg = edge_luma(-d_neg) - l_local;
+                                done_neg = std::fabs(end_neg) >= grad_scaled;
+                            }
+                            if (!done_pos)
+                            {
+                                d_pos += step;
+                                end_pos = edge_luma(d_pos) - l_local;
+                                done_pos = std::fabs(end_pos) >= grad_scaled;
+                            }
+                            if (done_neg && done_pos) break;
+                        }
+
+                        // Blend amount from the position along the edge span
+                        const bool closer_neg = d_neg < d_pos;
+                        const float d_min = (float)std::min(d_neg, d_pos);
+                        const float span = (float)(d_neg + d_pos);
+                        const bool m_smaller = (lM - l_local) < 0.0f;
+                        const bool correct = ((closer_neg ? end_neg : end_pos) < 0.0f) != m_smaller;
+                        const float edge_offset = correct ? (0.5f - d_min / span) : 0.0f;
+
+                        const float blend = std::max(edge_offset, subpix);
+
+                        const int ox = horizontal ? x : clampi(x + side, 0, W - 1);
+                        const int oy = horizontal ? clampi(y + side, 0, H - 1) : y;
+                        const uint8_t* a = src + i;
+                        const uint8_t* b = src + idx_rgba(W, ox, oy);
+                        for (int ch = 0; ch < 3; ++ch)
+                            dst[i + ch] = (uint8_t)((float)a[ch] + ((float)b[ch] - (float)a[ch]) * blend + 0.5f);
+                        dst[i + 3] = 255;
+                    }
                 }
+            });
 
-                g.post_out[i + 0] = to_u8(r);
-                g.post_out[i + 1] = to_u8(gch);
-                g.post_out[i + 2] = to_u8(b);
-                g.post_out[i + 3] = 255;
+        g.post_pool.release(std::move(luma));
+    }
+
+    static const uint8_t* build_postprocess_output(bool apply_post)
+    {
+        State& g = ctx();
+        if (!apply_post) return g.color.data();
+
+        if (!g.post_chain.compiled)
+            post_chain_compile();
+
+        const PostChain& pc = g.post_chain;
+        if (pc.stages.empty() && !pc.aa_pass)
+            return g.color.data();
+
+        // Ensure output buffer
+        const size_t bytes = (size_t)g.fb_w * g.fb_h * 4;
+        g.post_out.resize(bytes);
+
+        const uint8_t* composed = g.color.data();
+        if (!pc.stages.empty())
+        {
+            // With AA on, the composite lands in a scratch image that FXAA then reads.
+            uint8_t* target = g.post_out.data();
+            if (pc.aa_pass)
+            {
+                g.post_aa_in.resize(bytes);
+                target = g.post_aa_in.data();
             }
+            post_composite(pc, target);
+            composed = target;
         }
 
+        if (pc.aa_pass)
+            fxaa_pass(g.post.aa, composed, g.post_out.data());
+
         // Post touches whole frame
         g.dirty_empty = true;
         return g.post_out.data();
@@ -1128,6 +1753,7 @@ namespace
 
     static fs::path resolve_capture_path()
     {
+        State& g = ctx();
         if (!g.capture_hint_png.empty())
         {
             fs::path p = g.capture_hint_png;
@@ -1135,7 +1761,7 @@ namespace
             if (dir.empty()) dir = fs::current_path();
 
             const std::string stem = p.stem().string();
-            const std::string ext = p.extension().string().empty() ? ".png" : p.extension().string();
+            const std::string ext = Engine_::capture_output_extension(p.extension().string());
 
             return dir / (stem + "_" + frame6(g.frame_idx) + ext);
         }
@@ -1159,6 +1785,7 @@ namespace
     // -------------------------
     static bool create_presenter()
     {
+        State& g = ctx();
         glGetIntegerv(GL_MAX_TEXTURE_SIZE, &g.max_tex_size);
 
         if (g.fb_w > g.max_tex_size || g.fb_h > g.max_tex_size)
@@ -1410,11 +2037,147 @@ namespace Engine_
         return img;
     }
 
+    ColorLut3D load_cube_lut(const std::string& path)
+    {
+        ColorLut3D lut;
+
+        std::ifstream in(path);
+        if (!in)
+        {
+            std::cerr << "[Engine] Cannot open LUT: " << path << "\n";
+            return lut;
+        }
+
+        std::string line;
+        int line_no = 0;
+        while (std::getline(in, line))
+        {
+            ++line_no;
+            const size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') continue;
+
+            std::istringstream ls(line);
+            if (std::isalpha((unsigned char)line[first]))
+            {
+                std::string key;
+                ls >> key;
+                if (key == "LUT_3D_SIZE")
+                {
+                    ls >> lut.size;
+                    if (lut.size < 2 || lut.size > 256)
+                    {
+                        std::cerr << "[Engine] Bad LUT_3D_SIZE in " << path << ":" << line_no << "\n";
+                        return ColorLut3D{};
+                    }
+                    lut.rgb.reserve((size_t)lut.size * lut.size * lut.size * 3);
+                }
+                else if (key == "DOMAIN_MIN")
+                    ls >> lut.domain_min[0] >> lut.domain_min[1] >> lut.domain_min[2];
+                else if (key == "DOMAIN_MAX")
+                    ls >> lut.domain_max[0] >> lut.domain_max[1] >> lut.domain_max[2];
+                else if (key == "LUT_1D_SIZE")
+                {
+                    std::cerr << "[Engine] 1D .cube LUTs are not supported: " << path << "\n";
+                    return ColorLut3D{};
+                }
+                // TITLE and unknown keywords are ignored
+                continue;
+            }
+
+            float r = 0, gch = 0, b = 0;
+            if (!(ls >> r >> gch >> b))
+            {
+                std::cerr << "[Engine] Bad LUT entry in " << path << ":" << line_no << "\n";
+                return ColorLut3D{};
+            }
+            lut.rgb.push_back(r);
+            lut.rgb.push_back(gch);
+            lut.rgb.push_back(b);
+        }
+
+        if (!lut.valid())
+        {
+            std::cerr << "[Engine] LUT size/entry count mismatch: " << path << "\n";
+            return ColorLut3D{};
+        }
+        return lut;
+    }
+
+    ColorLut3D bake_lut_from_image(const Image& img)
+    {
+        ColorLut3D lut;
+        if (!img.valid()) return lut;
+
+        // HALD: square image of side level^3, LUT size level^2, entries in raster order.
+        int level = 0;
+        for (int l = 2; l * l * l <= img.w; ++l)
+            if (l * l * l == img.w) level = l;
+
+        int n = 0;
+        bool hald = false;
+        if (img.w == img.h && level > 0)
+        {
+            n = level * level;
+            hald = true;
+        }
+        else if (img.h >= 2 && img.w == img.h * img.h)
+        {
+            n = img.h; // strip: n tiles of n*n, blue selects the tile
+        }
+        else
+        {
+            std::cerr << "[Engine] LUT image must be HALD (level^3 square) or a n*n x n strip, got "
+                << img.w << "x" << img.h << "\n";
+            return lut;
+        }
+
+        lut.size = n;
+        lut.rgb.resize((size_t)n * n * n * 3);
+
+        for (int b = 0; b < n; ++b)
+            for (int gi = 0; gi < n; ++gi)
+                for (int r = 0; r < n; ++r)
+                {
+                    int x, y;
+                    if (hald)
+                    {
+                        const int i = r + gi * n + b * n * n;
+                        x = i % img.w;
+                        y = i / img.w;
+                    }
+                    else
+                    {
+                        x = r + b * n;
+                        y = gi;
+                    }
+
+                    const uint8_t* p = &img.rgba[idx_rgba(img.w, x, y)];
+                    float* o = &lut.rgb[((size_t)b * n * n + (size_t)gi * n + r) * 3];
+                    o[0] = p[0] / 255.0f;
+                    o[1] = p[1] / 255.0f;
+                    o[2] = p[2] / 255.0f;
+                }
+
+        return lut;
+    }
+
+    ColorLut3D load_color_lut(const std::string& path)
+    {
+        std::string ext = fs::path(path).extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+        if (ext == ".cube")
+            return load_cube_lut(path);
+
+        return bake_lut_from_image(load_image_rgba(path));
+    }
+
     // ------------------------------------------------------------
     // Lifecycle
     // ------------------------------------------------------------
     bool init(const Config& cfg)
     {
+        State& g = ctx();
         if (g.initialized) return true;
         g.cfg = cfg;
 
@@ -1435,6 +2198,7 @@ namespace Engine_
         g.depth.clear();
 
         g.post = PostProcessSettings{};
+        g.post_chain.compiled = false;
         g.dirty_empty = true;
 
         if (cfg.headless)
@@ -1469,6 +2233,7 @@ namespace Engine_
         }
 
         glfwMakeContextCurrent(g.window);
+        glfwSetWindowUserPointer(g.window, &g);
         glfwSwapInterval(cfg.vsync ? 1 : 0);
 
         glfwSetKeyCallback(g.window, glfw_key_cb);
@@ -1509,6 +2274,11 @@ namespace Engine_
 
     void shutdown()
     {
+        State& g = ctx();
+        // Finish writing queued captures before anything else goes away.
+        g.capture_stream.reset();
+        g.capture_queue.reset();
+
         if (g.gl_ready)
         {
             if (g.program) { glDeleteProgram(g.program); g.program = 0; }
@@ -1529,7 +2299,9 @@ namespace Engine_
         g.color.clear();
         g.depth.clear();
         g.post_out.clear();
+        g.post_aa_in.clear();
         g.bloom.reset();
+        g.post_pool.clear();
 
         for (int i = 0; i < State::KEY_MAX; ++i)
         {
@@ -1560,11 +2332,52 @@ namespace Engine_
         g.can_present = false;
     }
 
+    // ------------------------------------------------------------
+    // Render contexts
+    // ------------------------------------------------------------
+    class Context
+    {
+    public:
+        State state;
+    };
+
+    Context* create_context(const Config& cfg)
+    {
+        Context* c = new Context();
+        c->state.owner = c;
+
+        // Only the default context gets the window; the others render on the CPU.
+        Config cpu = cfg;
+        cpu.headless = true;
+
+        ContextScope scope(c);
+        init(cpu);
+        return c;
+    }
+
+    void destroy_context(Context* c)
+    {
+        if (!c) return;
+        {
+            ContextScope scope(c);
+            shutdown();
+        }
+        if (t_current == &c->state) t_current = nullptr;
+        delete c;
+    }
+
+    void set_current_context(Context* c) { t_current = c ? &c->state : nullptr; }
+    Context* current_context() { return t_current ? t_current->owner : nullptr; }
+
+    ContextScope::ContextScope(Context* c) : prev_(current_context()) { set_current_context(c); }
+    ContextScope::~ContextScope() { set_current_context(prev_); }
+
     // ------------------------------------------------------------
     // Loop + input
     // ------------------------------------------------------------
     bool should_close()
     {
+        State& g = ctx();
         if (g.want_close) return true;
         if (g.cfg.headless) return g.want_close;
         if (!g.window) return true;
@@ -1573,12 +2386,14 @@ namespace Engine_
 
     void request_close()
     {
+        State& g = ctx();
         g.want_close = true;
         if (g.window) glfwSetWindowShouldClose(g.window, GLFW_TRUE);
     }
 
     void poll_events()
     {
+        State& g = ctx();
         // clear key edge flags
         for (int i = 0; i < State::KEY_MAX; ++i)
         {
@@ -1603,6 +2418,17 @@ namespace Engine_
         g.mouse_entered = false;
         g.mouse_left = false;
 
+        if (!g.cfg.headless)
+            glfwPollEvents();
+
+        if (g.fixed_dt > 0.0)
+        {
+            // Every poll is exactly one step, however long the frame really took.
+            g.sim_time += g.fixed_dt;
+            g.dt = g.fixed_dt;
+            return;
+        }
+
         double now = 0.0;
         if (g.cfg.headless)
         {
@@ -1611,7 +2437,6 @@ namespace Engine_
         }
         else
         {
-            glfwPollEvents();
             now = glfwGetTime();
         }
 
@@ -1622,6 +2447,8 @@ namespace Engine_
 
     double time_seconds()
     {
+        State& g = ctx();
+        if (g.fixed_dt > 0.0) return g.sim_time;
         if (g.cfg.headless)
         {
             auto t = std::chrono::steady_clock::now();
@@ -1630,68 +2457,86 @@ namespace Engine_
         return g.gl_ready ? glfwGetTime() : 0.0;
     }
 
-    double delta_seconds() { return g.dt; }
+    double delta_seconds() { return ctx().dt; }
+
+    void set_fixed_timestep(double dt)
+    {
+        State& g = ctx();
+        g.fixed_dt = std::max(0.0, dt);
+        g.sim_time = 0.0;
+        if (g.fixed_dt > 0.0) g.dt = g.fixed_dt;
+    }
+
+    double fixed_timestep() { return ctx().fixed_dt; }
 
     bool key_down(int key)
     {
+        State& g = ctx();
         if (key < 0 || key >= State::KEY_MAX) return false;
         return g.key_down[key];
     }
 
     bool key_pressed(int key)
     {
+        State& g = ctx();
         if (key < 0 || key >= State::KEY_MAX) return false;
         return g.key_pressed[key];
     }
 
     bool key_released(int key)
     {
+        State& g = ctx();
         if (key < 0 || key >= State::KEY_MAX) return false;
         return g.key_released[key];
     }
 
-    double mouse_x() { return g.mouse_x; }
-    double mouse_y() { return g.mouse_y; }
-    double mouse_prev_x() { return g.mouse_prev_x; }
-    double mouse_prev_y() { return g.mouse_prev_y; }
-    double mouse_dx() { return g.mouse_dx; }
-    double mouse_dy() { return g.mouse_dy; }
-    bool mouse_moved() { return g.mouse_moved; }
+    double mouse_x() { return ctx().mouse_x; }
+    double mouse_y() { return ctx().mouse_y; }
+    double mouse_prev_x() { return ctx().mouse_prev_x; }
+    double mouse_prev_y() { return ctx().mouse_prev_y; }
+    double mouse_dx() { return ctx().mouse_dx; }
+    double mouse_dy() { return ctx().mouse_dy; }
+    bool mouse_moved() { return ctx().mouse_moved; }
 
     bool mouse_down(int button)
     {
+        State& g = ctx();
         if (button < 0 || button >= State::MOUSE_BUTTON_MAX) return false;
         return g.mouse_down[button];
     }
 
     bool mouse_pressed(int button)
     {
+        State& g = ctx();
         if (button < 0 || button >= State::MOUSE_BUTTON_MAX) return false;
         return g.mouse_pressed[button];
     }
 
     bool mouse_released(int button)
     {
+        State& g = ctx();
         if (button < 0 || button >= State::MOUSE_BUTTON_MAX) return false;
         return g.mouse_released[button];
     }
 
-    double mouse_scroll_x() { return g.mouse_scroll_x; }
-    double mouse_scroll_y() { return g.mouse_scroll_y; }
-    bool mouse_scrolled() { return g.mouse_scrolled; }
+    double mouse_scroll_x() { return ctx().mouse_scroll_x; }
+    double mouse_scroll_y() { return ctx().mouse_scroll_y; }
+    bool mouse_scrolled() { return ctx().mouse_scrolled; }
 
-    bool mouse_in_window() { return g.mouse_in_window; }
-    bool mouse_entered() { return g.mouse_entered; }
-    bool mouse_left() { return g.mouse_left; }
+    bool mouse_in_window() { return ctx().mouse_in_window; }
+    bool mouse_entered() { return ctx().mouse_entered; }
+    bool mouse_left() { return ctx().mouse_left; }
 
     double mouse_fb_x()
     {
+        State& g = ctx();
         if (g.display_w <= 0 || g.fb_w <= 0) return 0.0;
         return (g.mouse_x / (double)g.display_w) * (double)g.fb_w;
     }
 
     double mouse_fb_y()
     {
+        State& g = ctx();
         if (g.display_h <= 0 || g.fb_h <= 0) return 0.0;
         return (g.mouse_y / (double)g.display_h) * (double)g.fb_h;
     }
@@ -1708,6 +2553,7 @@ namespace Engine_
 
     void set_cursor_visible(bool visible)
     {
+        State& g = ctx();
         g.cursor_visible = visible;
         if (g.cfg.headless || !g.window) return;
 
@@ -1715,10 +2561,11 @@ namespace Engine_
         glfwSetInputMode(g.window, GLFW_CURSOR, visible ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_HIDDEN);
     }
 
-    bool cursor_visible() { return g.cursor_visible; }
+    bool cursor_visible() { return ctx().cursor_visible; }
 
     void set_cursor_captured(bool captured)
     {
+        State& g = ctx();
         g.cursor_captured = captured;
         if (g.cfg.headless || !g.window) return;
 
@@ -1732,18 +2579,19 @@ namespace Engine_
         }
     }
 
-    bool cursor_captured() { return g.cursor_captured; }
+    bool cursor_captured() { return ctx().cursor_captured; }
 
     // ------------------------------------------------------------
     // Framebuffer / state
     // ------------------------------------------------------------
-    int fb_width() { return g.fb_w; }
-    int fb_height() { return g.fb_h; }
-    int display_width() { return g.display_w; }
-    int display_height() { return g.display_h; }
+    int fb_width() { return ctx().fb_w; }
+    int fb_height() { return ctx().fb_h; }
+    int display_width() { return ctx().display_w; }
+    int display_height() { return ctx().display_h; }
 
     void resize_framebuffer(int new_w, int new_h)
     {
+        State& g = ctx();
         new_w = std::max(1, new_w);
         new_h = std::max(1, new_h);
 
@@ -1761,7 +2609,9 @@ namespace Engine_
         }
 
         g.post_out.clear();
+        g.post_aa_in.clear();
         g.bloom.reset();
+        g.post_pool.clear();
 
         g.dirty_empty = true;
 
@@ -1776,6 +2626,7 @@ namespace Engine_
 
     void enable_depth(bool enabled)
     {
+        State& g = ctx();
         g.depth_on = enabled;
         if (enabled)
             g.depth.assign((size_t)g.fb_w * g.fb_h, 1.0f);
@@ -1783,13 +2634,14 @@ namespace Engine_
             g.depth.clear();
     }
 
-    bool depth_enabled() { return g.depth_on; }
+    bool depth_enabled() { return ctx().depth_on; }
 
-    void set_blend_mode(BlendMode m) { g.blend = m; }
-    BlendMode blend_mode() { return g.blend; }
+    void set_blend_mode(BlendMode m) { ctx().blend = m; }
+    BlendMode blend_mode() { return ctx().blend; }
 
     void set_clip_rect(int x, int y, int w, int h)
     {
+        State& g = ctx();
         g.clip_on = true;
         g.clip_x = clampi(x, 0, g.fb_w);
         g.clip_y = clampi(y, 0, g.fb_h);
@@ -1797,10 +2649,11 @@ namespace Engine_
         g.clip_h = clampi(h, 0, g.fb_h - g.clip_y);
     }
 
-    void disable_clip_rect() { g.clip_on = false; }
+    void disable_clip_rect() { ctx().clip_on = false; }
 
     void clear_color(Color c)
     {
+        State& g = ctx();
         for (int y = 0; y < g.fb_h; ++y)
         {
             for (int x = 0; x < g.fb_w; ++x)
@@ -1819,14 +2672,16 @@ namespace Engine_
 
     void clear_depth(float z)
     {
+        State& g = ctx();
         if (!g.depth_on) return;
         std::fill(g.depth.begin(), g.depth.end(), z);
     }
 
-    bool can_present() { return g.can_present && g.gl_ready && !g.cfg.headless; }
+    bool can_present() { return ctx().can_present && ctx().gl_ready && !ctx().cfg.headless; }
 
     void set_present_filter_linear(bool linear)
     {
+        State& g = ctx();
         g.present_linear = linear;
         if (g.gl_ready && g.tex)
         {
@@ -1838,6 +2693,13 @@ namespace Engine_
 
     void flush_to_screen(bool apply_postprocess)
     {
+        State& g = ctx();
+        const PresentListener& listener = g.present_listener;
+        const bool notify = listener.frame && (!listener.wants || listener.wants());
+        if (!can_present() && !notify) return;
+
+        const uint8_t* src = build_postprocess_output(apply_postprocess);
+        if (notify) listener.frame(src, g.fb_w, g.fb_h);
         if (!can_present()) return;
 
         // Query actual window framebuffer size (for HiDPI)
@@ -1850,8 +2712,6 @@ namespace Engine_
         glDisable(GL_DEPTH_TEST);
         glDisable(GL_BLEND);
 
-        const uint8_t* src = build_postprocess_output(apply_postprocess);
-
         glBindTexture(GL_TEXTURE_2D, g.tex);
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
@@ -1873,59 +2733,138 @@ namespace Engine_
         glfwSwapBuffers(g.window);
     }
 
-    void set_postprocess(const PostProcessSettings& s) { g.post = s; }
-    const PostProcessSettings& postprocess() { return g.post; }
+    void set_present_listener(PresentListener listener) { ctx().present_listener = std::move(listener); }
+
+    void set_postprocess(const PostProcessSettings& s) { ctx().post = s; ctx().post_chain.compiled = false; }
+    const PostProcessSettings& postprocess() { return ctx().post; }
 
     // ------------------------------------------------------------
     // Capture
     // ------------------------------------------------------------
     void set_capture_filepath(const std::string& filepath)
     {
+        State& g = ctx();
+        g.capture_stream.reset(); // finishes the previous stream, if any
+
         fs::path p(filepath);
+        g.capture_streaming = stream_format_for(p.extension().string(), g.capture_stream_format);
         if (p.has_extension())
         {
             g.capture_hint_png = p;
             g.capture_dir.clear();
+            g.capture_format = capture_format_for(p.extension().string());
         }
         else
         {
             g.capture_dir = p;
             g.capture_hint_png.clear();
+            g.capture_format = CaptureFormat::Png;
         }
     }
 
-    void set_frame_index(uint64_t idx) { g.frame_idx = idx; }
-    uint64_t frame_index() { return g.frame_idx; }
-    void next_frame() { g.frame_idx++; }
+    void set_capture_fps(int fps) { ctx().capture_stream_options.fps = std::max(1, fps); }
+    void set_capture_compression(bool lz) { ctx().capture_stream_options.compress = lz; }
+    void set_capture_delta(bool enabled) { ctx().capture_stream_options.delta = enabled; }
+
+    void set_frame_index(uint64_t idx) { ctx().frame_idx = idx; }
+    uint64_t frame_index() { return ctx().frame_idx; }
+    void next_frame() { ctx().frame_idx++; }
+
+    static void save_frame_stream(bool apply_postprocess)
+    {
+        State& g = ctx();
+        if (!g.capture_stream)
+        {
+            ensure_parent_dir(g.capture_hint_png);
+            g.capture_stream = std::make_unique<CaptureStream>(g.capture_hint_png.string(),
+                g.capture_stream_format, g.fb_w, g.fb_h, g.capture_stream_options);
+        }
+        if (!g.capture_stream->ok()) return;
+
+        if (g.capture_stream->width() != g.fb_w || g.capture_stream->height() != g.fb_h)
+        {
+            std::cerr << "[Engine] Capture stream is " << g.capture_stream->width() << "x" << g.capture_stream->height()
+                << ", framebuffer is " << g.fb_w << "x" << g.fb_h << "; frame skipped\n";
+            return;
+        }
+
+        const uint8_t* src = build_postprocess_output(apply_postprocess);
+        std::vector<uint8_t> rgba = g.capture_stream->acquire_buffer();
+
+        if (src == g.post_out.data())
+            rgba.swap(g.post_out);
+        else
+            std::memcpy(rgba.data(), src, rgba.size());
+
+        g.capture_stream->submit(std::move(rgba), g.frame_idx);
+    }
 
     void save_frame_png(bool apply_postprocess)
     {
+        State& g = ctx();
+        if (g.capture_streaming)
+        {
+            save_frame_stream(apply_postprocess);
+            return;
+        }
+
         fs::path out = resolve_capture_path();
         ensure_parent_dir(out);
 
         const uint8_t* src = build_postprocess_output(apply_postprocess);
-        int stride = g.fb_w * 4;
+        const size_t bytes = (size_t)g.fb_w * g.fb_h * 4;
 
-        int ok = stbi_write_png(out.string().c_str(), g.fb_w, g.fb_h, 4, src, stride);
-        if (!ok)
-            std::cerr << "[Engine] stbi_write_png failed: " << out.string() << "\n";
+        if (!g.capture_queue)
+        {
+            const int threads = clampi((int)std::thread::hardware_concurrency() / 2, 1, 4);
+            g.capture_queue = std::make_unique<CaptureQueue>(threads, threads * 2);
+        }
+
+        CaptureFrame frame;
+        frame.format = g.capture_format;
+        frame.path = out.string();
+        frame.w = g.fb_w;
+        frame.h = g.fb_h;
+        frame.rgba = g.capture_queue->acquire_buffer(bytes);
+
+        if (src == g.post_out.data())
+            frame.rgba.swap(g.post_out); // hand the postprocess result over; post_out gets the recycled buffer
         else
-            std::cout << "[Engine] Saved: " << out.string() << "\n";
+            std::memcpy(frame.rgba.data(), src, bytes);
+
+        g.capture_queue->submit(std::move(frame));
+    }
+
+    void flush_captures()
+    {
+        State& g = ctx();
+        if (g.capture_queue)
+            g.capture_queue->flush();
+        if (g.capture_stream)
+            g.capture_stream->flush();
+    }
+
+    void read_frame(std::vector<uint8_t>& rgba, bool apply_postprocess)
+    {
+        State& g = ctx();
+        const uint8_t* src = build_postprocess_output(apply_postprocess);
+        rgba.assign(src, src + (size_t)g.fb_w * g.fb_h * 4);
     }
 
     // ------------------------------------------------------------
     // Raw buffer access
     // ------------------------------------------------------------
-    const uint8_t* fb_rgba() { return g.color.data(); }
-    uint8_t* fb_rgba_mut() { return g.color.data(); }
+    const uint8_t* fb_rgba() { return ctx().color.data(); }
+    uint8_t* fb_rgba_mut() { return ctx().color.data(); }
 
     // ------------------------------------------------------------
     // 2D primitives public
     // ------------------------------------------------------------
-    void set_pixel(int x, int y, Color c) { write_pixel(x, y, c); }
+    void set_pixel(int x, int y, Color c) { write_pixel(ctx(), x, y, c); }
 
     Color get_pixel(int x, int y)
     {
+        State& g = ctx();
         Color c{};
         if (x < 0 || y < 0 || x >= g.fb_w || y >= g.fb_h) return c;
         size_t i = idx_rgba(g.fb_w, x, y);
@@ -1936,20 +2875,101 @@ namespace Engine_
         return c;
     }
 
+    // Shared by the bulk writes: src_px(sx, sy) gives the source color of rectangle
+    // pixel (sx, sy); pixels are blended like write_pixel, rows split over the pool.
+    template <class SrcPx>
+    static void write_rect(int x, int y, int w, int h, const SrcPx& src_px)
+    {
+        State& g = ctx();
+        if (w <= 0 || h <= 0) return;
+        int x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+        if (!clip_write_rect(g, x0, y0, x1, y1)) return;
+
+        const BlendMode mode = g.blend;
+        const int min_rows = std::max(1, 16384 / (x1 - x0));
+        ctx_parallel_rows(y1 - y0, min_rows, [&](int r0, int r1)
+            {
+                for (int yy = y0 + r0; yy < y0 + r1; ++yy)
+                {
+                    uint8_t* d = &g.color[idx_rgba(g.fb_w, x0, yy)];
+                    for (int xx = x0; xx < x1; ++xx, d += 4)
+                        blend_into(d, src_px(xx - x, yy - y), mode);
+                }
+            });
+        dirty_add_rect(g, x0, y0, x1 - x0, y1 - y0);
+    }
+
+    void write_pixels(int x, int y, int w, int h, const uint8_t* rgba, int stride_bytes)
+    {
+        if (!rgba) return;
+        const size_t stride = stride_bytes > 0 ? (size_t)stride_bytes : (size_t)std::max(w, 0) * 4;
+
+        State& g = ctx();
+        if (g.blend == BlendMode::Overwrite)
+        {
+            // Plain row copies.
+            int x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+            if (w <= 0 || h <= 0 || !clip_write_rect(g, x0, y0, x1, y1)) return;
+            for (int yy = y0; yy < y1; ++yy)
+                std::memcpy(&g.color[idx_rgba(g.fb_w, x0, yy)],
+                    rgba + (size_t)(yy - y) * stride + (size_t)(x0 - x) * 4, (size_t)(x1 - x0) * 4);
+            dirty_add_rect(g, x0, y0, x1 - x0, y1 - y0);
+            return;
+        }
+
+        write_rect(x, y, w, h, [&](int sx, int sy)
+            {
+                const uint8_t* p = rgba + (size_t)sy * stride + (size_t)sx * 4;
+                return Color{ p[0], p[1], p[2], p[3] };
+            });
+    }
+
+    void write_pixels_palette(int x, int y, int w, int h, const float* values, const Color* palette, int palette_size)
+    {
+        if (!values || !palette || palette_size <= 0) return;
+        const float last = (float)(palette_size - 1);
+        write_rect(x, y, w, h, [&](int sx, int sy)
+            {
+                const float v = values[(size_t)sy * w + sx];
+                const float f = std::clamp(v == v ? v : 0.0f, 0.0f, 1.0f) * last; // NaN -> entry 0
+                return palette[(int)(f + 0.5f)];
+            });
+    }
+
+    void read_pixels(int x, int y, int w, int h, uint8_t* rgba, int stride_bytes)
+    {
+        State& g = ctx();
+        if (!rgba || w <= 0 || h <= 0) return;
+        const size_t stride = stride_bytes > 0 ? (size_t)stride_bytes : (size_t)w * 4;
+
+        const int x0 = std::clamp(x, 0, g.fb_w);
+        const int x1 = std::clamp(x + w, 0, g.fb_w);
+        for (int sy = 0; sy < h; ++sy)
+        {
+            uint8_t* out = rgba + (size_t)sy * stride;
+            const int yy = y + sy;
+            std::memset(out, 0, (size_t)w * 4);
+            if (yy >= 0 && yy < g.fb_h && x0 < x1)
+                std::memcpy(out + (size_t)(x0 - x) * 4, &g.color[idx_rgba(g.fb_w, x0, yy)], (size_t)(x1 - x0) * 4);
+        }
+    }
+
     void draw_line(int x0, int y0, int x1, int y1, Color c, int thickness)
     {
-        draw_line_bres(x0, y0, x1, y1, c, thickness);
-        dirty_add_rect(std::min(x0, x1), std::min(y0, y1), std::abs(x1 - x0) + 1, std::abs(y1 - y0) + 1);
+        State& g = ctx();
+        draw_line_bres(g, x0, y0, x1, y1, c, thickness);
+        dirty_add_rect(g, std::min(x0, x1), std::min(y0, y1), std::abs(x1 - x0) + 1, std::abs(y1 - y0) + 1);
     }
 
     void draw_rect(int x, int y, int w, int h, Color c, bool filled, int thickness)
     {
+        State& g = ctx();
         if (w <= 0 || h <= 0) return;
         if (filled)
         {
             for (int yy = y; yy < y + h; ++yy)
                 for (int xx = x; xx < x + w; ++xx)
-                    write_pixel(xx, yy, c);
+                    write_pixel(g, xx, yy, c);
         }
         else
         {
@@ -1958,18 +2978,19 @@ namespace Engine_
             {
                 int xx0 = x + t, yy0 = y + t, ww = w - 2 * t, hh = h - 2 * t;
                 if (ww <= 0 || hh <= 0) break;
-                for (int xx = xx0; xx < xx0 + ww; ++xx) { write_pixel(xx, yy0, c); write_pixel(xx, yy0 + hh - 1, c); }
-                for (int yy = yy0; yy < yy0 + hh; ++yy) { write_pixel(xx0, yy, c); write_pixel(xx0 + ww - 1, yy, c); }
+                for (int xx = xx0; xx < xx0 + ww; ++xx) { write_pixel(g, xx, yy0, c); write_pixel(g, xx, yy0 + hh - 1, c); }
+                for (int yy = yy0; yy < yy0 + hh; ++yy) { write_pixel(g, xx0, yy, c); write_pixel(g, xx0 + ww - 1, yy, c); }
             }
         }
-        dirty_add_rect(x, y, w, h);
+        dirty_add_rect(g, x, y, w, h);
     }
 
     void draw_circle(int cx, int cy, int radius, Color c, bool filled, int thickness)
     {
-        if (filled) draw_circle_filled(cx, cy, radius, c);
-        else draw_circle_outline(cx, cy, radius, c, thickness);
-        dirty_add_rect(cx - radius, cy - radius, radius * 2 + 1, radius * 2 + 1);
+        State& g = ctx();
+        if (filled) draw_circle_filled(g, cx, cy, radius, c);
+        else draw_circle_outline(g, cx, cy, radius, c, thickness);
+        dirty_add_rect(g, cx - radius, cy - radius, radius * 2 + 1, radius * 2 + 1);
     }
 
     void draw_triangle_outline(Vec2 a, Vec2 b, Vec2 c, Color col, int thickness)
@@ -1981,22 +3002,26 @@ namespace Engine_
 
     void draw_triangle_filled(Vec2 a, Vec2 b, Vec2 c, Color col)
     {
-        draw_tri_flat(a, b, c, col);
+        State& g = ctx();
+        draw_tri_flat(g, a, b, c, col);
     }
 
     void draw_triangle_filled_grad(Vec2 a, Color ca, Vec2 b, Color cb, Vec2 c, Color cc)
     {
-        draw_tri_grad(a, ca, b, cb, c, cc);
+        State& g = ctx();
+        draw_tri_grad(g, a, ca, b, cb, c, cc);
     }
 
     void draw_triangle_textured(Vec2 a, Vec2 ua, Vec2 b, Vec2 ub, Vec2 c, Vec2 uc,
         const Image& tex, Color tint)
     {
-        draw_tri_tex(a, ua, b, ub, c, uc, tex, tint);
+        State& g = ctx();
+        draw_tri_tex(g, a, ua, b, ub, c, uc, tex, tint);
     }
 
     void draw_image(const Image& img, int dstx, int dsty, bool alpha_blend)
     {
+        State& g = ctx();
         if (!img.valid()) return;
 
         BlendMode old = g.blend;
@@ -2020,12 +3045,12 @@ namespace Engine_
                 c.b = img.rgba[si + 2];
                 c.a = img.rgba[si + 3];
 
-                write_pixel(xx, yy, c);
+                write_pixel(g, xx, yy, c);
             }
         }
 
         g.blend = old;
-        dirty_add_rect(dstx, dsty, img.w, img.h);
+        dirty_add_rect(g, dstx, dsty, img.w, img.h);
     }
 
     // ------------------------------------------------------------
@@ -2037,6 +3062,7 @@ namespace Engine_
         const Image* texture,
         bool enable_depth_test)
     {
+        State& g = ctx();
         if (!verts || vcount <= 0 || !indices || icount <= 0) return;
         if ((icount % 3) != 0) return;
 
@@ -2045,7 +3071,7 @@ namespace Engine_
         std::vector<bool> ok((size_t)vcount, false);
 
         for (int i = 0; i < vcount; ++i)
-            ok[(size_t)i] = project_vertex(verts[i], mvp, proj[(size_t)i]);
+            ok[(size_t)i] = project_vertex(g, verts[i], mvp, proj[(size_t)i]);
 
         // Draw triangles
         for (int i = 0; i < icount; i += 3)
@@ -2056,7 +3082,7 @@ namespace Engine_
             if (ia >= (uint32_t)vcount || ib >= (uint32_t)vcount || ic >= (uint32_t)vcount) continue;
             if (!ok[ia] || !ok[ib] || !ok[ic]) continue;
 
-            draw_tri_3d(proj[ia], proj[ib], proj[ic], texture, enable_depth_test);
+            draw_tri_3d(g, proj[ia], proj[ib], proj[ic], texture, enable_depth_test);
         }
     }
 }
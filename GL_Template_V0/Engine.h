@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -146,10 +148,63 @@ namespace Engine_
         float gamma = 2.2f;  // typical display gamma
     };
 
+    // 3D color LUT: size^3 RGB entries, red varies fastest (same order as .cube files).
+    struct ColorLut3D
+    {
+        int size = 0;
+        std::vector<float> rgb; // size^3 * 3
+        float domain_min[3]{ 0.0f, 0.0f, 0.0f };
+        float domain_max[3]{ 1.0f, 1.0f, 1.0f };
+        bool valid() const { return size >= 2 && rgb.size() == (size_t)size * size * size * 3; }
+    };
+
+    // .cube text file (LUT_3D_SIZE, optional DOMAIN_MIN / DOMAIN_MAX).
+    ColorLut3D load_cube_lut(const std::string& path);
+
+    // Bake from a graded identity image: HALD (square, w = level^3) or
+    // strip (w = n*n, h = n; x = r + b*n, y = g).
+    ColorLut3D bake_lut_from_image(const Image& img);
+
+    // .cube -> load_cube_lut, anything else -> load_image_rgba + bake_lut_from_image.
+    ColorLut3D load_color_lut(const std::string& path);
+
+    enum class LutInterp
+    {
+        Tetrahedral,
+        Trilinear
+    };
+
+    struct GradeSettings
+    {
+        bool  enabled = false;
+        float strength = 1.0f; // 0 = ungraded, 1 = full LUT
+        LutInterp interp = LutInterp::Tetrahedral;
+
+        // Shared so copying settings around stays cheap.
+        std::shared_ptr<const ColorLut3D> lut;
+    };
+
+    // FXAA-style edge AA on the final image (cheap alternative to supersampling)
+    struct AntiAliasSettings
+    {
+        bool  enabled = false;
+
+        // Minimum local luma contrast, relative to the brightest neighbor, to count as an edge
+        float edge_threshold = 0.125f;
+
+        // Absolute contrast floor (skips dark noise)
+        float edge_threshold_min = 0.0312f;
+
+        // Sub-pixel smoothing amount in [0..1] (1 = softest)
+        float subpixel = 0.75f;
+    };
+
     struct PostProcessSettings
     {
         BloomSettings bloom{};
         ToneSettings  tone{};
+        GradeSettings grade{}; // applied after tone (display-referred)
+        AntiAliasSettings aa{}; // runs last
     };
 
     // ------------------------------------------------------------
@@ -180,6 +235,36 @@ namespace Engine_
     bool init(const Config& cfg);
     void shutdown();
 
+    // ------------------------------------------------------------
+    // Render contexts
+    // A context owns a framebuffer + depth, blend/clip state, postprocess and
+    // capture state. Every function in this header acts on the calling thread's
+    // current context; unless set_current_context() says otherwise that is the
+    // default context, which init()/shutdown() set up (with the window).
+    // Extra contexts render on the CPU only (Config::headless is forced), so
+    // independent renders can run on separate threads, one context each.
+    // ------------------------------------------------------------
+    class Context;
+
+    Context* create_context(const Config& cfg);
+    void destroy_context(Context* c);     // flushes its pending captures
+    void set_current_context(Context* c); // this thread only; nullptr = default context
+    Context* current_context();           // nullptr while the default context is current
+
+    // Makes `c` current for a scope, then restores the previous one.
+    class ContextScope
+    {
+    public:
+        explicit ContextScope(Context* c);
+        ~ContextScope();
+
+        ContextScope(const ContextScope&) = delete;
+        ContextScope& operator=(const ContextScope&) = delete;
+
+    private:
+        Context* prev_ = nullptr;
+    };
+
     // ------------------------------------------------------------
     // Loop + input
     // ------------------------------------------------------------
@@ -189,6 +274,11 @@ namespace Engine_
     double time_seconds();      // from GLFW timer (or monotonic fallback headless)
     double delta_seconds();     // time since last poll_events()
 
+    // Offline rendering: dt > 0 makes every poll_events() advance time_seconds() by
+    // exactly dt (reproducible, independent of real time). 0 = back to the real clock.
+    void set_fixed_timestep(double dt);
+    double fixed_timestep();
+
     bool key_down(int key);
     bool key_pressed(int key);  // true only on the frame the key transitions up->down
     bool key_released(int key);
@@ -259,6 +349,16 @@ namespace Engine_
     void set_present_filter_linear(bool linear);
     void flush_to_screen(bool apply_postprocess = true);
 
+    // Observer of presented frames (live preview, ...). flush_to_screen() asks wants()
+    // first and only then builds the output (also headless) and calls frame() with it,
+    // so a rate-limited listener costs nothing on the frames it skips. Per context.
+    struct PresentListener
+    {
+        std::function<bool()> wants; // empty = every frame
+        std::function<void(const uint8_t* rgba, int w, int h)> frame;
+    };
+    void set_present_listener(PresentListener listener); // {} removes it
+
     // Post process
     void set_postprocess(const PostProcessSettings& s);
     const PostProcessSettings& postprocess();
@@ -266,14 +366,33 @@ namespace Engine_
     // ------------------------------------------------------------
     // Capture
     // ------------------------------------------------------------
-    void set_capture_filepath(const std::string& filepath); // dir or .png hint
+    // Directory, or a file hint whose extension picks the format:
+    //   .png  -> stb PNG (smallest files)
+    //   .fpng -> fast parallel PNG (written as .png, larger files, much quicker)
+    //   .qoi  -> QOI (fastest encode)
+    //   .rgba / .y4m -> every saved frame appended to that one file (or named pipe;
+    //                   "-.y4m" = stdout) instead of numbered files. See Capture.h.
+    //   .frames -> indexed single-file archive (extract with --extract, see main.cpp)
+    void set_capture_filepath(const std::string& filepath);
+    void set_capture_fps(int fps); // frame rate written into .y4m headers (default 60)
+    void set_capture_compression(bool lz); // LZ-compress .frames archives (default true)
+    void set_capture_delta(bool enabled);  // .frames: store repeats / changed tiles only (default true)
     void set_frame_index(uint64_t idx);
     uint64_t frame_index();
     void next_frame(); // increments frame index
 
     // Saves post-processed output if apply_postprocess=true, otherwise raw framebuffer.
+    // (Despite the name, the format follows set_capture_filepath.)
+    // The frame is copied and encoded on background threads; this only blocks when
+    // too many frames are still pending.
     void save_frame_png(bool apply_postprocess = true);
 
+    // Wait until every queued capture is written (shutdown() does this too).
+    void flush_captures();
+
+    // Copy of the current frame (post-processed unless apply_postprocess=false), fb_w*fb_h*4.
+    void read_frame(std::vector<uint8_t>& rgba, bool apply_postprocess = true);
+
     // ------------------------------------------------------------
     // Raw buffer access (Lua friendly)
     // ------------------------------------------------------------
@@ -286,6 +405,15 @@ namespace Engine_
     void set_pixel(int x, int y, Color c);
     Color get_pixel(int x, int y);
 
+    // Bulk pixels: a w*h rectangle at (x, y); rgba rows are stride_bytes apart (0 = w*4).
+    // Writes blend and clip exactly like set_pixel on every pixel (Overwrite copies rows).
+    // Reads return the raw framebuffer; pixels outside it read as 0.
+    void write_pixels(int x, int y, int w, int h, const uint8_t* rgba, int stride_bytes = 0);
+    void read_pixels(int x, int y, int w, int h, uint8_t* rgba, int stride_bytes = 0);
+
+    // values[w*h] in [0..1] (row-major) pick the nearest of palette_size colors.
+    void write_pixels_palette(int x, int y, int w, int h, const float* values, const Color* palette, int palette_size);
+
     void draw_line(int x0, int y0, int x1, int y1, Color c, int thickness = 1);
 
     void draw_rect(int x, int y, int w, int h, Color c, bool filled = true, int thickness = 1);
@@ -0,0 +1,186 @@
+#include "JobPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Engine_
+{
+    namespace
+    {
+        // One parallel_for() call. Lives on the caller's stack; workers only touch it
+        // while registered in `users`, and the caller waits for users == 0 before returning.
+        struct Batch
+        {
+            const std::function<void(int)>* fn = nullptr;
+            int count = 0;
+            std::atomic<int> next{ 0 };
+            std::atomic<int> done{ 0 };
+            int users = 0; // guarded by Impl::m
+
+            // First exception thrown by fn; later items are skipped (but still counted done).
+            std::atomic<bool> failed{ false };
+            std::mutex error_m;
+            std::exception_ptr error;
+        };
+
+        static void drain(Batch& b)
+        {
+            for (;;)
+            {
+                const int i = b.next.fetch_add(1, std::memory_order_relaxed);
+                if (i >= b.count) return;
+                if (!b.failed.load(std::memory_order_relaxed))
+                {
+                    try
+                    {
+                        (*b.fn)(i);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lk(b.error_m);
+                        if (!b.error) b.error = std::current_exception();
+                        b.failed.store(true, std::memory_order_relaxed);
+                    }
+                }
+                b.done.fetch_add(1, std::memory_order_acq_rel);
+            }
+        }
+    }
+
+    struct JobPool::Impl
+    {
+        std::mutex m;
+        std::condition_variable cv_work;
+        std::condition_variable cv_done;
+        std::deque<Batch*> batches;
+        std::vector<std::thread> threads;
+        bool stop = false;
+
+        void worker_loop()
+        {
+            for (;;)
+            {
+                Batch* b = nullptr;
+                {
+                    std::unique_lock<std::mutex> lk(m);
+                    cv_work.wait(lk, [&] { return stop || !batches.empty(); });
+                    if (stop && batches.empty()) return;
+
+                    b = batches.front();
+                    if (b->next.load(std::memory_order_relaxed) >= b->count)
+                    {
+                        // Fully claimed: retire it so the others stop looking at it.
+                        batches.pop_front();
+                        continue;
+                    }
+                    b->users++;
+                }
+
+                drain(*b);
+
+                {
+                    std::lock_guard<std::mutex> lk(m);
+                    b->users--;
+                    if (b->users == 0 && b->done.load(std::memory_order_acquire) == b->count)
+                        cv_done.notify_all();
+                }
+            }
+        }
+    };
+
+    JobPool::JobPool(int worker_threads)
+        : impl_(new Impl())
+    {
+        worker_threads = std::max(0, worker_threads);
+        impl_->threads.reserve((size_t)worker_threads);
+        for (int i = 0; i < worker_threads; ++i)
+            impl_->threads.emplace_back([this] { impl_->worker_loop(); });
+    }
+
+    JobPool::~JobPool()
+    {
+        {
+            std::lock_guard<std::mutex> lk(impl_->m);
+            impl_->stop = true;
+        }
+        impl_->cv_work.notify_all();
+        for (auto& t : impl_->threads)
+            if (t.joinable()) t.join();
+        delete impl_;
+    }
+
+    JobPool& JobPool::shared()
+    {
+        static JobPool pool((int)std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    int JobPool::worker_count() const { return (int)impl_->threads.size(); }
+
+    void JobPool::parallel_for(int count, const std::function<void(int)>& fn)
+    {
+        if (count <= 0) return;
+
+        if (count == 1 || impl_->threads.empty())
+        {
+            for (int i = 0; i < count; ++i) fn(i);
+            return;
+        }
+
+        Batch b;
+        b.fn = &fn;
+        b.count = count;
+
+        {
+            std::lock_guard<std::mutex> lk(impl_->m);
+            impl_->batches.push_back(&b);
+        }
+        impl_->cv_work.notify_all();
+
+        // The caller always works on its own batch.
+        drain(b);
+
+        std::unique_lock<std::mutex> lk(impl_->m);
+        impl_->cv_done.wait(lk, [&] {
+            return b.users == 0 && b.done.load(std::memory_order_acquire) == b.count;
+            });
+
+        auto it = std::find(impl_->batches.begin(), impl_->batches.end(), &b);
+        if (it != impl_->batches.end()) impl_->batches.erase(it);
+        lk.unlock();
+
+        if (b.error) std::rethrow_exception(b.error);
+    }
+
+    void parallel_rows(int rows, int min_rows, const std::function<void(int, int)>& fn)
+    {
+        if (rows <= 0) return;
+        min_rows = std::max(1, min_rows);
+
+        JobPool& pool = JobPool::shared();
+
+        // A few bands per thread keeps the load balanced when rows differ in cost.
+        const int threads = pool.worker_count() + 1;
+        int bands = std::min(threads * 4, (rows + min_rows - 1) / min_rows);
+        bands = std::max(1, bands);
+
+        if (bands == 1)
+        {
+            fn(0, rows);
+            return;
+        }
+
+        pool.parallel_for(bands, [&](int i) {
+            const int y0 = (int)((int64_t)rows * i / bands);
+            const int y1 = (int)((int64_t)rows * (i + 1) / bands);
+            if (y1 > y0) fn(y0, y1);
+            });
+    }
+}
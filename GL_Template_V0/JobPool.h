@@ -0,0 +1,40 @@
+#pragma once
+
+#include <functional>
+
+namespace Engine_
+{
+    // ------------------------------------------------------------
+    // Small fork/join worker pool.
+    // parallel_for() runs fn(0..count-1) on the workers *and* the calling
+    // thread, and blocks until every item finished. Safe to call from several
+    // threads at once and from inside a job (the caller always helps, so
+    // nested calls cannot deadlock). If fn throws, items not yet started are
+    // skipped and the first exception is rethrown on the calling thread once
+    // every running item has returned.
+    // ------------------------------------------------------------
+    class JobPool
+    {
+    public:
+        explicit JobPool(int worker_threads);
+        ~JobPool();
+
+        JobPool(const JobPool&) = delete;
+        JobPool& operator=(const JobPool&) = delete;
+
+        // Process-wide pool (hardware_concurrency - 1 workers), created on first use.
+        static JobPool& shared();
+
+        int worker_count() const;
+
+        void parallel_for(int count, const std::function<void(int)>& fn);
+
+    private:
+        struct Impl;
+        Impl* impl_ = nullptr;
+    };
+
+    // Split [0, rows) into contiguous bands and run fn(y_begin, y_end) per band
+    // on the shared pool. Bands are never smaller than min_rows.
+    void parallel_rows(int rows, int min_rows, const std::function<void(int, int)>& fn);
+}
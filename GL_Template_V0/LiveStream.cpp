@@ -0,0 +1,283 @@
+#include "LiveStream.h"
+
+#include "Capture.h"
+
+#include <httplib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../External_libs/stb/image/stb_image_write.h"
+
+namespace Engine_
+{
+    namespace
+    {
+        using Clock = std::chrono::steady_clock;
+
+        // One published frame; clients hold it by shared_ptr while they send it.
+        struct LiveFrame
+        {
+            uint64_t seq = 0;
+            int w = 0;
+            int h = 0;
+            std::vector<uint8_t> rgba; // downscaled
+            std::string jpeg;
+        };
+
+        // Integer box filter: the smallest factor that brings w down to max_width.
+        static void downscale_box(const std::vector<uint8_t>& src, int w, int h, int max_width,
+            std::vector<uint8_t>& dst, int& dw, int& dh)
+        {
+            const int f = std::max(1, (w + std::max(1, max_width) - 1) / std::max(1, max_width));
+            dw = std::max(1, w / f);
+            dh = std::max(1, h / f);
+            if (f == 1)
+            {
+                dst = src;
+                return;
+            }
+
+            dst.resize((size_t)dw * dh * 4);
+            const uint32_t area = (uint32_t)(f * f);
+            for (int y = 0; y < dh; ++y)
+            {
+                uint8_t* out = dst.data() + (size_t)y * dw * 4;
+                for (int x = 0; x < dw; ++x)
+                {
+                    uint32_t sum[4] = { 0, 0, 0, 0 };
+                    for (int sy = 0; sy < f; ++sy)
+                    {
+                        const uint8_t* p = src.data() + ((size_t)(y * f + sy) * w + (size_t)x * f) * 4;
+                        for (int sx = 0; sx < f; ++sx, p += 4)
+                        {
+                            sum[0] += p[0];
+                            sum[1] += p[1];
+                            sum[2] += p[2];
+                            sum[3] += p[3];
+                        }
+                    }
+                    for (int c = 0; c < 4; ++c)
+                        out[x * 4 + c] = (uint8_t)((sum[c] + area / 2) / area);
+                }
+            }
+        }
+
+        static void append_to_string(void* context, void* data, int size)
+        {
+            static_cast<std::string*>(context)->append(static_cast<const char*>(data), (size_t)size);
+        }
+
+        static int64_t ticks_now() { return Clock::now().time_since_epoch().count(); }
+
+        const char* kIndexPage =
+            "<!doctype html><html><head><title>Live</title></head>"
+            "<body style=\"margin:0;background:#111\">"
+            "<img src=\"/live.mjpg\" style=\"display:block;margin:auto;max-width:100%\">"
+            "</body></html>\n";
+    }
+
+    struct LiveStream::Impl
+    {
+        LiveStreamOptions opt;
+        httplib::Server server;
+        std::thread server_thread;
+        std::thread encoder_thread;
+        bool running = false;
+
+        std::mutex m;
+        std::condition_variable cv_work;  // encoder: frame staged / stopping
+        std::condition_variable cv_frame; // clients: new frame published / stopping
+        bool stopping = false;
+
+        // Render thread -> encoder. `staged` is written by offer() only while !busy;
+        // the encoder takes it and clears busy once the result is published.
+        std::atomic<bool> busy{ false };
+        std::vector<uint8_t> staged;
+        int staged_w = 0;
+        int staged_h = 0;
+        Clock::time_point next_due{}; // render thread only
+
+        std::shared_ptr<const LiveFrame> latest; // guarded by m
+
+        // Encoding only runs while somebody watches.
+        std::atomic<int> viewers{ 0 };
+        std::atomic<int64_t> png_interest_until{ 0 };
+
+        explicit Impl(const LiveStreamOptions& o) : opt(o)
+        {
+            server.Get("/", [](const httplib::Request&, httplib::Response& res) {
+                res.set_content(kIndexPage, "text/html");
+                });
+            server.Get("/live.mjpg", [this](const httplib::Request&, httplib::Response& res) { serve_mjpeg(res); });
+            server.Get("/live.png", [this](const httplib::Request&, httplib::Response& res) { serve_png(res); });
+        }
+
+        std::shared_ptr<const LiveFrame> wait_newer(uint64_t seq, std::chrono::milliseconds timeout)
+        {
+            std::unique_lock<std::mutex> lk(m);
+            cv_frame.wait_for(lk, timeout, [&] { return stopping || (latest && latest->seq != seq); });
+            return stopping ? nullptr : latest;
+        }
+
+        void serve_mjpeg(httplib::Response& res)
+        {
+            res.set_header("Cache-Control", "no-cache");
+            viewers.fetch_add(1);
+
+            auto last_seq = std::make_shared<uint64_t>(0);
+            res.set_content_provider("multipart/x-mixed-replace; boundary=frame",
+                [this, last_seq](size_t, httplib::DataSink& sink) {
+                    std::shared_ptr<const LiveFrame> f = wait_newer(*last_seq, std::chrono::seconds(1));
+                    if (!f) return false;                // shutting down
+                    if (f->seq == *last_seq) return true; // nothing new yet, keep the connection
+                    *last_seq = f->seq;
+
+                    const std::string head = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: "
+                        + std::to_string(f->jpeg.size()) + "\r\n\r\n";
+                    return sink.write(head.data(), head.size())
+                        && sink.write(f->jpeg.data(), f->jpeg.size())
+                        && sink.write("\r\n", 2);
+                },
+                [this](bool) { viewers.fetch_sub(1); });
+        }
+
+        void serve_png(httplib::Response& res)
+        {
+            // Keep frames coming for a while; the first poll after a pause waits for a fresh one.
+            png_interest_until.store(ticks_now()
+                + std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(3)).count());
+
+            std::shared_ptr<const LiveFrame> f;
+            {
+                std::lock_guard<std::mutex> lk(m);
+                f = latest;
+            }
+            const std::shared_ptr<const LiveFrame> fresh = wait_newer(f ? f->seq : 0, std::chrono::milliseconds(500));
+            if (fresh) f = fresh;
+
+            std::vector<uint8_t> png;
+            if (!f || !encode_png_fast(f->rgba.data(), f->w, f->h, png))
+            {
+                res.status = 503;
+                res.set_content("no frame yet\n", "text/plain");
+                return;
+            }
+            res.set_header("Cache-Control", "no-cache");
+            res.set_content(reinterpret_cast<const char*>(png.data()), png.size(), "image/png");
+        }
+
+        void encoder_loop()
+        {
+            std::vector<uint8_t> frame;
+            uint64_t seq = 0;
+            for (;;)
+            {
+                int w = 0, h = 0;
+                {
+                    std::unique_lock<std::mutex> lk(m);
+                    cv_work.wait(lk, [&] { return stopping || busy.load(std::memory_order_acquire); });
+                    if (stopping) return;
+                    frame.swap(staged);
+                    w = staged_w;
+                    h = staged_h;
+                }
+
+                auto out = std::make_shared<LiveFrame>();
+                downscale_box(frame, w, h, opt.max_width, out->rgba, out->w, out->h);
+                stbi_write_jpg_to_func(append_to_string, &out->jpeg, out->w, out->h, 4, out->rgba.data(),
+                    std::clamp(opt.jpeg_quality, 1, 100));
+                out->seq = ++seq;
+
+                {
+                    std::lock_guard<std::mutex> lk(m);
+                    latest = std::move(out);
+                }
+                busy.store(false, std::memory_order_release);
+                cv_frame.notify_all();
+            }
+        }
+    };
+
+    LiveStream::LiveStream(const LiveStreamOptions& options)
+        : impl_(new Impl(options))
+    {
+    }
+
+    LiveStream::~LiveStream()
+    {
+        stop();
+        delete impl_;
+    }
+
+    bool LiveStream::start(int port)
+    {
+        Impl& s = *impl_;
+        if (s.running) return true;
+
+        if (!s.server.bind_to_port("127.0.0.1", port))
+        {
+            std::cerr << "[Engine] Live stream: cannot listen on 127.0.0.1:" << port << "\n";
+            return false;
+        }
+
+        s.running = true;
+        s.encoder_thread = std::thread([&s] { s.encoder_loop(); });
+        s.server_thread = std::thread([&s] { s.server.listen_after_bind(); });
+        std::cout << "[Engine] Live stream on http://127.0.0.1:" << port << "/ (live.mjpg, live.png)\n";
+        return true;
+    }
+
+    void LiveStream::stop()
+    {
+        Impl& s = *impl_;
+        if (!s.running) return;
+
+        {
+            std::lock_guard<std::mutex> lk(s.m);
+            s.stopping = true;
+        }
+        s.cv_work.notify_all();
+        s.cv_frame.notify_all();
+
+        s.server.stop();
+        if (s.server_thread.joinable()) s.server_thread.join();
+        if (s.encoder_thread.joinable()) s.encoder_thread.join();
+        s.running = false;
+    }
+
+    bool LiveStream::wants_frame() const
+    {
+        const Impl& s = *impl_;
+        if (!s.running || s.busy.load(std::memory_order_acquire)) return false;
+        if (s.viewers.load(std::memory_order_relaxed) == 0 && ticks_now() > s.png_interest_until.load(std::memory_order_relaxed))
+            return false;
+        return Clock::now() >= s.next_due;
+    }
+
+    void LiveStream::offer(const uint8_t* rgba, int w, int h)
+    {
+        if (!rgba || w <= 0 || h <= 0 || !wants_frame()) return;
+
+        Impl& s = *impl_;
+        const double fps = s.opt.max_fps > 0.0 ? s.opt.max_fps : 1000.0;
+        s.next_due = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+
+        s.staged.assign(rgba, rgba + (size_t)w * h * 4);
+        s.staged_w = w;
+        s.staged_h = h;
+        {
+            std::lock_guard<std::mutex> lk(s.m);
+            s.busy.store(true, std::memory_order_release);
+        }
+        s.cv_work.notify_one();
+    }
+}
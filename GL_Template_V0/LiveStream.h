@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Engine_
+{
+    // ------------------------------------------------------------
+    // Live preview over HTTP (localhost only), for watching headless runs.
+    //   /           small page showing the stream
+    //   /live.mjpg  multipart MJPEG, one part per encoded frame
+    //   /live.png   latest frame as PNG (poll it)
+    // The render thread only copies a frame when one is due (rate limit), someone
+    // is watching and the encoder is idle; downscaling and encoding happen on a
+    // background thread. Frames are dropped, never queued: a slow client simply
+    // gets the newest frame when it is ready for the next one.
+    // ------------------------------------------------------------
+    struct LiveStreamOptions
+    {
+        int max_width = 640;     // downscaled by an integer box filter to fit
+        double max_fps = 10.0;   // encoded frames per second, at most
+        int jpeg_quality = 75;
+    };
+
+    class LiveStream
+    {
+    public:
+        explicit LiveStream(const LiveStreamOptions& options = {});
+        ~LiveStream(); // stop()
+
+        LiveStream(const LiveStream&) = delete;
+        LiveStream& operator=(const LiveStream&) = delete;
+
+        bool start(int port); // 127.0.0.1:port, served from background threads
+        void stop();
+
+        // Render thread: cheap check, then hand over the frame (copied; never blocks on clients).
+        bool wants_frame() const;
+        void offer(const uint8_t* rgba, int w, int h);
+
+    private:
+        struct Impl;
+        Impl* impl_ = nullptr;
+    };
+}
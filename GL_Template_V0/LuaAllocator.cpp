@@ -0,0 +1,112 @@
+#include "LuaAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace Engine_
+{
+    LuaPoolAllocator::~LuaPoolAllocator() = default;
+
+    void* LuaPoolAllocator::bump(size_t block)
+    {
+        if ((size_t)(bump_end_ - bump_) < block)
+        {
+            // The tail of the old slab (< kMaxSmall bytes) is simply left unused.
+            std::unique_ptr<unsigned char[]> slab(new (std::nothrow) unsigned char[kSlabBytes]);
+            if (!slab) return nullptr;
+            bump_ = slab.get();
+            bump_end_ = bump_ + kSlabBytes;
+            slabs_.push_back(std::move(slab));
+            stats_.slab_bytes += kSlabBytes;
+        }
+        void* p = bump_;
+        bump_ += block;
+        return p;
+    }
+
+    void* LuaPoolAllocator::allocate(size_t size)
+    {
+        stats_.bytes_allocated += size;
+        if (size > kMaxSmall)
+        {
+            ++stats_.large_allocs;
+            return std::malloc(size);
+        }
+
+        ++stats_.small_allocs;
+        const size_t cls = class_of(size);
+        if (FreeBlock* b = free_[cls])
+        {
+            free_[cls] = b->next;
+            return b;
+        }
+        return bump((cls + 1) * kGranule);
+    }
+
+    void LuaPoolAllocator::release(void* p, size_t size)
+    {
+        if (size > kMaxSmall)
+        {
+            std::free(p);
+            return;
+        }
+        const size_t cls = class_of(size);
+        FreeBlock* b = static_cast<FreeBlock*>(p);
+        b->next = free_[cls];
+        free_[cls] = b;
+    }
+
+    // Lua passes the block's current size as osize whenever ptr is set (otherwise
+    // osize is an object type tag), so the size class never has to be stored.
+    void* LuaPoolAllocator::alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+    {
+        LuaPoolAllocator& self = *static_cast<LuaPoolAllocator*>(ud);
+
+        if (nsize == 0)
+        {
+            if (ptr)
+            {
+                self.release(ptr, osize);
+                self.stats_.bytes_in_use -= osize;
+            }
+            return nullptr;
+        }
+
+        if (!ptr)
+        {
+            void* p = self.allocate(nsize);
+            if (p) self.stats_.bytes_in_use += nsize;
+            return p;
+        }
+
+        // Resize. A block that stays in its size class does not move; large blocks
+        // that stay large go through realloc.
+        const bool oldSmall = osize <= kMaxSmall;
+        const bool newSmall = nsize <= kMaxSmall;
+        void* p = nullptr;
+        if (oldSmall && newSmall && class_of(osize) == class_of(nsize))
+        {
+            p = ptr;
+        }
+        else if (!oldSmall && !newSmall)
+        {
+            p = std::realloc(ptr, nsize);
+            if (!p) return nullptr; // Lua keeps the old block
+            ++self.stats_.large_allocs;
+            if (nsize > osize) self.stats_.bytes_allocated += nsize - osize;
+        }
+        else
+        {
+            p = self.allocate(nsize);
+            if (!p) return nullptr;
+            std::memcpy(p, ptr, std::min(osize, nsize));
+            self.release(ptr, osize);
+        }
+
+        self.stats_.bytes_in_use += nsize;
+        self.stats_.bytes_in_use -= osize;
+        return p;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Engine_
+{
+    // ------------------------------------------------------------
+    // Pooled allocator for a Lua state (lua_newstate(LuaPoolAllocator::alloc, &pool)).
+    // Blocks up to kMaxSmall bytes come from per-size-class free lists, refilled by
+    // bumping through 64 KiB slabs, so the tables, strings and closures scripts
+    // churn through every frame are recycled instead of going to malloc. Bigger
+    // blocks use malloc.
+    // Slabs are kept until the allocator is destroyed; it must outlive every state
+    // using it. Not thread-safe: one allocator per Lua state (or per host thread).
+    // ------------------------------------------------------------
+    class LuaPoolAllocator
+    {
+    public:
+        static constexpr size_t kGranule = 16;
+        static constexpr size_t kMaxSmall = 256;
+
+        struct Stats
+        {
+            size_t bytes_in_use = 0;      // what Lua asked for and has not freed yet
+            size_t slab_bytes = 0;        // reserved for small blocks
+            uint64_t bytes_allocated = 0; // running total, for GC pacing
+            uint64_t small_allocs = 0;
+            uint64_t large_allocs = 0;
+        };
+
+        LuaPoolAllocator() = default;
+        ~LuaPoolAllocator();
+
+        LuaPoolAllocator(const LuaPoolAllocator&) = delete;
+        LuaPoolAllocator& operator=(const LuaPoolAllocator&) = delete;
+
+        // lua_Alloc: ud is the LuaPoolAllocator.
+        static void* alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+        const Stats& stats() const { return stats_; }
+
+    private:
+        static constexpr size_t kClasses = kMaxSmall / kGranule;
+        static constexpr size_t kSlabBytes = 64 * 1024;
+
+        struct FreeBlock { FreeBlock* next; };
+
+        static size_t class_of(size_t size) { return (size - 1) / kGranule; } // size in 1..kMaxSmall
+
+        void* allocate(size_t size);
+        void release(void* p, size_t size);
+        void* bump(size_t block);
+
+        FreeBlock* free_[kClasses] = {};
+        unsigned char* bump_ = nullptr;
+        unsigned char* bump_end_ = nullptr;
+        std::vector<std::unique_ptr<unsigned char[]>> slabs_;
+        Stats stats_;
+    };
+}
@@ -0,0 +1,249 @@
+#include "LuaBytecodeCache.h"
+
+#include <lua.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace Engine_
+{
+    namespace
+    {
+        void fnv1a(uint64_t& h, const void* data, size_t n)
+        {
+            const uint8_t* p = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < n; ++i)
+            {
+                h ^= uint64_t(p[i]);
+                h *= 1099511628211ull;
+            }
+        }
+
+        bool read_file(const fs::path& p, std::string& out)
+        {
+            std::ifstream f(p, std::ios::binary);
+            if (!f) return false;
+            std::ostringstream ss;
+            ss << f.rdbuf();
+            out = ss.str();
+            return (bool)f || f.eof();
+        }
+
+        // Write next to the target and rename, so concurrent readers never see a partial file.
+        void write_file_atomic(const fs::path& p, const std::string& bytes)
+        {
+            std::ostringstream tmpName;
+            tmpName << p.filename().string() << "." << std::this_thread::get_id() << ".tmp";
+            const fs::path tmp = p.parent_path() / tmpName.str();
+            {
+                std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+                if (!f) return;
+                f.write(bytes.data(), (std::streamsize)bytes.size());
+                if (!f) return;
+            }
+            std::error_code ec;
+            fs::rename(tmp, p, ec);
+            if (ec) fs::remove(tmp, ec);
+        }
+
+        // Cache file: header, then the lua_dump output. Lua does not verify bytecode
+        // (a flipped byte can crash the VM), so nothing is loaded unless the digest
+        // of the bytes matches the header.
+        struct FileHeader
+        {
+            char magic[8];
+            uint64_t source_key; // version + chunk name + source text
+            uint64_t digest;     // of the bytecode that follows
+            uint64_t size;
+        };
+        constexpr char kMagic[8] = { 'L', 'U', 'A', 'C', 'C', 'H', '0', '1' };
+
+        uint64_t digest_of(const char* data, size_t n)
+        {
+            uint64_t h = 1469598103934665603ull;
+            fnv1a(h, data, n);
+            return h;
+        }
+
+        // Bytecode of a valid cache file whose source key matches; false otherwise.
+        bool parse_cache_file(const std::string& file, uint64_t source_key, std::string& bytecode, bool& corrupt)
+        {
+            corrupt = true;
+            if (file.size() < sizeof(FileHeader)) return false;
+            FileHeader h;
+            std::memcpy(&h, file.data(), sizeof(h));
+            if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) return false;
+            if (h.size != file.size() - sizeof(FileHeader)) return false;
+            const char* body = file.data() + sizeof(FileHeader);
+            if (h.digest != digest_of(body, (size_t)h.size)) return false;
+            corrupt = false;
+            if (h.source_key != source_key) return false; // intact but stale
+            bytecode.assign(body, (size_t)h.size);
+            return true;
+        }
+
+        std::string make_cache_file(uint64_t source_key, const std::string& bytecode)
+        {
+            FileHeader h;
+            std::memcpy(h.magic, kMagic, sizeof(kMagic));
+            h.source_key = source_key;
+            h.digest = digest_of(bytecode.data(), bytecode.size());
+            h.size = bytecode.size();
+            std::string file(reinterpret_cast<const char*>(&h), sizeof(h));
+            file += bytecode;
+            return file;
+        }
+
+        int dump_writer(lua_State*, const void* p, size_t sz, void* ud)
+        {
+            static_cast<std::string*>(ud)->append(static_cast<const char*>(p), sz);
+            return 0;
+        }
+    }
+
+    LuaBytecodeCache::LuaBytecodeCache(fs::path dir)
+        : dir_(std::move(dir))
+    {
+    }
+
+    int LuaBytecodeCache::load_file(lua_State* L, const std::string& path)
+    {
+        std::string source;
+        if (!read_file(path, source))
+        {
+            lua_pushfstring(L, "cannot read %s", path.c_str());
+            return LUA_ERRFILE;
+        }
+
+        // One cache file per module path (an edited script overwrites its entry);
+        // the source key inside tells whether it still matches the file.
+        const std::string chunkname = "@" + path;
+        uint64_t pathKey = 1469598103934665603ull;
+        fnv1a(pathKey, chunkname.data(), chunkname.size());
+        uint64_t key = pathKey;
+        fnv1a(key, LUA_VERSION_RELEASE, sizeof(LUA_VERSION_RELEASE));
+        fnv1a(key, source.data(), source.size());
+
+        char keyHex[17];
+        std::snprintf(keyHex, sizeof(keyHex), "%016llx", (unsigned long long)pathKey);
+        const fs::path cacheFile = dir_ / (std::string(keyHex) + ".luac");
+
+        auto mem = memory_.find(pathKey);
+        if (mem != memory_.end() && mem->second.source_key == key)
+        {
+            const std::string& bc = mem->second.bytecode;
+            if (luaL_loadbufferx(L, bc.data(), bc.size(), chunkname.c_str(), "b") == LUA_OK)
+            {
+                ++stats_.memory_hits;
+                return LUA_OK;
+            }
+            lua_pop(L, 1);
+            memory_.erase(mem);
+        }
+
+        std::string bytecode;
+        std::string file;
+        if (read_file(cacheFile, file))
+        {
+            bool corrupt = false;
+            if (parse_cache_file(file, key, bytecode, corrupt))
+            {
+                if (luaL_loadbufferx(L, bytecode.data(), bytecode.size(), chunkname.c_str(), "b") == LUA_OK)
+                {
+                    ++stats_.disk_hits;
+                    memory_[pathKey] = { key, std::move(bytecode) };
+                    return LUA_OK;
+                }
+                lua_pop(L, 1); // other Lua build: recompile below
+                corrupt = true;
+            }
+            if (corrupt)
+            {
+                std::error_code ec;
+                fs::remove(cacheFile, ec);
+            }
+        }
+
+        // Skip a UTF-8 BOM and a leading "#" line like luaL_loadfilex does.
+        size_t skip = 0;
+        if (source.compare(0, 3, "\xEF\xBB\xBF") == 0) skip = 3;
+        std::string_view text(source.data() + skip, source.size() - skip);
+        std::string commented;
+        if (!text.empty() && text[0] == '#')
+        {
+            // Keep the line count: blank out the first line instead of dropping it.
+            commented.assign(text);
+            const size_t eol = commented.find('\n');
+            commented.replace(0, eol == std::string::npos ? commented.size() : eol, "--");
+            text = commented;
+        }
+
+        const int status = luaL_loadbufferx(L, text.data(), text.size(), chunkname.c_str(), "t");
+        if (status != LUA_OK) return status;
+        ++stats_.compiled;
+
+        bytecode.clear();
+        if (lua_dump(L, &dump_writer, &bytecode, 0) == 0 && !bytecode.empty())
+        {
+            std::error_code ec;
+            fs::create_directories(dir_, ec);
+            write_file_atomic(cacheFile, make_cache_file(key, bytecode));
+            memory_[pathKey] = { key, std::move(bytecode) };
+        }
+        return LUA_OK;
+    }
+
+    // Same contract as Lua's file searcher: nothing when the module is not on
+    // package.path (the next searchers report that), otherwise loader + file name.
+    int LuaBytecodeCache::searcher(lua_State* L)
+    {
+        LuaBytecodeCache* self = static_cast<LuaBytecodeCache*>(lua_touserdata(L, lua_upvalueindex(1)));
+        const char* name = luaL_checkstring(L, 1);
+
+        lua_getglobal(L, "package");
+        lua_getfield(L, -1, "searchpath");
+        lua_pushstring(L, name);
+        lua_getfield(L, -3, "path");
+        lua_call(L, 2, 1);
+        if (!lua_isstring(L, -1)) return 0;
+        const char* path = lua_tostring(L, -1); // stays on the stack
+
+        // No C++ locals may be alive across luaL_error (it longjmps).
+        const int status = self->load_file(L, path);
+        if (status != LUA_OK)
+            return luaL_error(L, "error loading module '%s' from file '%s':\n\t%s", name, path, lua_tostring(L, -1));
+
+        lua_pushstring(L, path);
+        return 2;
+    }
+
+    void LuaBytecodeCache::install(lua_State* L)
+    {
+        lua_getglobal(L, "package");
+        lua_getfield(L, -1, "searchers");
+        if (!lua_istable(L, -1))
+        {
+            lua_pop(L, 2);
+            return;
+        }
+
+        // table.insert(package.searchers, 2, searcher)
+        const lua_Integer n = (lua_Integer)lua_rawlen(L, -1);
+        for (lua_Integer i = n; i >= 2; --i)
+        {
+            lua_rawgeti(L, -1, i);
+            lua_rawseti(L, -2, i + 1);
+        }
+        lua_pushlightuserdata(L, this);
+        lua_pushcclosure(L, &LuaBytecodeCache::searcher, 1);
+        lua_rawseti(L, -2, 2);
+        lua_pop(L, 2);
+    }
+}
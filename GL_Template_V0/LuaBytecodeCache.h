@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+struct lua_State;
+
+namespace Engine_
+{
+    // ------------------------------------------------------------
+    // Precompiled-chunk cache for require(). install() puts a searcher in front
+    // of Lua's file searcher: it finds the module on package.path as usual, hashes
+    // the file's bytes (plus its chunk name and the Lua version), and loads the
+    // cached bytecode when that hash matches instead of parsing the source. Misses
+    // are compiled from source, dumped with lua_dump (debug info kept, so errors
+    // still report file:line) and written to the cache directory.
+    // There is one file per module path, so edits replace their entry. Each file
+    // carries a header with the source hash and a digest of the bytecode; corrupt
+    // files are deleted and stale ones recompiled, since Lua itself does not
+    // verify bytecode.
+    // Bytecode stays in memory as well, so a hard reset (new VM in the same
+    // process) does not even read the cache files.
+    // One cache per Lua host; the directory may be shared between processes.
+    // ------------------------------------------------------------
+    class LuaBytecodeCache
+    {
+    public:
+        struct Stats
+        {
+            uint64_t memory_hits = 0;
+            uint64_t disk_hits = 0;
+            uint64_t compiled = 0;
+        };
+
+        explicit LuaBytecodeCache(std::filesystem::path dir);
+
+        // package.searchers[2] = cached searcher (the cache must outlive L).
+        void install(lua_State* L);
+
+        // Like luaL_loadfilex: pushes the chunk (or an error message) and returns
+        // the lua_load status.
+        int load_file(lua_State* L, const std::string& path);
+
+        const Stats& stats() const { return stats_; }
+
+    private:
+        static int searcher(lua_State* L);
+
+        std::filesystem::path dir_;
+        struct Entry
+        {
+            uint64_t source_key = 0;
+            std::string bytecode;
+        };
+
+        std::unordered_map<uint64_t, Entry> memory_; // module path key -> bytecode
+        Stats stats_;
+    };
+}
@@ -0,0 +1,319 @@
+#include "LuaProfiler.h"
+
+#include <lua.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace Engine_
+{
+    namespace
+    {
+        constexpr int kMaxDepth = 64;
+        constexpr size_t kMaxTimelineSamples = 2u << 20; // trace timeline cap; counts keep going
+
+        // Registry key: its address identifies the profiler slot of a state.
+        const char kRegistryKey = 0;
+
+        std::string json_escape(const std::string& s)
+        {
+            std::string o;
+            o.reserve(s.size());
+            for (char c : s)
+            {
+                switch (c)
+                {
+                case '"': o += "\\\""; break;
+                case '\\': o += "\\\\"; break;
+                case '\n': o += "\\n"; break;
+                case '\t': o += "\\t"; break;
+                default:
+                    if ((unsigned char)c < 0x20) o += ' ';
+                    else o += c;
+                }
+            }
+            return o;
+        }
+
+        // "update (scene.lua:120)", "[C] draw_line", "main chunk (main.lua)"
+        std::string frame_name(char what, const std::string& name, const std::string& source, int line)
+        {
+            std::string n;
+            if (what == 'C')
+            {
+                n = "[C] ";
+                n += name.empty() ? "?" : name;
+                return n;
+            }
+            if (what == 'm') n = "main chunk";
+            else n = name.empty() ? "?" : name;
+            n += " (";
+            n += source;
+            if (line > 0) n += ":" + std::to_string(line);
+            n += ")";
+            std::replace(n.begin(), n.end(), ';', ','); // ';' separates collapsed frames
+            return n;
+        }
+    }
+
+    LuaProfiler::LuaProfiler(int instructions_per_sample)
+        : every_(std::max(1, instructions_per_sample)), epoch_(clock::now())
+    {
+    }
+
+    LuaProfiler::~LuaProfiler()
+    {
+        stop();
+    }
+
+    double LuaProfiler::now_us() const
+    {
+        return std::chrono::duration<double, std::micro>(clock::now() - epoch_).count();
+    }
+
+    void LuaProfiler::start(lua_State* L)
+    {
+        if (L_ == L) return;
+        stop();
+        L_ = L;
+        function_ids_.clear(); // keys are addresses inside the previous state
+        lua_pushlightuserdata(L, this);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &kRegistryKey);
+        lua_sethook(L, &LuaProfiler::hook, LUA_MASKCOUNT, every_);
+    }
+
+    void LuaProfiler::stop()
+    {
+        if (!L_) return;
+        lua_sethook(L_, nullptr, 0, 0);
+        lua_pushnil(L_);
+        lua_rawsetp(L_, LUA_REGISTRYINDEX, &kRegistryKey);
+        L_ = nullptr;
+        if (in_frame_) end_frame();
+    }
+
+    void LuaProfiler::detach()
+    {
+        L_ = nullptr;
+        if (in_frame_) end_frame();
+    }
+
+    void LuaProfiler::hook(lua_State* L, lua_Debug* ar)
+    {
+        if (ar->event != LUA_HOOKCOUNT) return;
+        lua_rawgetp(L, LUA_REGISTRYINDEX, &kRegistryKey);
+        LuaProfiler* self = static_cast<LuaProfiler*>(lua_touserdata(L, -1));
+        lua_pop(L, 1);
+        if (self) self->record(L);
+    }
+
+    void LuaProfiler::record(lua_State* L)
+    {
+        // Walk leaf -> root, then store root first (collapsed stack order).
+        scratch_.clear();
+        lua_Debug ar;
+        for (int level = 0; level < kMaxDepth && lua_getstack(L, level, &ar); ++level)
+        {
+            if (!lua_getinfo(L, "S", &ar)) break;
+            scratch_.push_back(intern_function(L, ar));
+        }
+        if (scratch_.empty()) return;
+        std::reverse(scratch_.begin(), scratch_.end());
+
+        const uint32_t stack = intern_stack(scratch_);
+        ++stack_counts_[stack];
+        ++total_samples_;
+
+        if (in_frame_ && samples_.size() < kMaxTimelineSamples)
+            samples_.push_back({ now_us(), stack });
+    }
+
+    // Called per stack level per sample, so the hit path is one lookup on a key
+    // taken from "S" info. The source string lives as long as the chunk's
+    // functions, which is what the profile refers to.
+    uint32_t LuaProfiler::intern_function(lua_State* L, lua_Debug& ar)
+    {
+        const char what = ar.what ? ar.what[0] : 'L';
+        FunctionKey key{ ar.source, ar.linedefined, ar.lastlinedefined };
+        if (what == 'C')
+        {
+            // All C functions share source "=[C]": tell them apart by address.
+            lua_getinfo(L, "f", &ar);
+            key.id = reinterpret_cast<const void*>(lua_tocfunction(L, -1));
+            lua_pop(L, 1);
+        }
+
+        auto it = function_ids_.find(key);
+        if (it != function_ids_.end()) return it->second;
+
+        // First sighting: keep what the name is built from (the name as seen here).
+        FunctionInfo info;
+        info.what = what;
+        info.source = ar.short_src;
+        info.line = ar.linedefined;
+        if (lua_getinfo(L, "n", &ar) && ar.name) info.name = ar.name;
+
+        const uint32_t id = (uint32_t)functions_.size();
+        functions_.push_back(std::move(info));
+        function_ids_.emplace(key, id);
+        return id;
+    }
+
+    std::vector<std::string> LuaProfiler::function_names() const
+    {
+        std::vector<std::string> names;
+        names.reserve(functions_.size());
+        for (const FunctionInfo& f : functions_)
+            names.push_back(frame_name(f.what, f.name, f.source, f.line));
+        return names;
+    }
+
+    uint32_t LuaProfiler::intern_stack(const std::vector<uint32_t>& frames)
+    {
+        scratch_key_.assign(reinterpret_cast<const char*>(frames.data()), frames.size() * sizeof(uint32_t));
+        auto it = stack_ids_.find(scratch_key_);
+        if (it != stack_ids_.end()) return it->second;
+        const uint32_t id = (uint32_t)stacks_.size();
+        stacks_.push_back(frames);
+        stack_counts_.push_back(0);
+        stack_ids_.emplace(scratch_key_, id);
+        return id;
+    }
+
+    void LuaProfiler::begin_frame()
+    {
+        if (in_frame_) end_frame();
+        Frame f;
+        f.begin_us = now_us();
+        f.first_sample = f.sample_end = samples_.size();
+        frames_.push_back(f);
+        in_frame_ = true;
+    }
+
+    void LuaProfiler::end_frame()
+    {
+        if (!in_frame_) return;
+        Frame& f = frames_.back();
+        f.end_us = now_us();
+        f.sample_end = samples_.size();
+        in_frame_ = false;
+    }
+
+    void LuaProfiler::clear()
+    {
+        functions_.clear();
+        function_ids_.clear();
+        stacks_.clear();
+        stack_counts_.clear();
+        stack_ids_.clear();
+        samples_.clear();
+        frames_.clear();
+        in_frame_ = false;
+        total_samples_ = 0;
+    }
+
+    bool LuaProfiler::write_collapsed(const std::string& path) const
+    {
+        std::ofstream f(path, std::ios::binary);
+        if (!f) return false;
+        const std::vector<std::string> names = function_names();
+        for (size_t s = 0; s < stacks_.size(); ++s)
+        {
+            if (stack_counts_[s] == 0) continue;
+            const std::vector<uint32_t>& st = stacks_[s];
+            for (size_t i = 0; i < st.size(); ++i)
+            {
+                if (i) f << ';';
+                f << names[st[i]];
+            }
+            f << ' ' << stack_counts_[s] << '\n';
+        }
+        return (bool)f;
+    }
+
+    // Each frame becomes an "X" event; inside it, consecutive samples that share a
+    // call-stack prefix are merged into spans (a span ends at the next sample that
+    // left it, or at the end of the frame).
+    bool LuaProfiler::write_chrome_trace(const std::string& path) const
+    {
+        std::ofstream f(path, std::ios::binary);
+        if (!f) return false;
+        const std::vector<std::string> names = function_names();
+
+        char num[64];
+        bool first = true;
+        auto event = [&](const std::string& name, double ts, double dur, int depth) {
+            std::snprintf(num, sizeof(num), "%.3f,\"dur\":%.3f", ts, std::max(0.0, dur));
+            f << (first ? "\n" : ",\n")
+              << "{\"name\":\"" << json_escape(name) << "\",\"cat\":\"" << (depth < 0 ? "frame" : "lua")
+              << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << num << "}";
+            first = false;
+        };
+
+        f << "{\"traceEvents\":[";
+        f << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Lua\"}}";
+        first = false;
+
+        std::vector<uint32_t> open;    // function ids of the open spans, root first
+        std::vector<double> open_ts;
+        for (size_t fi = 0; fi < frames_.size(); ++fi)
+        {
+            const Frame& fr = frames_[fi];
+            event("frame " + std::to_string(fi), fr.begin_us, fr.end_us - fr.begin_us, -1);
+
+            open.clear();
+            open_ts.clear();
+            for (size_t si = fr.first_sample; si < fr.sample_end; ++si)
+            {
+                const Sample& sm = samples_[si];
+                const std::vector<uint32_t>& st = stacks_[sm.stack];
+
+                size_t common = 0;
+                while (common < open.size() && common < st.size() && open[common] == st[common]) ++common;
+                while (open.size() > common)
+                {
+                    event(names[open.back()], open_ts.back(), sm.t_us - open_ts.back(), (int)open.size());
+                    open.pop_back();
+                    open_ts.pop_back();
+                }
+                for (size_t d = common; d < st.size(); ++d)
+                {
+                    open.push_back(st[d]);
+                    open_ts.push_back(sm.t_us);
+                }
+            }
+            while (!open.empty())
+            {
+                event(names[open.back()], open_ts.back(), fr.end_us - open_ts.back(), (int)open.size());
+                open.pop_back();
+                open_ts.pop_back();
+            }
+        }
+
+        f << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return (bool)f;
+    }
+
+    std::string LuaProfiler::summary(int top) const
+    {
+        std::vector<uint64_t> self(functions_.size(), 0);
+        for (size_t s = 0; s < stacks_.size(); ++s)
+            if (!stacks_[s].empty()) self[stacks_[s].back()] += stack_counts_[s];
+
+        std::vector<uint32_t> order(functions_.size());
+        for (uint32_t i = 0; i < (uint32_t)order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return self[a] > self[b]; });
+
+        const std::vector<std::string> names = function_names();
+        std::ostringstream os;
+        char pct[32];
+        for (int i = 0; i < top && i < (int)order.size() && self[order[i]] > 0; ++i)
+        {
+            std::snprintf(pct, sizeof(pct), "%5.1f%%", total_samples_ ? 100.0 * (double)self[order[i]] / (double)total_samples_ : 0.0);
+            os << "  " << pct << "  " << self[order[i]] << "  " << names[order[i]] << "\n";
+        }
+        return os.str();
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct lua_State;
+struct lua_Debug;
+
+namespace Engine_
+{
+    // ------------------------------------------------------------
+    // Sampling profiler for Lua scripts. A count hook (lua_sethook, LUA_MASKCOUNT)
+    // fires every N VM instructions and records the current Lua call stack.
+    // Samples are grouped by frame (begin_frame / end_frame around the script's
+    // Update) and exported as
+    //   - collapsed stacks ("outer;inner;leaf count" per line), the input of
+    //     flamegraph.pl / speedscope / inferno,
+    //   - a Chrome trace (chrome://tracing, Perfetto): one event per frame plus
+    //     the sampled call spans inside it.
+    // Time spent inside C functions (engine calls) runs no Lua instructions, so it
+    // is attributed to the next sample taken after the call returns.
+    // Samples only store function ids (see intern_function); names are built when
+    // a profile is written. Most of the remaining cost is Lua's own: with a count
+    // hook set the VM checks the hook on every instruction.
+    // One profiler per Lua state; it only touches the state from its own thread.
+    // ------------------------------------------------------------
+    class LuaProfiler
+    {
+    public:
+        explicit LuaProfiler(int instructions_per_sample = 1000);
+        ~LuaProfiler();
+
+        LuaProfiler(const LuaProfiler&) = delete;
+        LuaProfiler& operator=(const LuaProfiler&) = delete;
+
+        // Installs the hook on L (replacing another profiler's hook). Recorded data
+        // is kept, so a new VM after a hard reset can be attached to the same run.
+        void start(lua_State* L);
+        void stop(); // removes the hook; the state must still be alive
+        void detach(); // forget the state without touching it (already closed)
+        bool running() const { return L_ != nullptr; }
+
+        void begin_frame();
+        void end_frame();
+
+        void clear();
+        uint64_t sample_count() const { return total_samples_; }
+        size_t frame_count() const { return frames_.size(); }
+
+        bool write_collapsed(const std::string& path) const;
+        bool write_chrome_trace(const std::string& path) const;
+
+        // "name (file:line)  N samples  P%" for the leaf frames seen most often.
+        std::string summary(int top) const;
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        struct Sample
+        {
+            double t_us; // since the profiler was created
+            uint32_t stack;
+        };
+
+        struct Frame
+        {
+            double begin_us = 0.0;
+            double end_us = 0.0;
+            size_t first_sample = 0; // into samples_
+            size_t sample_end = 0;
+        };
+
+        // Identifies a function without building its name: the chunk's source
+        // string plus its line range for Lua functions, the C function pointer for C.
+        struct FunctionKey
+        {
+            const void* id;
+            int line;
+            int last_line;
+            bool operator==(const FunctionKey& o) const { return id == o.id && line == o.line && last_line == o.last_line; }
+        };
+
+        struct FunctionKeyHash
+        {
+            size_t operator()(const FunctionKey& k) const
+            {
+                return std::hash<const void*>()(k.id) ^ (size_t(uint32_t(k.line) * 31u + uint32_t(k.last_line)) * size_t(0x9E3779B97F4A7C15ull));
+            }
+        };
+
+        // What the display name is built from (at export time).
+        struct FunctionInfo
+        {
+            char what = 'L'; // 'L' Lua, 'C' C, 'm' main chunk
+            std::string name;
+            std::string source; // short_src
+            int line = 0;
+        };
+
+        static void hook(lua_State* L, lua_Debug* ar);
+        void record(lua_State* L);
+        uint32_t intern_function(lua_State* L, lua_Debug& ar);
+        uint32_t intern_stack(const std::vector<uint32_t>& frames);
+        std::vector<std::string> function_names() const;
+        double now_us() const;
+
+        int every_ = 1000;
+        lua_State* L_ = nullptr;
+        clock::time_point epoch_;
+
+        std::vector<FunctionInfo> functions_;               // id -> name parts
+        std::unordered_map<FunctionKey, uint32_t, FunctionKeyHash> function_ids_;
+        std::vector<std::vector<uint32_t>> stacks_;         // id -> function ids, root first
+        std::vector<uint64_t> stack_counts_;                // id -> samples
+        std::unordered_map<std::string, uint32_t> stack_ids_; // packed ids -> stack id
+
+        std::vector<Sample> samples_;   // timeline for the trace (capped)
+        std::vector<Frame> frames_;
+        bool in_frame_ = false;
+        uint64_t total_samples_ = 0;
+
+        std::vector<uint32_t> scratch_;
+        std::string scratch_key_;
+    };
+}
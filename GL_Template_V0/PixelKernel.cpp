@@ -0,0 +1,651 @@
+#include "PixelKernel.h"
+
+#include "JobPool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Engine_
+{
+    namespace
+    {
+        // Pixels evaluated per instruction step (one register = kLanes doubles).
+        constexpr int kLanes = 32;
+        // Rows per job-pool band never cover fewer pixels than this.
+        constexpr int kMinPixelsPerBand = 4096;
+        constexpr int kMaxRegisters = 4096;
+
+        // Fixed registers; params follow, then constants and temporaries.
+        enum : uint16_t { kRegX, kRegY, kRegU, kRegV, kRegT, kRegW, kRegH, kFirstParam };
+
+        // Register levels: what a value depends on decides how often it is computed.
+        enum Level { kConst, kRun, kRow, kPixel };
+
+        enum Op : uint8_t
+        {
+            Add, Sub, Mul, Div, Mod, Pow, Neg,
+            Lt, Le, Gt, Ge,
+            Sin, Cos, Tan, Abs, Floor, Ceil, Fract, Round, Sqrt, Exp, Log,
+            Min, Max, Clamp, Mix, Step, Smoothstep, Smooth01,
+            Hash, Noise,
+            PalR, PalG, PalB, PalA
+        };
+
+        struct Builtin
+        {
+            const char* name;
+            Op op;
+            int arity;
+        };
+
+        const Builtin kBuiltins[] = {
+            { "sin", Sin, 1 }, { "cos", Cos, 1 }, { "tan", Tan, 1 }, { "abs", Abs, 1 },
+            { "floor", Floor, 1 }, { "ceil", Ceil, 1 }, { "fract", Fract, 1 }, { "round", Round, 1 },
+            { "sqrt", Sqrt, 1 }, { "exp", Exp, 1 }, { "log", Log, 1 }, { "pow", Pow, 2 },
+            { "min", Min, 2 }, { "max", Max, 2 }, { "clamp", Clamp, 3 },
+            { "mix", Mix, 3 }, { "lerp", Mix, 3 }, { "step", Step, 2 },
+            { "smoothstep", Smoothstep, 3 }, { "smooth01", Smooth01, 1 },
+            { "hash", Hash, 2 }, { "noise", Noise, 2 },
+            { "pal_r", PalR, 1 }, { "pal_g", PalG, 1 }, { "pal_b", PalB, 1 }, { "pal_a", PalA, 1 },
+        };
+
+        const Builtin* find_builtin(const std::string& name)
+        {
+            for (const Builtin& b : kBuiltins)
+                if (name == b.name) return &b;
+            return nullptr;
+        }
+
+        bool is_palette_op(uint8_t op) { return op >= PalR && op <= PalA; }
+
+        // Scalar helpers; written like the Lua scene helpers so the results match.
+        inline double fract1(double x) { return x - std::floor(x); }
+        inline double clamp3(double x, double lo, double hi) { return x < lo ? lo : (x > hi ? hi : x); }
+        inline double mix3(double a, double b, double t) { return a + (b - a) * t; }
+
+        inline double smooth01(double t)
+        {
+            t = clamp3(t, 0.0, 1.0);
+            return t * t * (3.0 - 2.0 * t);
+        }
+
+        inline double lua_mod(double a, double b)
+        {
+            double m = std::fmod(a, b);
+            if (m != 0.0 && (m < 0.0) != (b < 0.0)) m += b;
+            return m;
+        }
+
+        inline double hash2(double x, double y)
+        {
+            return fract1(std::sin(x * 127.1 + y * 311.7 + 74.7) * 43758.5453123);
+        }
+
+        // Value noise: hashed lattice corners, smoothly interpolated (0..1).
+        inline double noise2(double x, double y)
+        {
+            const double ix = std::floor(x), iy = std::floor(y);
+            const double sx = smooth01(x - ix), sy = smooth01(y - iy);
+            const double a = hash2(ix, iy), b = hash2(ix + 1.0, iy);
+            const double c = hash2(ix, iy + 1.0), d = hash2(ix + 1.0, iy + 1.0);
+            return mix3(mix3(a, b, sx), mix3(c, d, sx), sy);
+        }
+
+        inline double palette_channel(const std::vector<Color>& pal, double t, int ch)
+        {
+            if (pal.empty()) return 0.0;
+            const double f = clamp3(t == t ? t : 0.0, 0.0, 1.0) * (double)(pal.size() - 1);
+            const size_t i0 = (size_t)f;
+            const size_t i1 = std::min(i0 + 1, pal.size() - 1);
+            auto channel = [&](size_t i) {
+                const Color& c = pal[i];
+                return (double)(ch == 0 ? c.r : ch == 1 ? c.g : ch == 2 ? c.b : c.a);
+            };
+            return mix3(channel(i0), channel(i1), f - (double)i0);
+        }
+
+        inline uint8_t to_byte(double v)
+        {
+            if (!(v == v)) return 0;
+            return (uint8_t)clamp3(std::floor(v + 0.5), 0.0, 255.0);
+        }
+
+        // d[i] = op(a[i], b[i], c[i]) for n lanes. The switch sits outside the loops,
+        // so each case is a plain array loop the compiler can vectorize.
+        void exec(uint8_t op, double* d, const double* a, const double* b, const double* c, int n,
+            const std::vector<Color>& pal)
+        {
+#define KERNEL_LANES(expr) for (int i = 0; i < n; ++i) d[i] = (expr); break
+            switch (op)
+            {
+            case Add:        KERNEL_LANES(a[i] + b[i]);
+            case Sub:        KERNEL_LANES(a[i] - b[i]);
+            case Mul:        KERNEL_LANES(a[i] * b[i]);
+            case Div:        KERNEL_LANES(a[i] / b[i]);
+            case Mod:        KERNEL_LANES(lua_mod(a[i], b[i]));
+            case Pow:        KERNEL_LANES(std::pow(a[i], b[i]));
+            case Neg:        KERNEL_LANES(-a[i]);
+            case Lt:         KERNEL_LANES(a[i] < b[i] ? 1.0 : 0.0);
+            case Le:         KERNEL_LANES(a[i] <= b[i] ? 1.0 : 0.0);
+            case Gt:         KERNEL_LANES(a[i] > b[i] ? 1.0 : 0.0);
+            case Ge:         KERNEL_LANES(a[i] >= b[i] ? 1.0 : 0.0);
+            case Sin:        KERNEL_LANES(std::sin(a[i]));
+            case Cos:        KERNEL_LANES(std::cos(a[i]));
+            case Tan:        KERNEL_LANES(std::tan(a[i]));
+            case Abs:        KERNEL_LANES(std::fabs(a[i]));
+            case Floor:      KERNEL_LANES(std::floor(a[i]));
+            case Ceil:       KERNEL_LANES(std::ceil(a[i]));
+            case Fract:      KERNEL_LANES(fract1(a[i]));
+            case Round:      KERNEL_LANES(std::floor(a[i] + 0.5));
+            case Sqrt:       KERNEL_LANES(std::sqrt(a[i]));
+            case Exp:        KERNEL_LANES(std::exp(a[i]));
+            case Log:        KERNEL_LANES(std::log(a[i]));
+            case Min:        KERNEL_LANES(b[i] < a[i] ? b[i] : a[i]);
+            case Max:        KERNEL_LANES(b[i] > a[i] ? b[i] : a[i]);
+            case Clamp:      KERNEL_LANES(clamp3(a[i], b[i], c[i]));
+            case Mix:        KERNEL_LANES(mix3(a[i], b[i], c[i]));
+            case Step:       KERNEL_LANES(b[i] < a[i] ? 0.0 : 1.0);
+            case Smoothstep: KERNEL_LANES(smooth01((c[i] - a[i]) / (b[i] - a[i])));
+            case Smooth01:   KERNEL_LANES(smooth01(a[i]));
+            case Hash:       KERNEL_LANES(hash2(a[i], b[i]));
+            case Noise:      KERNEL_LANES(noise2(a[i], b[i]));
+            case PalR:       KERNEL_LANES(palette_channel(pal, a[i], 0));
+            case PalG:       KERNEL_LANES(palette_channel(pal, a[i], 1));
+            case PalB:       KERNEL_LANES(palette_channel(pal, a[i], 2));
+            case PalA:       KERNEL_LANES(palette_channel(pal, a[i], 3));
+            default: break;
+            }
+#undef KERNEL_LANES
+        }
+
+        bool is_name_start(char c) { return std::isalpha((unsigned char)c) || c == '_'; }
+        bool is_name_char(char c) { return std::isalnum((unsigned char)c) || c == '_'; }
+    }
+
+    // ------------------------------------------------------------
+    // Compiler: recursive descent straight to bytecode (no AST).
+    // Precedence, low to high (as in Lua): comparisons, + -, * / %, unary -, ^.
+    // ------------------------------------------------------------
+    class KernelCompiler
+    {
+    public:
+        KernelCompiler(const std::string& source, PixelKernel& k)
+            : src_(source), k_(k), reg_count_(kFirstParam + (int)k.param_names_.size())
+        {
+        }
+
+        bool compile(std::string& error)
+        {
+            try
+            {
+                next();
+                while (tok_.kind != Tok::End)
+                {
+                    if (accept(";")) continue;
+                    statement();
+                }
+                finish();
+                return true;
+            }
+            catch (const std::runtime_error& e)
+            {
+                error = "line " + std::to_string(error_line_ > 0 ? error_line_ : tok_.line) + ": " + e.what();
+                return false;
+            }
+        }
+
+    private:
+        enum class Tok { End, Number, Name, Punct };
+
+        struct Token
+        {
+            Tok kind = Tok::End;
+            std::string text;
+            double number = 0.0;
+            int line = 1;
+        };
+
+        struct Value
+        {
+            uint16_t reg = 0;
+            int level = kConst;
+            bool temp = false; // pixel temporary, recycled once consumed
+        };
+
+        [[noreturn]] static void fail(const std::string& msg) { throw std::runtime_error(msg); }
+
+        // ---- tokens ----
+
+        void next()
+        {
+            for (;;)
+            {
+                while (pos_ < src_.size() && std::isspace((unsigned char)src_[pos_]))
+                {
+                    if (src_[pos_] == '\n') ++line_;
+                    ++pos_;
+                }
+                if (src_.compare(pos_, 2, "--") != 0) break;
+                while (pos_ < src_.size() && src_[pos_] != '\n') ++pos_;
+            }
+
+            tok_ = Token{};
+            tok_.line = line_;
+            if (pos_ >= src_.size()) return;
+
+            const char c = src_[pos_];
+            if (std::isdigit((unsigned char)c) || (c == '.' && pos_ + 1 < src_.size() && std::isdigit((unsigned char)src_[pos_ + 1])))
+            {
+                const char* begin = src_.c_str() + pos_;
+                char* end = nullptr;
+                tok_.number = std::strtod(begin, &end);
+                tok_.kind = Tok::Number;
+                tok_.text.assign(begin, (size_t)(end - begin));
+                pos_ += (size_t)(end - begin);
+                return;
+            }
+            if (is_name_start(c))
+            {
+                const size_t start = pos_;
+                while (pos_ < src_.size() && is_name_char(src_[pos_])) ++pos_;
+                tok_.kind = Tok::Name;
+                tok_.text = src_.substr(start, pos_ - start);
+                return;
+            }
+            if ((c == '<' || c == '>') && pos_ + 1 < src_.size() && src_[pos_ + 1] == '=')
+            {
+                tok_.kind = Tok::Punct;
+                tok_.text = src_.substr(pos_, 2);
+                pos_ += 2;
+                return;
+            }
+            if (std::strchr("+-*/%^(),=<>;", c))
+            {
+                tok_.kind = Tok::Punct;
+                tok_.text.assign(1, c);
+                ++pos_;
+                return;
+            }
+            fail(std::string("unexpected character '") + c + "'");
+        }
+
+        bool is(const char* punct) const { return tok_.kind == Tok::Punct && tok_.text == punct; }
+
+        bool accept(const char* punct)
+        {
+            if (!is(punct)) return false;
+            next();
+            return true;
+        }
+
+        void expect(const char* punct)
+        {
+            if (!accept(punct)) fail(std::string("expected '") + punct + "' near '" + tok_.text + "'");
+        }
+
+        // ---- registers / emission ----
+
+        uint16_t new_register()
+        {
+            if (reg_count_ >= kMaxRegisters) fail("program too large");
+            return (uint16_t)reg_count_++;
+        }
+
+        Value constant(double v)
+        {
+            uint64_t bits = 0;
+            std::memcpy(&bits, &v, sizeof bits);
+            auto it = consts_.find(bits);
+            if (it == consts_.end())
+            {
+                it = consts_.emplace(bits, new_register()).first;
+                k_.consts_.push_back({ it->second, v });
+            }
+            return Value{ it->second, kConst, false };
+        }
+
+        double const_value(const Value& v) const
+        {
+            for (const auto& [reg, value] : k_.consts_)
+                if (reg == v.reg) return value;
+            return 0.0;
+        }
+
+        void release(const Value& v)
+        {
+            if (v.temp) free_.push_back(v.reg);
+        }
+
+        Value emit(Op op, const Value& a, const Value& b, const Value& c, int arity)
+        {
+            int level = std::max({ a.level, arity > 1 ? b.level : kConst, arity > 2 ? c.level : kConst });
+
+            if (level == kConst && !is_palette_op(op))
+            {
+                const double va = const_value(a), vb = const_value(b), vc = const_value(c);
+                double out = 0.0;
+                exec(op, &out, &va, &vb, &vc, 1, k_.palette_);
+                return constant(out);
+            }
+            level = std::max(level, (int)kRun); // the palette may change between runs
+
+            // Only pixel registers are recycled: lower levels run ahead of the pixel
+            // program, so their registers must keep their values for the whole run.
+            release(a);
+            if (arity > 1) release(b);
+            if (arity > 2) release(c);
+
+            uint16_t dst = 0;
+            if (level == kPixel && !free_.empty())
+            {
+                dst = free_.back();
+                free_.pop_back();
+            }
+            else
+            {
+                dst = new_register();
+            }
+
+            const PixelKernel::Instr in{ op, dst, a.reg, arity > 1 ? b.reg : (uint16_t)0, arity > 2 ? c.reg : (uint16_t)0 };
+            (level == kRun ? k_.run_ : level == kRow ? k_.row_ : k_.pixel_).push_back(in);
+            return Value{ dst, level, level == kPixel };
+        }
+
+        // ---- grammar ----
+
+        void statement()
+        {
+            if (tok_.kind != Tok::Name) fail("expected an assignment near '" + tok_.text + "'");
+            const std::string name = tok_.text;
+            if (input(name) || param(name) >= 0 || name == "pi" || name == "tau" || find_builtin(name))
+                fail("cannot assign to '" + name + "'");
+            next();
+            expect("=");
+            Value v = expr();
+            v.temp = false; // named values live until the end of the program
+            vars_[name] = v;
+        }
+
+        Value expr()
+        {
+            Value v = additive();
+            for (;;)
+            {
+                Op op;
+                if (is("<")) op = Lt;
+                else if (is("<=")) op = Le;
+                else if (is(">")) op = Gt;
+                else if (is(">=")) op = Ge;
+                else return v;
+                next();
+                const Value rhs = additive();
+                v = emit(op, v, rhs, Value{}, 2);
+            }
+        }
+
+        Value additive()
+        {
+            Value v = term();
+            for (;;)
+            {
+                Op op;
+                if (is("+")) op = Add;
+                else if (is("-")) op = Sub;
+                else return v;
+                next();
+                const Value rhs = term();
+                v = emit(op, v, rhs, Value{}, 2);
+            }
+        }
+
+        Value term()
+        {
+            Value v = unary();
+            for (;;)
+            {
+                Op op;
+                if (is("*")) op = Mul;
+                else if (is("/")) op = Div;
+                else if (is("%")) op = Mod;
+                else return v;
+                next();
+                const Value rhs = unary();
+                v = emit(op, v, rhs, Value{}, 2);
+            }
+        }
+
+        Value unary()
+        {
+            if (accept("-")) return emit(Neg, unary(), Value{}, Value{}, 1);
+            if (accept("+")) return unary();
+            return power();
+        }
+
+        Value power()
+        {
+            const Value base = primary();
+            if (!accept("^")) return base;
+            const Value e = unary(); // right-associative, 2^-x allowed
+            return emit(Pow, base, e, Value{}, 2);
+        }
+
+        Value primary()
+        {
+            if (tok_.kind == Tok::Number)
+            {
+                const double v = tok_.number;
+                next();
+                return constant(v);
+            }
+            if (accept("("))
+            {
+                const Value v = expr();
+                expect(")");
+                return v;
+            }
+            if (tok_.kind == Tok::End) fail("unexpected end of source");
+            if (tok_.kind != Tok::Name) fail("unexpected '" + tok_.text + "'");
+
+            const std::string name = tok_.text;
+            const int name_line = tok_.line;
+            next();
+            if (accept("(")) return call(name);
+
+            if (auto it = vars_.find(name); it != vars_.end()) return it->second;
+            if (const Value* in = input(name)) return *in;
+            if (const int p = param(name); p >= 0) return Value{ (uint16_t)(kFirstParam + p), kRun, false };
+            if (name == "pi") return constant(3.14159265358979323846);
+            if (name == "tau") return constant(3.14159265358979323846 * 2.0);
+            error_line_ = name_line; // point at the name, not at the token after it
+            fail("unknown name '" + name + "'");
+        }
+
+        Value call(const std::string& name)
+        {
+            const Builtin* fn = find_builtin(name);
+            if (!fn) fail("unknown function '" + name + "'");
+
+            Value args[3];
+            int n = 0;
+            if (!is(")"))
+            {
+                do
+                {
+                    if (n == fn->arity) fail(name + " takes " + std::to_string(fn->arity) + " argument(s)");
+                    args[n++] = expr();
+                } while (accept(","));
+            }
+            expect(")");
+            if (n != fn->arity) fail(name + " takes " + std::to_string(fn->arity) + " argument(s)");
+            return emit(fn->op, args[0], args[1], args[2], fn->arity);
+        }
+
+        const Value* input(const std::string& name) const
+        {
+            static const std::pair<const char*, Value> kInputs[] = {
+                { "x", { kRegX, kPixel, false } }, { "u", { kRegU, kPixel, false } },
+                { "y", { kRegY, kRow, false } },   { "v", { kRegV, kRow, false } },
+                { "t", { kRegT, kRun, false } },   { "w", { kRegW, kRun, false } }, { "h", { kRegH, kRun, false } },
+            };
+            for (const auto& [n, v] : kInputs)
+                if (name == n) return &v;
+            return nullptr;
+        }
+
+        int param(const std::string& name) const
+        {
+            for (size_t i = 0; i < k_.param_names_.size(); ++i)
+                if (k_.param_names_[i] == name) return (int)i;
+            return -1;
+        }
+
+        void finish()
+        {
+            const char* outputs[4] = { "r", "g", "b", "a" };
+            for (int i = 0; i < 4; ++i)
+            {
+                auto it = vars_.find(outputs[i]);
+                if (it != vars_.end()) k_.out_[i] = it->second.reg;
+                else if (i == 3) k_.out_[i] = constant(255.0).reg;
+                else fail("the kernel must assign r, g and b");
+            }
+            k_.reg_count_ = reg_count_;
+        }
+
+        const std::string& src_;
+        PixelKernel& k_;
+        size_t pos_ = 0;
+        int line_ = 1;
+        Token tok_;
+        int error_line_ = 0; // 0: report the current token's line
+
+        int reg_count_;
+        std::vector<uint16_t> free_;
+        std::map<uint64_t, uint16_t> consts_; // bit pattern -> register
+        std::unordered_map<std::string, Value> vars_;
+    };
+
+    std::shared_ptr<PixelKernel> PixelKernel::compile(const std::string& source,
+        const std::vector<std::pair<std::string, double>>& params, std::string& error)
+    {
+        auto k = std::make_shared<PixelKernel>();
+        for (const auto& [name, value] : params)
+        {
+            const bool valid = !name.empty() && is_name_start(name[0])
+                && std::all_of(name.begin(), name.end(), is_name_char);
+            if (!valid)
+            {
+                error = "bad param name '" + name + "'";
+                return nullptr;
+            }
+            k->param_names_.push_back(name);
+            k->params_.push_back(value);
+        }
+
+        KernelCompiler c(source, *k);
+        if (!c.compile(error)) return nullptr;
+        return k;
+    }
+
+    bool PixelKernel::set_param(const std::string& name, double value)
+    {
+        for (size_t i = 0; i < param_names_.size(); ++i)
+        {
+            if (param_names_[i] != name) continue;
+            params_[i] = value;
+            return true;
+        }
+        return false;
+    }
+
+    void PixelKernel::set_palette(std::vector<Color> palette)
+    {
+        palette_ = std::move(palette);
+    }
+
+    void PixelKernel::evaluate(int w, int h, double t, uint8_t* rgba) const
+    {
+        if (w <= 0 || h <= 0 || !rgba) return;
+
+        parallel_rows(h, std::max(1, kMinPixelsPerBand / w), [&](int y0, int y1)
+            {
+                std::vector<double> regs((size_t)reg_count_ * kLanes);
+                auto R = [&](uint16_t r) { return regs.data() + (size_t)r * kLanes; };
+                auto set = [&](uint16_t r, double v) { std::fill_n(R(r), kLanes, v); };
+
+                // Run and row programs compute lane 0 once and broadcast it, so the
+                // pixel program can read every register as a full block.
+                auto run_scalar = [&](const std::vector<Instr>& prog)
+                    {
+                        for (const Instr& in : prog)
+                        {
+                            double* d = R(in.dst);
+                            exec(in.op, d, R(in.a), R(in.b), R(in.c), 1, palette_);
+                            std::fill(d + 1, d + kLanes, d[0]);
+                        }
+                    };
+
+                for (const auto& [reg, value] : consts_) set(reg, value);
+                set(kRegT, t);
+                set(kRegW, (double)w);
+                set(kRegH, (double)h);
+                for (size_t i = 0; i < params_.size(); ++i) set((uint16_t)(kFirstParam + i), params_[i]);
+                run_scalar(run_);
+
+                double* xs = R(kRegX);
+                double* us = R(kRegU);
+                const double* ch[4] = { R(out_[0]), R(out_[1]), R(out_[2]), R(out_[3]) };
+
+                for (int yy = y0; yy < y1; ++yy)
+                {
+                    set(kRegY, (double)yy);
+                    set(kRegV, h > 1 ? (double)yy / (h - 1) : 0.0);
+                    run_scalar(row_);
+
+                    uint8_t* out = rgba + (size_t)yy * w * 4;
+                    for (int x0 = 0; x0 < w; x0 += kLanes)
+                    {
+                        const int n = std::min(kLanes, w - x0);
+                        for (int i = 0; i < n; ++i)
+                        {
+                            xs[i] = (double)(x0 + i);
+                            us[i] = w > 1 ? (double)(x0 + i) / (w - 1) : 0.0;
+                        }
+                        for (const Instr& in : pixel_)
+                            exec(in.op, R(in.dst), R(in.a), R(in.b), R(in.c), n, palette_);
+
+                        uint8_t* px = out + (size_t)x0 * 4;
+                        for (int i = 0; i < n; ++i, px += 4)
+                        {
+                            px[0] = to_byte(ch[0][i]);
+                            px[1] = to_byte(ch[1][i]);
+                            px[2] = to_byte(ch[2][i]);
+                            px[3] = to_byte(ch[3][i]);
+                        }
+                    }
+                }
+            });
+    }
+
+    void PixelKernel::run(int x, int y, int w, int h, double t) const
+    {
+        if (w <= 0 || h <= 0) return;
+        thread_local std::vector<uint8_t> scratch;
+        scratch.resize((size_t)w * h * 4);
+        evaluate(w, h, t, scratch.data());
+        write_pixels(x, y, w, h, scratch.data());
+    }
+
+    void PixelKernel::instruction_counts(int& per_run, int& per_row, int& per_pixel) const
+    {
+        per_run = (int)run_.size();
+        per_row = (int)row_.size();
+        per_pixel = (int)pixel_.size();
+    }
+}
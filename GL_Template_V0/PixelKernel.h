@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Engine.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Engine_
+{
+    // ------------------------------------------------------------
+    // Per-pixel expression kernels: a script registers a small program once,
+    // the engine evaluates it natively over a rectangle.
+    //
+    //   -- comments run to the end of the line
+    //   wave = sin((u * 7 + t) * tau) * 0.5 + noise(x * 0.1, y * 0.1) * 0.5
+    //   r = pal_r(wave)  g = pal_g(wave)  b = pal_b(wave)   -- a defaults to 255
+    //
+    // Inputs: x, y (pixel in the rectangle, from 0), u, v (x / (w-1), y / (h-1)),
+    // t, w, h, plus named params. Outputs r, g, b [, a] are 0..255, rounded and
+    // clamped like colors. Operators: + - * / % ^ < <= > >= (1 or 0).
+    // Functions: sin cos tan abs floor ceil fract round sqrt exp log pow min max
+    // clamp mix (lerp) step smoothstep smooth01 hash(x, y) noise(x, y) and
+    // pal_r / pal_g / pal_b / pal_a(t) (palette sampled linearly, t in 0..1).
+    //
+    // Compiled to register bytecode with constants folded; each instruction is
+    // placed at the cheapest level it can run at (once per run, once per row or
+    // per pixel). Pixel instructions process a block of lanes per step, so every
+    // op is a tight loop over plain arrays; row bands run on the job pool.
+    // All math is double, so results match the same expression written in Lua.
+    // ------------------------------------------------------------
+    class PixelKernel
+    {
+    public:
+        // nullptr and `error` set ("line N: ...") if the source does not compile.
+        static std::shared_ptr<PixelKernel> compile(const std::string& source,
+            const std::vector<std::pair<std::string, double>>& params, std::string& error);
+
+        bool set_param(const std::string& name, double value); // false: unknown param
+        void set_palette(std::vector<Color> palette);
+
+        // w*h*4 RGBA bytes, rows top to bottom.
+        void evaluate(int w, int h, double t, uint8_t* rgba) const;
+
+        // evaluate() and write the result at (x, y) like write_pixels (blend + clip).
+        void run(int x, int y, int w, int h, double t) const;
+
+        // Instructions per level: once per run, once per row, per pixel.
+        void instruction_counts(int& per_run, int& per_row, int& per_pixel) const;
+
+    private:
+        friend class KernelCompiler;
+
+        struct Instr
+        {
+            uint8_t op;
+            uint16_t dst, a, b, c; // registers
+        };
+
+        std::vector<Instr> run_;
+        std::vector<Instr> row_;
+        std::vector<Instr> pixel_;
+        std::vector<std::pair<uint16_t, double>> consts_;
+        std::vector<std::string> param_names_;
+        std::vector<double> params_;
+        std::vector<Color> palette_;
+        uint16_t out_[4] = { 0, 0, 0, 0 }; // r, g, b, a registers
+        int reg_count_ = 0;
+    };
+}
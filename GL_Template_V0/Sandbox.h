@@ -6,7 +6,12 @@
 #include <functional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
 
 namespace EngineLuaBridge_
@@ -14,19 +19,9 @@ namespace EngineLuaBridge_
 
 // -------------------------
 // Decode helpers (Lua -> C++)
-// All commands are Lua arrays: arr[1] = op string, arr[2..] = args
+// All commands are Lua arrays: arr[1] = opcode or op name, arr[2..] = args
 // -------------------------
 
-inline std::string get_op1(const sol::table& arr)
-{
-    sol::object o = arr[1];
-    if (!o.valid() || o.is<sol::lua_nil_t>())
-        throw std::runtime_error("Command array missing op at index 1");
-    if (!o.is<std::string>())
-        throw std::runtime_error("Command op at index 1 must be a string");
-    return o.as<std::string>();
-}
-
 inline int clamp_int(int v, int lo, int hi)
 {
     return std::max(lo, std::min(hi, v));
@@ -186,6 +181,7 @@ inline Engine_::Vec3 get_vec3(const sol::table& arr, int idx, Engine_::Vec3 def,
         if (required) throw std::runtime_error("Missing Vec3 arg at index " + std::to_string(idx));
         return def;
     }
+    if (o.is<Engine_::Vec3>()) return o.as<Engine_::Vec3>(); // Engine.Vec3
     if (!o.is<sol::table>())
         throw std::runtime_error("Expected Vec3 table at index " + std::to_string(idx));
     sol::table t = o.as<sol::table>();
@@ -221,6 +217,7 @@ inline Engine_::Mat4 get_mat4(const sol::table& arr, int idx, Engine_::Mat4 def,
         if (required) throw std::runtime_error("Missing Mat4 arg at index " + std::to_string(idx));
         return def;
     }
+    if (o.is<Engine_::Mat4>()) return o.as<Engine_::Mat4>(); // Engine.Mat4
     if (!o.is<sol::table>())
         throw std::runtime_error("Expected Mat4 table at index " + std::to_string(idx));
     sol::table t = o.as<sol::table>();
@@ -270,6 +267,15 @@ inline Engine_::Color get_color(const sol::table& arr, int idx, Engine_::Color d
     return c;
 }
 
+inline Engine_::BlendMode blend_mode_from_string(const std::string& s)
+{
+    if (s == "Overwrite") return Engine_::BlendMode::Overwrite;
+    if (s == "Alpha") return Engine_::BlendMode::Alpha;
+    if (s == "Additive") return Engine_::BlendMode::Additive;
+    if (s == "Multiply") return Engine_::BlendMode::Multiply;
+    throw std::runtime_error("Unknown BlendMode string: " + s);
+}
+
 inline Engine_::BlendMode get_blend_mode(const sol::table& arr, int idx, Engine_::BlendMode def, bool required)
 {
     sol::object o = arr[idx];
@@ -281,12 +287,7 @@ inline Engine_::BlendMode get_blend_mode(const sol::table& arr, int idx, Engine_
         return (Engine_::BlendMode)o.as<int>();
     }
     if (o.is<std::string>()) {
-        const std::string s = o.as<std::string>();
-        if (s == "Overwrite") return Engine_::BlendMode::Overwrite;
-        if (s == "Alpha") return Engine_::BlendMode::Alpha;
-        if (s == "Additive") return Engine_::BlendMode::Additive;
-        if (s == "Multiply") return Engine_::BlendMode::Multiply;
-        throw std::runtime_error("Unknown BlendMode string: " + s);
+        return blend_mode_from_string(o.as<std::string>());
     }
     throw std::runtime_error("Expected BlendMode (string or int) at index " + std::to_string(idx));
 }
@@ -302,6 +303,58 @@ inline const char* blend_mode_to_cstr(Engine_::BlendMode m)
     }
 }
 
+// -------------------------
+// Flat argument helpers (components passed as plain Lua values, no tables)
+// -------------------------
+inline Engine_::Color make_color(double r, double g, double b, double a)
+{
+    Engine_::Color c;
+    c.r = (uint8_t)clamp_int((int)r, 0, 255);
+    c.g = (uint8_t)clamp_int((int)g, 0, 255);
+    c.b = (uint8_t)clamp_int((int)b, 0, 255);
+    c.a = (uint8_t)clamp_int((int)a, 0, 255);
+    return c;
+}
+
+inline Engine_::Mat4 table_to_mat4(const sol::table& t)
+{
+    Engine_::Mat4 m;
+    for (int i = 0; i < 16; ++i) {
+        sol::object oi = t[i + 1];
+        if (obj_is_nil(oi)) throw std::runtime_error("Mat4 missing element " + std::to_string(i + 1));
+        m.m[i] = (float)obj_to_number(oi, "Mat4[i]");
+    }
+    return m;
+}
+
+// Engine.Mat4 userdata (used as is) or a 16-number table.
+inline Engine_::Mat4 mat4_from_object(const sol::object& o)
+{
+    if (o.is<Engine_::Mat4>()) return o.as<Engine_::Mat4>();
+    if (o.is<sol::table>()) return table_to_mat4(o.as<sol::table>());
+    throw std::runtime_error("Expected Mat4 (Engine.Mat4 or table)");
+}
+
+// Engine.Vec3 userdata or a {x, y, z} / {1, 2, 3} table.
+inline Engine_::Vec3 vec3_from_object(const sol::object& o)
+{
+    if (o.is<Engine_::Vec3>()) return o.as<Engine_::Vec3>();
+    if (!o.is<sol::table>()) throw std::runtime_error("Expected Vec3 (Engine.Vec3 or table)");
+    const sol::table t = o.as<sol::table>();
+    Engine_::Vec3 v;
+    v.x = get_field_float_named_or_index(t, "x", 1, 0.0f, true, "Vec3.x");
+    v.y = get_field_float_named_or_index(t, "y", 2, 0.0f, true, "Vec3.y");
+    v.z = get_field_float_named_or_index(t, "z", 3, 0.0f, true, "Vec3.z");
+    return v;
+}
+
+inline Engine_::BlendMode blend_mode_from_object(const sol::object& o)
+{
+    if (o.is<int>()) return (Engine_::BlendMode)o.as<int>();
+    if (o.is<std::string>()) return blend_mode_from_string(o.as<std::string>());
+    throw std::runtime_error("Expected BlendMode (string or int)");
+}
+
 // -------------------------
 // Return helpers (C++ -> Lua)
 // -------------------------
@@ -351,90 +404,94 @@ inline sol::table mat4_to_table(sol::state_view lua, const Engine_::Mat4& m)
 
 // -------------------------
 // Global callbacks (set these from C++).
+// Thread-local: each thread that runs a Lua state binds its own set.
 // If a callback is not set, dispatch() will throw.
 // -------------------------
 
-inline std::function<double()> cb_time_seconds;
-inline std::function<double()> cb_delta_seconds;
-inline std::function<bool(int key)> cb_key_down;
-inline std::function<bool(int key)> cb_key_pressed;
-inline std::function<bool(int key)> cb_key_released;
-inline std::function<double()> cb_mouse_x;
-inline std::function<double()> cb_mouse_y;
-inline std::function<double()> cb_mouse_prev_x;
-inline std::function<double()> cb_mouse_prev_y;
-inline std::function<double()> cb_mouse_dx;
-inline std::function<double()> cb_mouse_dy;
-inline std::function<bool()> cb_mouse_moved;
-inline std::function<bool(int button)> cb_mouse_down;
-inline std::function<bool(int button)> cb_mouse_pressed;
-inline std::function<bool(int button)> cb_mouse_released;
-inline std::function<double()> cb_mouse_scroll_x;
-inline std::function<double()> cb_mouse_scroll_y;
-inline std::function<bool()> cb_mouse_scrolled;
-inline std::function<bool()> cb_mouse_in_window;
-inline std::function<bool()> cb_mouse_entered;
-inline std::function<bool()> cb_mouse_left;
-inline std::function<double()> cb_mouse_fb_x;
-inline std::function<double()> cb_mouse_fb_y;
-inline std::function<int()> cb_mouse_fb_ix;
-inline std::function<int()> cb_mouse_fb_iy;
-inline std::function<void(bool visible)> cb_set_cursor_visible;
-inline std::function<bool()> cb_cursor_visible;
-inline std::function<void(bool captured)> cb_set_cursor_captured;
-inline std::function<bool()> cb_cursor_captured;
-inline std::function<bool()> cb_should_close;
-inline std::function<void()> cb_request_close;
-inline std::function<void()> cb_poll_events;
-inline std::function<int()> cb_fb_width;
-inline std::function<int()> cb_fb_height;
-inline std::function<int()> cb_display_width;
-inline std::function<int()> cb_display_height;
-inline std::function<void(int w, int h)> cb_resize_framebuffer;
-inline std::function<void(bool enabled)> cb_enable_depth;
-inline std::function<bool()> cb_depth_enabled;
-inline std::function<void(Engine_::BlendMode mode)> cb_set_blend_mode;
-inline std::function<Engine_::BlendMode()> cb_blend_mode;
-inline std::function<void(int x, int y, int w, int h)> cb_set_clip_rect;
-inline std::function<void()> cb_disable_clip_rect;
-inline std::function<void(Engine_::Color c)> cb_clear_color;
-inline std::function<void(float z)> cb_clear_depth;
-inline std::function<void(bool linear)> cb_set_present_filter_linear;
-inline std::function<void(bool apply_postprocess)> cb_flush_to_screen;
-inline std::function<void(const std::string& filepath)> cb_set_capture_filepath;
-inline std::function<void(uint64_t idx)> cb_set_frame_index;
-inline std::function<uint64_t()> cb_frame_index;
-inline std::function<void()> cb_next_frame;
-inline std::function<void(bool apply_postprocess)> cb_save_frame_png;
-inline std::function<void(int x, int y, Engine_::Color c)> cb_set_pixel;
-inline std::function<Engine_::Color(int x, int y)> cb_get_pixel;
-inline std::function<void(int x0, int y0, int x1, int y1, Engine_::Color c, int thickness)> cb_draw_line;
-inline std::function<void(int x, int y, int w, int h, Engine_::Color c, bool filled, int thickness)> cb_draw_rect;
-inline std::function<void(int cx, int cy, int radius, Engine_::Color c, bool filled, int thickness)> cb_draw_circle;
-inline std::function<void(Engine_::Vec2 a, Engine_::Vec2 b, Engine_::Vec2 c, Engine_::Color col, int thickness)> cb_draw_triangle_outline;
-inline std::function<void(Engine_::Vec2 a, Engine_::Vec2 b, Engine_::Vec2 c, Engine_::Color col)> cb_draw_triangle_filled;
-inline std::function<void(Engine_::Vec2 a, Engine_::Color ca, Engine_::Vec2 b, Engine_::Color cb, Engine_::Vec2 c, Engine_::Color cc)> cb_draw_triangle_filled_grad;
-inline std::function<void(Engine_::Vec2 a, Engine_::Vec2 ua, Engine_::Vec2 b, Engine_::Vec2 ub, Engine_::Vec2 c, Engine_::Vec2 uc, const std::string& texture_name, Engine_::Color tint)> cb_draw_triangle_textured_named;
-inline std::function<Engine_::Mat4()> cb_mat4_identity;
-inline std::function<Engine_::Mat4(const Engine_::Mat4& a, const Engine_::Mat4& b)> cb_mat4_mul;
-inline std::function<Engine_::Mat4(Engine_::Vec3 t)> cb_mat4_translate;
-inline std::function<Engine_::Mat4(float radians)> cb_mat4_rotate_x;
-inline std::function<Engine_::Mat4(float radians)> cb_mat4_rotate_y;
-inline std::function<Engine_::Mat4(float radians)> cb_mat4_rotate_z;
-inline std::function<Engine_::Mat4(float fovy_radians, float aspect, float znear, float zfar)> cb_mat4_perspective;
-inline std::function<Engine_::Mat4(Engine_::Vec3 eye, Engine_::Vec3 center, Engine_::Vec3 up)> cb_mat4_look_at;
-inline std::function<bool(const std::string& name, int w, int h, int cell)> cb_tex_make_checker;
-inline std::function<bool(const std::string& name, const std::string& filepath)> cb_tex_load;
-inline std::function<bool(const std::string& name)> cb_tex_delete;
-inline std::function<bool(const std::string& name)> cb_tex_exists;
-inline std::function<bool(const std::string& name)> cb_tex_from_framebuffer;
-inline std::function<bool(const std::string& name, float size)> cb_mesh_make_cube;
-inline std::function<bool(const std::string& name)> cb_mesh_delete;
-inline std::function<bool(const std::string& name)> cb_mesh_exists;
-inline std::function<void(const std::string& mesh_name, const Engine_::Mat4& mvp, const std::string& texture_name, bool enable_depth_test)> cb_draw_mesh_named;
-inline std::function<void(bool enabled, float threshold, float intensity, int downsample, float sigma)> cb_pp_set_bloom;
-inline std::function<void(bool enabled, float exposure, float gamma)> cb_pp_set_tone;
-inline std::function<void()> cb_pp_reset;
+inline thread_local std::function<double()> cb_time_seconds;
+inline thread_local std::function<double()> cb_delta_seconds;
+inline thread_local std::function<bool(int key)> cb_key_down;
+inline thread_local std::function<bool(int key)> cb_key_pressed;
+inline thread_local std::function<bool(int key)> cb_key_released;
+inline thread_local std::function<double()> cb_mouse_x;
+inline thread_local std::function<double()> cb_mouse_y;
+inline thread_local std::function<double()> cb_mouse_prev_x;
+inline thread_local std::function<double()> cb_mouse_prev_y;
+inline thread_local std::function<double()> cb_mouse_dx;
+inline thread_local std::function<double()> cb_mouse_dy;
+inline thread_local std::function<bool()> cb_mouse_moved;
+inline thread_local std::function<bool(int button)> cb_mouse_down;
+inline thread_local std::function<bool(int button)> cb_mouse_pressed;
+inline thread_local std::function<bool(int button)> cb_mouse_released;
+inline thread_local std::function<double()> cb_mouse_scroll_x;
+inline thread_local std::function<double()> cb_mouse_scroll_y;
+inline thread_local std::function<bool()> cb_mouse_scrolled;
+inline thread_local std::function<bool()> cb_mouse_in_window;
+inline thread_local std::function<bool()> cb_mouse_entered;
+inline thread_local std::function<bool()> cb_mouse_left;
+inline thread_local std::function<double()> cb_mouse_fb_x;
+inline thread_local std::function<double()> cb_mouse_fb_y;
+inline thread_local std::function<int()> cb_mouse_fb_ix;
+inline thread_local std::function<int()> cb_mouse_fb_iy;
+inline thread_local std::function<void(bool visible)> cb_set_cursor_visible;
+inline thread_local std::function<bool()> cb_cursor_visible;
+inline thread_local std::function<void(bool captured)> cb_set_cursor_captured;
+inline thread_local std::function<bool()> cb_cursor_captured;
+inline thread_local std::function<bool()> cb_should_close;
+inline thread_local std::function<void()> cb_request_close;
+inline thread_local std::function<void()> cb_poll_events;
+inline thread_local std::function<int()> cb_fb_width;
+inline thread_local std::function<int()> cb_fb_height;
+inline thread_local std::function<int()> cb_display_width;
+inline thread_local std::function<int()> cb_display_height;
+inline thread_local std::function<void(int w, int h)> cb_resize_framebuffer;
+inline thread_local std::function<void(bool enabled)> cb_enable_depth;
+inline thread_local std::function<bool()> cb_depth_enabled;
+inline thread_local std::function<void(Engine_::BlendMode mode)> cb_set_blend_mode;
+inline thread_local std::function<Engine_::BlendMode()> cb_blend_mode;
+inline thread_local std::function<void(int x, int y, int w, int h)> cb_set_clip_rect;
+inline thread_local std::function<void()> cb_disable_clip_rect;
+inline thread_local std::function<void(Engine_::Color c)> cb_clear_color;
+inline thread_local std::function<void(float z)> cb_clear_depth;
+inline thread_local std::function<void(bool linear)> cb_set_present_filter_linear;
+inline thread_local std::function<void(bool apply_postprocess)> cb_flush_to_screen;
+inline thread_local std::function<void(const std::string& filepath)> cb_set_capture_filepath;
+inline thread_local std::function<void(int fps)> cb_set_capture_fps;
+inline thread_local std::function<void(uint64_t idx)> cb_set_frame_index;
+inline thread_local std::function<uint64_t()> cb_frame_index;
+inline thread_local std::function<void()> cb_next_frame;
+inline thread_local std::function<void(bool apply_postprocess)> cb_save_frame_png;
+inline thread_local std::function<void(int x, int y, Engine_::Color c)> cb_set_pixel;
+inline thread_local std::function<Engine_::Color(int x, int y)> cb_get_pixel;
+inline thread_local std::function<void(int x0, int y0, int x1, int y1, Engine_::Color c, int thickness)> cb_draw_line;
+inline thread_local std::function<void(int x, int y, int w, int h, Engine_::Color c, bool filled, int thickness)> cb_draw_rect;
+inline thread_local std::function<void(int cx, int cy, int radius, Engine_::Color c, bool filled, int thickness)> cb_draw_circle;
+inline thread_local std::function<void(Engine_::Vec2 a, Engine_::Vec2 b, Engine_::Vec2 c, Engine_::Color col, int thickness)> cb_draw_triangle_outline;
+inline thread_local std::function<void(Engine_::Vec2 a, Engine_::Vec2 b, Engine_::Vec2 c, Engine_::Color col)> cb_draw_triangle_filled;
+inline thread_local std::function<void(Engine_::Vec2 a, Engine_::Color ca, Engine_::Vec2 b, Engine_::Color cb, Engine_::Vec2 c, Engine_::Color cc)> cb_draw_triangle_filled_grad;
+inline thread_local std::function<void(Engine_::Vec2 a, Engine_::Vec2 ua, Engine_::Vec2 b, Engine_::Vec2 ub, Engine_::Vec2 c, Engine_::Vec2 uc, const std::string& texture_name, Engine_::Color tint)> cb_draw_triangle_textured_named;
+inline thread_local std::function<Engine_::Mat4()> cb_mat4_identity;
+inline thread_local std::function<Engine_::Mat4(const Engine_::Mat4& a, const Engine_::Mat4& b)> cb_mat4_mul;
+inline thread_local std::function<Engine_::Mat4(Engine_::Vec3 t)> cb_mat4_translate;
+inline thread_local std::function<Engine_::Mat4(float radians)> cb_mat4_rotate_x;
+inline thread_local std::function<Engine_::Mat4(float radians)> cb_mat4_rotate_y;
+inline thread_local std::function<Engine_::Mat4(float radians)> cb_mat4_rotate_z;
+inline thread_local std::function<Engine_::Mat4(float fovy_radians, float aspect, float znear, float zfar)> cb_mat4_perspective;
+inline thread_local std::function<Engine_::Mat4(Engine_::Vec3 eye, Engine_::Vec3 center, Engine_::Vec3 up)> cb_mat4_look_at;
+inline thread_local std::function<bool(const std::string& name, int w, int h, int cell)> cb_tex_make_checker;
+inline thread_local std::function<bool(const std::string& name, const std::string& filepath)> cb_tex_load;
+inline thread_local std::function<bool(const std::string& name)> cb_tex_delete;
+inline thread_local std::function<bool(const std::string& name)> cb_tex_exists;
+inline thread_local std::function<bool(const std::string& name)> cb_tex_from_framebuffer;
+inline thread_local std::function<bool(const std::string& name, float size)> cb_mesh_make_cube;
+inline thread_local std::function<bool(const std::string& name)> cb_mesh_delete;
+inline thread_local std::function<bool(const std::string& name)> cb_mesh_exists;
+inline thread_local std::function<void(const std::string& mesh_name, const Engine_::Mat4& mvp, const std::string& texture_name, bool enable_depth_test)> cb_draw_mesh_named;
+inline thread_local std::function<void(bool enabled, float threshold, float intensity, int downsample, float sigma)> cb_pp_set_bloom;
+inline thread_local std::function<void(bool enabled, float exposure, float gamma)> cb_pp_set_tone;
+inline thread_local std::function<bool(bool enabled, const std::string& lut_path, float strength, const std::string& interp)> cb_pp_set_grade;
+inline thread_local std::function<void(bool enabled, float edge_threshold, float edge_threshold_min, float subpixel)> cb_pp_set_aa;
+inline thread_local std::function<void()> cb_pp_reset;
 
 // Optional: bind defaults to Engine_::* functions directly.
 // Call this once after including the generated header.
@@ -489,6 +546,7 @@ inline void bind_engine_defaults()
     cb_set_present_filter_linear = [](bool linear){ Engine_::set_present_filter_linear(linear); };
     cb_flush_to_screen = [](bool apply_postprocess){ Engine_::flush_to_screen(apply_postprocess); };
     cb_set_capture_filepath = [](const std::string& filepath){ Engine_::set_capture_filepath(filepath); };
+    cb_set_capture_fps = [](int fps){ Engine_::set_capture_fps(fps); };
     cb_set_frame_index = [](uint64_t idx){ Engine_::set_frame_index(idx); };
     cb_frame_index = [](){ return Engine_::frame_index(); };
     cb_next_frame = [](){ Engine_::next_frame(); };
@@ -511,750 +569,2532 @@ inline void bind_engine_defaults()
     cb_mat4_look_at = [](Engine_::Vec3 eye, Engine_::Vec3 center, Engine_::Vec3 up){ return Engine_::mat4_look_at(eye, center, up); };
 }
 
-// Execute a single command array immediately.
-// Returns 0 values for void ops, or 1+ values for query ops.
-inline sol::variadic_results dispatch(sol::this_state ts, const sol::table& arr)
+// -------------------------
+// Opcodes. arr[1] is one of these (Engine.Op.<name> in Lua) or the op name.
+// Values follow the op list; new ops go at the end so scripts keep working.
+// -------------------------
+
+enum Op : int
 {
-    sol::state_view lua(ts);
-    sol::variadic_results out;
-    const std::string op = get_op1(arr);
-    
-    if (op == "time_seconds")
-    {
-        if (!cb_time_seconds) throw std::runtime_error("Callback not set for op: time_seconds");
-        auto r = cb_time_seconds();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "delta_seconds")
-    {
-        if (!cb_delta_seconds) throw std::runtime_error("Callback not set for op: delta_seconds");
-        auto r = cb_delta_seconds();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "key_down")
-    {
-        const int key = get_int(arr, 2, 0, true);
-        if (!cb_key_down) throw std::runtime_error("Callback not set for op: key_down");
-        auto r = cb_key_down(key);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "key_pressed")
-    {
-        const int key = get_int(arr, 2, 0, true);
-        if (!cb_key_pressed) throw std::runtime_error("Callback not set for op: key_pressed");
-        auto r = cb_key_pressed(key);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "key_released")
-    {
-        const int key = get_int(arr, 2, 0, true);
-        if (!cb_key_released) throw std::runtime_error("Callback not set for op: key_released");
-        auto r = cb_key_released(key);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_x")
-    {
-        if (!cb_mouse_x) throw std::runtime_error("Callback not set for op: mouse_x");
-        auto r = cb_mouse_x();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_y")
-    {
-        if (!cb_mouse_y) throw std::runtime_error("Callback not set for op: mouse_y");
-        auto r = cb_mouse_y();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_prev_x")
-    {
-        if (!cb_mouse_prev_x) throw std::runtime_error("Callback not set for op: mouse_prev_x");
-        auto r = cb_mouse_prev_x();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_prev_y")
-    {
-        if (!cb_mouse_prev_y) throw std::runtime_error("Callback not set for op: mouse_prev_y");
-        auto r = cb_mouse_prev_y();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_dx")
-    {
-        if (!cb_mouse_dx) throw std::runtime_error("Callback not set for op: mouse_dx");
-        auto r = cb_mouse_dx();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_dy")
-    {
-        if (!cb_mouse_dy) throw std::runtime_error("Callback not set for op: mouse_dy");
-        auto r = cb_mouse_dy();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_moved")
-    {
-        if (!cb_mouse_moved) throw std::runtime_error("Callback not set for op: mouse_moved");
-        auto r = cb_mouse_moved();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_down")
-    {
-        const int button = get_int(arr, 2, 0, true);
-        if (!cb_mouse_down) throw std::runtime_error("Callback not set for op: mouse_down");
-        auto r = cb_mouse_down(button);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_pressed")
-    {
-        const int button = get_int(arr, 2, 0, true);
-        if (!cb_mouse_pressed) throw std::runtime_error("Callback not set for op: mouse_pressed");
-        auto r = cb_mouse_pressed(button);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_released")
-    {
-        const int button = get_int(arr, 2, 0, true);
-        if (!cb_mouse_released) throw std::runtime_error("Callback not set for op: mouse_released");
-        auto r = cb_mouse_released(button);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_scroll_x")
-    {
-        if (!cb_mouse_scroll_x) throw std::runtime_error("Callback not set for op: mouse_scroll_x");
-        auto r = cb_mouse_scroll_x();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_scroll_y")
-    {
-        if (!cb_mouse_scroll_y) throw std::runtime_error("Callback not set for op: mouse_scroll_y");
-        auto r = cb_mouse_scroll_y();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_scrolled")
-    {
-        if (!cb_mouse_scrolled) throw std::runtime_error("Callback not set for op: mouse_scrolled");
-        auto r = cb_mouse_scrolled();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_in_window")
-    {
-        if (!cb_mouse_in_window) throw std::runtime_error("Callback not set for op: mouse_in_window");
-        auto r = cb_mouse_in_window();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_entered")
-    {
-        if (!cb_mouse_entered) throw std::runtime_error("Callback not set for op: mouse_entered");
-        auto r = cb_mouse_entered();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_left")
-    {
-        if (!cb_mouse_left) throw std::runtime_error("Callback not set for op: mouse_left");
-        auto r = cb_mouse_left();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_fb_x")
-    {
-        if (!cb_mouse_fb_x) throw std::runtime_error("Callback not set for op: mouse_fb_x");
-        auto r = cb_mouse_fb_x();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_fb_y")
-    {
-        if (!cb_mouse_fb_y) throw std::runtime_error("Callback not set for op: mouse_fb_y");
-        auto r = cb_mouse_fb_y();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_fb_ix")
-    {
-        if (!cb_mouse_fb_ix) throw std::runtime_error("Callback not set for op: mouse_fb_ix");
-        auto r = cb_mouse_fb_ix();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mouse_fb_iy")
-    {
-        if (!cb_mouse_fb_iy) throw std::runtime_error("Callback not set for op: mouse_fb_iy");
-        auto r = cb_mouse_fb_iy();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "set_cursor_visible")
-    {
-        const bool visible = get_bool(arr, 2, false, true);
-        if (!cb_set_cursor_visible) throw std::runtime_error("Callback not set for op: set_cursor_visible");
-        cb_set_cursor_visible(visible);
-        return out;
-    }
-    
-    else if (op == "cursor_visible")
-    {
-        if (!cb_cursor_visible) throw std::runtime_error("Callback not set for op: cursor_visible");
-        auto r = cb_cursor_visible();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "set_cursor_captured")
-    {
-        const bool captured = get_bool(arr, 2, false, true);
-        if (!cb_set_cursor_captured) throw std::runtime_error("Callback not set for op: set_cursor_captured");
-        cb_set_cursor_captured(captured);
-        return out;
-    }
-    
-    else if (op == "cursor_captured")
-    {
-        if (!cb_cursor_captured) throw std::runtime_error("Callback not set for op: cursor_captured");
-        auto r = cb_cursor_captured();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "should_close")
-    {
-        if (!cb_should_close) throw std::runtime_error("Callback not set for op: should_close");
-        auto r = cb_should_close();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "request_close")
-    {
-        if (!cb_request_close) throw std::runtime_error("Callback not set for op: request_close");
-        cb_request_close();
-        return out;
-    }
-    
-    else if (op == "poll_events")
-    {
-        if (!cb_poll_events) throw std::runtime_error("Callback not set for op: poll_events");
-        cb_poll_events();
-        return out;
-    }
-    
-    else if (op == "fb_width")
-    {
-        if (!cb_fb_width) throw std::runtime_error("Callback not set for op: fb_width");
-        auto r = cb_fb_width();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "fb_height")
-    {
-        if (!cb_fb_height) throw std::runtime_error("Callback not set for op: fb_height");
-        auto r = cb_fb_height();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "display_width")
-    {
-        if (!cb_display_width) throw std::runtime_error("Callback not set for op: display_width");
-        auto r = cb_display_width();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "display_height")
-    {
-        if (!cb_display_height) throw std::runtime_error("Callback not set for op: display_height");
-        auto r = cb_display_height();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "resize_framebuffer")
-    {
-        const int w = get_int(arr, 2, 0, true);
-        const int h = get_int(arr, 3, 0, true);
-        if (!cb_resize_framebuffer) throw std::runtime_error("Callback not set for op: resize_framebuffer");
-        cb_resize_framebuffer(w, h);
-        return out;
-    }
-    
-    else if (op == "enable_depth")
-    {
-        const bool enabled = get_bool(arr, 2, false, true);
-        if (!cb_enable_depth) throw std::runtime_error("Callback not set for op: enable_depth");
-        cb_enable_depth(enabled);
-        return out;
-    }
-    
-    else if (op == "depth_enabled")
-    {
-        if (!cb_depth_enabled) throw std::runtime_error("Callback not set for op: depth_enabled");
-        auto r = cb_depth_enabled();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "set_blend_mode")
-    {
-        const Engine_::BlendMode mode = get_blend_mode(arr, 2, Engine_::BlendMode::Overwrite, true);
-        if (!cb_set_blend_mode) throw std::runtime_error("Callback not set for op: set_blend_mode");
-        cb_set_blend_mode(mode);
-        return out;
-    }
-    
-    else if (op == "blend_mode")
-    {
-        if (!cb_blend_mode) throw std::runtime_error("Callback not set for op: blend_mode");
-        auto r = cb_blend_mode();
-        out.push_back(sol::make_object(lua, std::string(blend_mode_to_cstr(r))));
-        return out;
-    }
-    
-    else if (op == "set_clip_rect")
-    {
-        const int x = get_int(arr, 2, 0, true);
-        const int y = get_int(arr, 3, 0, true);
-        const int w = get_int(arr, 4, 0, true);
-        const int h = get_int(arr, 5, 0, true);
-        if (!cb_set_clip_rect) throw std::runtime_error("Callback not set for op: set_clip_rect");
-        cb_set_clip_rect(x, y, w, h);
-        return out;
-    }
-    
-    else if (op == "disable_clip_rect")
-    {
-        if (!cb_disable_clip_rect) throw std::runtime_error("Callback not set for op: disable_clip_rect");
-        cb_disable_clip_rect();
-        return out;
-    }
-    
-    else if (op == "clear_color")
-    {
-        const Engine_::Color c = get_color(arr, 2, Engine_::Color{0,0,0,255}, true);
-        if (!cb_clear_color) throw std::runtime_error("Callback not set for op: clear_color");
-        cb_clear_color(c);
-        return out;
-    }
-    
-    else if (op == "clear_depth")
-    {
-        const float z = get_float(arr, 2, 1.0f, false);
-        if (!cb_clear_depth) throw std::runtime_error("Callback not set for op: clear_depth");
-        cb_clear_depth(z);
-        return out;
-    }
-    
-    else if (op == "set_present_filter_linear")
-    {
-        const bool linear = get_bool(arr, 2, false, true);
-        if (!cb_set_present_filter_linear) throw std::runtime_error("Callback not set for op: set_present_filter_linear");
-        cb_set_present_filter_linear(linear);
-        return out;
-    }
-    
-    else if (op == "flush_to_screen")
-    {
-        const bool apply_postprocess = get_bool(arr, 2, true, false);
-        if (!cb_flush_to_screen) throw std::runtime_error("Callback not set for op: flush_to_screen");
-        cb_flush_to_screen(apply_postprocess);
-        return out;
-    }
-    
-    else if (op == "set_capture_filepath")
-    {
-        const std::string filepath = get_string(arr, 2, std::string{}, true);
-        if (!cb_set_capture_filepath) throw std::runtime_error("Callback not set for op: set_capture_filepath");
-        cb_set_capture_filepath(filepath);
-        return out;
-    }
-    
-    else if (op == "set_frame_index")
-    {
-        const uint64_t idx = get_u64(arr, 2, 0, true);
-        if (!cb_set_frame_index) throw std::runtime_error("Callback not set for op: set_frame_index");
-        cb_set_frame_index(idx);
-        return out;
-    }
-    
-    else if (op == "frame_index")
-    {
-        if (!cb_frame_index) throw std::runtime_error("Callback not set for op: frame_index");
-        auto r = cb_frame_index();
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "next_frame")
-    {
-        if (!cb_next_frame) throw std::runtime_error("Callback not set for op: next_frame");
-        cb_next_frame();
-        return out;
-    }
-    
-    else if (op == "save_frame_png")
-    {
-        const bool apply_postprocess = get_bool(arr, 2, true, false);
-        if (!cb_save_frame_png) throw std::runtime_error("Callback not set for op: save_frame_png");
-        cb_save_frame_png(apply_postprocess);
-        return out;
-    }
-    
-    else if (op == "set_pixel")
-    {
-        const int x = get_int(arr, 2, 0, true);
-        const int y = get_int(arr, 3, 0, true);
-        const Engine_::Color c = get_color(arr, 4, Engine_::Color{0,0,0,255}, true);
-        if (!cb_set_pixel) throw std::runtime_error("Callback not set for op: set_pixel");
-        cb_set_pixel(x, y, c);
-        return out;
-    }
-    
-    else if (op == "get_pixel")
-    {
-        const int x = get_int(arr, 2, 0, true);
-        const int y = get_int(arr, 3, 0, true);
-        if (!cb_get_pixel) throw std::runtime_error("Callback not set for op: get_pixel");
-        auto r = cb_get_pixel(x, y);
-        out.push_back(sol::make_object(lua, color_to_table(lua, r)));
-        return out;
-    }
-    
-    else if (op == "draw_line")
-    {
-        const int x0 = get_int(arr, 2, 0, true);
-        const int y0 = get_int(arr, 3, 0, true);
-        const int x1 = get_int(arr, 4, 0, true);
-        const int y1 = get_int(arr, 5, 0, true);
-        const Engine_::Color c = get_color(arr, 6, Engine_::Color{0,0,0,255}, true);
-        const int thickness = get_int(arr, 7, 1, false);
-        if (!cb_draw_line) throw std::runtime_error("Callback not set for op: draw_line");
-        cb_draw_line(x0, y0, x1, y1, c, thickness);
-        return out;
-    }
-    
-    else if (op == "draw_rect")
-    {
-        const int x = get_int(arr, 2, 0, true);
-        const int y = get_int(arr, 3, 0, true);
-        const int w = get_int(arr, 4, 0, true);
-        const int h = get_int(arr, 5, 0, true);
-        const Engine_::Color c = get_color(arr, 6, Engine_::Color{0,0,0,255}, true);
-        const bool filled = get_bool(arr, 7, true, false);
-        const int thickness = get_int(arr, 8, 1, false);
-        if (!cb_draw_rect) throw std::runtime_error("Callback not set for op: draw_rect");
-        cb_draw_rect(x, y, w, h, c, filled, thickness);
-        return out;
-    }
-    
-    else if (op == "draw_circle")
-    {
-        const int cx = get_int(arr, 2, 0, true);
-        const int cy = get_int(arr, 3, 0, true);
-        const int radius = get_int(arr, 4, 0, true);
-        const Engine_::Color c = get_color(arr, 5, Engine_::Color{0,0,0,255}, true);
-        const bool filled = get_bool(arr, 6, true, false);
-        const int thickness = get_int(arr, 7, 1, false);
-        if (!cb_draw_circle) throw std::runtime_error("Callback not set for op: draw_circle");
-        cb_draw_circle(cx, cy, radius, c, filled, thickness);
-        return out;
-    }
-    
-    else if (op == "draw_triangle_outline")
-    {
-        const Engine_::Vec2 a = get_vec2(arr, 2, Engine_::Vec2{0,0}, true);
-        const Engine_::Vec2 b = get_vec2(arr, 3, Engine_::Vec2{0,0}, true);
-        const Engine_::Vec2 c = get_vec2(arr, 4, Engine_::Vec2{0,0}, true);
-        const Engine_::Color col = get_color(arr, 5, Engine_::Color{0,0,0,255}, true);
-        const int thickness = get_int(arr, 6, 1, false);
-        if (!cb_draw_triangle_outline) throw std::runtime_error("Callback not set for op: draw_triangle_outline");
-        cb_draw_triangle_outline(a, b, c, col, thickness);
-        return out;
-    }
-    
-    else if (op == "draw_triangle_filled")
-    {
-        const Engine_::Vec2 a = get_vec2(arr, 2, Engine_::Vec2{0,0}, true);
-        const Engine_::Vec2 b = get_vec2(arr, 3, Engine_::Vec2{0,0}, true);
-        const Engine_::Vec2 c = get_vec2(arr, 4, Engine_::Vec2{0,0}, true);
-        const Engine_::Color col = get_color(arr, 5, Engine_::Color{0,0,0,255}, true);
-        if (!cb_draw_triangle_filled) throw std::runtime_error("Callback not set for op: draw_triangle_filled");
-        cb_draw_triangle_filled(a, b, c, col);
-        return out;
-    }
-    
-    else if (op == "draw_triangle_filled_grad")
-    {
-        const Engine_::Vec2 a = get_vec2(arr, 2, Engine_::Vec2{0,0}, true);
-        const Engine_::Color ca = get_color(arr, 3, Engine_::Color{0,0,0,255}, true);
-        const Engine_::Vec2 b = get_vec2(arr, 4, Engine_::Vec2{0,0}, true);
-        const Engine_::Color cb = get_color(arr, 5, Engine_::Color{0,0,0,255}, true);
-        const Engine_::Vec2 c = get_vec2(arr, 6, Engine_::Vec2{0,0}, true);
-        const Engine_::Color cc = get_color(arr, 7, Engine_::Color{0,0,0,255}, true);
-        if (!cb_draw_triangle_filled_grad) throw std::runtime_error("Callback not set for op: draw_triangle_filled_grad");
-        cb_draw_triangle_filled_grad(a, ca, b, cb, c, cc);
-        return out;
-    }
-    
-    else if (op == "draw_triangle_textured_named")
-    {
-        const Engine_::Vec2 a = get_vec2(arr, 2, Engine_::Vec2{0,0}, true);
-        const Engine_::Vec2 ua = get_vec2(arr, 3, Engine_::Vec2{0,0}, true);
-        const Engine_::Vec2 b = get_vec2(arr, 4, Engine_::Vec2{0,0}, true);
-        const Engine_::Vec2 ub = get_vec2(arr, 5, Engine_::Vec2{0,0}, true);
-        const Engine_::Vec2 c = get_vec2(arr, 6, Engine_::Vec2{0,0}, true);
-        const Engine_::Vec2 uc = get_vec2(arr, 7, Engine_::Vec2{0,0}, true);
-        const std::string texture_name = get_string(arr, 8, std::string{}, true);
-        const Engine_::Color tint = get_color(arr, 9, Engine_::Color{255,255,255,255}, false);
-        if (!cb_draw_triangle_textured_named) throw std::runtime_error("Callback not set for op: draw_triangle_textured_named");
-        cb_draw_triangle_textured_named(a, ua, b, ub, c, uc, texture_name, tint);
-        return out;
-    }
-    
-    else if (op == "mat4_identity")
-    {
-        if (!cb_mat4_identity) throw std::runtime_error("Callback not set for op: mat4_identity");
-        auto r = cb_mat4_identity();
-        out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
-        return out;
-    }
-    
-    else if (op == "mat4_mul")
-    {
-        const Engine_::Mat4 a = get_mat4(arr, 2, Engine_::mat4_identity(), true);
-        const Engine_::Mat4 b = get_mat4(arr, 3, Engine_::mat4_identity(), true);
-        if (!cb_mat4_mul) throw std::runtime_error("Callback not set for op: mat4_mul");
-        auto r = cb_mat4_mul(a, b);
-        out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
-        return out;
-    }
-    
-    else if (op == "mat4_translate")
-    {
-        const Engine_::Vec3 t = get_vec3(arr, 2, Engine_::Vec3{0,0,0}, true);
-        if (!cb_mat4_translate) throw std::runtime_error("Callback not set for op: mat4_translate");
-        auto r = cb_mat4_translate(t);
-        out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
-        return out;
-    }
-    
-    else if (op == "mat4_rotate_x")
-    {
-        const float radians = get_float(arr, 2, 0.0f, true);
-        if (!cb_mat4_rotate_x) throw std::runtime_error("Callback not set for op: mat4_rotate_x");
-        auto r = cb_mat4_rotate_x(radians);
-        out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
-        return out;
-    }
-    
-    else if (op == "mat4_rotate_y")
-    {
-        const float radians = get_float(arr, 2, 0.0f, true);
-        if (!cb_mat4_rotate_y) throw std::runtime_error("Callback not set for op: mat4_rotate_y");
-        auto r = cb_mat4_rotate_y(radians);
-        out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
-        return out;
-    }
-    
-    else if (op == "mat4_rotate_z")
-    {
-        const float radians = get_float(arr, 2, 0.0f, true);
-        if (!cb_mat4_rotate_z) throw std::runtime_error("Callback not set for op: mat4_rotate_z");
-        auto r = cb_mat4_rotate_z(radians);
-        out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
-        return out;
-    }
-    
-    else if (op == "mat4_perspective")
-    {
-        const float fovy_radians = get_float(arr, 2, 0.0f, true);
-        const float aspect = get_float(arr, 3, 0.0f, true);
-        const float znear = get_float(arr, 4, 0.0f, true);
-        const float zfar = get_float(arr, 5, 0.0f, true);
-        if (!cb_mat4_perspective) throw std::runtime_error("Callback not set for op: mat4_perspective");
-        auto r = cb_mat4_perspective(fovy_radians, aspect, znear, zfar);
-        out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
-        return out;
-    }
-    
-    else if (op == "mat4_look_at")
-    {
-        const Engine_::Vec3 eye = get_vec3(arr, 2, Engine_::Vec3{0,0,0}, true);
-        const Engine_::Vec3 center = get_vec3(arr, 3, Engine_::Vec3{0,0,0}, true);
-        const Engine_::Vec3 up = get_vec3(arr, 4, Engine_::Vec3{0,0,0}, true);
-        if (!cb_mat4_look_at) throw std::runtime_error("Callback not set for op: mat4_look_at");
-        auto r = cb_mat4_look_at(eye, center, up);
-        out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
-        return out;
-    }
-    
-    else if (op == "tex_make_checker")
-    {
-        const std::string name = get_string(arr, 2, std::string{}, true);
-        const int w = get_int(arr, 3, 256, false);
-        const int h = get_int(arr, 4, 256, false);
-        const int cell = get_int(arr, 5, 16, false);
-        if (!cb_tex_make_checker) throw std::runtime_error("Callback not set for op: tex_make_checker");
-        auto r = cb_tex_make_checker(name, w, h, cell);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "tex_load")
-    {
-        const std::string name = get_string(arr, 2, std::string{}, true);
-        const std::string filepath = get_string(arr, 3, std::string{}, true);
-        if (!cb_tex_load) throw std::runtime_error("Callback not set for op: tex_load");
-        auto r = cb_tex_load(name, filepath);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "tex_delete")
-    {
-        const std::string name = get_string(arr, 2, std::string{}, true);
-        if (!cb_tex_delete) throw std::runtime_error("Callback not set for op: tex_delete");
-        auto r = cb_tex_delete(name);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "tex_exists")
-    {
-        const std::string name = get_string(arr, 2, std::string{}, true);
-        if (!cb_tex_exists) throw std::runtime_error("Callback not set for op: tex_exists");
-        auto r = cb_tex_exists(name);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "tex_from_framebuffer")
-    {
-        const std::string name = get_string(arr, 2, std::string{}, true);
-        if (!cb_tex_from_framebuffer) throw std::runtime_error("Callback not set for op: tex_from_framebuffer");
-        auto r = cb_tex_from_framebuffer(name);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mesh_make_cube")
-    {
-        const std::string name = get_string(arr, 2, std::string{}, true);
-        const float size = get_float(arr, 3, 1.0f, false);
-        if (!cb_mesh_make_cube) throw std::runtime_error("Callback not set for op: mesh_make_cube");
-        auto r = cb_mesh_make_cube(name, size);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mesh_delete")
-    {
-        const std::string name = get_string(arr, 2, std::string{}, true);
-        if (!cb_mesh_delete) throw std::runtime_error("Callback not set for op: mesh_delete");
-        auto r = cb_mesh_delete(name);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "mesh_exists")
-    {
-        const std::string name = get_string(arr, 2, std::string{}, true);
-        if (!cb_mesh_exists) throw std::runtime_error("Callback not set for op: mesh_exists");
-        auto r = cb_mesh_exists(name);
-        out.push_back(sol::make_object(lua, r));
-        return out;
-    }
-    
-    else if (op == "draw_mesh_named")
-    {
-        const std::string mesh_name = get_string(arr, 2, std::string{}, true);
-        const Engine_::Mat4 mvp = get_mat4(arr, 3, Engine_::mat4_identity(), true);
-        const std::string texture_name = get_string(arr, 4, std::string{}, false);
-        const bool enable_depth_test = get_bool(arr, 5, true, false);
-        if (!cb_draw_mesh_named) throw std::runtime_error("Callback not set for op: draw_mesh_named");
-        cb_draw_mesh_named(mesh_name, mvp, texture_name, enable_depth_test);
-        return out;
-    }
-    
-    else if (op == "pp_set_bloom")
-    {
-        const bool enabled = get_bool(arr, 2, true, false);
-        const float threshold = get_float(arr, 3, 0.75f, false);
-        const float intensity = get_float(arr, 4, 1.25f, false);
-        const int downsample = get_int(arr, 5, 4, false);
-        const float sigma = get_float(arr, 6, 6.0f, false);
-        if (!cb_pp_set_bloom) throw std::runtime_error("Callback not set for op: pp_set_bloom");
-        cb_pp_set_bloom(enabled, threshold, intensity, downsample, sigma);
-        return out;
-    }
-    
-    else if (op == "pp_set_tone")
-    {
-        const bool enabled = get_bool(arr, 2, true, false);
-        const float exposure = get_float(arr, 3, 1.25f, false);
-        const float gamma = get_float(arr, 4, 2.2f, false);
-        if (!cb_pp_set_tone) throw std::runtime_error("Callback not set for op: pp_set_tone");
-        cb_pp_set_tone(enabled, exposure, gamma);
-        return out;
-    }
-    
-    else if (op == "pp_reset")
-    {
-        if (!cb_pp_reset) throw std::runtime_error("Callback not set for op: pp_reset");
-        cb_pp_reset();
-        return out;
+    OP_TIME_SECONDS = 1,
+    OP_DELTA_SECONDS = 2,
+    OP_KEY_DOWN = 3,
+    OP_KEY_PRESSED = 4,
+    OP_KEY_RELEASED = 5,
+    OP_MOUSE_X = 6,
+    OP_MOUSE_Y = 7,
+    OP_MOUSE_PREV_X = 8,
+    OP_MOUSE_PREV_Y = 9,
+    OP_MOUSE_DX = 10,
+    OP_MOUSE_DY = 11,
+    OP_MOUSE_MOVED = 12,
+    OP_MOUSE_DOWN = 13,
+    OP_MOUSE_PRESSED = 14,
+    OP_MOUSE_RELEASED = 15,
+    OP_MOUSE_SCROLL_X = 16,
+    OP_MOUSE_SCROLL_Y = 17,
+    OP_MOUSE_SCROLLED = 18,
+    OP_MOUSE_IN_WINDOW = 19,
+    OP_MOUSE_ENTERED = 20,
+    OP_MOUSE_LEFT = 21,
+    OP_MOUSE_FB_X = 22,
+    OP_MOUSE_FB_Y = 23,
+    OP_MOUSE_FB_IX = 24,
+    OP_MOUSE_FB_IY = 25,
+    OP_SET_CURSOR_VISIBLE = 26,
+    OP_CURSOR_VISIBLE = 27,
+    OP_SET_CURSOR_CAPTURED = 28,
+    OP_CURSOR_CAPTURED = 29,
+    OP_SHOULD_CLOSE = 30,
+    OP_REQUEST_CLOSE = 31,
+    OP_POLL_EVENTS = 32,
+    OP_FB_WIDTH = 33,
+    OP_FB_HEIGHT = 34,
+    OP_DISPLAY_WIDTH = 35,
+    OP_DISPLAY_HEIGHT = 36,
+    OP_RESIZE_FRAMEBUFFER = 37,
+    OP_ENABLE_DEPTH = 38,
+    OP_DEPTH_ENABLED = 39,
+    OP_SET_BLEND_MODE = 40,
+    OP_BLEND_MODE = 41,
+    OP_SET_CLIP_RECT = 42,
+    OP_DISABLE_CLIP_RECT = 43,
+    OP_CLEAR_COLOR = 44,
+    OP_CLEAR_DEPTH = 45,
+    OP_SET_PRESENT_FILTER_LINEAR = 46,
+    OP_FLUSH_TO_SCREEN = 47,
+    OP_SET_CAPTURE_FILEPATH = 48,
+    OP_SET_CAPTURE_FPS = 49,
+    OP_SET_FRAME_INDEX = 50,
+    OP_FRAME_INDEX = 51,
+    OP_NEXT_FRAME = 52,
+    OP_SAVE_FRAME_PNG = 53,
+    OP_SET_PIXEL = 54,
+    OP_GET_PIXEL = 55,
+    OP_DRAW_LINE = 56,
+    OP_DRAW_RECT = 57,
+    OP_DRAW_CIRCLE = 58,
+    OP_DRAW_TRIANGLE_OUTLINE = 59,
+    OP_DRAW_TRIANGLE_FILLED = 60,
+    OP_DRAW_TRIANGLE_FILLED_GRAD = 61,
+    OP_DRAW_TRIANGLE_TEXTURED_NAMED = 62,
+    OP_MAT4_IDENTITY = 63,
+    OP_MAT4_MUL = 64,
+    OP_MAT4_TRANSLATE = 65,
+    OP_MAT4_ROTATE_X = 66,
+    OP_MAT4_ROTATE_Y = 67,
+    OP_MAT4_ROTATE_Z = 68,
+    OP_MAT4_PERSPECTIVE = 69,
+    OP_MAT4_LOOK_AT = 70,
+    OP_TEX_MAKE_CHECKER = 71,
+    OP_TEX_LOAD = 72,
+    OP_TEX_DELETE = 73,
+    OP_TEX_EXISTS = 74,
+    OP_TEX_FROM_FRAMEBUFFER = 75,
+    OP_MESH_MAKE_CUBE = 76,
+    OP_MESH_DELETE = 77,
+    OP_MESH_EXISTS = 78,
+    OP_DRAW_MESH_NAMED = 79,
+    OP_PP_SET_BLOOM = 80,
+    OP_PP_SET_TONE = 81,
+    OP_PP_SET_GRADE = 82,
+    OP_PP_SET_AA = 83,
+    OP_PP_RESET = 84,
+};
+
+inline constexpr int OP_COUNT = 85; // opcode 0 is unused
+
+inline constexpr const char* k_op_names[OP_COUNT] =
+{
+    "",
+    "time_seconds",
+    "delta_seconds",
+    "key_down",
+    "key_pressed",
+    "key_released",
+    "mouse_x",
+    "mouse_y",
+    "mouse_prev_x",
+    "mouse_prev_y",
+    "mouse_dx",
+    "mouse_dy",
+    "mouse_moved",
+    "mouse_down",
+    "mouse_pressed",
+    "mouse_released",
+    "mouse_scroll_x",
+    "mouse_scroll_y",
+    "mouse_scrolled",
+    "mouse_in_window",
+    "mouse_entered",
+    "mouse_left",
+    "mouse_fb_x",
+    "mouse_fb_y",
+    "mouse_fb_ix",
+    "mouse_fb_iy",
+    "set_cursor_visible",
+    "cursor_visible",
+    "set_cursor_captured",
+    "cursor_captured",
+    "should_close",
+    "request_close",
+    "poll_events",
+    "fb_width",
+    "fb_height",
+    "display_width",
+    "display_height",
+    "resize_framebuffer",
+    "enable_depth",
+    "depth_enabled",
+    "set_blend_mode",
+    "blend_mode",
+    "set_clip_rect",
+    "disable_clip_rect",
+    "clear_color",
+    "clear_depth",
+    "set_present_filter_linear",
+    "flush_to_screen",
+    "set_capture_filepath",
+    "set_capture_fps",
+    "set_frame_index",
+    "frame_index",
+    "next_frame",
+    "save_frame_png",
+    "set_pixel",
+    "get_pixel",
+    "draw_line",
+    "draw_rect",
+    "draw_circle",
+    "draw_triangle_outline",
+    "draw_triangle_filled",
+    "draw_triangle_filled_grad",
+    "draw_triangle_textured_named",
+    "mat4_identity",
+    "mat4_mul",
+    "mat4_translate",
+    "mat4_rotate_x",
+    "mat4_rotate_y",
+    "mat4_rotate_z",
+    "mat4_perspective",
+    "mat4_look_at",
+    "tex_make_checker",
+    "tex_load",
+    "tex_delete",
+    "tex_exists",
+    "tex_from_framebuffer",
+    "mesh_make_cube",
+    "mesh_delete",
+    "mesh_exists",
+    "draw_mesh_named",
+    "pp_set_bloom",
+    "pp_set_tone",
+    "pp_set_grade",
+    "pp_set_aa",
+    "pp_reset",
+};
+
+// Perfect hash over the op names (built by the generator): two FNV-1a passes
+// and one string compare, whatever the op.
+inline constexpr int k_op_hash_bits = 7;
+inline constexpr uint32_t k_op_hash_disp[128] =
+{
+    1, 1, 2, 1, 1, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1,
+    1, 1, 2, 1, 1, 1, 1, 1, 1, 6, 1, 1, 1, 1, 3, 2,
+    2, 1, 1, 3, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 3, 2, 1, 1, 2, 1, 1, 1, 2, 1, 1,
+    1, 3, 3, 1, 6, 2, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1,
+    2, 1, 1, 1, 1, 1, 1, 3, 1, 2, 2, 1, 1, 1, 1, 2,
+    1, 3, 1, 3, 4, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 2, 1, 1, 1, 3, 2, 1, 4, 1, 1, 1, 1, 1, 1,
+};
+inline constexpr uint16_t k_op_hash_slots[128] =
+{
+    39, 79, 62, 59, 16, 5, 61, 63, 0, 65, 69, 0, 0, 0, 0, 72,
+    34, 80, 70, 0, 20, 0, 0, 17, 0, 7, 84, 0, 83, 74, 27, 0,
+    26, 30, 0, 38, 73, 64, 46, 0, 49, 8, 44, 78, 42, 37, 15, 35,
+    0, 0, 53, 0, 58, 0, 0, 32, 0, 0, 0, 9, 0, 51, 76, 60,
+    0, 55, 82, 0, 33, 0, 22, 6, 77, 28, 1, 23, 4, 52, 67, 75,
+    25, 31, 19, 0, 0, 13, 0, 36, 0, 11, 3, 0, 47, 18, 0, 10,
+    0, 66, 43, 24, 48, 14, 0, 40, 0, 12, 56, 57, 0, 0, 68, 0,
+    0, 54, 71, 81, 45, 0, 41, 21, 50, 0, 0, 2, 0, 0, 29, 0,
+};
+
+inline uint32_t op_hash(std::string_view s, uint32_t basis)
+{
+    uint32_t h = basis;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 16777619u;
     }
-    
-    else
-    {
-        throw std::runtime_error(std::string("Unknown op: ") + op);
+    return h;
+}
+
+// 0 if `name` is not an op.
+inline int op_from_name(std::string_view name)
+{
+    constexpr uint32_t mask = (1u << k_op_hash_bits) - 1u;
+    const uint32_t basis = k_op_hash_disp[op_hash(name, 2166136261u) & mask];
+    const int op = k_op_hash_slots[op_hash(name, basis) & mask];
+    return (op != 0 && name == k_op_names[op]) ? op : 0;
+}
+
+inline int get_opcode(const sol::table& arr)
+{
+    sol::object o = arr[1];
+    switch (o.get_type()) {
+    case sol::type::number: {
+        const int op = o.as<int>();
+        if (op <= 0 || op >= OP_COUNT)
+            throw std::runtime_error("Unknown opcode: " + std::to_string(op));
+        return op;
+    }
+    case sol::type::string: {
+        const std::string_view name = o.as<std::string_view>();
+        const int op = op_from_name(name);
+        if (op == 0)
+            throw std::runtime_error("Unknown op: " + std::string(name));
+        return op;
+    }
+    case sol::type::lua_nil:
+    case sol::type::none:
+        throw std::runtime_error("Command array missing op at index 1");
+    default:
+        throw std::runtime_error("Command op at index 1 must be an opcode or a string");
     }
+}
+
+// { op_name = opcode, ... } for Lua (Engine.Op).
+inline sol::table make_opcode_table(sol::state_view lua)
+{
+    sol::table t = lua.create_table(0, OP_COUNT - 1);
+    for (int op = 1; op < OP_COUNT; ++op)
+        t[k_op_names[op]] = op;
+    return t;
+}
+
+// -------------------------
+// Op handlers (decode args from the command array, call the callback)
+// -------------------------
+
+inline sol::variadic_results op_time_seconds([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_time_seconds) throw std::runtime_error("Callback not set for op: time_seconds");
+    auto r = cb_time_seconds();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_delta_seconds([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_delta_seconds) throw std::runtime_error("Callback not set for op: delta_seconds");
+    auto r = cb_delta_seconds();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_key_down([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int key = get_int(arr, 2, 0, true);
+    if (!cb_key_down) throw std::runtime_error("Callback not set for op: key_down");
+    auto r = cb_key_down(key);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_key_pressed([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int key = get_int(arr, 2, 0, true);
+    if (!cb_key_pressed) throw std::runtime_error("Callback not set for op: key_pressed");
+    auto r = cb_key_pressed(key);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_key_released([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int key = get_int(arr, 2, 0, true);
+    if (!cb_key_released) throw std::runtime_error("Callback not set for op: key_released");
+    auto r = cb_key_released(key);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_x([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_x) throw std::runtime_error("Callback not set for op: mouse_x");
+    auto r = cb_mouse_x();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_y([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_y) throw std::runtime_error("Callback not set for op: mouse_y");
+    auto r = cb_mouse_y();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_prev_x([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_prev_x) throw std::runtime_error("Callback not set for op: mouse_prev_x");
+    auto r = cb_mouse_prev_x();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_prev_y([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_prev_y) throw std::runtime_error("Callback not set for op: mouse_prev_y");
+    auto r = cb_mouse_prev_y();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_dx([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_dx) throw std::runtime_error("Callback not set for op: mouse_dx");
+    auto r = cb_mouse_dx();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_dy([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_dy) throw std::runtime_error("Callback not set for op: mouse_dy");
+    auto r = cb_mouse_dy();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_moved([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_moved) throw std::runtime_error("Callback not set for op: mouse_moved");
+    auto r = cb_mouse_moved();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_down([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int button = get_int(arr, 2, 0, true);
+    if (!cb_mouse_down) throw std::runtime_error("Callback not set for op: mouse_down");
+    auto r = cb_mouse_down(button);
+    out.push_back(sol::make_object(lua, r));
     return out;
 }
 
+inline sol::variadic_results op_mouse_pressed([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int button = get_int(arr, 2, 0, true);
+    if (!cb_mouse_pressed) throw std::runtime_error("Callback not set for op: mouse_pressed");
+    auto r = cb_mouse_pressed(button);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_released([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int button = get_int(arr, 2, 0, true);
+    if (!cb_mouse_released) throw std::runtime_error("Callback not set for op: mouse_released");
+    auto r = cb_mouse_released(button);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_scroll_x([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_scroll_x) throw std::runtime_error("Callback not set for op: mouse_scroll_x");
+    auto r = cb_mouse_scroll_x();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_scroll_y([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_scroll_y) throw std::runtime_error("Callback not set for op: mouse_scroll_y");
+    auto r = cb_mouse_scroll_y();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_scrolled([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_scrolled) throw std::runtime_error("Callback not set for op: mouse_scrolled");
+    auto r = cb_mouse_scrolled();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_in_window([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_in_window) throw std::runtime_error("Callback not set for op: mouse_in_window");
+    auto r = cb_mouse_in_window();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_entered([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_entered) throw std::runtime_error("Callback not set for op: mouse_entered");
+    auto r = cb_mouse_entered();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_left([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_left) throw std::runtime_error("Callback not set for op: mouse_left");
+    auto r = cb_mouse_left();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_fb_x([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_fb_x) throw std::runtime_error("Callback not set for op: mouse_fb_x");
+    auto r = cb_mouse_fb_x();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_fb_y([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_fb_y) throw std::runtime_error("Callback not set for op: mouse_fb_y");
+    auto r = cb_mouse_fb_y();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_fb_ix([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_fb_ix) throw std::runtime_error("Callback not set for op: mouse_fb_ix");
+    auto r = cb_mouse_fb_ix();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mouse_fb_iy([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mouse_fb_iy) throw std::runtime_error("Callback not set for op: mouse_fb_iy");
+    auto r = cb_mouse_fb_iy();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_set_cursor_visible([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const bool visible = get_bool(arr, 2, false, true);
+    if (!cb_set_cursor_visible) throw std::runtime_error("Callback not set for op: set_cursor_visible");
+    cb_set_cursor_visible(visible);
+    return out;
+}
+
+inline sol::variadic_results op_cursor_visible([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_cursor_visible) throw std::runtime_error("Callback not set for op: cursor_visible");
+    auto r = cb_cursor_visible();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_set_cursor_captured([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const bool captured = get_bool(arr, 2, false, true);
+    if (!cb_set_cursor_captured) throw std::runtime_error("Callback not set for op: set_cursor_captured");
+    cb_set_cursor_captured(captured);
+    return out;
+}
+
+inline sol::variadic_results op_cursor_captured([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_cursor_captured) throw std::runtime_error("Callback not set for op: cursor_captured");
+    auto r = cb_cursor_captured();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_should_close([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_should_close) throw std::runtime_error("Callback not set for op: should_close");
+    auto r = cb_should_close();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_request_close([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_request_close) throw std::runtime_error("Callback not set for op: request_close");
+    cb_request_close();
+    return out;
+}
+
+inline sol::variadic_results op_poll_events([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_poll_events) throw std::runtime_error("Callback not set for op: poll_events");
+    cb_poll_events();
+    return out;
+}
+
+inline sol::variadic_results op_fb_width([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_fb_width) throw std::runtime_error("Callback not set for op: fb_width");
+    auto r = cb_fb_width();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_fb_height([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_fb_height) throw std::runtime_error("Callback not set for op: fb_height");
+    auto r = cb_fb_height();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_display_width([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_display_width) throw std::runtime_error("Callback not set for op: display_width");
+    auto r = cb_display_width();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_display_height([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_display_height) throw std::runtime_error("Callback not set for op: display_height");
+    auto r = cb_display_height();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_resize_framebuffer([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int w = get_int(arr, 2, 0, true);
+    const int h = get_int(arr, 3, 0, true);
+    if (!cb_resize_framebuffer) throw std::runtime_error("Callback not set for op: resize_framebuffer");
+    cb_resize_framebuffer(w, h);
+    return out;
+}
+
+inline sol::variadic_results op_enable_depth([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const bool enabled = get_bool(arr, 2, false, true);
+    if (!cb_enable_depth) throw std::runtime_error("Callback not set for op: enable_depth");
+    cb_enable_depth(enabled);
+    return out;
+}
+
+inline sol::variadic_results op_depth_enabled([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_depth_enabled) throw std::runtime_error("Callback not set for op: depth_enabled");
+    auto r = cb_depth_enabled();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_set_blend_mode([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const Engine_::BlendMode mode = get_blend_mode(arr, 2, Engine_::BlendMode::Overwrite, true);
+    if (!cb_set_blend_mode) throw std::runtime_error("Callback not set for op: set_blend_mode");
+    cb_set_blend_mode(mode);
+    return out;
+}
+
+inline sol::variadic_results op_blend_mode([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_blend_mode) throw std::runtime_error("Callback not set for op: blend_mode");
+    auto r = cb_blend_mode();
+    out.push_back(sol::make_object(lua, std::string(blend_mode_to_cstr(r))));
+    return out;
+}
+
+inline sol::variadic_results op_set_clip_rect([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int x = get_int(arr, 2, 0, true);
+    const int y = get_int(arr, 3, 0, true);
+    const int w = get_int(arr, 4, 0, true);
+    const int h = get_int(arr, 5, 0, true);
+    if (!cb_set_clip_rect) throw std::runtime_error("Callback not set for op: set_clip_rect");
+    cb_set_clip_rect(x, y, w, h);
+    return out;
+}
+
+inline sol::variadic_results op_disable_clip_rect([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_disable_clip_rect) throw std::runtime_error("Callback not set for op: disable_clip_rect");
+    cb_disable_clip_rect();
+    return out;
+}
+
+inline sol::variadic_results op_clear_color([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const Engine_::Color c = get_color(arr, 2, Engine_::Color{0,0,0,255}, true);
+    if (!cb_clear_color) throw std::runtime_error("Callback not set for op: clear_color");
+    cb_clear_color(c);
+    return out;
+}
+
+inline sol::variadic_results op_clear_depth([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const float z = get_float(arr, 2, 1.0f, false);
+    if (!cb_clear_depth) throw std::runtime_error("Callback not set for op: clear_depth");
+    cb_clear_depth(z);
+    return out;
+}
+
+inline sol::variadic_results op_set_present_filter_linear([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const bool linear = get_bool(arr, 2, false, true);
+    if (!cb_set_present_filter_linear) throw std::runtime_error("Callback not set for op: set_present_filter_linear");
+    cb_set_present_filter_linear(linear);
+    return out;
+}
+
+inline sol::variadic_results op_flush_to_screen([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const bool apply_postprocess = get_bool(arr, 2, true, false);
+    if (!cb_flush_to_screen) throw std::runtime_error("Callback not set for op: flush_to_screen");
+    cb_flush_to_screen(apply_postprocess);
+    return out;
+}
+
+inline sol::variadic_results op_set_capture_filepath([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const std::string filepath = get_string(arr, 2, std::string{}, true);
+    if (!cb_set_capture_filepath) throw std::runtime_error("Callback not set for op: set_capture_filepath");
+    cb_set_capture_filepath(filepath);
+    return out;
+}
+
+inline sol::variadic_results op_set_capture_fps([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int fps = get_int(arr, 2, 0, true);
+    if (!cb_set_capture_fps) throw std::runtime_error("Callback not set for op: set_capture_fps");
+    cb_set_capture_fps(fps);
+    return out;
+}
+
+inline sol::variadic_results op_set_frame_index([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const uint64_t idx = get_u64(arr, 2, 0, true);
+    if (!cb_set_frame_index) throw std::runtime_error("Callback not set for op: set_frame_index");
+    cb_set_frame_index(idx);
+    return out;
+}
+
+inline sol::variadic_results op_frame_index([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_frame_index) throw std::runtime_error("Callback not set for op: frame_index");
+    auto r = cb_frame_index();
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_next_frame([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_next_frame) throw std::runtime_error("Callback not set for op: next_frame");
+    cb_next_frame();
+    return out;
+}
+
+inline sol::variadic_results op_save_frame_png([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const bool apply_postprocess = get_bool(arr, 2, true, false);
+    if (!cb_save_frame_png) throw std::runtime_error("Callback not set for op: save_frame_png");
+    cb_save_frame_png(apply_postprocess);
+    return out;
+}
+
+inline sol::variadic_results op_set_pixel([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int x = get_int(arr, 2, 0, true);
+    const int y = get_int(arr, 3, 0, true);
+    const Engine_::Color c = get_color(arr, 4, Engine_::Color{0,0,0,255}, true);
+    if (!cb_set_pixel) throw std::runtime_error("Callback not set for op: set_pixel");
+    cb_set_pixel(x, y, c);
+    return out;
+}
+
+inline sol::variadic_results op_get_pixel([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int x = get_int(arr, 2, 0, true);
+    const int y = get_int(arr, 3, 0, true);
+    if (!cb_get_pixel) throw std::runtime_error("Callback not set for op: get_pixel");
+    auto r = cb_get_pixel(x, y);
+    out.push_back(sol::make_object(lua, color_to_table(lua, r)));
+    return out;
+}
+
+inline sol::variadic_results op_draw_line([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int x0 = get_int(arr, 2, 0, true);
+    const int y0 = get_int(arr, 3, 0, true);
+    const int x1 = get_int(arr, 4, 0, true);
+    const int y1 = get_int(arr, 5, 0, true);
+    const Engine_::Color c = get_color(arr, 6, Engine_::Color{0,0,0,255}, true);
+    const int thickness = get_int(arr, 7, 1, false);
+    if (!cb_draw_line) throw std::runtime_error("Callback not set for op: draw_line");
+    cb_draw_line(x0, y0, x1, y1, c, thickness);
+    return out;
+}
+
+inline sol::variadic_results op_draw_rect([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int x = get_int(arr, 2, 0, true);
+    const int y = get_int(arr, 3, 0, true);
+    const int w = get_int(arr, 4, 0, true);
+    const int h = get_int(arr, 5, 0, true);
+    const Engine_::Color c = get_color(arr, 6, Engine_::Color{0,0,0,255}, true);
+    const bool filled = get_bool(arr, 7, true, false);
+    const int thickness = get_int(arr, 8, 1, false);
+    if (!cb_draw_rect) throw std::runtime_error("Callback not set for op: draw_rect");
+    cb_draw_rect(x, y, w, h, c, filled, thickness);
+    return out;
+}
+
+inline sol::variadic_results op_draw_circle([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const int cx = get_int(arr, 2, 0, true);
+    const int cy = get_int(arr, 3, 0, true);
+    const int radius = get_int(arr, 4, 0, true);
+    const Engine_::Color c = get_color(arr, 5, Engine_::Color{0,0,0,255}, true);
+    const bool filled = get_bool(arr, 6, true, false);
+    const int thickness = get_int(arr, 7, 1, false);
+    if (!cb_draw_circle) throw std::runtime_error("Callback not set for op: draw_circle");
+    cb_draw_circle(cx, cy, radius, c, filled, thickness);
+    return out;
+}
+
+inline sol::variadic_results op_draw_triangle_outline([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const Engine_::Vec2 a = get_vec2(arr, 2, Engine_::Vec2{0,0}, true);
+    const Engine_::Vec2 b = get_vec2(arr, 3, Engine_::Vec2{0,0}, true);
+    const Engine_::Vec2 c = get_vec2(arr, 4, Engine_::Vec2{0,0}, true);
+    const Engine_::Color col = get_color(arr, 5, Engine_::Color{0,0,0,255}, true);
+    const int thickness = get_int(arr, 6, 1, false);
+    if (!cb_draw_triangle_outline) throw std::runtime_error("Callback not set for op: draw_triangle_outline");
+    cb_draw_triangle_outline(a, b, c, col, thickness);
+    return out;
+}
+
+inline sol::variadic_results op_draw_triangle_filled([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const Engine_::Vec2 a = get_vec2(arr, 2, Engine_::Vec2{0,0}, true);
+    const Engine_::Vec2 b = get_vec2(arr, 3, Engine_::Vec2{0,0}, true);
+    const Engine_::Vec2 c = get_vec2(arr, 4, Engine_::Vec2{0,0}, true);
+    const Engine_::Color col = get_color(arr, 5, Engine_::Color{0,0,0,255}, true);
+    if (!cb_draw_triangle_filled) throw std::runtime_error("Callback not set for op: draw_triangle_filled");
+    cb_draw_triangle_filled(a, b, c, col);
+    return out;
+}
+
+inline sol::variadic_results op_draw_triangle_filled_grad([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const Engine_::Vec2 a = get_vec2(arr, 2, Engine_::Vec2{0,0}, true);
+    const Engine_::Color ca = get_color(arr, 3, Engine_::Color{0,0,0,255}, true);
+    const Engine_::Vec2 b = get_vec2(arr, 4, Engine_::Vec2{0,0}, true);
+    const Engine_::Color cb = get_color(arr, 5, Engine_::Color{0,0,0,255}, true);
+    const Engine_::Vec2 c = get_vec2(arr, 6, Engine_::Vec2{0,0}, true);
+    const Engine_::Color cc = get_color(arr, 7, Engine_::Color{0,0,0,255}, true);
+    if (!cb_draw_triangle_filled_grad) throw std::runtime_error("Callback not set for op: draw_triangle_filled_grad");
+    cb_draw_triangle_filled_grad(a, ca, b, cb, c, cc);
+    return out;
+}
+
+inline sol::variadic_results op_draw_triangle_textured_named([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const Engine_::Vec2 a = get_vec2(arr, 2, Engine_::Vec2{0,0}, true);
+    const Engine_::Vec2 ua = get_vec2(arr, 3, Engine_::Vec2{0,0}, true);
+    const Engine_::Vec2 b = get_vec2(arr, 4, Engine_::Vec2{0,0}, true);
+    const Engine_::Vec2 ub = get_vec2(arr, 5, Engine_::Vec2{0,0}, true);
+    const Engine_::Vec2 c = get_vec2(arr, 6, Engine_::Vec2{0,0}, true);
+    const Engine_::Vec2 uc = get_vec2(arr, 7, Engine_::Vec2{0,0}, true);
+    const std::string texture_name = get_string(arr, 8, std::string{}, true);
+    const Engine_::Color tint = get_color(arr, 9, Engine_::Color{255,255,255,255}, false);
+    if (!cb_draw_triangle_textured_named) throw std::runtime_error("Callback not set for op: draw_triangle_textured_named");
+    cb_draw_triangle_textured_named(a, ua, b, ub, c, uc, texture_name, tint);
+    return out;
+}
+
+inline sol::variadic_results op_mat4_identity([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_mat4_identity) throw std::runtime_error("Callback not set for op: mat4_identity");
+    auto r = cb_mat4_identity();
+    out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
+    return out;
+}
+
+inline sol::variadic_results op_mat4_mul([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const Engine_::Mat4 a = get_mat4(arr, 2, Engine_::mat4_identity(), true);
+    const Engine_::Mat4 b = get_mat4(arr, 3, Engine_::mat4_identity(), true);
+    if (!cb_mat4_mul) throw std::runtime_error("Callback not set for op: mat4_mul");
+    auto r = cb_mat4_mul(a, b);
+    out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
+    return out;
+}
+
+inline sol::variadic_results op_mat4_translate([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const Engine_::Vec3 t = get_vec3(arr, 2, Engine_::Vec3{0,0,0}, true);
+    if (!cb_mat4_translate) throw std::runtime_error("Callback not set for op: mat4_translate");
+    auto r = cb_mat4_translate(t);
+    out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
+    return out;
+}
+
+inline sol::variadic_results op_mat4_rotate_x([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const float radians = get_float(arr, 2, 0.0f, true);
+    if (!cb_mat4_rotate_x) throw std::runtime_error("Callback not set for op: mat4_rotate_x");
+    auto r = cb_mat4_rotate_x(radians);
+    out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
+    return out;
+}
+
+inline sol::variadic_results op_mat4_rotate_y([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const float radians = get_float(arr, 2, 0.0f, true);
+    if (!cb_mat4_rotate_y) throw std::runtime_error("Callback not set for op: mat4_rotate_y");
+    auto r = cb_mat4_rotate_y(radians);
+    out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
+    return out;
+}
+
+inline sol::variadic_results op_mat4_rotate_z([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const float radians = get_float(arr, 2, 0.0f, true);
+    if (!cb_mat4_rotate_z) throw std::runtime_error("Callback not set for op: mat4_rotate_z");
+    auto r = cb_mat4_rotate_z(radians);
+    out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
+    return out;
+}
+
+inline sol::variadic_results op_mat4_perspective([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const float fovy_radians = get_float(arr, 2, 0.0f, true);
+    const float aspect = get_float(arr, 3, 0.0f, true);
+    const float znear = get_float(arr, 4, 0.0f, true);
+    const float zfar = get_float(arr, 5, 0.0f, true);
+    if (!cb_mat4_perspective) throw std::runtime_error("Callback not set for op: mat4_perspective");
+    auto r = cb_mat4_perspective(fovy_radians, aspect, znear, zfar);
+    out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
+    return out;
+}
+
+inline sol::variadic_results op_mat4_look_at([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const Engine_::Vec3 eye = get_vec3(arr, 2, Engine_::Vec3{0,0,0}, true);
+    const Engine_::Vec3 center = get_vec3(arr, 3, Engine_::Vec3{0,0,0}, true);
+    const Engine_::Vec3 up = get_vec3(arr, 4, Engine_::Vec3{0,0,0}, true);
+    if (!cb_mat4_look_at) throw std::runtime_error("Callback not set for op: mat4_look_at");
+    auto r = cb_mat4_look_at(eye, center, up);
+    out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));
+    return out;
+}
+
+inline sol::variadic_results op_tex_make_checker([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const std::string name = get_string(arr, 2, std::string{}, true);
+    const int w = get_int(arr, 3, 256, false);
+    const int h = get_int(arr, 4, 256, false);
+    const int cell = get_int(arr, 5, 16, false);
+    if (!cb_tex_make_checker) throw std::runtime_error("Callback not set for op: tex_make_checker");
+    auto r = cb_tex_make_checker(name, w, h, cell);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_tex_load([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const std::string name = get_string(arr, 2, std::string{}, true);
+    const std::string filepath = get_string(arr, 3, std::string{}, true);
+    if (!cb_tex_load) throw std::runtime_error("Callback not set for op: tex_load");
+    auto r = cb_tex_load(name, filepath);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_tex_delete([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const std::string name = get_string(arr, 2, std::string{}, true);
+    if (!cb_tex_delete) throw std::runtime_error("Callback not set for op: tex_delete");
+    auto r = cb_tex_delete(name);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_tex_exists([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const std::string name = get_string(arr, 2, std::string{}, true);
+    if (!cb_tex_exists) throw std::runtime_error("Callback not set for op: tex_exists");
+    auto r = cb_tex_exists(name);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_tex_from_framebuffer([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const std::string name = get_string(arr, 2, std::string{}, true);
+    if (!cb_tex_from_framebuffer) throw std::runtime_error("Callback not set for op: tex_from_framebuffer");
+    auto r = cb_tex_from_framebuffer(name);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mesh_make_cube([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const std::string name = get_string(arr, 2, std::string{}, true);
+    const float size = get_float(arr, 3, 1.0f, false);
+    if (!cb_mesh_make_cube) throw std::runtime_error("Callback not set for op: mesh_make_cube");
+    auto r = cb_mesh_make_cube(name, size);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mesh_delete([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const std::string name = get_string(arr, 2, std::string{}, true);
+    if (!cb_mesh_delete) throw std::runtime_error("Callback not set for op: mesh_delete");
+    auto r = cb_mesh_delete(name);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_mesh_exists([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const std::string name = get_string(arr, 2, std::string{}, true);
+    if (!cb_mesh_exists) throw std::runtime_error("Callback not set for op: mesh_exists");
+    auto r = cb_mesh_exists(name);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_draw_mesh_named([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const std::string mesh_name = get_string(arr, 2, std::string{}, true);
+    const Engine_::Mat4 mvp = get_mat4(arr, 3, Engine_::mat4_identity(), true);
+    const std::string texture_name = get_string(arr, 4, std::string{}, false);
+    const bool enable_depth_test = get_bool(arr, 5, true, false);
+    if (!cb_draw_mesh_named) throw std::runtime_error("Callback not set for op: draw_mesh_named");
+    cb_draw_mesh_named(mesh_name, mvp, texture_name, enable_depth_test);
+    return out;
+}
+
+inline sol::variadic_results op_pp_set_bloom([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const bool enabled = get_bool(arr, 2, true, false);
+    const float threshold = get_float(arr, 3, 0.75f, false);
+    const float intensity = get_float(arr, 4, 1.25f, false);
+    const int downsample = get_int(arr, 5, 4, false);
+    const float sigma = get_float(arr, 6, 6.0f, false);
+    if (!cb_pp_set_bloom) throw std::runtime_error("Callback not set for op: pp_set_bloom");
+    cb_pp_set_bloom(enabled, threshold, intensity, downsample, sigma);
+    return out;
+}
+
+inline sol::variadic_results op_pp_set_tone([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const bool enabled = get_bool(arr, 2, true, false);
+    const float exposure = get_float(arr, 3, 1.25f, false);
+    const float gamma = get_float(arr, 4, 2.2f, false);
+    if (!cb_pp_set_tone) throw std::runtime_error("Callback not set for op: pp_set_tone");
+    cb_pp_set_tone(enabled, exposure, gamma);
+    return out;
+}
+
+inline sol::variadic_results op_pp_set_grade([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const bool enabled = get_bool(arr, 2, true, false);
+    const std::string lut_path = get_string(arr, 3, std::string{}, false);
+    const float strength = get_float(arr, 4, 1.0f, false);
+    const std::string interp = get_string(arr, 5, std::string{"tetrahedral"}, false);
+    if (!cb_pp_set_grade) throw std::runtime_error("Callback not set for op: pp_set_grade");
+    auto r = cb_pp_set_grade(enabled, lut_path, strength, interp);
+    out.push_back(sol::make_object(lua, r));
+    return out;
+}
+
+inline sol::variadic_results op_pp_set_aa([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    const bool enabled = get_bool(arr, 2, true, false);
+    const float edge_threshold = get_float(arr, 3, 0.125f, false);
+    const float edge_threshold_min = get_float(arr, 4, 0.0312f, false);
+    const float subpixel = get_float(arr, 5, 0.75f, false);
+    if (!cb_pp_set_aa) throw std::runtime_error("Callback not set for op: pp_set_aa");
+    cb_pp_set_aa(enabled, edge_threshold, edge_threshold_min, subpixel);
+    return out;
+}
+
+inline sol::variadic_results op_pp_reset([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)
+{
+    sol::variadic_results out;
+    if (!cb_pp_reset) throw std::runtime_error("Callback not set for op: pp_reset");
+    cb_pp_reset();
+    return out;
+}
+
+using OpHandler = sol::variadic_results (*)(sol::state_view, const sol::table&);
+
+inline constexpr OpHandler k_op_handlers[OP_COUNT] =
+{
+    nullptr,
+    &op_time_seconds,
+    &op_delta_seconds,
+    &op_key_down,
+    &op_key_pressed,
+    &op_key_released,
+    &op_mouse_x,
+    &op_mouse_y,
+    &op_mouse_prev_x,
+    &op_mouse_prev_y,
+    &op_mouse_dx,
+    &op_mouse_dy,
+    &op_mouse_moved,
+    &op_mouse_down,
+    &op_mouse_pressed,
+    &op_mouse_released,
+    &op_mouse_scroll_x,
+    &op_mouse_scroll_y,
+    &op_mouse_scrolled,
+    &op_mouse_in_window,
+    &op_mouse_entered,
+    &op_mouse_left,
+    &op_mouse_fb_x,
+    &op_mouse_fb_y,
+    &op_mouse_fb_ix,
+    &op_mouse_fb_iy,
+    &op_set_cursor_visible,
+    &op_cursor_visible,
+    &op_set_cursor_captured,
+    &op_cursor_captured,
+    &op_should_close,
+    &op_request_close,
+    &op_poll_events,
+    &op_fb_width,
+    &op_fb_height,
+    &op_display_width,
+    &op_display_height,
+    &op_resize_framebuffer,
+    &op_enable_depth,
+    &op_depth_enabled,
+    &op_set_blend_mode,
+    &op_blend_mode,
+    &op_set_clip_rect,
+    &op_disable_clip_rect,
+    &op_clear_color,
+    &op_clear_depth,
+    &op_set_present_filter_linear,
+    &op_flush_to_screen,
+    &op_set_capture_filepath,
+    &op_set_capture_fps,
+    &op_set_frame_index,
+    &op_frame_index,
+    &op_next_frame,
+    &op_save_frame_png,
+    &op_set_pixel,
+    &op_get_pixel,
+    &op_draw_line,
+    &op_draw_rect,
+    &op_draw_circle,
+    &op_draw_triangle_outline,
+    &op_draw_triangle_filled,
+    &op_draw_triangle_filled_grad,
+    &op_draw_triangle_textured_named,
+    &op_mat4_identity,
+    &op_mat4_mul,
+    &op_mat4_translate,
+    &op_mat4_rotate_x,
+    &op_mat4_rotate_y,
+    &op_mat4_rotate_z,
+    &op_mat4_perspective,
+    &op_mat4_look_at,
+    &op_tex_make_checker,
+    &op_tex_load,
+    &op_tex_delete,
+    &op_tex_exists,
+    &op_tex_from_framebuffer,
+    &op_mesh_make_cube,
+    &op_mesh_delete,
+    &op_mesh_exists,
+    &op_draw_mesh_named,
+    &op_pp_set_bloom,
+    &op_pp_set_tone,
+    &op_pp_set_grade,
+    &op_pp_set_aa,
+    &op_pp_reset,
+};
+
+// Execute a single command array immediately.
+// Returns 0 values for void ops, or 1+ values for query ops.
+inline sol::variadic_results dispatch(sol::this_state ts, const sol::table& arr)
+{
+    return k_op_handlers[get_opcode(arr)](sol::state_view(ts), arr);
+}
+
+// -------------------------
+// Direct bindings (Engine.Direct in Lua): flat args, no tables per call.
+//   Engine.Direct.draw_line(x0, y0, x1, y1, r, g, b, a, thickness)
+//   local r, g, b, a = Engine.Direct.get_pixel(x, y)
+// Optional args follow the op list defaults; a Color's alpha defaults to 255.
+// Mat4 results are Engine.Mat4 userdata (the host registers that usertype).
+// -------------------------
+
+inline double direct_time_seconds()
+{
+    if (!cb_time_seconds) throw std::runtime_error("Callback not set for op: time_seconds");
+    return cb_time_seconds();
+}
+
+inline double direct_delta_seconds()
+{
+    if (!cb_delta_seconds) throw std::runtime_error("Callback not set for op: delta_seconds");
+    return cb_delta_seconds();
+}
+
+inline bool direct_key_down(double key)
+{
+    if (!cb_key_down) throw std::runtime_error("Callback not set for op: key_down");
+    return cb_key_down((int)key);
+}
+
+inline bool direct_key_pressed(double key)
+{
+    if (!cb_key_pressed) throw std::runtime_error("Callback not set for op: key_pressed");
+    return cb_key_pressed((int)key);
+}
+
+inline bool direct_key_released(double key)
+{
+    if (!cb_key_released) throw std::runtime_error("Callback not set for op: key_released");
+    return cb_key_released((int)key);
+}
+
+inline double direct_mouse_x()
+{
+    if (!cb_mouse_x) throw std::runtime_error("Callback not set for op: mouse_x");
+    return cb_mouse_x();
+}
+
+inline double direct_mouse_y()
+{
+    if (!cb_mouse_y) throw std::runtime_error("Callback not set for op: mouse_y");
+    return cb_mouse_y();
+}
+
+inline double direct_mouse_prev_x()
+{
+    if (!cb_mouse_prev_x) throw std::runtime_error("Callback not set for op: mouse_prev_x");
+    return cb_mouse_prev_x();
+}
+
+inline double direct_mouse_prev_y()
+{
+    if (!cb_mouse_prev_y) throw std::runtime_error("Callback not set for op: mouse_prev_y");
+    return cb_mouse_prev_y();
+}
+
+inline double direct_mouse_dx()
+{
+    if (!cb_mouse_dx) throw std::runtime_error("Callback not set for op: mouse_dx");
+    return cb_mouse_dx();
+}
+
+inline double direct_mouse_dy()
+{
+    if (!cb_mouse_dy) throw std::runtime_error("Callback not set for op: mouse_dy");
+    return cb_mouse_dy();
+}
+
+inline bool direct_mouse_moved()
+{
+    if (!cb_mouse_moved) throw std::runtime_error("Callback not set for op: mouse_moved");
+    return cb_mouse_moved();
+}
+
+inline bool direct_mouse_down(double button)
+{
+    if (!cb_mouse_down) throw std::runtime_error("Callback not set for op: mouse_down");
+    return cb_mouse_down((int)button);
+}
+
+inline bool direct_mouse_pressed(double button)
+{
+    if (!cb_mouse_pressed) throw std::runtime_error("Callback not set for op: mouse_pressed");
+    return cb_mouse_pressed((int)button);
+}
+
+inline bool direct_mouse_released(double button)
+{
+    if (!cb_mouse_released) throw std::runtime_error("Callback not set for op: mouse_released");
+    return cb_mouse_released((int)button);
+}
+
+inline double direct_mouse_scroll_x()
+{
+    if (!cb_mouse_scroll_x) throw std::runtime_error("Callback not set for op: mouse_scroll_x");
+    return cb_mouse_scroll_x();
+}
+
+inline double direct_mouse_scroll_y()
+{
+    if (!cb_mouse_scroll_y) throw std::runtime_error("Callback not set for op: mouse_scroll_y");
+    return cb_mouse_scroll_y();
+}
+
+inline bool direct_mouse_scrolled()
+{
+    if (!cb_mouse_scrolled) throw std::runtime_error("Callback not set for op: mouse_scrolled");
+    return cb_mouse_scrolled();
+}
+
+inline bool direct_mouse_in_window()
+{
+    if (!cb_mouse_in_window) throw std::runtime_error("Callback not set for op: mouse_in_window");
+    return cb_mouse_in_window();
+}
+
+inline bool direct_mouse_entered()
+{
+    if (!cb_mouse_entered) throw std::runtime_error("Callback not set for op: mouse_entered");
+    return cb_mouse_entered();
+}
+
+inline bool direct_mouse_left()
+{
+    if (!cb_mouse_left) throw std::runtime_error("Callback not set for op: mouse_left");
+    return cb_mouse_left();
+}
+
+inline double direct_mouse_fb_x()
+{
+    if (!cb_mouse_fb_x) throw std::runtime_error("Callback not set for op: mouse_fb_x");
+    return cb_mouse_fb_x();
+}
+
+inline double direct_mouse_fb_y()
+{
+    if (!cb_mouse_fb_y) throw std::runtime_error("Callback not set for op: mouse_fb_y");
+    return cb_mouse_fb_y();
+}
+
+inline int direct_mouse_fb_ix()
+{
+    if (!cb_mouse_fb_ix) throw std::runtime_error("Callback not set for op: mouse_fb_ix");
+    return cb_mouse_fb_ix();
+}
+
+inline int direct_mouse_fb_iy()
+{
+    if (!cb_mouse_fb_iy) throw std::runtime_error("Callback not set for op: mouse_fb_iy");
+    return cb_mouse_fb_iy();
+}
+
+inline void direct_set_cursor_visible(bool visible)
+{
+    if (!cb_set_cursor_visible) throw std::runtime_error("Callback not set for op: set_cursor_visible");
+    cb_set_cursor_visible(visible);
+}
+
+inline bool direct_cursor_visible()
+{
+    if (!cb_cursor_visible) throw std::runtime_error("Callback not set for op: cursor_visible");
+    return cb_cursor_visible();
+}
+
+inline void direct_set_cursor_captured(bool captured)
+{
+    if (!cb_set_cursor_captured) throw std::runtime_error("Callback not set for op: set_cursor_captured");
+    cb_set_cursor_captured(captured);
+}
+
+inline bool direct_cursor_captured()
+{
+    if (!cb_cursor_captured) throw std::runtime_error("Callback not set for op: cursor_captured");
+    return cb_cursor_captured();
+}
+
+inline bool direct_should_close()
+{
+    if (!cb_should_close) throw std::runtime_error("Callback not set for op: should_close");
+    return cb_should_close();
+}
+
+inline void direct_request_close()
+{
+    if (!cb_request_close) throw std::runtime_error("Callback not set for op: request_close");
+    cb_request_close();
+}
+
+inline void direct_poll_events()
+{
+    if (!cb_poll_events) throw std::runtime_error("Callback not set for op: poll_events");
+    cb_poll_events();
+}
+
+inline int direct_fb_width()
+{
+    if (!cb_fb_width) throw std::runtime_error("Callback not set for op: fb_width");
+    return cb_fb_width();
+}
+
+inline int direct_fb_height()
+{
+    if (!cb_fb_height) throw std::runtime_error("Callback not set for op: fb_height");
+    return cb_fb_height();
+}
+
+inline int direct_display_width()
+{
+    if (!cb_display_width) throw std::runtime_error("Callback not set for op: display_width");
+    return cb_display_width();
+}
+
+inline int direct_display_height()
+{
+    if (!cb_display_height) throw std::runtime_error("Callback not set for op: display_height");
+    return cb_display_height();
+}
+
+inline void direct_resize_framebuffer(double w, double h)
+{
+    if (!cb_resize_framebuffer) throw std::runtime_error("Callback not set for op: resize_framebuffer");
+    cb_resize_framebuffer((int)w, (int)h);
+}
+
+inline void direct_enable_depth(bool enabled)
+{
+    if (!cb_enable_depth) throw std::runtime_error("Callback not set for op: enable_depth");
+    cb_enable_depth(enabled);
+}
+
+inline bool direct_depth_enabled()
+{
+    if (!cb_depth_enabled) throw std::runtime_error("Callback not set for op: depth_enabled");
+    return cb_depth_enabled();
+}
+
+inline void direct_set_blend_mode(const sol::object& mode)
+{
+    if (!cb_set_blend_mode) throw std::runtime_error("Callback not set for op: set_blend_mode");
+    cb_set_blend_mode(blend_mode_from_object(mode));
+}
+
+inline const char* direct_blend_mode()
+{
+    if (!cb_blend_mode) throw std::runtime_error("Callback not set for op: blend_mode");
+    return blend_mode_to_cstr(cb_blend_mode());
+}
+
+inline void direct_set_clip_rect(double x, double y, double w, double h)
+{
+    if (!cb_set_clip_rect) throw std::runtime_error("Callback not set for op: set_clip_rect");
+    cb_set_clip_rect((int)x, (int)y, (int)w, (int)h);
+}
+
+inline void direct_disable_clip_rect()
+{
+    if (!cb_disable_clip_rect) throw std::runtime_error("Callback not set for op: disable_clip_rect");
+    cb_disable_clip_rect();
+}
+
+inline void direct_clear_color(double c_r, double c_g, double c_b, sol::optional<double> c_a)
+{
+    if (!cb_clear_color) throw std::runtime_error("Callback not set for op: clear_color");
+    cb_clear_color(make_color(c_r, c_g, c_b, c_a.value_or(255.0)));
+}
+
+inline void direct_clear_depth(sol::optional<double> z)
+{
+    if (!cb_clear_depth) throw std::runtime_error("Callback not set for op: clear_depth");
+    cb_clear_depth(z ? (float)*z : 1.0f);
+}
+
+inline void direct_set_present_filter_linear(bool linear)
+{
+    if (!cb_set_present_filter_linear) throw std::runtime_error("Callback not set for op: set_present_filter_linear");
+    cb_set_present_filter_linear(linear);
+}
+
+inline void direct_flush_to_screen(sol::optional<bool> apply_postprocess)
+{
+    if (!cb_flush_to_screen) throw std::runtime_error("Callback not set for op: flush_to_screen");
+    cb_flush_to_screen(apply_postprocess.value_or(true));
+}
+
+inline void direct_set_capture_filepath(const std::string& filepath)
+{
+    if (!cb_set_capture_filepath) throw std::runtime_error("Callback not set for op: set_capture_filepath");
+    cb_set_capture_filepath(filepath);
+}
+
+inline void direct_set_capture_fps(double fps)
+{
+    if (!cb_set_capture_fps) throw std::runtime_error("Callback not set for op: set_capture_fps");
+    cb_set_capture_fps((int)fps);
+}
+
+inline void direct_set_frame_index(double idx)
+{
+    if (!cb_set_frame_index) throw std::runtime_error("Callback not set for op: set_frame_index");
+    cb_set_frame_index((uint64_t)idx);
+}
+
+inline uint64_t direct_frame_index()
+{
+    if (!cb_frame_index) throw std::runtime_error("Callback not set for op: frame_index");
+    return cb_frame_index();
+}
+
+inline void direct_next_frame()
+{
+    if (!cb_next_frame) throw std::runtime_error("Callback not set for op: next_frame");
+    cb_next_frame();
+}
+
+inline void direct_save_frame_png(sol::optional<bool> apply_postprocess)
+{
+    if (!cb_save_frame_png) throw std::runtime_error("Callback not set for op: save_frame_png");
+    cb_save_frame_png(apply_postprocess.value_or(true));
+}
+
+inline void direct_set_pixel(double x, double y, double c_r, double c_g, double c_b, sol::optional<double> c_a)
+{
+    if (!cb_set_pixel) throw std::runtime_error("Callback not set for op: set_pixel");
+    cb_set_pixel((int)x, (int)y, make_color(c_r, c_g, c_b, c_a.value_or(255.0)));
+}
+
+inline std::tuple<int, int, int, int> direct_get_pixel(double x, double y)
+{
+    if (!cb_get_pixel) throw std::runtime_error("Callback not set for op: get_pixel");
+    const Engine_::Color c = cb_get_pixel((int)x, (int)y);
+    return { c.r, c.g, c.b, c.a };
+}
+
+inline void direct_draw_line(double x0, double y0, double x1, double y1, double c_r, double c_g, double c_b, sol::optional<double> c_a, sol::optional<double> thickness)
+{
+    if (!cb_draw_line) throw std::runtime_error("Callback not set for op: draw_line");
+    cb_draw_line((int)x0, (int)y0, (int)x1, (int)y1, make_color(c_r, c_g, c_b, c_a.value_or(255.0)), thickness ? (int)*thickness : 1);
+}
+
+inline void direct_draw_rect(double x, double y, double w, double h, double c_r, double c_g, double c_b, sol::optional<double> c_a, sol::optional<bool> filled, sol::optional<double> thickness)
+{
+    if (!cb_draw_rect) throw std::runtime_error("Callback not set for op: draw_rect");
+    cb_draw_rect((int)x, (int)y, (int)w, (int)h, make_color(c_r, c_g, c_b, c_a.value_or(255.0)), filled.value_or(true), thickness ? (int)*thickness : 1);
+}
+
+inline void direct_draw_circle(double cx, double cy, double radius, double c_r, double c_g, double c_b, sol::optional<double> c_a, sol::optional<bool> filled, sol::optional<double> thickness)
+{
+    if (!cb_draw_circle) throw std::runtime_error("Callback not set for op: draw_circle");
+    cb_draw_circle((int)cx, (int)cy, (int)radius, make_color(c_r, c_g, c_b, c_a.value_or(255.0)), filled.value_or(true), thickness ? (int)*thickness : 1);
+}
+
+inline void direct_draw_triangle_outline(double a_x, double a_y, double b_x, double b_y, double c_x, double c_y, double col_r, double col_g, double col_b, sol::optional<double> col_a, sol::optional<double> thickness)
+{
+    if (!cb_draw_triangle_outline) throw std::runtime_error("Callback not set for op: draw_triangle_outline");
+    cb_draw_triangle_outline(Engine_::Vec2{(float)a_x, (float)a_y}, Engine_::Vec2{(float)b_x, (float)b_y}, Engine_::Vec2{(float)c_x, (float)c_y}, make_color(col_r, col_g, col_b, col_a.value_or(255.0)), thickness ? (int)*thickness : 1);
+}
+
+inline void direct_draw_triangle_filled(double a_x, double a_y, double b_x, double b_y, double c_x, double c_y, double col_r, double col_g, double col_b, sol::optional<double> col_a)
+{
+    if (!cb_draw_triangle_filled) throw std::runtime_error("Callback not set for op: draw_triangle_filled");
+    cb_draw_triangle_filled(Engine_::Vec2{(float)a_x, (float)a_y}, Engine_::Vec2{(float)b_x, (float)b_y}, Engine_::Vec2{(float)c_x, (float)c_y}, make_color(col_r, col_g, col_b, col_a.value_or(255.0)));
+}
+
+inline void direct_draw_triangle_filled_grad(double a_x, double a_y, double ca_r, double ca_g, double ca_b, sol::optional<double> ca_a, double b_x, double b_y, double cb_r, double cb_g, double cb_b, sol::optional<double> cb_a, double c_x, double c_y, double cc_r, double cc_g, double cc_b, sol::optional<double> cc_a)
+{
+    if (!cb_draw_triangle_filled_grad) throw std::runtime_error("Callback not set for op: draw_triangle_filled_grad");
+    cb_draw_triangle_filled_grad(Engine_::Vec2{(float)a_x, (float)a_y}, make_color(ca_r, ca_g, ca_b, ca_a.value_or(255.0)), Engine_::Vec2{(float)b_x, (float)b_y}, make_color(cb_r, cb_g, cb_b, cb_a.value_or(255.0)), Engine_::Vec2{(float)c_x, (float)c_y}, make_color(cc_r, cc_g, cc_b, cc_a.value_or(255.0)));
+}
+
+inline void direct_draw_triangle_textured_named(double a_x, double a_y, double ua_x, double ua_y, double b_x, double b_y, double ub_x, double ub_y, double c_x, double c_y, double uc_x, double uc_y, const std::string& texture_name, sol::optional<double> tint_r, sol::optional<double> tint_g, sol::optional<double> tint_b, sol::optional<double> tint_a)
+{
+    if (!cb_draw_triangle_textured_named) throw std::runtime_error("Callback not set for op: draw_triangle_textured_named");
+    cb_draw_triangle_textured_named(Engine_::Vec2{(float)a_x, (float)a_y}, Engine_::Vec2{(float)ua_x, (float)ua_y}, Engine_::Vec2{(float)b_x, (float)b_y}, Engine_::Vec2{(float)ub_x, (float)ub_y}, Engine_::Vec2{(float)c_x, (float)c_y}, Engine_::Vec2{(float)uc_x, (float)uc_y}, texture_name, tint_r ? make_color(*tint_r, tint_g.value_or(0.0), tint_b.value_or(0.0), tint_a.value_or(255.0)) : Engine_::Color{255,255,255,255});
+}
+
+inline Engine_::Mat4 direct_mat4_identity()
+{
+    if (!cb_mat4_identity) throw std::runtime_error("Callback not set for op: mat4_identity");
+    return cb_mat4_identity();
+}
+
+inline Engine_::Mat4 direct_mat4_mul(const sol::object& a, const sol::object& b)
+{
+    if (!cb_mat4_mul) throw std::runtime_error("Callback not set for op: mat4_mul");
+    return cb_mat4_mul(mat4_from_object(a), mat4_from_object(b));
+}
+
+inline Engine_::Mat4 direct_mat4_translate(double t_x, double t_y, double t_z)
+{
+    if (!cb_mat4_translate) throw std::runtime_error("Callback not set for op: mat4_translate");
+    return cb_mat4_translate(Engine_::Vec3{(float)t_x, (float)t_y, (float)t_z});
+}
+
+inline Engine_::Mat4 direct_mat4_rotate_x(double radians)
+{
+    if (!cb_mat4_rotate_x) throw std::runtime_error("Callback not set for op: mat4_rotate_x");
+    return cb_mat4_rotate_x((float)radians);
+}
+
+inline Engine_::Mat4 direct_mat4_rotate_y(double radians)
+{
+    if (!cb_mat4_rotate_y) throw std::runtime_error("Callback not set for op: mat4_rotate_y");
+    return cb_mat4_rotate_y((float)radians);
+}
+
+inline Engine_::Mat4 direct_mat4_rotate_z(double radians)
+{
+    if (!cb_mat4_rotate_z) throw std::runtime_error("Callback not set for op: mat4_rotate_z");
+    return cb_mat4_rotate_z((float)radians);
+}
+
+inline Engine_::Mat4 direct_mat4_perspective(double fovy_radians, double aspect, double znear, double zfar)
+{
+    if (!cb_mat4_perspective) throw std::runtime_error("Callback not set for op: mat4_perspective");
+    return cb_mat4_perspective((float)fovy_radians, (float)aspect, (float)znear, (float)zfar);
+}
+
+inline Engine_::Mat4 direct_mat4_look_at(double eye_x, double eye_y, double eye_z, double center_x, double center_y, double center_z, double up_x, double up_y, double up_z)
+{
+    if (!cb_mat4_look_at) throw std::runtime_error("Callback not set for op: mat4_look_at");
+    return cb_mat4_look_at(Engine_::Vec3{(float)eye_x, (float)eye_y, (float)eye_z}, Engine_::Vec3{(float)center_x, (float)center_y, (float)center_z}, Engine_::Vec3{(float)up_x, (float)up_y, (float)up_z});
+}
+
+inline bool direct_tex_make_checker(const std::string& name, sol::optional<double> w, sol::optional<double> h, sol::optional<double> cell)
+{
+    if (!cb_tex_make_checker) throw std::runtime_error("Callback not set for op: tex_make_checker");
+    return cb_tex_make_checker(name, w ? (int)*w : 256, h ? (int)*h : 256, cell ? (int)*cell : 16);
+}
+
+inline bool direct_tex_load(const std::string& name, const std::string& filepath)
+{
+    if (!cb_tex_load) throw std::runtime_error("Callback not set for op: tex_load");
+    return cb_tex_load(name, filepath);
+}
+
+inline bool direct_tex_delete(const std::string& name)
+{
+    if (!cb_tex_delete) throw std::runtime_error("Callback not set for op: tex_delete");
+    return cb_tex_delete(name);
+}
+
+inline bool direct_tex_exists(const std::string& name)
+{
+    if (!cb_tex_exists) throw std::runtime_error("Callback not set for op: tex_exists");
+    return cb_tex_exists(name);
+}
+
+inline bool direct_tex_from_framebuffer(const std::string& name)
+{
+    if (!cb_tex_from_framebuffer) throw std::runtime_error("Callback not set for op: tex_from_framebuffer");
+    return cb_tex_from_framebuffer(name);
+}
+
+inline bool direct_mesh_make_cube(const std::string& name, sol::optional<double> size)
+{
+    if (!cb_mesh_make_cube) throw std::runtime_error("Callback not set for op: mesh_make_cube");
+    return cb_mesh_make_cube(name, size ? (float)*size : 1.0f);
+}
+
+inline bool direct_mesh_delete(const std::string& name)
+{
+    if (!cb_mesh_delete) throw std::runtime_error("Callback not set for op: mesh_delete");
+    return cb_mesh_delete(name);
+}
+
+inline bool direct_mesh_exists(const std::string& name)
+{
+    if (!cb_mesh_exists) throw std::runtime_error("Callback not set for op: mesh_exists");
+    return cb_mesh_exists(name);
+}
+
+inline void direct_draw_mesh_named(const std::string& mesh_name, const sol::object& mvp, sol::optional<std::string> texture_name, sol::optional<bool> enable_depth_test)
+{
+    if (!cb_draw_mesh_named) throw std::runtime_error("Callback not set for op: draw_mesh_named");
+    cb_draw_mesh_named(mesh_name, mat4_from_object(mvp), texture_name ? *texture_name : std::string{}, enable_depth_test.value_or(true));
+}
+
+inline void direct_pp_set_bloom(sol::optional<bool> enabled, sol::optional<double> threshold, sol::optional<double> intensity, sol::optional<double> downsample, sol::optional<double> sigma)
+{
+    if (!cb_pp_set_bloom) throw std::runtime_error("Callback not set for op: pp_set_bloom");
+    cb_pp_set_bloom(enabled.value_or(true), threshold ? (float)*threshold : 0.75f, intensity ? (float)*intensity : 1.25f, downsample ? (int)*downsample : 4, sigma ? (float)*sigma : 6.0f);
+}
+
+inline void direct_pp_set_tone(sol::optional<bool> enabled, sol::optional<double> exposure, sol::optional<double> gamma)
+{
+    if (!cb_pp_set_tone) throw std::runtime_error("Callback not set for op: pp_set_tone");
+    cb_pp_set_tone(enabled.value_or(true), exposure ? (float)*exposure : 1.25f, gamma ? (float)*gamma : 2.2f);
+}
+
+inline bool direct_pp_set_grade(sol::optional<bool> enabled, sol::optional<std::string> lut_path, sol::optional<double> strength, sol::optional<std::string> interp)
+{
+    if (!cb_pp_set_grade) throw std::runtime_error("Callback not set for op: pp_set_grade");
+    return cb_pp_set_grade(enabled.value_or(true), lut_path ? *lut_path : std::string{}, strength ? (float)*strength : 1.0f, interp ? *interp : std::string{"tetrahedral"});
+}
+
+inline void direct_pp_set_aa(sol::optional<bool> enabled, sol::optional<double> edge_threshold, sol::optional<double> edge_threshold_min, sol::optional<double> subpixel)
+{
+    if (!cb_pp_set_aa) throw std::runtime_error("Callback not set for op: pp_set_aa");
+    cb_pp_set_aa(enabled.value_or(true), edge_threshold ? (float)*edge_threshold : 0.125f, edge_threshold_min ? (float)*edge_threshold_min : 0.0312f, subpixel ? (float)*subpixel : 0.75f);
+}
+
+inline void direct_pp_reset()
+{
+    if (!cb_pp_reset) throw std::runtime_error("Callback not set for op: pp_reset");
+    cb_pp_reset();
+}
+
+inline sol::table make_direct_table(sol::state_view lua)
+{
+    sol::table t = lua.create_table(0, 84);
+    t.set_function("time_seconds", &direct_time_seconds);
+    t.set_function("delta_seconds", &direct_delta_seconds);
+    t.set_function("key_down", &direct_key_down);
+    t.set_function("key_pressed", &direct_key_pressed);
+    t.set_function("key_released", &direct_key_released);
+    t.set_function("mouse_x", &direct_mouse_x);
+    t.set_function("mouse_y", &direct_mouse_y);
+    t.set_function("mouse_prev_x", &direct_mouse_prev_x);
+    t.set_function("mouse_prev_y", &direct_mouse_prev_y);
+    t.set_function("mouse_dx", &direct_mouse_dx);
+    t.set_function("mouse_dy", &direct_mouse_dy);
+    t.set_function("mouse_moved", &direct_mouse_moved);
+    t.set_function("mouse_down", &direct_mouse_down);
+    t.set_function("mouse_pressed", &direct_mouse_pressed);
+    t.set_function("mouse_released", &direct_mouse_released);
+    t.set_function("mouse_scroll_x", &direct_mouse_scroll_x);
+    t.set_function("mouse_scroll_y", &direct_mouse_scroll_y);
+    t.set_function("mouse_scrolled", &direct_mouse_scrolled);
+    t.set_function("mouse_in_window", &direct_mouse_in_window);
+    t.set_function("mouse_entered", &direct_mouse_entered);
+    t.set_function("mouse_left", &direct_mouse_left);
+    t.set_function("mouse_fb_x", &direct_mouse_fb_x);
+    t.set_function("mouse_fb_y", &direct_mouse_fb_y);
+    t.set_function("mouse_fb_ix", &direct_mouse_fb_ix);
+    t.set_function("mouse_fb_iy", &direct_mouse_fb_iy);
+    t.set_function("set_cursor_visible", &direct_set_cursor_visible);
+    t.set_function("cursor_visible", &direct_cursor_visible);
+    t.set_function("set_cursor_captured", &direct_set_cursor_captured);
+    t.set_function("cursor_captured", &direct_cursor_captured);
+    t.set_function("should_close", &direct_should_close);
+    t.set_function("request_close", &direct_request_close);
+    t.set_function("poll_events", &direct_poll_events);
+    t.set_function("fb_width", &direct_fb_width);
+    t.set_function("fb_height", &direct_fb_height);
+    t.set_function("display_width", &direct_display_width);
+    t.set_function("display_height", &direct_display_height);
+    t.set_function("resize_framebuffer", &direct_resize_framebuffer);
+    t.set_function("enable_depth", &direct_enable_depth);
+    t.set_function("depth_enabled", &direct_depth_enabled);
+    t.set_function("set_blend_mode", &direct_set_blend_mode);
+    t.set_function("blend_mode", &direct_blend_mode);
+    t.set_function("set_clip_rect", &direct_set_clip_rect);
+    t.set_function("disable_clip_rect", &direct_disable_clip_rect);
+    t.set_function("clear_color", &direct_clear_color);
+    t.set_function("clear_depth", &direct_clear_depth);
+    t.set_function("set_present_filter_linear", &direct_set_present_filter_linear);
+    t.set_function("flush_to_screen", &direct_flush_to_screen);
+    t.set_function("set_capture_filepath", &direct_set_capture_filepath);
+    t.set_function("set_capture_fps", &direct_set_capture_fps);
+    t.set_function("set_frame_index", &direct_set_frame_index);
+    t.set_function("frame_index", &direct_frame_index);
+    t.set_function("next_frame", &direct_next_frame);
+    t.set_function("save_frame_png", &direct_save_frame_png);
+    t.set_function("set_pixel", &direct_set_pixel);
+    t.set_function("get_pixel", &direct_get_pixel);
+    t.set_function("draw_line", &direct_draw_line);
+    t.set_function("draw_rect", &direct_draw_rect);
+    t.set_function("draw_circle", &direct_draw_circle);
+    t.set_function("draw_triangle_outline", &direct_draw_triangle_outline);
+    t.set_function("draw_triangle_filled", &direct_draw_triangle_filled);
+    t.set_function("draw_triangle_filled_grad", &direct_draw_triangle_filled_grad);
+    t.set_function("draw_triangle_textured_named", &direct_draw_triangle_textured_named);
+    t.set_function("mat4_identity", &direct_mat4_identity);
+    t.set_function("mat4_mul", &direct_mat4_mul);
+    t.set_function("mat4_translate", &direct_mat4_translate);
+    t.set_function("mat4_rotate_x", &direct_mat4_rotate_x);
+    t.set_function("mat4_rotate_y", &direct_mat4_rotate_y);
+    t.set_function("mat4_rotate_z", &direct_mat4_rotate_z);
+    t.set_function("mat4_perspective", &direct_mat4_perspective);
+    t.set_function("mat4_look_at", &direct_mat4_look_at);
+    t.set_function("tex_make_checker", &direct_tex_make_checker);
+    t.set_function("tex_load", &direct_tex_load);
+    t.set_function("tex_delete", &direct_tex_delete);
+    t.set_function("tex_exists", &direct_tex_exists);
+    t.set_function("tex_from_framebuffer", &direct_tex_from_framebuffer);
+    t.set_function("mesh_make_cube", &direct_mesh_make_cube);
+    t.set_function("mesh_delete", &direct_mesh_delete);
+    t.set_function("mesh_exists", &direct_mesh_exists);
+    t.set_function("draw_mesh_named", &direct_draw_mesh_named);
+    t.set_function("pp_set_bloom", &direct_pp_set_bloom);
+    t.set_function("pp_set_tone", &direct_pp_set_tone);
+    t.set_function("pp_set_grade", &direct_pp_set_grade);
+    t.set_function("pp_set_aa", &direct_pp_set_aa);
+    t.set_function("pp_reset", &direct_pp_reset);
+    return t;
+}
+
+// -------------------------
+// CommandBuffer: void ops recorded from Lua into a flat word stream and executed
+// by one C++ call. Each command is a header word (opcode | payload words << 16)
+// followed by its arguments: int/float/bool/BlendMode one word, u64 two, Color
+// packed RGBA in one word, VecN/Mat4 as float words, strings as an index into the
+// buffer's string table. Recording methods take flat args (see the op list):
+//   buf:draw_line(x0, y0, x1, y1, r, g, b, a, thickness)
+// execute() replays the commands in recorded order through the same callbacks as
+// dispatch(); nothing is reordered, since blending makes draw order visible.
+// -------------------------
+class CommandBuffer
+{
+public:
+    void clear()
+    {
+        words_.clear();
+        strings_.clear();
+        string_ids_.clear();
+        count_ = 0;
+    }
+
+    size_t count() const { return count_; }
+    size_t size_bytes() const { return words_.size() * sizeof(uint32_t); }
+    void reserve_words(size_t n) { words_.reserve(n); }
+
+    void execute() const;
+
+    // execute() then clear(); the buffer keeps its capacity for the next frame.
+    void submit()
+    {
+        execute();
+        clear();
+    }
+
+    void set_cursor_visible(bool visible)
+    {
+        const size_t at = begin(OP_SET_CURSOR_VISIBLE);
+        put(visible);
+        finish(at);
+    }
+
+    void set_cursor_captured(bool captured)
+    {
+        const size_t at = begin(OP_SET_CURSOR_CAPTURED);
+        put(captured);
+        finish(at);
+    }
+
+    void request_close()
+    {
+        const size_t at = begin(OP_REQUEST_CLOSE);
+        finish(at);
+    }
+
+    void poll_events()
+    {
+        const size_t at = begin(OP_POLL_EVENTS);
+        finish(at);
+    }
+
+    void resize_framebuffer(double w, double h)
+    {
+        const size_t at = begin(OP_RESIZE_FRAMEBUFFER);
+        put((int)w);
+        put((int)h);
+        finish(at);
+    }
+
+    void enable_depth(bool enabled)
+    {
+        const size_t at = begin(OP_ENABLE_DEPTH);
+        put(enabled);
+        finish(at);
+    }
+
+    void set_blend_mode(const sol::object& mode)
+    {
+        const size_t at = begin(OP_SET_BLEND_MODE);
+        put(blend_mode_from_object(mode));
+        finish(at);
+    }
+
+    void set_clip_rect(double x, double y, double w, double h)
+    {
+        const size_t at = begin(OP_SET_CLIP_RECT);
+        put((int)x);
+        put((int)y);
+        put((int)w);
+        put((int)h);
+        finish(at);
+    }
+
+    void disable_clip_rect()
+    {
+        const size_t at = begin(OP_DISABLE_CLIP_RECT);
+        finish(at);
+    }
+
+    void clear_color(double c_r, double c_g, double c_b, sol::optional<double> c_a)
+    {
+        const size_t at = begin(OP_CLEAR_COLOR);
+        put(make_color(c_r, c_g, c_b, c_a.value_or(255.0)));
+        finish(at);
+    }
+
+    void clear_depth(sol::optional<double> z)
+    {
+        const size_t at = begin(OP_CLEAR_DEPTH);
+        put(z ? (float)*z : 1.0f);
+        finish(at);
+    }
+
+    void set_present_filter_linear(bool linear)
+    {
+        const size_t at = begin(OP_SET_PRESENT_FILTER_LINEAR);
+        put(linear);
+        finish(at);
+    }
+
+    void flush_to_screen(sol::optional<bool> apply_postprocess)
+    {
+        const size_t at = begin(OP_FLUSH_TO_SCREEN);
+        put(apply_postprocess.value_or(true));
+        finish(at);
+    }
+
+    void set_capture_filepath(const std::string& filepath)
+    {
+        const size_t at = begin(OP_SET_CAPTURE_FILEPATH);
+        put(filepath);
+        finish(at);
+    }
+
+    void set_capture_fps(double fps)
+    {
+        const size_t at = begin(OP_SET_CAPTURE_FPS);
+        put((int)fps);
+        finish(at);
+    }
+
+    void set_frame_index(double idx)
+    {
+        const size_t at = begin(OP_SET_FRAME_INDEX);
+        put((uint64_t)idx);
+        finish(at);
+    }
+
+    void next_frame()
+    {
+        const size_t at = begin(OP_NEXT_FRAME);
+        finish(at);
+    }
+
+    void save_frame_png(sol::optional<bool> apply_postprocess)
+    {
+        const size_t at = begin(OP_SAVE_FRAME_PNG);
+        put(apply_postprocess.value_or(true));
+        finish(at);
+    }
+
+    void set_pixel(double x, double y, double c_r, double c_g, double c_b, sol::optional<double> c_a)
+    {
+        const size_t at = begin(OP_SET_PIXEL);
+        put((int)x);
+        put((int)y);
+        put(make_color(c_r, c_g, c_b, c_a.value_or(255.0)));
+        finish(at);
+    }
+
+    void draw_line(double x0, double y0, double x1, double y1, double c_r, double c_g, double c_b, sol::optional<double> c_a, sol::optional<double> thickness)
+    {
+        const size_t at = begin(OP_DRAW_LINE);
+        put((int)x0);
+        put((int)y0);
+        put((int)x1);
+        put((int)y1);
+        put(make_color(c_r, c_g, c_b, c_a.value_or(255.0)));
+        put(thickness ? (int)*thickness : 1);
+        finish(at);
+    }
+
+    void draw_rect(double x, double y, double w, double h, double c_r, double c_g, double c_b, sol::optional<double> c_a, sol::optional<bool> filled, sol::optional<double> thickness)
+    {
+        const size_t at = begin(OP_DRAW_RECT);
+        put((int)x);
+        put((int)y);
+        put((int)w);
+        put((int)h);
+        put(make_color(c_r, c_g, c_b, c_a.value_or(255.0)));
+        put(filled.value_or(true));
+        put(thickness ? (int)*thickness : 1);
+        finish(at);
+    }
+
+    void draw_circle(double cx, double cy, double radius, double c_r, double c_g, double c_b, sol::optional<double> c_a, sol::optional<bool> filled, sol::optional<double> thickness)
+    {
+        const size_t at = begin(OP_DRAW_CIRCLE);
+        put((int)cx);
+        put((int)cy);
+        put((int)radius);
+        put(make_color(c_r, c_g, c_b, c_a.value_or(255.0)));
+        put(filled.value_or(true));
+        put(thickness ? (int)*thickness : 1);
+        finish(at);
+    }
+
+    void draw_triangle_outline(double a_x, double a_y, double b_x, double b_y, double c_x, double c_y, double col_r, double col_g, double col_b, sol::optional<double> col_a, sol::optional<double> thickness)
+    {
+        const size_t at = begin(OP_DRAW_TRIANGLE_OUTLINE);
+        put(Engine_::Vec2{(float)a_x, (float)a_y});
+        put(Engine_::Vec2{(float)b_x, (float)b_y});
+        put(Engine_::Vec2{(float)c_x, (float)c_y});
+        put(make_color(col_r, col_g, col_b, col_a.value_or(255.0)));
+        put(thickness ? (int)*thickness : 1);
+        finish(at);
+    }
+
+    void draw_triangle_filled(double a_x, double a_y, double b_x, double b_y, double c_x, double c_y, double col_r, double col_g, double col_b, sol::optional<double> col_a)
+    {
+        const size_t at = begin(OP_DRAW_TRIANGLE_FILLED);
+        put(Engine_::Vec2{(float)a_x, (float)a_y});
+        put(Engine_::Vec2{(float)b_x, (float)b_y});
+        put(Engine_::Vec2{(float)c_x, (float)c_y});
+        put(make_color(col_r, col_g, col_b, col_a.value_or(255.0)));
+        finish(at);
+    }
+
+    void draw_triangle_filled_grad(double a_x, double a_y, double ca_r, double ca_g, double ca_b, sol::optional<double> ca_a, double b_x, double b_y, double cb_r, double cb_g, double cb_b, sol::optional<double> cb_a, double c_x, double c_y, double cc_r, double cc_g, double cc_b, sol::optional<double> cc_a)
+    {
+        const size_t at = begin(OP_DRAW_TRIANGLE_FILLED_GRAD);
+        put(Engine_::Vec2{(float)a_x, (float)a_y});
+        put(make_color(ca_r, ca_g, ca_b, ca_a.value_or(255.0)));
+        put(Engine_::Vec2{(float)b_x, (float)b_y});
+        put(make_color(cb_r, cb_g, cb_b, cb_a.value_or(255.0)));
+        put(Engine_::Vec2{(float)c_x, (float)c_y});
+        put(make_color(cc_r, cc_g, cc_b, cc_a.value_or(255.0)));
+        finish(at);
+    }
+
+    void draw_triangle_textured_named(double a_x, double a_y, double ua_x, double ua_y, double b_x, double b_y, double ub_x, double ub_y, double c_x, double c_y, double uc_x, double uc_y, const std::string& texture_name, sol::optional<double> tint_r, sol::optional<double> tint_g, sol::optional<double> tint_b, sol::optional<double> tint_a)
+    {
+        const size_t at = begin(OP_DRAW_TRIANGLE_TEXTURED_NAMED);
+        put(Engine_::Vec2{(float)a_x, (float)a_y});
+        put(Engine_::Vec2{(float)ua_x, (float)ua_y});
+        put(Engine_::Vec2{(float)b_x, (float)b_y});
+        put(Engine_::Vec2{(float)ub_x, (float)ub_y});
+        put(Engine_::Vec2{(float)c_x, (float)c_y});
+        put(Engine_::Vec2{(float)uc_x, (float)uc_y});
+        put(texture_name);
+        put(tint_r ? make_color(*tint_r, tint_g.value_or(0.0), tint_b.value_or(0.0), tint_a.value_or(255.0)) : Engine_::Color{255,255,255,255});
+        finish(at);
+    }
+
+    void draw_mesh_named(const std::string& mesh_name, const sol::object& mvp, sol::optional<std::string> texture_name, sol::optional<bool> enable_depth_test)
+    {
+        const size_t at = begin(OP_DRAW_MESH_NAMED);
+        put(mesh_name);
+        put(mat4_from_object(mvp));
+        put(texture_name ? *texture_name : std::string{});
+        put(enable_depth_test.value_or(true));
+        finish(at);
+    }
+
+    void pp_set_bloom(sol::optional<bool> enabled, sol::optional<double> threshold, sol::optional<double> intensity, sol::optional<double> downsample, sol::optional<double> sigma)
+    {
+        const size_t at = begin(OP_PP_SET_BLOOM);
+        put(enabled.value_or(true));
+        put(threshold ? (float)*threshold : 0.75f);
+        put(intensity ? (float)*intensity : 1.25f);
+        put(downsample ? (int)*downsample : 4);
+        put(sigma ? (float)*sigma : 6.0f);
+        finish(at);
+    }
+
+    void pp_set_tone(sol::optional<bool> enabled, sol::optional<double> exposure, sol::optional<double> gamma)
+    {
+        const size_t at = begin(OP_PP_SET_TONE);
+        put(enabled.value_or(true));
+        put(exposure ? (float)*exposure : 1.25f);
+        put(gamma ? (float)*gamma : 2.2f);
+        finish(at);
+    }
+
+    void pp_set_aa(sol::optional<bool> enabled, sol::optional<double> edge_threshold, sol::optional<double> edge_threshold_min, sol::optional<double> subpixel)
+    {
+        const size_t at = begin(OP_PP_SET_AA);
+        put(enabled.value_or(true));
+        put(edge_threshold ? (float)*edge_threshold : 0.125f);
+        put(edge_threshold_min ? (float)*edge_threshold_min : 0.0312f);
+        put(subpixel ? (float)*subpixel : 0.75f);
+        finish(at);
+    }
+
+    void pp_reset()
+    {
+        const size_t at = begin(OP_PP_RESET);
+        finish(at);
+    }
+
+private:
+    class Reader
+    {
+    public:
+        Reader(const CommandBuffer& buf, const uint32_t* p) : buf_(buf), p_(p) {}
+
+        int read_int() { return (int)*p_++; }
+        bool read_bool() { return *p_++ != 0; }
+        float read_float()
+        {
+            float v;
+            std::memcpy(&v, p_++, sizeof(v));
+            return v;
+        }
+        uint64_t read_u64()
+        {
+            const uint64_t lo = *p_++;
+            const uint64_t hi = *p_++;
+            return lo | (hi << 32);
+        }
+        const std::string& read_string() { return buf_.strings_[*p_++]; }
+        Engine_::Color read_color()
+        {
+            const uint32_t w = *p_++;
+            return Engine_::Color{ (uint8_t)w, (uint8_t)(w >> 8), (uint8_t)(w >> 16), (uint8_t)(w >> 24) };
+        }
+        Engine_::Vec2 read_vec2()
+        {
+            Engine_::Vec2 v;
+            v.x = read_float();
+            v.y = read_float();
+            return v;
+        }
+        Engine_::Vec3 read_vec3()
+        {
+            Engine_::Vec3 v;
+            v.x = read_float();
+            v.y = read_float();
+            v.z = read_float();
+            return v;
+        }
+        Engine_::Vec4 read_vec4()
+        {
+            Engine_::Vec4 v;
+            v.x = read_float();
+            v.y = read_float();
+            v.z = read_float();
+            v.w = read_float();
+            return v;
+        }
+        Engine_::Mat4 read_mat4()
+        {
+            Engine_::Mat4 m;
+            std::memcpy(m.m, p_, sizeof(m.m));
+            p_ += 16;
+            return m;
+        }
+        Engine_::BlendMode read_blend_mode() { return (Engine_::BlendMode)read_int(); }
+
+    private:
+        const CommandBuffer& buf_;
+        const uint32_t* p_;
+    };
+
+    size_t begin(int op)
+    {
+        words_.push_back((uint32_t)op);
+        return words_.size() - 1;
+    }
+
+    void finish(size_t at)
+    {
+        words_[at] |= (uint32_t)(words_.size() - at - 1) << 16;
+        ++count_;
+    }
+
+    void put(int v) { words_.push_back((uint32_t)v); }
+    void put(bool v) { words_.push_back(v ? 1u : 0u); }
+    void put(float v)
+    {
+        uint32_t w;
+        std::memcpy(&w, &v, sizeof(w));
+        words_.push_back(w);
+    }
+    void put(uint64_t v)
+    {
+        words_.push_back((uint32_t)v);
+        words_.push_back((uint32_t)(v >> 32));
+    }
+    void put(const std::string& s)
+    {
+        auto it = string_ids_.find(s);
+        if (it == string_ids_.end()) {
+            it = string_ids_.emplace(s, (uint32_t)strings_.size()).first;
+            strings_.push_back(s);
+        }
+        words_.push_back(it->second);
+    }
+    void put(Engine_::Color c)
+    {
+        words_.push_back((uint32_t)c.r | ((uint32_t)c.g << 8) | ((uint32_t)c.b << 16) | ((uint32_t)c.a << 24));
+    }
+    void put(const Engine_::Vec2& v) { put(v.x); put(v.y); }
+    void put(const Engine_::Vec3& v) { put(v.x); put(v.y); put(v.z); }
+    void put(const Engine_::Vec4& v) { put(v.x); put(v.y); put(v.z); put(v.w); }
+    void put(const Engine_::Mat4& m)
+    {
+        const size_t at = words_.size();
+        words_.resize(at + 16);
+        std::memcpy(words_.data() + at, m.m, sizeof(m.m));
+    }
+    void put(Engine_::BlendMode m) { put((int)m); }
+
+    std::vector<uint32_t> words_;
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, uint32_t> string_ids_;
+    size_t count_ = 0;
+};
+
+inline void CommandBuffer::execute() const
+{
+    const uint32_t* p = words_.data();
+    const uint32_t* const end = p + words_.size();
+    while (p < end) {
+        const uint32_t header = *p;
+        const uint32_t* const next = p + 1 + (header >> 16);
+        Reader rd(*this, p + 1);
+        switch ((int)(header & 0xFFFFu)) {
+        case OP_SET_CURSOR_VISIBLE: {
+            const bool visible = rd.read_bool();
+            if (!cb_set_cursor_visible) throw std::runtime_error("Callback not set for op: set_cursor_visible");
+            cb_set_cursor_visible(visible);
+            break;
+        }
+        case OP_SET_CURSOR_CAPTURED: {
+            const bool captured = rd.read_bool();
+            if (!cb_set_cursor_captured) throw std::runtime_error("Callback not set for op: set_cursor_captured");
+            cb_set_cursor_captured(captured);
+            break;
+        }
+        case OP_REQUEST_CLOSE: {
+            if (!cb_request_close) throw std::runtime_error("Callback not set for op: request_close");
+            cb_request_close();
+            break;
+        }
+        case OP_POLL_EVENTS: {
+            if (!cb_poll_events) throw std::runtime_error("Callback not set for op: poll_events");
+            cb_poll_events();
+            break;
+        }
+        case OP_RESIZE_FRAMEBUFFER: {
+            const int w = rd.read_int();
+            const int h = rd.read_int();
+            if (!cb_resize_framebuffer) throw std::runtime_error("Callback not set for op: resize_framebuffer");
+            cb_resize_framebuffer(w, h);
+            break;
+        }
+        case OP_ENABLE_DEPTH: {
+            const bool enabled = rd.read_bool();
+            if (!cb_enable_depth) throw std::runtime_error("Callback not set for op: enable_depth");
+            cb_enable_depth(enabled);
+            break;
+        }
+        case OP_SET_BLEND_MODE: {
+            const Engine_::BlendMode mode = rd.read_blend_mode();
+            if (!cb_set_blend_mode) throw std::runtime_error("Callback not set for op: set_blend_mode");
+            cb_set_blend_mode(mode);
+            break;
+        }
+        case OP_SET_CLIP_RECT: {
+            const int x = rd.read_int();
+            const int y = rd.read_int();
+            const int w = rd.read_int();
+            const int h = rd.read_int();
+            if (!cb_set_clip_rect) throw std::runtime_error("Callback not set for op: set_clip_rect");
+            cb_set_clip_rect(x, y, w, h);
+            break;
+        }
+        case OP_DISABLE_CLIP_RECT: {
+            if (!cb_disable_clip_rect) throw std::runtime_error("Callback not set for op: disable_clip_rect");
+            cb_disable_clip_rect();
+            break;
+        }
+        case OP_CLEAR_COLOR: {
+            const Engine_::Color c = rd.read_color();
+            if (!cb_clear_color) throw std::runtime_error("Callback not set for op: clear_color");
+            cb_clear_color(c);
+            break;
+        }
+        case OP_CLEAR_DEPTH: {
+            const float z = rd.read_float();
+            if (!cb_clear_depth) throw std::runtime_error("Callback not set for op: clear_depth");
+            cb_clear_depth(z);
+            break;
+        }
+        case OP_SET_PRESENT_FILTER_LINEAR: {
+            const bool linear = rd.read_bool();
+            if (!cb_set_present_filter_linear) throw std::runtime_error("Callback not set for op: set_present_filter_linear");
+            cb_set_present_filter_linear(linear);
+            break;
+        }
+        case OP_FLUSH_TO_SCREEN: {
+            const bool apply_postprocess = rd.read_bool();
+            if (!cb_flush_to_screen) throw std::runtime_error("Callback not set for op: flush_to_screen");
+            cb_flush_to_screen(apply_postprocess);
+            break;
+        }
+        case OP_SET_CAPTURE_FILEPATH: {
+            const std::string& filepath = rd.read_string();
+            if (!cb_set_capture_filepath) throw std::runtime_error("Callback not set for op: set_capture_filepath");
+            cb_set_capture_filepath(filepath);
+            break;
+        }
+        case OP_SET_CAPTURE_FPS: {
+            const int fps = rd.read_int();
+            if (!cb_set_capture_fps) throw std::runtime_error("Callback not set for op: set_capture_fps");
+            cb_set_capture_fps(fps);
+            break;
+        }
+        case OP_SET_FRAME_INDEX: {
+            const uint64_t idx = rd.read_u64();
+            if (!cb_set_frame_index) throw std::runtime_error("Callback not set for op: set_frame_index");
+            cb_set_frame_index(idx);
+            break;
+        }
+        case OP_NEXT_FRAME: {
+            if (!cb_next_frame) throw std::runtime_error("Callback not set for op: next_frame");
+            cb_next_frame();
+            break;
+        }
+        case OP_SAVE_FRAME_PNG: {
+            const bool apply_postprocess = rd.read_bool();
+            if (!cb_save_frame_png) throw std::runtime_error("Callback not set for op: save_frame_png");
+            cb_save_frame_png(apply_postprocess);
+            break;
+        }
+        case OP_SET_PIXEL: {
+            const int x = rd.read_int();
+            const int y = rd.read_int();
+            const Engine_::Color c = rd.read_color();
+            if (!cb_set_pixel) throw std::runtime_error("Callback not set for op: set_pixel");
+            cb_set_pixel(x, y, c);
+            break;
+        }
+        case OP_DRAW_LINE: {
+            const int x0 = rd.read_int();
+            const int y0 = rd.read_int();
+            const int x1 = rd.read_int();
+            const int y1 = rd.read_int();
+            const Engine_::Color c = rd.read_color();
+            const int thickness = rd.read_int();
+            if (!cb_draw_line) throw std::runtime_error("Callback not set for op: draw_line");
+            cb_draw_line(x0, y0, x1, y1, c, thickness);
+            break;
+        }
+        case OP_DRAW_RECT: {
+            const int x = rd.read_int();
+            const int y = rd.read_int();
+            const int w = rd.read_int();
+            const int h = rd.read_int();
+            const Engine_::Color c = rd.read_color();
+            const bool filled = rd.read_bool();
+            const int thickness = rd.read_int();
+            if (!cb_draw_rect) throw std::runtime_error("Callback not set for op: draw_rect");
+            cb_draw_rect(x, y, w, h, c, filled, thickness);
+            break;
+        }
+        case OP_DRAW_CIRCLE: {
+            const int cx = rd.read_int();
+            const int cy = rd.read_int();
+            const int radius = rd.read_int();
+            const Engine_::Color c = rd.read_color();
+            const bool filled = rd.read_bool();
+            const int thickness = rd.read_int();
+            if (!cb_draw_circle) throw std::runtime_error("Callback not set for op: draw_circle");
+            cb_draw_circle(cx, cy, radius, c, filled, thickness);
+            break;
+        }
+        case OP_DRAW_TRIANGLE_OUTLINE: {
+            const Engine_::Vec2 a = rd.read_vec2();
+            const Engine_::Vec2 b = rd.read_vec2();
+            const Engine_::Vec2 c = rd.read_vec2();
+            const Engine_::Color col = rd.read_color();
+            const int thickness = rd.read_int();
+            if (!cb_draw_triangle_outline) throw std::runtime_error("Callback not set for op: draw_triangle_outline");
+            cb_draw_triangle_outline(a, b, c, col, thickness);
+            break;
+        }
+        case OP_DRAW_TRIANGLE_FILLED: {
+            const Engine_::Vec2 a = rd.read_vec2();
+            const Engine_::Vec2 b = rd.read_vec2();
+            const Engine_::Vec2 c = rd.read_vec2();
+            const Engine_::Color col = rd.read_color();
+            if (!cb_draw_triangle_filled) throw std::runtime_error("Callback not set for op: draw_triangle_filled");
+            cb_draw_triangle_filled(a, b, c, col);
+            break;
+        }
+        case OP_DRAW_TRIANGLE_FILLED_GRAD: {
+            const Engine_::Vec2 a = rd.read_vec2();
+            const Engine_::Color ca = rd.read_color();
+            const Engine_::Vec2 b = rd.read_vec2();
+            const Engine_::Color cb = rd.read_color();
+            const Engine_::Vec2 c = rd.read_vec2();
+            const Engine_::Color cc = rd.read_color();
+            if (!cb_draw_triangle_filled_grad) throw std::runtime_error("Callback not set for op: draw_triangle_filled_grad");
+            cb_draw_triangle_filled_grad(a, ca, b, cb, c, cc);
+            break;
+        }
+        case OP_DRAW_TRIANGLE_TEXTURED_NAMED: {
+            const Engine_::Vec2 a = rd.read_vec2();
+            const Engine_::Vec2 ua = rd.read_vec2();
+            const Engine_::Vec2 b = rd.read_vec2();
+            const Engine_::Vec2 ub = rd.read_vec2();
+            const Engine_::Vec2 c = rd.read_vec2();
+            const Engine_::Vec2 uc = rd.read_vec2();
+            const std::string& texture_name = rd.read_string();
+            const Engine_::Color tint = rd.read_color();
+            if (!cb_draw_triangle_textured_named) throw std::runtime_error("Callback not set for op: draw_triangle_textured_named");
+            cb_draw_triangle_textured_named(a, ua, b, ub, c, uc, texture_name, tint);
+            break;
+        }
+        case OP_DRAW_MESH_NAMED: {
+            const std::string& mesh_name = rd.read_string();
+            const Engine_::Mat4 mvp = rd.read_mat4();
+            const std::string& texture_name = rd.read_string();
+            const bool enable_depth_test = rd.read_bool();
+            if (!cb_draw_mesh_named) throw std::runtime_error("Callback not set for op: draw_mesh_named");
+            cb_draw_mesh_named(mesh_name, mvp, texture_name, enable_depth_test);
+            break;
+        }
+        case OP_PP_SET_BLOOM: {
+            const bool enabled = rd.read_bool();
+            const float threshold = rd.read_float();
+            const float intensity = rd.read_float();
+            const int downsample = rd.read_int();
+            const float sigma = rd.read_float();
+            if (!cb_pp_set_bloom) throw std::runtime_error("Callback not set for op: pp_set_bloom");
+            cb_pp_set_bloom(enabled, threshold, intensity, downsample, sigma);
+            break;
+        }
+        case OP_PP_SET_TONE: {
+            const bool enabled = rd.read_bool();
+            const float exposure = rd.read_float();
+            const float gamma = rd.read_float();
+            if (!cb_pp_set_tone) throw std::runtime_error("Callback not set for op: pp_set_tone");
+            cb_pp_set_tone(enabled, exposure, gamma);
+            break;
+        }
+        case OP_PP_SET_AA: {
+            const bool enabled = rd.read_bool();
+            const float edge_threshold = rd.read_float();
+            const float edge_threshold_min = rd.read_float();
+            const float subpixel = rd.read_float();
+            if (!cb_pp_set_aa) throw std::runtime_error("Callback not set for op: pp_set_aa");
+            cb_pp_set_aa(enabled, edge_threshold, edge_threshold_min, subpixel);
+            break;
+        }
+        case OP_PP_RESET: {
+            if (!cb_pp_reset) throw std::runtime_error("Callback not set for op: pp_reset");
+            cb_pp_reset();
+            break;
+        }
+        default:
+            throw std::runtime_error("CommandBuffer: bad opcode " + std::to_string(header & 0xFFFFu));
+        }
+        p = next;
+    }
+}
+
+// Engine.CommandBuffer in Lua: CommandBuffer.new(), then buf:<op>(flat args...),
+// buf:submit() / execute() / clear() / count() / size_bytes().
+inline void register_command_buffer(sol::table owner, const char* type_name = "CommandBuffer")
+{
+    sol::usertype<CommandBuffer> ut = owner.new_usertype<CommandBuffer>(type_name,
+        sol::constructors<CommandBuffer()>());
+    ut["clear"] = &CommandBuffer::clear;
+    ut["count"] = &CommandBuffer::count;
+    ut["size_bytes"] = &CommandBuffer::size_bytes;
+    ut["reserve_words"] = &CommandBuffer::reserve_words;
+    ut["execute"] = &CommandBuffer::execute;
+    ut["submit"] = &CommandBuffer::submit;
+    ut["set_cursor_visible"] = &CommandBuffer::set_cursor_visible;
+    ut["set_cursor_captured"] = &CommandBuffer::set_cursor_captured;
+    ut["request_close"] = &CommandBuffer::request_close;
+    ut["poll_events"] = &CommandBuffer::poll_events;
+    ut["resize_framebuffer"] = &CommandBuffer::resize_framebuffer;
+    ut["enable_depth"] = &CommandBuffer::enable_depth;
+    ut["set_blend_mode"] = &CommandBuffer::set_blend_mode;
+    ut["set_clip_rect"] = &CommandBuffer::set_clip_rect;
+    ut["disable_clip_rect"] = &CommandBuffer::disable_clip_rect;
+    ut["clear_color"] = &CommandBuffer::clear_color;
+    ut["clear_depth"] = &CommandBuffer::clear_depth;
+    ut["set_present_filter_linear"] = &CommandBuffer::set_present_filter_linear;
+    ut["flush_to_screen"] = &CommandBuffer::flush_to_screen;
+    ut["set_capture_filepath"] = &CommandBuffer::set_capture_filepath;
+    ut["set_capture_fps"] = &CommandBuffer::set_capture_fps;
+    ut["set_frame_index"] = &CommandBuffer::set_frame_index;
+    ut["next_frame"] = &CommandBuffer::next_frame;
+    ut["save_frame_png"] = &CommandBuffer::save_frame_png;
+    ut["set_pixel"] = &CommandBuffer::set_pixel;
+    ut["draw_line"] = &CommandBuffer::draw_line;
+    ut["draw_rect"] = &CommandBuffer::draw_rect;
+    ut["draw_circle"] = &CommandBuffer::draw_circle;
+    ut["draw_triangle_outline"] = &CommandBuffer::draw_triangle_outline;
+    ut["draw_triangle_filled"] = &CommandBuffer::draw_triangle_filled;
+    ut["draw_triangle_filled_grad"] = &CommandBuffer::draw_triangle_filled_grad;
+    ut["draw_triangle_textured_named"] = &CommandBuffer::draw_triangle_textured_named;
+    ut["draw_mesh_named"] = &CommandBuffer::draw_mesh_named;
+    ut["pp_set_bloom"] = &CommandBuffer::pp_set_bloom;
+    ut["pp_set_tone"] = &CommandBuffer::pp_set_tone;
+    ut["pp_set_aa"] = &CommandBuffer::pp_set_aa;
+    ut["pp_reset"] = &CommandBuffer::pp_reset;
+}
+
 // Convenience: register a single function into Lua.
 // Example: EngineLuaBridge_::register_into(lua, "LuaEngine_"); then in Lua: LuaEngine_({"get_pixel", 10, 20})
+// (or, skipping the name lookup, LuaEngine_({Op.get_pixel, 10, 20}) with Op = make_opcode_table(lua))
 inline void register_into(sol::state_view lua, const char* fn_name = "LuaEngine_")
 {
     lua[fn_name] = &EngineLuaBridge_::dispatch;
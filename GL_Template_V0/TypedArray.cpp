@@ -0,0 +1,293 @@
+#include "TypedArray.h"
+
+#include "JobPool.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace Engine_
+{
+    namespace
+    {
+        // Below this many elements a bulk op stays on the calling thread.
+        constexpr size_t kParallelMin = 1u << 16;
+
+        // f32 arrays compute in float (keeps the loops vectorizable), integer arrays in double.
+        template <class T>
+        using Calc = std::conditional_t<std::is_same_v<T, float>, float, double>;
+
+        template <class T, class V>
+        inline T store(V v)
+        {
+            if constexpr (std::is_same_v<T, float>)
+            {
+                return (float)v;
+            }
+            else
+            {
+                if (!(v == v)) return 0; // NaN
+                constexpr double hi = (double)std::numeric_limits<T>::max();
+                const double r = std::nearbyint(std::clamp((double)v, 0.0, hi));
+                return (T)r;
+            }
+        }
+
+        template <class Fn>
+        void chunked(size_t n, const Fn& fn)
+        {
+            if (n < kParallelMin || n > (size_t)INT_MAX)
+            {
+                fn((size_t)0, n);
+                return;
+            }
+            parallel_rows((int)n, (int)kParallelMin, [&](int a, int b) { fn((size_t)a, (size_t)b); });
+        }
+
+        template <class Fn>
+        void visit(ElemType t, void* p, const Fn& fn)
+        {
+            switch (t)
+            {
+            case ElemType::F32: fn(static_cast<float*>(p)); break;
+            case ElemType::U8:  fn(static_cast<uint8_t*>(p)); break;
+            case ElemType::U32: fn(static_cast<uint32_t*>(p)); break;
+            }
+        }
+
+        template <class Fn>
+        void visit(ElemType t, const void* p, const Fn& fn)
+        {
+            switch (t)
+            {
+            case ElemType::F32: fn(static_cast<const float*>(p)); break;
+            case ElemType::U8:  fn(static_cast<const uint8_t*>(p)); break;
+            case ElemType::U32: fn(static_cast<const uint32_t*>(p)); break;
+            }
+        }
+
+        // a[i] = fn(a[i])
+        template <class Fn>
+        void apply(TypedArray& a, const Fn& fn)
+        {
+            visit(a.type(), a.data(), [&](auto* p)
+                {
+                    using T = std::remove_pointer_t<decltype(p)>;
+                    chunked(a.size(), [&](size_t i0, size_t i1)
+                        {
+                            for (size_t i = i0; i < i1; ++i)
+                                p[i] = store<T>(fn((Calc<T>)p[i]));
+                        });
+                });
+        }
+
+        // Views whose bytes overlap without lining up element for element.
+        inline bool partly_overlaps(const TypedArray& a, const TypedArray& b)
+        {
+            const uintptr_t a0 = reinterpret_cast<uintptr_t>(a.data());
+            const uintptr_t b0 = reinterpret_cast<uintptr_t>(b.data());
+            if (a0 == b0 && a.type() == b.type()) return false;
+            return a0 < b0 + b.byte_size() && b0 < a0 + a.byte_size();
+        }
+
+        // a[i] = fn(a[i], b[i])
+        template <class Fn>
+        void apply(TypedArray& a, const TypedArray& b, const Fn& fn)
+        {
+            if (a.size() != b.size()) return;
+
+            // b is a shifted slice of a: read it from a copy, or a chunk (or the loop
+            // itself) would see elements of b that were already overwritten in a.
+            std::vector<uint8_t> copy;
+            const void* src = b.data();
+            if (partly_overlaps(a, b))
+            {
+                const uint8_t* bytes = static_cast<const uint8_t*>(b.data());
+                copy.assign(bytes, bytes + b.byte_size());
+                src = copy.data();
+            }
+
+            visit(a.type(), a.data(), [&](auto* p)
+                {
+                    using T = std::remove_pointer_t<decltype(p)>;
+                    visit(b.type(), src, [&](const auto* q)
+                        {
+                            chunked(a.size(), [&](size_t i0, size_t i1)
+                                {
+                                    for (size_t i = i0; i < i1; ++i)
+                                        p[i] = store<T>(fn((Calc<T>)p[i], (Calc<T>)q[i]));
+                                });
+                        });
+                });
+        }
+
+        inline uint8_t unit_to_u8(double v)
+        {
+            return store<uint8_t>(std::clamp(v == v ? v : 0.0, 0.0, 1.0) * 255.0);
+        }
+    }
+
+    const char* elem_type_name(ElemType t)
+    {
+        switch (t)
+        {
+        case ElemType::F32: return "f32";
+        case ElemType::U8:  return "u8";
+        case ElemType::U32: return "u32";
+        }
+        return "?";
+    }
+
+    size_t elem_size(ElemType t)
+    {
+        switch (t)
+        {
+        case ElemType::F32: return sizeof(float);
+        case ElemType::U8:  return sizeof(uint8_t);
+        case ElemType::U32: return sizeof(uint32_t);
+        }
+        return 1;
+    }
+
+    TypedArray::TypedArray(ElemType type, size_t count)
+        : type_(type)
+        , storage_(std::make_shared<std::vector<uint8_t>>(count * elem_size(type)))
+        , count_(count)
+    {
+    }
+
+    TypedArray::TypedArray(ElemType type, std::shared_ptr<std::vector<uint8_t>> storage, size_t offset, size_t count)
+        : type_(type)
+        , storage_(std::move(storage))
+        , offset_(offset)
+        , count_(count)
+    {
+    }
+
+    double TypedArray::get(size_t i) const
+    {
+        double v = 0.0;
+        visit(type_, data(), [&](const auto* p) { v = (double)p[i]; });
+        return v;
+    }
+
+    void TypedArray::set(size_t i, double v)
+    {
+        visit(type_, data(), [&](auto* p)
+            {
+                using T = std::remove_pointer_t<decltype(p)>;
+                p[i] = store<T>(v);
+            });
+    }
+
+    TypedArray TypedArray::slice(size_t first, size_t count) const
+    {
+        first = std::min(first, count_);
+        count = std::min(count, count_ - first);
+        return TypedArray(type_, storage_, offset_ + first * elem_size(type_), count);
+    }
+
+    TypedArray TypedArray::copy() const
+    {
+        TypedArray out(type_, count_);
+        if (count_ > 0) std::memcpy(out.data(), data(), byte_size());
+        return out;
+    }
+
+    void TypedArray::fill(double v)
+    {
+        apply(*this, [v](auto) { return v; });
+    }
+
+    void TypedArray::copy_from(const TypedArray& src)
+    {
+        if (src.size() != count_) return;
+        if (src.type() == type_)
+        {
+            std::memmove(data(), src.data(), byte_size());
+            return;
+        }
+        apply(*this, src, [](auto, auto b) { return b; });
+    }
+
+    void TypedArray::add(double s)
+    {
+        apply(*this, [s](auto v) { return v + (decltype(v))s; });
+    }
+
+    void TypedArray::add(const TypedArray& o)
+    {
+        apply(*this, o, [](auto a, auto b) { return a + b; });
+    }
+
+    void TypedArray::mul(double s)
+    {
+        apply(*this, [s](auto v) { return v * (decltype(v))s; });
+    }
+
+    void TypedArray::mul(const TypedArray& o)
+    {
+        apply(*this, o, [](auto a, auto b) { return a * b; });
+    }
+
+    void TypedArray::lerp(const TypedArray& to, double t)
+    {
+        apply(*this, to, [t](auto a, auto b) { return a + (b - a) * (decltype(a))t; });
+    }
+
+    void TypedArray::sin()
+    {
+        apply(*this, [](auto v) { return std::sin(v); });
+    }
+
+    void TypedArray::clamp(double lo, double hi)
+    {
+        if (hi < lo) std::swap(lo, hi);
+        apply(*this, [lo, hi](auto v) { return std::clamp(v, (decltype(v))lo, (decltype(v))hi); });
+    }
+
+    bool TypedArray::pack_rgba(const TypedArray& r, const TypedArray& g, const TypedArray& b, const TypedArray* a)
+    {
+        const size_t n = r.size();
+        if (g.size() != n || b.size() != n || (a && a->size() != n)) return false;
+
+        uint8_t* out = nullptr;
+        if (type_ == ElemType::U8 && count_ == n * 4) out = u8();
+        else if (type_ == ElemType::U32 && count_ == n) out = static_cast<uint8_t*>(data());
+        if (!out) return false;
+
+        const float* rf = r.f32();
+        const float* gf = g.f32();
+        const float* bf = b.f32();
+        const float* af = a ? a->f32() : nullptr;
+        const bool all_f32 = rf && gf && bf && (!a || af);
+
+        chunked(n, [&](size_t i0, size_t i1)
+            {
+                for (size_t i = i0; i < i1; ++i)
+                {
+                    uint8_t* px = out + i * 4;
+                    if (all_f32)
+                    {
+                        px[0] = unit_to_u8(rf[i]);
+                        px[1] = unit_to_u8(gf[i]);
+                        px[2] = unit_to_u8(bf[i]);
+                        px[3] = af ? unit_to_u8(af[i]) : 255;
+                    }
+                    else
+                    {
+                        px[0] = unit_to_u8(r.get(i));
+                        px[1] = unit_to_u8(g.get(i));
+                        px[2] = unit_to_u8(b.get(i));
+                        px[3] = a ? unit_to_u8(a->get(i)) : 255;
+                    }
+                }
+            });
+        return true;
+    }
+}
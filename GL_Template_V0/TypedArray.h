@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Engine_
+{
+    // ------------------------------------------------------------
+    // Typed arrays: flat native number storage for scripts (vertex data, pixel
+    // fields, ...), so big data never lives in Lua tables.
+    // slice() returns a view sharing the same storage (like a JS subarray); the
+    // bulk ops below work in place on the elements of this array/view.
+    // Stores convert like this: f32 plain cast, u8 round + clamp to 0..255,
+    // u32 round + clamp to 0..2^32-1.
+    // Large arrays are processed in chunks on the shared job pool.
+    // ------------------------------------------------------------
+    enum class ElemType
+    {
+        F32,
+        U8,
+        U32
+    };
+
+    const char* elem_type_name(ElemType t);
+    size_t elem_size(ElemType t);
+
+    class TypedArray
+    {
+    public:
+        TypedArray(ElemType type, size_t count); // zero-filled
+
+        ElemType type() const { return type_; }
+        size_t size() const { return count_; }
+        size_t byte_size() const { return count_ * elem_size(type_); }
+
+        void* data() { return storage_->data() + offset_; }
+        const void* data() const { return storage_->data() + offset_; }
+
+        // nullptr unless the element type matches.
+        float* f32() { return type_ == ElemType::F32 ? static_cast<float*>(data()) : nullptr; }
+        uint8_t* u8() { return type_ == ElemType::U8 ? static_cast<uint8_t*>(data()) : nullptr; }
+        uint32_t* u32() { return type_ == ElemType::U32 ? static_cast<uint32_t*>(data()) : nullptr; }
+        const float* f32() const { return type_ == ElemType::F32 ? static_cast<const float*>(data()) : nullptr; }
+        const uint8_t* u8() const { return type_ == ElemType::U8 ? static_cast<const uint8_t*>(data()) : nullptr; }
+        const uint32_t* u32() const { return type_ == ElemType::U32 ? static_cast<const uint32_t*>(data()) : nullptr; }
+
+        // 0-based; callers check bounds.
+        double get(size_t i) const;
+        void set(size_t i, double v);
+
+        // View of [first, first + count), sharing storage (clamped to this array).
+        TypedArray slice(size_t first, size_t count) const;
+        TypedArray copy() const; // own storage
+
+        // Element-wise, in place. Array operands must have the same size (any element type).
+        void fill(double v);
+        void copy_from(const TypedArray& src);
+        void add(double s);
+        void add(const TypedArray& o);
+        void mul(double s);
+        void mul(const TypedArray& o);
+        void lerp(const TypedArray& to, double t); // this + (to - this) * t
+        void sin();
+        void clamp(double lo, double hi);
+
+        // this = RGBA8 from channel arrays in [0..1] (alpha nullptr = opaque).
+        // u8 arrays take 4 bytes per pixel, u32 arrays one packed pixel (bytes R,G,B,A in memory).
+        bool pack_rgba(const TypedArray& r, const TypedArray& g, const TypedArray& b, const TypedArray* a);
+
+    private:
+        TypedArray(ElemType type, std::shared_ptr<std::vector<uint8_t>> storage, size_t offset, size_t count);
+
+        ElemType type_;
+        std::shared_ptr<std::vector<uint8_t>> storage_;
+        size_t offset_ = 0; // bytes
+        size_t count_ = 0;  // elements
+    };
+}
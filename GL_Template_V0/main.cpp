@@ -4,17 +4,26 @@
 
 #include "FindScriptsFolder.h"
 
+#include <httplib.h>
+
 #define SOL_ALL_SAFETIES_ON 1
 #include <sol/sol.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
+#include <cctype>
 #include <cmath>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
@@ -24,7 +33,15 @@
 #include <conio.h> // _kbhit, _getch
 #endif
 
+#include "Capture.h"
 #include "Engine.h"
+#include "JobPool.h"
+#include "LiveStream.h"
+#include "LuaAllocator.h"
+#include "LuaBytecodeCache.h"
+#include "LuaProfiler.h"
+#include "PixelKernel.h"
+#include "TypedArray.h"
 #include "Sandbox.h" // <-- generated bridge header (updated)
 
 namespace fs = std::filesystem;
@@ -81,7 +98,48 @@ namespace Lua_helpers
         return h;
     }
 
-    enum class KeyAction { None, Quit, ToggleHotReload, ReloadNow, HardReset, SoftReset };
+    static bool ParseElemType(const std::string& s, Engine_::ElemType& out) {
+        const std::string t = Lower(s);
+        if (t == "f32" || t == "float") { out = Engine_::ElemType::F32; return true; }
+        if (t == "u8" || t == "byte") { out = Engine_::ElemType::U8; return true; }
+        if (t == "u32") { out = Engine_::ElemType::U32; return true; }
+        return false;
+    }
+
+    // RGBA bytes of a Lua string or a u8/u32 TypedArray (no copy); nullptr otherwise.
+    static const uint8_t* RgbaBytes(const sol::object& o, size_t& size) {
+        if (o.get_type() == sol::type::string) {
+            const std::string_view s = o.as<std::string_view>();
+            size = s.size();
+            return reinterpret_cast<const uint8_t*>(s.data());
+        }
+        if (o.is<Engine_::TypedArray>()) {
+            const Engine_::TypedArray& a = o.as<const Engine_::TypedArray&>();
+            if (a.type() == Engine_::ElemType::F32) return nullptr;
+            size = a.byte_size();
+            return static_cast<const uint8_t*>(a.data());
+        }
+        return nullptr;
+    }
+
+    // Palette: list of colors, or RGBA bytes (string or u8/u32 TypedArray).
+    static std::vector<Engine_::Color> ParsePalette(const sol::object& palette) {
+        std::vector<Engine_::Color> pal;
+        size_t size = 0;
+        if (const uint8_t* bytes = RgbaBytes(palette, size)) {
+            for (size_t i = 0; i + 4 <= size; i += 4)
+                pal.push_back({ bytes[i], bytes[i + 1], bytes[i + 2], bytes[i + 3] });
+        }
+        else if (palette.is<sol::table>()) {
+            const sol::table pt = palette.as<sol::table>();
+            const int n = (int)pt.size();
+            for (int i = 1; i <= n; ++i)
+                pal.push_back(EngineLuaBridge_::get_color(pt, i, Engine_::Color{}, true));
+        }
+        return pal;
+    }
+
+    enum class KeyAction { None, Quit, ToggleHotReload, ReloadNow, HardReset, SoftReset, ToggleProfiler };
 
     static KeyAction PollKey()
     {
@@ -96,6 +154,7 @@ namespace Lua_helpers
             if (sc == 63) return KeyAction::ReloadNow;
             if (sc == 64) return KeyAction::HardReset;
             if (sc == 65) return KeyAction::SoftReset;
+            if (sc == 66) return KeyAction::ToggleProfiler; // F8
             return KeyAction::None;
         }
 
@@ -104,6 +163,7 @@ namespace Lua_helpers
         if (c == 'r' || c == 'R') return KeyAction::ReloadNow; // fallback manual reload
         if (c == 't' || c == 'T') return KeyAction::HardReset; // fallback
         if (c == 'x' || c == 'X') return KeyAction::SoftReset; // fallback
+        if (c == 'p' || c == 'P') return KeyAction::ToggleProfiler; // fallback
 #else
         (void)0;
 #endif
@@ -124,6 +184,63 @@ struct RuntimeAssets
 {
     std::unordered_map<std::string, Engine_::Image> textures;
     std::unordered_map<std::string, Mesh> meshes;
+    std::unordered_map<std::string, std::shared_ptr<const Engine_::ColorLut3D>> luts; // by path
+
+    // Read-only fallback layer (batch jobs share the assets baked once up front).
+    // Lookups see both; writes and deletes only touch this set.
+    const RuntimeAssets* shared = nullptr;
+
+    const Engine_::Image* FindTexture(const std::string& name) const
+    {
+        auto it = textures.find(name);
+        if (it != textures.end()) return &it->second;
+        return shared ? shared->FindTexture(name) : nullptr;
+    }
+
+    const Mesh* FindMesh(const std::string& name) const
+    {
+        auto it = meshes.find(name);
+        if (it != meshes.end()) return &it->second;
+        return shared ? shared->FindMesh(name) : nullptr;
+    }
+
+    std::shared_ptr<const Engine_::ColorLut3D> FindLut(const std::string& path) const
+    {
+        auto it = luts.find(path);
+        if (it != luts.end()) return it->second;
+        return shared ? shared->FindLut(path) : nullptr;
+    }
+
+    // How each named texture / mesh was made ("checker 256 256 16", "file <path>",
+    // "cube 1"), so a job asking for the same thing can use the shared copy.
+    std::unordered_map<std::string, std::string> textureOrigins;
+    std::unordered_map<std::string, std::string> meshOrigins;
+
+    // True when the shared layer already has `name` made from `origin`; any private
+    // copy is dropped so lookups fall through to the shared one.
+    bool UseSharedTexture(const std::string& name, const std::string& origin)
+    {
+        if (!shared || !SameOrigin(shared->textureOrigins, name, origin)) return false;
+        textures.erase(name);
+        textureOrigins.erase(name);
+        return true;
+    }
+
+    bool UseSharedMesh(const std::string& name, const std::string& origin)
+    {
+        if (!shared || !SameOrigin(shared->meshOrigins, name, origin)) return false;
+        meshes.erase(name);
+        meshOrigins.erase(name);
+        return true;
+    }
+
+private:
+    static bool SameOrigin(const std::unordered_map<std::string, std::string>& origins,
+        const std::string& name, const std::string& origin)
+    {
+        auto it = origins.find(name);
+        return it != origins.end() && it->second == origin;
+    }
 };
 
 // -------------------------
@@ -136,36 +253,34 @@ public:
         std::string entryModule = "main_lua_example_v1_4"; // scripts/main_lua_example_v1_4.lua
         bool hotReloadEnabled = true;
         int pollMs = 200;
+        std::optional<int64_t> randomSeed; // fixed math.randomseed for reproducible runs
+        std::vector<std::pair<std::string, std::string>> job; // batch job parameters -> Engine.Job
+        double gcBudgetMs = 1.0; // > 0: collect once per Tick, after present (0 = Lua's automatic GC);
+                                 // the ms cap only applies without generational mode
+        std::string profilePath; // profile from Init, written at Shutdown (PATH.folded / PATH.trace.json)
+        bool bytecodeCache = true; // require() loads precompiled chunks from <scripts>/../.luacache
     };
 
     explicit LuaHost(Config cfg, RuntimeAssets& assets)
-        : cfg_(std::move(cfg)), assets_(assets) {
+        : cfg_(std::move(cfg)), assets_(assets), bytecodeCache_(cfg_.scriptsDir.parent_path() / ".luacache") {
     }
 
     bool Init() {
-        std::cout.setf(std::ios::unitbuf);
-
         if (!fs::exists(cfg_.scriptsDir)) {
             std::cerr << "[C++] ERROR scriptsDir does not exist: " << cfg_.scriptsDir.string() << "\n";
             return false;
         }
 
-        lua_ = sol::state{};
-        lua_.open_libraries(
-            sol::lib::base,
-            sol::lib::package,
-            sol::lib::math,
-            sol::lib::string,
-            sol::lib::table,
-            sol::lib::io,
-            sol::lib::os
-        );
+        CreateState();
+        SeedRandom();
 
         BuildEngineTable();
         ConfigurePackagePath();
         InstallRequireTracker(); // MUST be before requiring the entry module
 
-        if (!LoadScriptInstance()) return false;
+        if (!cfg_.profilePath.empty()) profiler_.start(lua_.lua_state());
+
+        if (!LoadScriptInstanceTimed()) return false;
 
         fp_ = Lua_helpers::ComputeLuaFingerprint(cfg_.scriptsDir);
         lastPoll_ = std::chrono::steady_clock::now();
@@ -174,15 +289,26 @@ public:
         return true;
     }
 
-    void Shutdown() { Call0(shutdown_, "Shutdown"); }
+    void Shutdown() {
+        MakeBridgeCurrent();
+        Call0(shutdown_, "Shutdown");
+
+        if (profiler_.running()) {
+            profiler_.stop();
+            WriteProfile(cfg_.profilePath.empty() ? NextProfilePath() : cfg_.profilePath);
+        }
+    }
 
     void Tick(double dt) {
+        MakeBridgeCurrent();
         didPresentThisFrame_ = false;
 
         LuaEngine_["Dt"] = dt;
 
         if (cfg_.hotReloadEnabled) PollHotReload();
 
+        if (profiler_.running()) profiler_.begin_frame();
+
         if (update_.valid()) {
             sol::protected_function_result pr = update_(dt);
             if (!pr.valid()) {
@@ -196,6 +322,9 @@ public:
         if (!didPresentThisFrame_) {
             Engine_::flush_to_screen(true);
         }
+
+        profiler_.end_frame();
+        StepGc();
     }
 
     void ToggleHotReload() {
@@ -203,7 +332,22 @@ public:
         std::cout << "[C++] HotReload " << (cfg_.hotReloadEnabled ? "ON" : "OFF") << "\n";
     }
 
+    // First toggle starts a fresh profile, the second writes it next to scripts/
+    // (profiles/lua_profile_N.folded + .trace.json) and prints the hottest functions.
+    void ToggleProfiler() {
+        if (!profiler_.running()) {
+            profiler_.clear();
+            profiler_.start(lua_.lua_state());
+            std::cout << "[C++] Lua profiler ON\n";
+            return;
+        }
+        profiler_.stop();
+        std::cout << "[C++] Lua profiler OFF\n";
+        WriteProfile(NextProfilePath());
+    }
+
     void ReloadNow() {
+        MakeBridgeCurrent();
         std::cout << "[C++] Manual reload\n";
         if (Reload()) {
             fp_ = Lua_helpers::ComputeLuaFingerprint(cfg_.scriptsDir);
@@ -228,22 +372,14 @@ public:
         factory_ = sol::protected_function{};
         LuaEngine_ = sol::table{};
 
-        lua_ = sol::state{};
-        lua_.open_libraries(
-            sol::lib::base,
-            sol::lib::package,
-            sol::lib::math,
-            sol::lib::string,
-            sol::lib::table,
-            sol::lib::io,
-            sol::lib::os
-        );
+        CreateState();
+        SeedRandom();
 
         BuildEngineTable();
         ConfigurePackagePath();
         InstallRequireTracker();
 
-        if (!LoadScriptInstance())
+        if (!LoadScriptInstanceTimed())
             return false;
 
         LuaEngine_["ReloadCount"] = 0;
@@ -258,6 +394,112 @@ public:
     void SoftReset()
     {
         std::cout << "[C++] SOFT RESET (clear Engine.State)\n";
+        ResetScriptState();
+    }
+
+    // Warm restart for a new render request: same VM and loaded modules, new
+    // seed + Engine.Job, cleared Engine.State, then Reset() (or Init()).
+    void Restart(std::optional<int64_t> seed, std::vector<std::pair<std::string, std::string>> job)
+    {
+        cfg_.randomSeed = seed;
+        cfg_.job = std::move(job);
+        LuaEngine_["Job"] = sol::nil;
+        ExposeJob();
+        SeedRandom();
+        ResetScriptState();
+    }
+
+private:
+    // New VM on the pooled allocator. The pool lives as long as the host, so a hard
+    // reset reuses the blocks the old VM freed.
+    void CreateState()
+    {
+        // A running profile carries over to the new VM.
+        const bool profiling = profiler_.running();
+        profiler_.stop();
+
+        lua_ = sol::state(sol::default_at_panic, &Engine_::LuaPoolAllocator::alloc, &luaPool_);
+        if (profiling) profiler_.start(lua_.lua_state());
+        lua_.open_libraries(
+            sol::lib::base,
+            sol::lib::package,
+            sol::lib::math,
+            sol::lib::string,
+            sol::lib::table,
+            sol::lib::io,
+            sol::lib::os
+        );
+        if (cfg_.bytecodeCache) bytecodeCache_.install(lua_.lua_state());
+
+        gcAllocMark_ = luaPool_.stats().bytes_allocated;
+        if (cfg_.gcBudgetMs <= 0.0) return;
+
+        // The collector only runs from StepGc (or on an allocation failure), never
+        // in the middle of Update. Generational mode keeps each frame's step to one
+        // young collection.
+        lua_State* L = lua_.lua_state();
+#if defined(LUA_GCGEN)
+        lua_gc(L, LUA_GCGEN, 0, 0);
+        gcGenerational_ = true;
+#endif
+        lua_gc(L, LUA_GCSTOP, 0);
+    }
+
+    // Fixed point in the frame (after present) for garbage collection.
+    // Generational: adds this frame's allocation to the GC debt and lets Lua
+    // decide; once the debt is due it runs a young collection, or a major one when
+    // the heap has grown enough since the last. (A step of 0 clears the debt and
+    // Lua never escalates: old garbage would pile up.) gcBudgetMs is not a time
+    // limit here, collections cannot be split. Incremental: steps until the cycle
+    // ends or the time budget is spent, but never less work than this frame
+    // allocated, so the heap cannot outgrow the collector.
+    void StepGc()
+    {
+        if (cfg_.gcBudgetMs <= 0.0) return;
+
+        lua_State* L = lua_.lua_state();
+        const uint64_t allocated = luaPool_.stats().bytes_allocated;
+        const uint64_t frameKb = (allocated - gcAllocMark_) / 1024;
+        gcAllocMark_ = allocated;
+
+        if (gcGenerational_) {
+            lua_gc(L, LUA_GCSTEP, (int)std::min<uint64_t>(std::max<uint64_t>(1, frameKb), 1u << 20));
+            return;
+        }
+
+        using clock = std::chrono::steady_clock;
+        const auto deadline = clock::now() + std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double, std::milli>(cfg_.gcBudgetMs));
+
+        constexpr int kStepKb = 64;
+        int debtKb = (int)std::min<uint64_t>(frameKb * 2, 1u << 20);
+        do {
+            const int kb = std::max(kStepKb, debtKb);
+            debtKb = 0;
+            if (lua_gc(L, LUA_GCSTEP, kb)) break; // cycle finished
+        } while (clock::now() < deadline);
+    }
+
+    std::string NextProfilePath() {
+        const fs::path dir = cfg_.scriptsDir.parent_path() / "profiles";
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        for (int i = 0;; ++i) {
+            const fs::path p = dir / ("lua_profile_" + std::to_string(i));
+            if (!fs::exists(p.string() + ".folded", ec)) return p.string();
+        }
+    }
+
+    void WriteProfile(const std::string& path) {
+        const bool ok = profiler_.write_collapsed(path + ".folded") && profiler_.write_chrome_trace(path + ".trace.json");
+        std::cout << "[C++] Lua profile: " << profiler_.sample_count() << " samples over "
+            << profiler_.frame_count() << " frames -> " << path << ".folded / .trace.json"
+            << (ok ? "" : " (WRITE FAILED)") << "\n" << profiler_.summary(10);
+    }
+
+    void ResetScriptState()
+    {
+        MakeBridgeCurrent();
 
         sol::object stObj = LuaEngine_["State"];
         if (stObj.valid() && stObj.get_type() == sol::type::table) {
@@ -284,7 +526,6 @@ public:
         Call0(init_, "Init(soft reset)");
     }
 
-private:
     void ExposeKeyConstants()
     {
         // Convenience: expose engine keycodes to Lua
@@ -297,6 +538,7 @@ private:
         LuaEngine_["KEY_5"] = Engine_::KEY_5;
 
         LuaEngine_["KEY_B"] = Engine_::KEY_B;
+        LuaEngine_["KEY_C"] = Engine_::KEY_C;
         LuaEngine_["KEY_F"] = Engine_::KEY_F;
         LuaEngine_["KEY_S"] = Engine_::KEY_S;
 
@@ -327,12 +569,35 @@ private:
             std::cout << "[Lua] " << s << "\n";
             });
 
-        LuaEngine_.set_function("rand01", []() -> double {
-            static uint32_t x = 123456789u;
+        LuaEngine_.set_function("rand01", [this]() -> double {
+            uint32_t& x = rand01State_;
             x = 1664525u * x + 1013904223u;
             return (x & 0xFFFFFF) / double(0x1000000);
             });
 
+        ExposeJob();
+
+        BindBridgeCallbacks();
+
+        // Register dispatcher
+        EngineLuaBridge_::register_into(lua_, "LuaEngine_");
+
+        // Also expose it on Engine table for convenience
+        LuaEngine_["cmd"] = lua_["LuaEngine_"];
+        LuaEngine_["Op"] = EngineLuaBridge_::make_opcode_table(lua_); // Engine.Op.draw_line -> opcode
+        LuaEngine_["Direct"] = EngineLuaBridge_::make_direct_table(lua_); // Engine.Direct.draw_line(x0, y0, x1, y1, r, g, b, a)
+        ExposeTypedArrays();
+        ExposeMath();
+        ExposePixelBulk(LuaEngine_["Direct"]);
+        ExposeKernels();
+        EngineLuaBridge_::register_command_buffer(LuaEngine_); // Engine.CommandBuffer.new()
+    }
+
+    // The bridge callbacks are thread_local and capture this host; a host driven from
+    // several threads (render server) rebinds them on entry.
+    void BindBridgeCallbacks() {
+        t_bridgeOwner = id_;
+
         // Default callbacks (Engine_::*)
         EngineLuaBridge_::bind_engine_defaults();
 
@@ -346,27 +611,35 @@ private:
         EngineLuaBridge_::cb_tex_make_checker = [this](const std::string& name, int w, int h, int cell) -> bool
             {
                 if (w <= 0 || h <= 0 || cell <= 0) return false;
-                assets_.textures[name] = Engine_::make_checker_rgba(w, h, cell);
-                return assets_.textures[name].valid();
+                std::string origin = "checker " + std::to_string(w) + " " + std::to_string(h) + " " + std::to_string(cell);
+                if (assets_.UseSharedTexture(name, origin)) return true;
+                Engine_::Image& img = assets_.textures[name];
+                img = Engine_::make_checker_rgba(w, h, cell);
+                assets_.textureOrigins[name] = std::move(origin);
+                return img.valid();
             };
 
         EngineLuaBridge_::cb_tex_load = [this](const std::string& name, const std::string& filepath) -> bool
             {
+                std::string origin = "file " + filepath;
+                if (assets_.UseSharedTexture(name, origin)) return true;
                 Engine_::Image img = Engine_::load_image_rgba(filepath);
                 if (!img.valid()) return false;
                 assets_.textures[name] = std::move(img);
+                assets_.textureOrigins[name] = std::move(origin);
                 return true;
             };
 
         EngineLuaBridge_::cb_tex_delete = [this](const std::string& name) -> bool
             {
+                assets_.textureOrigins.erase(name);
                 return assets_.textures.erase(name) > 0;
             };
 
         EngineLuaBridge_::cb_tex_exists = [this](const std::string& name) -> bool
             {
-                auto it = assets_.textures.find(name);
-                return it != assets_.textures.end() && it->second.valid();
+                const Engine_::Image* img = assets_.FindTexture(name);
+                return img && img->valid();
             };
 
         EngineLuaBridge_::cb_tex_from_framebuffer = [this](const std::string& name) -> bool
@@ -384,6 +657,7 @@ private:
                 img.rgba.assign(src, src + (size_t)W * (size_t)H * 4u);
 
                 assets_.textures[name] = std::move(img);
+                assets_.textureOrigins.erase(name);
                 return true;
             };
 
@@ -395,16 +669,18 @@ private:
                 const std::string& texture_name,
                 Engine_::Color tint)
             {
-                auto it = assets_.textures.find(texture_name);
-                if (it == assets_.textures.end())
+                const Engine_::Image* tex = assets_.FindTexture(texture_name);
+                if (!tex)
                     throw std::runtime_error("Unknown texture_name: " + texture_name);
-                Engine_::draw_triangle_textured(a, ua, b, ub, c, uc, it->second, tint);
+                Engine_::draw_triangle_textured(a, ua, b, ub, c, uc, *tex, tint);
             };
 
         // --- mesh registry ---
         EngineLuaBridge_::cb_mesh_make_cube = [this](const std::string& name, float size) -> bool
             {
                 if (size <= 0.0f) size = 1.0f;
+                std::string origin = "cube " + std::to_string(size);
+                if (assets_.UseSharedMesh(name, origin)) return true;
 
                 using V = Engine_::Vertex3D;
 
@@ -438,35 +714,36 @@ private:
                 m.verts = std::move(cubeVerts);
                 m.idx = std::move(cubeIdx);
                 assets_.meshes[name] = std::move(m);
+                assets_.meshOrigins[name] = std::move(origin);
                 return true;
             };
 
         EngineLuaBridge_::cb_mesh_delete = [this](const std::string& name) -> bool
             {
+                assets_.meshOrigins.erase(name);
                 return assets_.meshes.erase(name) > 0;
             };
 
         EngineLuaBridge_::cb_mesh_exists = [this](const std::string& name) -> bool
             {
-                return assets_.meshes.find(name) != assets_.meshes.end();
+                return assets_.FindMesh(name) != nullptr;
             };
 
         EngineLuaBridge_::cb_draw_mesh_named =
             [this](const std::string& mesh_name, const Engine_::Mat4& mvp, const std::string& texture_name, bool enable_depth_test)
             {
-                auto it = assets_.meshes.find(mesh_name);
-                if (it == assets_.meshes.end())
+                const Mesh* mesh = assets_.FindMesh(mesh_name);
+                if (!mesh)
                     throw std::runtime_error("Unknown mesh_name: " + mesh_name);
 
                 const Engine_::Image* tex = nullptr;
                 if (!texture_name.empty()) {
-                    auto tt = assets_.textures.find(texture_name);
-                    if (tt == assets_.textures.end())
+                    tex = assets_.FindTexture(texture_name);
+                    if (!tex)
                         throw std::runtime_error("Unknown texture_name: " + texture_name);
-                    tex = &tt->second;
                 }
 
-                const Mesh& m = it->second;
+                const Mesh& m = *mesh;
                 Engine_::draw_mesh(
                     m.verts.data(), (int)m.verts.size(),
                     m.idx.data(), (int)m.idx.size(),
@@ -497,17 +774,48 @@ private:
                 Engine_::set_postprocess(s);
             };
 
+        EngineLuaBridge_::cb_pp_set_grade = [this](bool enabled, const std::string& lut_path, float strength, const std::string& interp) -> bool
+            {
+                Engine_::PostProcessSettings s = Engine_::postprocess();
+
+                if (!lut_path.empty())
+                {
+                    std::shared_ptr<const Engine_::ColorLut3D> found = assets_.FindLut(lut_path);
+                    if (!found)
+                    {
+                        auto lut = std::make_shared<Engine_::ColorLut3D>(Engine_::load_color_lut(lut_path));
+                        if (!lut->valid()) return false;
+                        found = assets_.luts.emplace(lut_path, std::move(lut)).first->second;
+                    }
+                    s.grade.lut = found;
+                }
+
+                s.grade.enabled = enabled;
+                s.grade.strength = std::clamp(strength, 0.0f, 1.0f);
+                s.grade.interp = (interp == "trilinear") ? Engine_::LutInterp::Trilinear : Engine_::LutInterp::Tetrahedral;
+                Engine_::set_postprocess(s);
+                return !enabled || s.grade.lut != nullptr;
+            };
+
+        EngineLuaBridge_::cb_pp_set_aa = [](bool enabled, float edge_threshold, float edge_threshold_min, float subpixel)
+            {
+                Engine_::PostProcessSettings s = Engine_::postprocess();
+                s.aa.enabled = enabled;
+                s.aa.edge_threshold = std::clamp(edge_threshold, 0.0f, 1.0f);
+                s.aa.edge_threshold_min = std::clamp(edge_threshold_min, 0.0f, 1.0f);
+                s.aa.subpixel = std::clamp(subpixel, 0.0f, 1.0f);
+                Engine_::set_postprocess(s);
+            };
+
         EngineLuaBridge_::cb_pp_reset = []()
             {
                 Engine_::PostProcessSettings s{};
                 Engine_::set_postprocess(s);
             };
+    }
 
-        // Register dispatcher
-        EngineLuaBridge_::register_into(lua_, "LuaEngine_");
-
-        // Also expose it on Engine table for convenience
-        LuaEngine_["cmd"] = lua_["LuaEngine_"];
+    void MakeBridgeCurrent() {
+        if (t_bridgeOwner != id_) BindBridgeCallbacks();
     }
 
     void ConfigurePackagePath() {
@@ -537,6 +845,23 @@ private:
         }
     }
 
+    bool LoadScriptInstanceTimed() {
+        const Engine_::LuaBytecodeCache::Stats before = bytecodeCache_.stats();
+        const auto t0 = std::chrono::steady_clock::now();
+        const bool ok = LoadScriptInstance();
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        const Engine_::LuaBytecodeCache::Stats& s = bytecodeCache_.stats();
+        std::ostringstream line;
+        line << "[C++] Scripts loaded in " << std::fixed << std::setprecision(1) << ms << " ms";
+        if (cfg_.bytecodeCache)
+            line << " (bytecode: " << (s.memory_hits - before.memory_hits) << " in memory, "
+                << (s.disk_hits - before.disk_hits) << " from cache, " << (s.compiled - before.compiled) << " compiled)";
+        line << "\n";
+        std::cout << line.str();
+        return ok;
+    }
+
     bool LoadScriptInstance() {
         sol::protected_function requireFn = lua_["require"];
         sol::protected_function_result pr = requireFn(cfg_.entryModule);
@@ -691,6 +1016,409 @@ private:
         }
     }
 
+    // Engine.Job = { key = value, ... } for batch jobs (numbers stay numbers), nil otherwise.
+    void ExposeJob() {
+        if (cfg_.job.empty()) return;
+        sol::table job = lua_.create_table();
+        for (const auto& [key, value] : cfg_.job) {
+            char* end = nullptr;
+            const double num = std::strtod(value.c_str(), &end);
+            if (!value.empty() && end && *end == '\0') job[key] = num;
+            else job[key] = value;
+        }
+        LuaEngine_["Job"] = job;
+    }
+
+    // Bulk pixel transfer next to the generated per-op functions: one call per rectangle
+    // instead of one set_pixel / get_pixel per pixel.
+    //   write_pixels(x, y, w, h, rgba [, stride_bytes])   rgba: byte string or u8/u32 TypedArray
+    //   read_pixels(x, y, w, h [, out]) -> rgba byte string, or fills and returns out (u8/u32)
+    //   write_pixels_palette(x, y, w, h, values, palette)
+    //       values: w*h numbers in [0..1] (table or TypedArray; f32 is used in place)
+    //       palette: list of colors, or RGBA bytes (string or u8/u32 TypedArray)
+    // Typed arrays are read and written in place, never copied.
+    void ExposePixelBulk(sol::table t) {
+        t.set_function("write_pixels", [](int x, int y, int w, int h, const sol::object& rgba, sol::optional<int> stride) {
+            if (w <= 0 || h <= 0) return;
+            size_t size = 0;
+            const uint8_t* bytes = Lua_helpers::RgbaBytes(rgba, size);
+            if (!bytes) throw std::runtime_error("write_pixels: expected a byte string or u8/u32 TypedArray");
+            const size_t row = (size_t)w * 4;
+            const size_t step = (stride && *stride > 0) ? (size_t)*stride : row;
+            if (size < step * (size_t)(h - 1) + row)
+                throw std::runtime_error("write_pixels: data shorter than the rectangle");
+            Engine_::write_pixels(x, y, w, h, bytes, (int)step);
+            });
+
+        t.set_function("read_pixels", [](sol::this_state ts, int x, int y, int w, int h, sol::optional<Engine_::TypedArray&> out) -> sol::object {
+            sol::state_view lua(ts);
+            if (out) {
+                Engine_::TypedArray& dst = *out;
+                const bool fits = (dst.type() == Engine_::ElemType::U8 || dst.type() == Engine_::ElemType::U32)
+                    && w > 0 && h > 0 && dst.byte_size() >= (size_t)w * h * 4;
+                if (!fits) throw std::runtime_error("read_pixels: out must be a u8/u32 TypedArray of w*h pixels");
+                Engine_::read_pixels(x, y, w, h, static_cast<uint8_t*>(dst.data()));
+                return sol::make_object(lua, dst);
+            }
+            std::string bytes;
+            if (w > 0 && h > 0) {
+                bytes.resize((size_t)w * h * 4);
+                Engine_::read_pixels(x, y, w, h, reinterpret_cast<uint8_t*>(bytes.data()));
+            }
+            return sol::make_object(lua, bytes);
+            });
+
+        t.set_function("write_pixels_palette", [](int x, int y, int w, int h, const sol::object& values, const sol::object& palette) {
+            if (w <= 0 || h <= 0) return;
+
+            const std::vector<Engine_::Color> pal = Lua_helpers::ParsePalette(palette);
+            if (pal.empty()) throw std::runtime_error("write_pixels_palette: empty palette");
+
+            const size_t count = (size_t)w * h;
+            std::vector<float> v;
+            const float* field = nullptr;
+            if (values.is<Engine_::TypedArray>()) {
+                const Engine_::TypedArray& a = values.as<const Engine_::TypedArray&>();
+                if (a.size() < count) throw std::runtime_error("write_pixels_palette: values shorter than w*h");
+                field = a.f32();
+                if (!field) {
+                    v.resize(count);
+                    for (size_t i = 0; i < count; ++i) v[i] = (float)a.get(i);
+                }
+            }
+            else if (values.is<sol::table>()) {
+                const sol::table vt = values.as<sol::table>();
+                v.resize(count);
+                for (size_t i = 0; i < count; ++i)
+                    v[i] = (float)vt.raw_get<sol::optional<double>>(i + 1).value_or(0.0);
+            }
+            else {
+                throw std::runtime_error("write_pixels_palette: values must be a table or TypedArray");
+            }
+            Engine_::write_pixels_palette(x, y, w, h, field ? field : v.data(), pal.data(), (int)pal.size());
+            });
+    }
+
+    // Engine.TypedArray: native f32 / u8 / u32 arrays (see TypedArray.h).
+    //   local a = Engine.TypedArray.f32(n)      -- also .u8(n), .u32(n), .from("f32", {1, 2, 3})
+    //   a[i] = v; v = a[i]; #a                  -- 1-based like Lua tables
+    //   a:slice(first [, last])                 -- view sharing storage, 1-based inclusive
+    //   a:add(x) a:mul(x) a:lerp(b, t) a:sin() a:clamp(lo, hi) a:fill(v) a:copy_from(b)
+    //   px:pack_rgba(r, g, b [, a])             -- px: u8 (4 per pixel) or u32 (1 per pixel)
+    void ExposeTypedArrays() {
+        using Engine_::ElemType;
+        using Engine_::TypedArray;
+
+        auto make = [](ElemType type) {
+            return [type](int n) {
+                if (n < 0) throw std::runtime_error("TypedArray: negative size");
+                return TypedArray(type, (size_t)n);
+            };
+        };
+        auto check_index = [](const TypedArray& a, int i) {
+            if (i < 1 || (size_t)i > a.size())
+                throw std::runtime_error("TypedArray: index " + std::to_string(i) + " out of range 1.." + std::to_string(a.size()));
+            return (size_t)(i - 1);
+        };
+
+        sol::usertype<TypedArray> ut = LuaEngine_.new_usertype<TypedArray>("TypedArray", sol::no_constructor);
+        ut["f32"] = make(ElemType::F32);
+        ut["u8"] = make(ElemType::U8);
+        ut["u32"] = make(ElemType::U32);
+        ut["from"] = [](const std::string& type, const sol::table& values) {
+            ElemType et;
+            if (!Lua_helpers::ParseElemType(type, et)) throw std::runtime_error("TypedArray.from: unknown type " + type);
+            TypedArray a(et, values.size());
+            for (size_t i = 0; i < a.size(); ++i)
+                a.set(i, values.raw_get<sol::optional<double>>(i + 1).value_or(0.0));
+            return a;
+        };
+
+        ut[sol::meta_function::length] = &TypedArray::size;
+        // Only reached for keys that are not methods; other non-number keys read as nil.
+        ut[sol::meta_function::index] = [check_index](sol::this_state ts, const TypedArray& a, const sol::object& key) {
+            if (key.get_type() != sol::type::number) return sol::make_object(ts, sol::lua_nil);
+            const double v = a.get(check_index(a, key.as<int>()));
+            if (a.type() == ElemType::F32) return sol::make_object(ts, v);
+            return sol::make_object(ts, (int64_t)v);
+        };
+        ut[sol::meta_function::new_index] = [check_index](TypedArray& a, int i, double v) { a.set(check_index(a, i), v); };
+        ut[sol::meta_function::to_string] = [](const TypedArray& a) {
+            return std::string("TypedArray<") + Engine_::elem_type_name(a.type()) + ">(" + std::to_string(a.size()) + ")";
+        };
+
+        ut["size"] = &TypedArray::size;
+        ut["byte_size"] = &TypedArray::byte_size;
+        ut["type"] = [](const TypedArray& a) { return Engine_::elem_type_name(a.type()); };
+        ut["slice"] = [](const TypedArray& a, int first, sol::optional<int> last) {
+            const int l = last.value_or((int)a.size());
+            if (first < 1 || l < first - 1) return a.slice(a.size(), 0);
+            return a.slice((size_t)(first - 1), (size_t)(l - first + 1));
+        };
+        ut["copy"] = &TypedArray::copy;
+        ut["fill"] = &TypedArray::fill;
+        ut["copy_from"] = [](TypedArray& a, const TypedArray& b) {
+            if (a.size() != b.size()) throw std::runtime_error("TypedArray:copy_from: size mismatch");
+            a.copy_from(b);
+        };
+        ut["add"] = sol::overload(
+            [](TypedArray& a, double s) { a.add(s); },
+            [](TypedArray& a, const TypedArray& b) {
+                if (a.size() != b.size()) throw std::runtime_error("TypedArray:add: size mismatch");
+                a.add(b);
+            });
+        ut["mul"] = sol::overload(
+            [](TypedArray& a, double s) { a.mul(s); },
+            [](TypedArray& a, const TypedArray& b) {
+                if (a.size() != b.size()) throw std::runtime_error("TypedArray:mul: size mismatch");
+                a.mul(b);
+            });
+        ut["lerp"] = [](TypedArray& a, const TypedArray& b, double t) {
+            if (a.size() != b.size()) throw std::runtime_error("TypedArray:lerp: size mismatch");
+            a.lerp(b, t);
+        };
+        ut["sin"] = &TypedArray::sin;
+        ut["clamp"] = &TypedArray::clamp;
+        ut["pack_rgba"] = [](TypedArray& px, const TypedArray& r, const TypedArray& g, const TypedArray& b, sol::optional<const TypedArray&> a) {
+            if (!px.pack_rgba(r, g, b, a ? &*a : nullptr))
+                throw std::runtime_error("TypedArray:pack_rgba: channels must match and px be u8 (4n) or u32 (n)");
+        };
+        ut["to_string"] = [](const TypedArray& a) {
+            return std::string(static_cast<const char*>(a.data()), a.byte_size());
+        };
+        ut["to_table"] = [](sol::this_state ts, const TypedArray& a) {
+            sol::state_view lua(ts);
+            sol::table t = lua.create_table((int)a.size(), 0);
+            for (size_t i = 0; i < a.size(); ++i) t.raw_set(i + 1, a.get(i));
+            return t;
+        };
+    }
+
+    // Engine.Mat4 / Engine.Vec3: native math values. Engine.Direct.mat4_* return Engine.Mat4,
+    // and every bridge Mat4 / Vec3 argument takes them as well as tables.
+    //   local m = Engine.Mat4.new()               -- identity; Engine.Mat4.new({ 16 numbers })
+    //   m:set_mul(a, b)  m:mul(b)  m:premul(a)    -- in place: m = a*b, m = m*b, m = a*m
+    //   m:set_identity() m:set_translate(v) m:set_scale(v) m:set_rotate_x(r) (y, z)
+    //   m:set_perspective(fovy, aspect, zn, zf) m:set_look_at(eye, at, up) m:copy_from(a)
+    //   m[i] (1..16, column-major)  m:copy()  m:to_table()  a * b (new)
+    //   m:transform(x, y, z [, w]) -> x, y, z, w
+    //   local v = Engine.Vec3.new(x, y, z)        -- v.x v.y v.z, v:set(x, y, z), v:add(o) v:sub(o)
+    //   v:scale(s) v:normalize() v:dot(o) v:cross(o) v:length() v:copy()  v + o, v - o, v * s
+    // Vec3 args take Engine.Vec3, a vec3 table or three numbers. In-place methods return
+    // self for chaining and allocate nothing.
+    void ExposeMath() {
+        using Engine_::Mat4;
+        using Engine_::Vec3;
+
+        auto self_mat4 = [](const sol::object& self) -> Mat4& {
+            if (!self.is<Mat4>()) throw std::runtime_error("Mat4 method called without a Mat4 (use m:method)");
+            return self.as<Mat4&>();
+        };
+        auto self_vec3 = [](const sol::object& self) -> Vec3& {
+            if (!self.is<Vec3>()) throw std::runtime_error("Vec3 method called without a Vec3 (use v:method)");
+            return self.as<Vec3&>();
+        };
+        auto vec3_arg = [](const sol::object& a, sol::optional<double> y, sol::optional<double> z) {
+            if (a.get_type() == sol::type::number) return Vec3{ a.as<float>(), (float)y.value_or(0.0), (float)z.value_or(0.0) };
+            return EngineLuaBridge_::vec3_from_object(a);
+        };
+        auto mat4_index = [](const sol::object& key) {
+            const int i = key.as<int>();
+            if (i < 1 || i > 16) throw std::runtime_error("Mat4: index " + std::to_string(i) + " out of range 1..16");
+            return i - 1;
+        };
+
+        sol::usertype<Mat4> mt = LuaEngine_.new_usertype<Mat4>("Mat4", sol::no_constructor);
+        mt["new"] = [](sol::optional<sol::table> values) {
+            return values ? EngineLuaBridge_::table_to_mat4(*values) : Engine_::mat4_identity();
+        };
+
+        mt["set_identity"] = [self_mat4](sol::object self) { self_mat4(self) = Engine_::mat4_identity(); return self; };
+        mt["set_translate"] = [self_mat4, vec3_arg](sol::object self, const sol::object& v, sol::optional<double> y, sol::optional<double> z) {
+            self_mat4(self) = Engine_::mat4_translate(vec3_arg(v, y, z));
+            return self;
+        };
+        mt["set_scale"] = [self_mat4, vec3_arg](sol::object self, const sol::object& v, sol::optional<double> y, sol::optional<double> z) {
+            self_mat4(self) = Engine_::mat4_scale(vec3_arg(v, y, z));
+            return self;
+        };
+        mt["set_rotate_x"] = [self_mat4](sol::object self, double r) { self_mat4(self) = Engine_::mat4_rotate_x((float)r); return self; };
+        mt["set_rotate_y"] = [self_mat4](sol::object self, double r) { self_mat4(self) = Engine_::mat4_rotate_y((float)r); return self; };
+        mt["set_rotate_z"] = [self_mat4](sol::object self, double r) { self_mat4(self) = Engine_::mat4_rotate_z((float)r); return self; };
+        mt["set_perspective"] = [self_mat4](sol::object self, double fovy, double aspect, double zn, double zf) {
+            self_mat4(self) = Engine_::mat4_perspective((float)fovy, (float)aspect, (float)zn, (float)zf);
+            return self;
+        };
+        mt["set_look_at"] = [self_mat4](sol::object self, const sol::object& eye, const sol::object& at, const sol::object& up) {
+            self_mat4(self) = Engine_::mat4_look_at(EngineLuaBridge_::vec3_from_object(eye),
+                EngineLuaBridge_::vec3_from_object(at), EngineLuaBridge_::vec3_from_object(up));
+            return self;
+        };
+        mt["set_mul"] = [self_mat4](sol::object self, const sol::object& a, const sol::object& b) {
+            self_mat4(self) = Engine_::mat4_mul(EngineLuaBridge_::mat4_from_object(a), EngineLuaBridge_::mat4_from_object(b));
+            return self;
+        };
+        mt["mul"] = [self_mat4](sol::object self, const sol::object& b) {
+            Mat4& m = self_mat4(self);
+            m = Engine_::mat4_mul(m, EngineLuaBridge_::mat4_from_object(b));
+            return self;
+        };
+        mt["premul"] = [self_mat4](sol::object self, const sol::object& a) {
+            Mat4& m = self_mat4(self);
+            m = Engine_::mat4_mul(EngineLuaBridge_::mat4_from_object(a), m);
+            return self;
+        };
+        mt["copy_from"] = [self_mat4](sol::object self, const sol::object& a) {
+            self_mat4(self) = EngineLuaBridge_::mat4_from_object(a);
+            return self;
+        };
+        mt["copy"] = [](const Mat4& m) { return m; };
+        mt["to_table"] = [](sol::this_state ts, const Mat4& m) { return EngineLuaBridge_::mat4_to_table(ts, m); };
+        mt["transform"] = [](const Mat4& m, double x, double y, double z, sol::optional<double> w) {
+            const Engine_::Vec4 r = Engine_::mat4_mul(m, Engine_::Vec4{ (float)x, (float)y, (float)z, (float)w.value_or(1.0) });
+            return std::make_tuple(r.x, r.y, r.z, r.w);
+        };
+        mt[sol::meta_function::multiplication] = [](const Mat4& a, const Mat4& b) { return Engine_::mat4_mul(a, b); };
+        // Only reached for keys that are not methods; other non-number keys read as nil.
+        mt[sol::meta_function::index] = [mat4_index](sol::this_state ts, const Mat4& m, const sol::object& key) {
+            if (key.get_type() != sol::type::number) return sol::make_object(ts, sol::lua_nil);
+            return sol::make_object(ts, (double)m.m[mat4_index(key)]);
+        };
+        mt[sol::meta_function::new_index] = [mat4_index](Mat4& m, const sol::object& key, double v) {
+            if (key.get_type() != sol::type::number) throw std::runtime_error("Mat4: only elements 1..16 can be set");
+            m.m[mat4_index(key)] = (float)v;
+        };
+        mt[sol::meta_function::length] = [](const Mat4&) { return 16; };
+        mt[sol::meta_function::to_string] = [](const Mat4& m) {
+            std::ostringstream os;
+            os << "Mat4(";
+            for (int i = 0; i < 16; ++i) os << (i ? ", " : "") << m.m[i];
+            os << ")";
+            return os.str();
+        };
+
+        sol::usertype<Vec3> vt = LuaEngine_.new_usertype<Vec3>("Vec3", sol::no_constructor);
+        vt["new"] = [](sol::optional<double> x, sol::optional<double> y, sol::optional<double> z) {
+            return Vec3{ (float)x.value_or(0.0), (float)y.value_or(0.0), (float)z.value_or(0.0) };
+        };
+        vt["x"] = &Vec3::x;
+        vt["y"] = &Vec3::y;
+        vt["z"] = &Vec3::z;
+        vt["set"] = [self_vec3, vec3_arg](sol::object self, const sol::object& v, sol::optional<double> y, sol::optional<double> z) {
+            self_vec3(self) = vec3_arg(v, y, z);
+            return self;
+        };
+        vt["add"] = [self_vec3](sol::object self, const sol::object& o) {
+            Vec3& v = self_vec3(self);
+            const Vec3 b = EngineLuaBridge_::vec3_from_object(o);
+            v = Vec3{ v.x + b.x, v.y + b.y, v.z + b.z };
+            return self;
+        };
+        vt["sub"] = [self_vec3](sol::object self, const sol::object& o) {
+            Vec3& v = self_vec3(self);
+            const Vec3 b = EngineLuaBridge_::vec3_from_object(o);
+            v = Vec3{ v.x - b.x, v.y - b.y, v.z - b.z };
+            return self;
+        };
+        vt["scale"] = [self_vec3](sol::object self, double s) {
+            Vec3& v = self_vec3(self);
+            v = Vec3{ (float)(v.x * s), (float)(v.y * s), (float)(v.z * s) };
+            return self;
+        };
+        vt["normalize"] = [self_vec3](sol::object self) {
+            Vec3& v = self_vec3(self);
+            const float len = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+            if (len > 0.0f) v = Vec3{ v.x / len, v.y / len, v.z / len };
+            return self;
+        };
+        vt["length"] = [](const Vec3& v) { return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z); };
+        vt["dot"] = [](const Vec3& a, const sol::object& o) {
+            const Vec3 b = EngineLuaBridge_::vec3_from_object(o);
+            return a.x * b.x + a.y * b.y + a.z * b.z;
+        };
+        vt["cross"] = [](const Vec3& a, const sol::object& o) {
+            const Vec3 b = EngineLuaBridge_::vec3_from_object(o);
+            return Vec3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+        };
+        vt["copy"] = [](const Vec3& v) { return v; };
+        vt[sol::meta_function::addition] = [](const Vec3& a, const Vec3& b) { return Vec3{ a.x + b.x, a.y + b.y, a.z + b.z }; };
+        vt[sol::meta_function::subtraction] = [](const Vec3& a, const Vec3& b) { return Vec3{ a.x - b.x, a.y - b.y, a.z - b.z }; };
+        vt[sol::meta_function::multiplication] = [](const Vec3& a, double s) {
+            return Vec3{ (float)(a.x * s), (float)(a.y * s), (float)(a.z * s) };
+        };
+        vt[sol::meta_function::to_string] = [](const Vec3& v) {
+            std::ostringstream os;
+            os << "Vec3(" << v.x << ", " << v.y << ", " << v.z << ")";
+            return os.str();
+        };
+    }
+
+    // Engine.Kernel: per-pixel expression kernels evaluated natively (see PixelKernel.h).
+    //   local k, err = Engine.Kernel.compile(src [, { seed = 1, ... }])  -- nil, "line N: ..." on errors
+    //   k:set(name, value)   k:palette(colors | rgba)
+    //   k:run(x, y, w, h [, t])            -- writes like write_pixels (blend + clip)
+    //   k:render(w, h, t, out) -> out      -- into a u8/u32 TypedArray of w*h pixels instead
+    void ExposeKernels() {
+        using Engine_::PixelKernel;
+
+        sol::usertype<PixelKernel> ut = LuaEngine_.new_usertype<PixelKernel>("Kernel", sol::no_constructor);
+        ut["compile"] = [](sol::this_state ts, const std::string& src, sol::optional<sol::table> params) {
+            sol::state_view lua(ts);
+            std::vector<std::pair<std::string, double>> list;
+            if (params) {
+                for (const auto& [key, value] : *params) {
+                    if (!key.is<std::string>() || value.get_type() != sol::type::number)
+                        throw std::runtime_error("Kernel.compile: params must be { name = number }");
+                    list.emplace_back(key.as<std::string>(), value.as<double>());
+                }
+            }
+            std::string error;
+            std::shared_ptr<PixelKernel> k = PixelKernel::compile(src, list, error);
+            if (!k) return std::make_tuple(sol::make_object(lua, sol::lua_nil), sol::make_object(lua, "Kernel.compile: " + error));
+            return std::make_tuple(sol::make_object(lua, std::move(k)), sol::make_object(lua, sol::lua_nil));
+        };
+
+        ut["set"] = [](PixelKernel& k, const std::string& name, double value) {
+            if (!k.set_param(name, value)) throw std::runtime_error("Kernel:set: unknown param '" + name + "'");
+        };
+        ut["palette"] = [](PixelKernel& k, const sol::object& palette) {
+            std::vector<Engine_::Color> pal = Lua_helpers::ParsePalette(palette);
+            if (pal.empty()) throw std::runtime_error("Kernel:palette: empty palette");
+            k.set_palette(std::move(pal));
+        };
+        ut["run"] = [](const PixelKernel& k, int x, int y, int w, int h, sol::optional<double> t) {
+            k.run(x, y, w, h, t.value_or(0.0));
+        };
+        ut["render"] = [](const PixelKernel& k, int w, int h, double t, Engine_::TypedArray& out) -> Engine_::TypedArray& {
+            const bool fits = (out.type() == Engine_::ElemType::U8 || out.type() == Engine_::ElemType::U32)
+                && w > 0 && h > 0 && out.byte_size() >= (size_t)w * h * 4;
+            if (!fits) throw std::runtime_error("Kernel:render: out must be a u8/u32 TypedArray of w*h pixels");
+            k.evaluate(w, h, t, static_cast<uint8_t*>(out.data()));
+            return out;
+        };
+        ut[sol::meta_function::to_string] = [](const PixelKernel& k) {
+            int run = 0, row = 0, pixel = 0;
+            k.instruction_counts(run, row, pixel);
+            return "Kernel(ops: " + std::to_string(run) + " per run, " + std::to_string(row) + " per row, "
+                + std::to_string(pixel) + " per pixel)";
+        };
+    }
+
+    // Lua 5.4 seeds math.random randomly per state; offline runs want the same frames every time.
+    // Engine.rand01 restarts too, from the seed, so a warm Restart replays a cold run
+    // and farm jobs with different seeds get different streams.
+    void SeedRandom() {
+        rand01State_ = kRand01Default;
+        if (!cfg_.randomSeed) return;
+        sol::protected_function seed = lua_["math"]["randomseed"];
+        if (seed.valid()) seed(*cfg_.randomSeed);
+
+        uint64_t z = (uint64_t)*cfg_.randomSeed + 0x9E3779B97F4A7C15ull; // splitmix64 finalizer
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        rand01State_ = (uint32_t)(z ^ (z >> 31));
+    }
+
     void Call0(sol::protected_function& fn, const char* label) {
         if (!fn.valid()) return;
         sol::protected_function_result pr = fn();
@@ -704,7 +1432,13 @@ private:
     Config cfg_;
     RuntimeAssets& assets_;
 
+    Engine_::LuaPoolAllocator luaPool_; // declared before lua_: outlives the VM
+    Engine_::LuaBytecodeCache bytecodeCache_; // also outlives the VM (its searcher points here)
+    uint64_t gcAllocMark_ = 0;          // pool bytes_allocated at the last StepGc
+    bool gcGenerational_ = false;
+
     sol::state lua_;
+    Engine_::LuaProfiler profiler_; // declared after lua_: unhooks while the VM is alive
     sol::table LuaEngine_;
     sol::protected_function factory_;
     sol::table instance_;
@@ -715,37 +1449,166 @@ private:
     sol::protected_function onReload_;
 
     bool didPresentThisFrame_ = false;
+    static constexpr uint32_t kRand01Default = 123456789u; // unseeded runs
+    uint32_t rand01State_ = kRand01Default;
+
+    const uint64_t id_ = NextHostId();
+    static inline thread_local uint64_t t_bridgeOwner = 0; // id_ of the host bound on this thread
+
+    static uint64_t NextHostId() {
+        static std::atomic<uint64_t> next{ 1 };
+        return next.fetch_add(1);
+    }
 
     std::optional<uint64_t> fp_;
     std::chrono::steady_clock::time_point lastPoll_{};
 };
 
-int main()
+// GL_Template_V0 --extract <archive.frames> <out_dir> [first] [count]
+static int RunExtract(int argc, char** argv)
 {
-    std::cout << "[C++] step_by_step (Lua-driven)\n";
+    if (argc < 4) {
+        std::cerr << "usage: " << argv[0] << " --extract <archive.frames> <out_dir> [first] [count]\n";
+        return 2;
+    }
+    const size_t first = argc > 4 ? (size_t)std::strtoull(argv[4], nullptr, 10) : 0;
+    const size_t count = argc > 5 ? (size_t)std::strtoull(argv[5], nullptr, 10) : SIZE_MAX;
+    return Engine_::extract_frame_archive(argv[2], argv[3], first, count) ? 0 : 1;
+}
 
-    // -------------------------
-    // Engine init (same settings as your old C++ scene)
-    // -------------------------
+// -------------------------
+// Command line
+// -------------------------
+struct AppOptions
+{
+    bool headless = false;
+    int frames = 0;             // 0 = until the window closes / Lua requests close
+    double fixedDt = 0.0;       // 0 = wall clock (headless defaults to 1/60)
+    std::string capture;        // save every frame through set_capture_filepath (empty = off)
+    int fbW = 1920 / 2;
+    int fbH = 1080 / 2;
+    std::string entryModule = "main_lua_example_v1_4";
+    std::optional<int64_t> seed; // headless defaults to 0
+    std::string batch;          // --batch: job count or job file (implies --headless)
+    int servePort = 0;          // --serve: render server port (implies --headless)
+    int livePort = 0;           // --live: MJPEG/PNG preview of presented frames (0 = off)
+    double gcBudgetMs = 1.0;    // --gc-budget: Lua GC once per frame, after present (0 = Lua's own)
+    std::string luaProfile;     // --lua-profile: sample the scripts, write PATH.folded / PATH.trace.json
+    bool bytecodeCache = true;  // --no-bytecode-cache: always parse scripts from source
+};
+
+static void PrintUsage(const char* exe)
+{
+    std::cout <<
+        "usage: " << exe << " [options]\n"
+        "  --headless          no window / OpenGL, runs as fast as the CPU allows\n"
+        "  --frames N          stop after N frames\n"
+        "  --dt SECONDS        fixed timestep (headless default 1/60)\n"
+        "  --fps F             same as --dt 1/F (also the .y4m frame rate)\n"
+        "  --capture PATH      save every frame: dir, name.png/.fpng/.qoi, out.y4m/.rgba, run.frames\n"
+        "  --size WxH          framebuffer size\n"
+        "  --script MODULE     entry module in scripts/ (default main_lua_example_v1_4)\n"
+        "  --seed N            math.randomseed for the Lua VM (headless default 0)\n"
+        "  --batch N|FILE      render N jobs (seeds seed..seed+N-1) or one job per line of FILE\n"
+        "                      (key=value ...; seed/frames/capture override, all visible as Engine.Job)\n"
+        "                      in parallel; a {job} in --capture is replaced by the job index\n"
+        "  --serve PORT        keep scripts warm and render on request at http://127.0.0.1:PORT/render\n"
+        "  --live PORT         watch the presented frames at http://127.0.0.1:PORT/ (MJPEG / PNG)\n"
+        "  --gc-budget MS      run the Lua GC once per frame after present (default 1, 0 = automatic GC);\n"
+        "                      with Lua 5.4's generational GC the frame's allocation is collected\n"
+        "                      (young or full collection, as Lua paces it) and MS only switches\n"
+        "                      this on; on an incremental GC it caps the step\n"
+        "  --lua-profile PATH  profile the scripts, write PATH.folded (flamegraph) and PATH.trace.json\n"
+        "  --no-bytecode-cache parse every required script from source (no .luacache)\n"
+        "  --extract ARCHIVE OUT_DIR [first] [count]\n";
+}
+
+static bool ParseArgs(int argc, char** argv, AppOptions& o)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (a == "--headless") o.headless = true;
+        else if (a == "--frames" && hasValue) o.frames = std::max(0, std::atoi(argv[++i]));
+        else if (a == "--dt" && hasValue) o.fixedDt = std::max(0.0, std::atof(argv[++i]));
+        else if (a == "--fps" && hasValue) {
+            const double fps = std::atof(argv[++i]);
+            if (fps <= 0.0) { std::cerr << "[C++] --fps must be > 0\n"; return false; }
+            o.fixedDt = 1.0 / fps;
+        }
+        else if (a == "--capture" && hasValue) o.capture = argv[++i];
+        else if (a == "--size" && hasValue) {
+            int w = 0, h = 0;
+            if (std::sscanf(argv[++i], "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) {
+                std::cerr << "[C++] --size expects WxH\n";
+                return false;
+            }
+            o.fbW = w;
+            o.fbH = h;
+        }
+        else if (a == "--script" && hasValue) o.entryModule = argv[++i];
+        else if (a == "--seed" && hasValue) o.seed = std::strtoll(argv[++i], nullptr, 10);
+        else if (a == "--batch" && hasValue) {
+            o.batch = argv[++i];
+            o.headless = true;
+        }
+        else if (a == "--serve" && hasValue) {
+            o.servePort = std::atoi(argv[++i]);
+            if (o.servePort <= 0 || o.servePort > 65535) { std::cerr << "[C++] --serve expects a port\n"; return false; }
+            o.headless = true;
+        }
+        else if (a == "--live" && hasValue) {
+            o.livePort = std::atoi(argv[++i]);
+            if (o.livePort <= 0 || o.livePort > 65535) { std::cerr << "[C++] --live expects a port\n"; return false; }
+        }
+        else if (a == "--gc-budget" && hasValue) o.gcBudgetMs = std::max(0.0, std::atof(argv[++i]));
+        else if (a == "--lua-profile" && hasValue) o.luaProfile = argv[++i];
+        else if (a == "--no-bytecode-cache") o.bytecodeCache = false;
+        else {
+            std::cerr << "[C++] Unknown or incomplete argument: " << a << "\n";
+            return false;
+        }
+    }
+
+    if (o.headless) {
+        if (o.fixedDt <= 0.0) o.fixedDt = 1.0 / 60.0;
+        if (!o.seed) o.seed = 0;
+        if (o.frames == 0 && o.batch.empty() && o.servePort == 0)
+            std::cout << "[C++] --headless without --frames runs until the script requests close\n";
+    }
+    return true;
+}
+
+// -------------------------
+// Engine setup shared by the interactive loop and batch jobs
+// -------------------------
+static Engine_::Config MakeEngineConfig(const AppOptions& opt)
+{
+    // same settings as your old C++ scene
     Engine_::Config cfg;
     cfg.display_w = 960;
     cfg.display_h = 540;
-    cfg.fb_w = 1920 / 2;
-    cfg.fb_h = 1080 / 2;
+    cfg.fb_w = opt.fbW;
+    cfg.fb_h = opt.fbH;
 
     cfg.resizable = true;
     cfg.vsync = false;
     cfg.linear_filter = false;
     cfg.hidden_window = false;
-    cfg.headless = false;
-
-    if (!Engine_::init(cfg)) {
-        std::cerr << "Engine init failed.\n";
-        return 1;
-    }
+    cfg.headless = opt.headless;
+    return cfg;
+}
 
-    Engine_::set_capture_filepath("captures");
+// Frame/capture/postprocess defaults for the current context.
+static void ConfigureRenderState(const AppOptions& opt, const std::string& capturePath)
+{
+    if (!capturePath.empty())
+        Engine_::set_capture_filepath(capturePath);
     Engine_::set_frame_index(0);
+    Engine_::set_fixed_timestep(opt.fixedDt);
+    if (opt.fixedDt > 0.0)
+        Engine_::set_capture_fps((int)std::lround(1.0 / opt.fixedDt));
 
     // Enable depth for 3D
     Engine_::enable_depth(true);
@@ -755,41 +1618,572 @@ int main()
     pp.bloom.enabled = false;
     pp.tone.enabled = false;
     Engine_::set_postprocess(pp);
+}
+
+// -------------------------
+// Batch render farm
+// Assets are baked once by a warm-up run of the script's Init, then every job
+// gets its own render context + Lua VM on the shared job pool and sees those
+// assets read-only (RuntimeAssets::shared); whatever a job creates stays private.
+// -------------------------
+struct BatchJob
+{
+    int index = 0;
+    int64_t seed = 0;
+    int frames = 0;
+    std::string capture; // empty = render only
+    std::vector<std::pair<std::string, std::string>> params;
+};
+
+struct BatchResult
+{
+    bool ok = false;
+    int frames = 0;
+    double seconds = 0.0;
+};
+
+// "{job}" -> index; otherwise "_job<index>" goes before the extension (or after a directory name).
+static std::string JobCapturePath(const std::string& pattern, int index)
+{
+    if (pattern.empty()) return {};
+
+    const std::string tag = std::to_string(index);
+    std::string out = pattern;
+    const size_t at = out.find("{job}");
+    if (at != std::string::npos)
+        return out.replace(at, 5, tag);
+
+    fs::path p(pattern);
+    if (!p.has_extension())
+        return pattern + "_job" + tag;
+    return (p.parent_path() / (p.stem().string() + "_job" + tag + p.extension().string())).string();
+}
+
+static bool BuildBatchJobs(const AppOptions& opt, std::vector<BatchJob>& jobs)
+{
+    const int64_t baseSeed = opt.seed.value_or(0);
+    auto makeJob = [&](int index) {
+        BatchJob j;
+        j.index = index;
+        j.seed = baseSeed + index;
+        j.frames = opt.frames;
+        j.capture = JobCapturePath(opt.capture, index);
+        return j;
+    };
+
+    const bool isCount = !opt.batch.empty() && std::all_of(opt.batch.begin(), opt.batch.end(),
+        [](char c) { return c >= '0' && c <= '9'; });
+
+    if (isCount) {
+        const int n = std::atoi(opt.batch.c_str());
+        for (int i = 0; i < n; ++i) jobs.push_back(makeJob(i));
+    }
+    else {
+        std::ifstream in(opt.batch);
+        if (!in) {
+            std::cerr << "[C++] cannot open batch file: " << opt.batch << "\n";
+            return false;
+        }
+
+        std::string line;
+        int lineNo = 0;
+        while (std::getline(in, line)) {
+            ++lineNo;
+            std::istringstream words(line);
+            std::string word;
+            if (!(words >> word) || word[0] == '#') continue;
+
+            BatchJob j = makeJob((int)jobs.size());
+            do {
+                const size_t eq = word.find('=');
+                if (eq == std::string::npos || eq == 0) {
+                    std::cerr << "[C++] " << opt.batch << ":" << lineNo << ": expected key=value, got '" << word << "'\n";
+                    return false;
+                }
+                std::string key = word.substr(0, eq), value = word.substr(eq + 1);
+                if (key == "seed") j.seed = std::strtoll(value.c_str(), nullptr, 10);
+                else if (key == "frames") j.frames = std::max(0, std::atoi(value.c_str()));
+                else if (key == "capture") j.capture = JobCapturePath(value, j.index);
+                else j.params.emplace_back(std::move(key), std::move(value));
+            } while (words >> word);
+            jobs.push_back(std::move(j));
+        }
+    }
+
+    if (jobs.empty()) {
+        std::cerr << "[C++] batch has no jobs\n";
+        return false;
+    }
+    for (BatchJob& j : jobs) {
+        j.params.emplace_back("index", std::to_string(j.index));
+        j.params.emplace_back("seed", std::to_string(j.seed));
+        j.params.emplace_back("frames", std::to_string(j.frames));
+        if (j.frames <= 0) {
+            std::cerr << "[C++] batch job " << j.index << " needs frames > 0 (--frames or frames=)\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+static BatchResult RunBatchJob(const AppOptions& opt, const BatchJob& job, const LuaHost::Config& baseCfg,
+    const RuntimeAssets& sharedAssets)
+{
+    BatchResult r;
+    const auto t0 = std::chrono::steady_clock::now();
+
+    Engine_::Context* ctx = Engine_::create_context(MakeEngineConfig(opt));
+    {
+        Engine_::ContextScope scope(ctx);
+        ConfigureRenderState(opt, job.capture);
+
+        RuntimeAssets assets;
+        assets.shared = &sharedAssets;
+
+        LuaHost::Config lcfg = baseCfg;
+        lcfg.randomSeed = job.seed;
+        lcfg.job = job.params;
+
+        LuaHost host(lcfg, assets);
+        if (host.Init()) {
+            for (; r.frames < job.frames && !Engine_::should_close(); ++r.frames) {
+                host.Tick(opt.fixedDt);
+                if (!job.capture.empty()) {
+                    Engine_::save_frame_png(true);
+                    Engine_::next_frame();
+                }
+            }
+            host.Shutdown();
+            r.ok = true;
+        }
+    }
+    Engine_::destroy_context(ctx); // flushes this job's captures
+
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return r;
+}
+
+static int RunBatch(const AppOptions& opt, const fs::path& scriptsDir)
+{
+    std::vector<BatchJob> jobs;
+    if (!BuildBatchJobs(opt, jobs)) return 2;
+
+    LuaHost::Config lcfg;
+    lcfg.scriptsDir = scriptsDir;
+    lcfg.entryModule = opt.entryModule;
+    lcfg.hotReloadEnabled = false;
+    lcfg.randomSeed = opt.seed;
+    lcfg.gcBudgetMs = opt.gcBudgetMs;
+    lcfg.bytecodeCache = opt.bytecodeCache;
+
+    const auto runStart = std::chrono::steady_clock::now();
+
+    // Warm-up: the script's Init bakes/loads into `shared`, which is read-only from here on.
+    RuntimeAssets shared;
+    {
+        Engine_::Context* ctx = Engine_::create_context(MakeEngineConfig(opt));
+        bool warmed = false;
+        {
+            Engine_::ContextScope scope(ctx);
+            ConfigureRenderState(opt, {});
+            LuaHost host(lcfg, shared);
+            warmed = host.Init();
+            if (warmed) host.Shutdown();
+        }
+        Engine_::destroy_context(ctx);
+        if (!warmed) {
+            std::cerr << "[C++] batch warm-up failed\n";
+            return 1;
+        }
+    }
+    const double warmS = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+    std::cout << "[C++] batch: " << jobs.size() << " jobs, " << shared.textures.size() << " textures + "
+        << shared.meshes.size() << " meshes shared, " << Engine_::JobPool::shared().worker_count() + 1 << " threads\n";
+
+    std::vector<BatchResult> results(jobs.size());
+    Engine_::JobPool::shared().parallel_for((int)jobs.size(), [&](int i) {
+        results[(size_t)i] = RunBatchJob(opt, jobs[(size_t)i], lcfg, shared);
+
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(2) << "[C++] job " << jobs[(size_t)i].index
+            << (results[(size_t)i].ok ? "" : " FAILED") << ": " << results[(size_t)i].frames << " frames in "
+            << results[(size_t)i].seconds << " s\n";
+        std::cout << line.str();
+        });
+
+    int failed = 0, frames = 0;
+    for (const BatchResult& r : results) {
+        failed += r.ok ? 0 : 1;
+        frames += r.frames;
+    }
+    const double totalS = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+    std::cout << std::fixed << std::setprecision(2)
+        << "[C++] batch done: " << jobs.size() - failed << "/" << jobs.size() << " jobs, " << frames << " frames in "
+        << totalS << " s (warm-up " << warmS << " s, " << (totalS > warmS ? frames / (totalS - warmS) : 0.0) << " fps)\n";
+    return failed ? 1 : 0;
+}
+
+// -------------------------
+// Render server (--serve PORT), localhost only
+// Keeps one warm render context + Lua VM (and its baked assets) per script and
+// size, so a request only pays for the frames it renders.
+//   GET|POST /render  script=MODULE frames=N size=WxH seed=N format=png|fpng|qoi|rgba
+//                     capture=PATH (relative, under captures/; frames go through
+//                     set_capture_filepath; JSON reply)
+//                     any other key=value reaches the script as Engine.Job
+//                     -> the last frame, encoded in `format`
+//   GET /health, POST /quit
+// -------------------------
+class RenderServer
+{
+public:
+    RenderServer(const AppOptions& opt, fs::path scriptsDir)
+        : opt_(opt), scriptsDir_(std::move(scriptsDir)) {
+    }
+
+    ~RenderServer()
+    {
+        for (auto& [key, warm] : warm_) {
+            if (!warm->ctx) continue;
+            {
+                Engine_::ContextScope scope(warm->ctx);
+                if (warm->host) warm->host->Shutdown();
+                warm->host.reset();
+            }
+            Engine_::destroy_context(warm->ctx);
+        }
+    }
+
+    int Run(int port)
+    {
+        httplib::Server svr;
+
+        svr.Get("/health", [](const httplib::Request&, httplib::Response& res) {
+            res.set_content("ok\n", "text/plain");
+            });
+        auto render = [this](const httplib::Request& req, httplib::Response& res) { HandleRender(req, res); };
+        svr.Get("/render", render);
+        svr.Post("/render", render);
+        svr.Post("/quit", [&svr](const httplib::Request&, httplib::Response& res) {
+            res.set_content("bye\n", "text/plain");
+            svr.stop();
+            });
+
+        std::cout << "[C++] render server on http://127.0.0.1:" << port << "/render\n";
+        if (!svr.listen("127.0.0.1", port)) {
+            std::cerr << "[C++] cannot listen on 127.0.0.1:" << port << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+private:
+    struct RenderRequest
+    {
+        std::string module;
+        int w = 0;
+        int h = 0;
+        int frames = 1;
+        int64_t seed = 0;
+        std::string format = "png";
+        std::string capture;
+        std::vector<std::pair<std::string, std::string>> job;
+    };
+
+    struct WarmHost
+    {
+        std::mutex m; // one request at a time per host
+        Engine_::Context* ctx = nullptr;
+        RuntimeAssets assets;
+        std::unique_ptr<LuaHost> host;
+    };
+
+    // Request captures are written below this directory (also the idle target).
+    static constexpr const char* kCaptureDir = "captures";
+
+    // capture= comes from the network: only relative paths inside kCaptureDir.
+    static bool ResolveCapturePath(const std::string& value, std::string& out, std::string& error)
+    {
+        const fs::path p(value);
+        bool ok = !value.empty() && !p.has_root_name() && !p.has_root_directory()
+            && value.find(':') == std::string::npos && p.stem() != "-"; // "-.y4m" = stdout
+        for (const fs::path& part : p)
+            if (part == "..") ok = false;
+        if (!ok) {
+            error = "capture must be a relative path inside " + std::string(kCaptureDir) + "/ (no '..')";
+            return false;
+        }
+        out = (fs::path(kCaptureDir) / p).generic_string();
+        return true;
+    }
+
+    static std::string JsonEscape(const std::string& s)
+    {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+    bool ParseRequest(const httplib::Request& req, RenderRequest& r, std::string& error) const
+    {
+        r.module = opt_.entryModule;
+        r.w = opt_.fbW;
+        r.h = opt_.fbH;
+
+        for (const auto& [key, value] : req.params) {
+            if (key == "script") r.module = value;
+            else if (key == "frames") r.frames = std::atoi(value.c_str());
+            else if (key == "seed") r.seed = std::strtoll(value.c_str(), nullptr, 10);
+            else if (key == "format") r.format = value;
+            else if (key == "capture") {
+                if (!ResolveCapturePath(value, r.capture, error)) return false;
+            }
+            else if (key == "size") {
+                if (std::sscanf(value.c_str(), "%dx%d", &r.w, &r.h) != 2) {
+                    error = "size expects WxH";
+                    return false;
+                }
+            }
+            else r.job.emplace_back(key, value);
+        }
+
+        if (r.module.empty() || !std::all_of(r.module.begin(), r.module.end(),
+            [](char c) { return std::isalnum((unsigned char)c) || c == '_' || c == '.'; })) {
+            error = "script must be a module name in scripts/";
+            return false;
+        }
+        if (r.w <= 0 || r.h <= 0 || r.w > 8192 || r.h > 8192) {
+            error = "size out of range";
+            return false;
+        }
+        if (r.frames <= 0) {
+            error = "frames must be > 0";
+            return false;
+        }
+        if (r.format != "png" && r.format != "fpng" && r.format != "qoi" && r.format != "rgba") {
+            error = "format must be png, fpng, qoi or rgba";
+            return false;
+        }
+
+        r.job.emplace_back("seed", std::to_string(r.seed));
+        r.job.emplace_back("frames", std::to_string(r.frames));
+        return true;
+    }
+
+    WarmHost& FindOrAddWarm(const RenderRequest& r)
+    {
+        const std::string key = r.module + "@" + std::to_string(r.w) + "x" + std::to_string(r.h);
+        std::lock_guard<std::mutex> lk(warmMutex_);
+        std::unique_ptr<WarmHost>& warm = warm_[key];
+        if (!warm) warm = std::make_unique<WarmHost>();
+        return *warm;
+    }
+
+    void HandleRender(const httplib::Request& req, httplib::Response& res)
+    {
+        RenderRequest r;
+        std::string error;
+        if (!ParseRequest(req, r, error)) {
+            res.status = 400;
+            res.set_content(error + "\n", "text/plain");
+            return;
+        }
+
+        const auto t0 = std::chrono::steady_clock::now();
+        WarmHost& warm = FindOrAddWarm(r);
+        std::lock_guard<std::mutex> lk(warm.m);
+
+        const bool cold = !warm.host;
+        if (!warm.ctx) {
+            AppOptions sized = opt_;
+            sized.fbW = r.w;
+            sized.fbH = r.h;
+            warm.ctx = Engine_::create_context(MakeEngineConfig(sized));
+        }
+
+        Engine_::ContextScope scope(warm.ctx);
+        Engine_::set_postprocess(Engine_::PostProcessSettings{});
+        ConfigureRenderState(opt_, r.capture);
+
+        if (cold) {
+            LuaHost::Config lcfg;
+            lcfg.scriptsDir = scriptsDir_;
+            lcfg.entryModule = r.module;
+            lcfg.hotReloadEnabled = false;
+            lcfg.randomSeed = r.seed;
+            lcfg.job = r.job;
+            lcfg.gcBudgetMs = opt_.gcBudgetMs;
+            lcfg.bytecodeCache = opt_.bytecodeCache;
+
+            warm.host = std::make_unique<LuaHost>(lcfg, warm.assets);
+            if (!warm.host->Init()) {
+                warm.host.reset();
+                res.status = 500;
+                res.set_content("script init failed (see server log)\n", "text/plain");
+                return;
+            }
+        }
+        else {
+            warm.host->Restart(r.seed, r.job);
+        }
+
+        for (int i = 0; i < r.frames; ++i) {
+            warm.host->Tick(opt_.fixedDt);
+            if (!r.capture.empty()) {
+                Engine_::save_frame_png(true);
+                Engine_::next_frame();
+            }
+        }
+
+        if (!r.capture.empty()) {
+            Engine_::flush_captures();
+            Engine_::set_capture_filepath(kCaptureDir); // closes a stream / archive
+            res.set_content("{\"capture\":\"" + JsonEscape(r.capture) + "\",\"frames\":" + std::to_string(r.frames) + "}\n",
+                "application/json");
+        }
+        else {
+            std::vector<uint8_t> rgba, encoded;
+            Engine_::read_frame(rgba, true);
+            if (r.format == "rgba") {
+                res.set_content(reinterpret_cast<const char*>(rgba.data()), rgba.size(), "application/octet-stream");
+            }
+            else {
+                const Engine_::CaptureFormat format = r.format == "qoi" ? Engine_::CaptureFormat::Qoi
+                    : r.format == "fpng" ? Engine_::CaptureFormat::PngFast : Engine_::CaptureFormat::Png;
+                if (!Engine_::encode_frame(format, rgba.data(), r.w, r.h, encoded)) {
+                    res.status = 500;
+                    res.set_content("encode failed\n", "text/plain");
+                    return;
+                }
+                res.set_content(reinterpret_cast<const char*>(encoded.data()), encoded.size(),
+                    r.format == "qoi" ? "image/qoi" : "image/png");
+            }
+            res.set_header("X-Frame-Size", std::to_string(r.w) + "x" + std::to_string(r.h));
+        }
+
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::ostringstream timing;
+        timing << std::fixed << std::setprecision(2) << ms;
+        res.set_header("X-Render-Ms", timing.str());
+        std::cout << "[C++] render " << r.module << " " << r.w << "x" << r.h << " x" << r.frames
+            << (cold ? " (cold) " : " ") << timing.str() << " ms\n";
+    }
+
+private:
+    AppOptions opt_;
+    fs::path scriptsDir_;
+
+    std::mutex warmMutex_;
+    std::unordered_map<std::string, std::unique_ptr<WarmHost>> warm_;
+};
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "--extract")
+        return RunExtract(argc, argv);
+    if (argc > 1 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h")) {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+
+    AppOptions opt;
+    if (!ParseArgs(argc, argv, opt)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    // A "-.y4m" / "-.rgba" capture owns stdout: everything printed (std::cout,
+    // Lua print) goes to stderr so the stream stays readable by ffmpeg.
+    if (!opt.capture.empty() && fs::path(opt.capture).stem() == "-") {
+        if (!Engine_::reserve_stdout_for_streams()) {
+            std::cout.rdbuf(std::cerr.rdbuf());
+            std::cerr << "[C++] cannot move stdout; Lua print() may still reach the stream\n";
+        }
+    }
+
+    std::cout.setf(std::ios::unitbuf);
+    std::cout << "[C++] step_by_step (Lua-driven)\n";
+
+    fs::path scriptsDir = find_scripts_folder();
+    std::cout << "[C++] scriptsDir: " << scriptsDir << "\n";
+
+    if (!opt.batch.empty())
+        return RunBatch(opt, scriptsDir);
+    if (opt.servePort > 0) {
+        RenderServer server(opt, scriptsDir);
+        return server.Run(opt.servePort);
+    }
+
+    // -------------------------
+    // Engine init
+    // -------------------------
+    if (!Engine_::init(MakeEngineConfig(opt))) {
+        std::cerr << "Engine init failed.\n";
+        return 1;
+    }
+
+    ConfigureRenderState(opt, opt.capture.empty() ? "captures" : opt.capture);
+
+    // Optional live preview; frames are only read back while someone watches.
+    std::unique_ptr<Engine_::LiveStream> live;
+    if (opt.livePort > 0) {
+        live = std::make_unique<Engine_::LiveStream>();
+        if (live->start(opt.livePort)) {
+            Engine_::LiveStream* l = live.get();
+            Engine_::set_present_listener({
+                [l] { return l->wants_frame(); },
+                [l](const uint8_t* rgba, int w, int h) { l->offer(rgba, w, h); } });
+        }
+    }
 
     // -------------------------
     // Lua init
     // -------------------------
-    fs::path scriptsDir = find_scripts_folder();
-    std::cout << "[C++] scriptsDir: " << scriptsDir << "\n";
-    std::cout << "[C++] Console keys: F5=reload, F6=hard reset, F7=soft reset, "
-        "R=reload, T=hard reset, X=soft reset, H=toggle hot reload, Q=quit\n";
+    if (!opt.headless)
+        std::cout << "[C++] Console keys: F5=reload, F6=hard reset, F7=soft reset, F8=Lua profiler, "
+            "R=reload, T=hard reset, X=soft reset, P=Lua profiler, H=toggle hot reload, Q=quit\n";
 
     RuntimeAssets assets;
 
     LuaHost::Config lcfg;
     lcfg.scriptsDir = scriptsDir;
-    lcfg.entryModule = "main_lua_example_v1_4";
-    lcfg.hotReloadEnabled = true;
+    lcfg.entryModule = opt.entryModule;
+    lcfg.hotReloadEnabled = !opt.headless;
     lcfg.pollMs = 200;
+    lcfg.randomSeed = opt.seed;
+    lcfg.gcBudgetMs = opt.gcBudgetMs;
+    lcfg.profilePath = opt.luaProfile;
+    lcfg.bytecodeCache = opt.bytecodeCache;
 
     LuaHost host(lcfg, assets);
     if (!host.Init()) {
         return 1;
     }
 
-    auto last = std::chrono::steady_clock::now();
+    const auto runStart = std::chrono::steady_clock::now();
+    auto last = runStart;
     bool running = true;
 
+    // frame timing summary (offline runs)
+    int framesDone = 0;
+    double frameMsMin = 1e30, frameMsMax = 0.0, captureMs = 0.0;
+
     while (running)
     {
-        // dt
+        // dt: fixed step offline (reproducible), wall clock otherwise
         auto now = std::chrono::steady_clock::now();
         double dt = std::chrono::duration<double>(now - last).count();
         last = now;
         if (dt > 0.1) dt = 0.1;
+        if (opt.fixedDt > 0.0) dt = opt.fixedDt;
 
         // console hot-reload keys
-        switch (Lua_helpers::PollKey()) {
+        switch (opt.headless ? Lua_helpers::KeyAction::None : Lua_helpers::PollKey()) {
         case Lua_helpers::KeyAction::Quit: running = false; break;
         case Lua_helpers::KeyAction::ToggleHotReload: host.ToggleHotReload(); break;
         case Lua_helpers::KeyAction::ReloadNow: host.ReloadNow(); break;
@@ -802,15 +2196,48 @@ int main()
         case Lua_helpers::KeyAction::SoftReset:
             host.SoftReset();
             break;
+        case Lua_helpers::KeyAction::ToggleProfiler: host.ToggleProfiler(); break;
         default: break;
         }
 
         host.Tick(dt);
 
+        if (!opt.capture.empty()) {
+            const auto c0 = std::chrono::steady_clock::now();
+            Engine_::save_frame_png(true);
+            Engine_::next_frame();
+            captureMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - c0).count();
+        }
+
+        const double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - now).count();
+        frameMsMin = std::min(frameMsMin, frameMs);
+        frameMsMax = std::max(frameMsMax, frameMs);
+        ++framesDone;
+
         running = running && !Engine_::should_close();
+        if (opt.frames > 0 && framesDone >= opt.frames) running = false;
     }
 
     host.Shutdown();
+
+    const auto f0 = std::chrono::steady_clock::now();
+    Engine_::flush_captures();
+    const double flushMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - f0).count();
+    const double totalS = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+    if (opt.headless || opt.frames > 0) {
+        std::cout << std::fixed << std::setprecision(2)
+            << "[C++] " << framesDone << " frames in " << totalS << " s ("
+            << (totalS > 0.0 ? framesDone / totalS : 0.0) << " fps)\n"
+            << "[C++] frame ms: avg " << (framesDone ? (totalS * 1000.0 - flushMs) / framesDone : 0.0)
+            << ", min " << (framesDone ? frameMsMin : 0.0) << ", max " << frameMsMax << "\n";
+        if (!opt.capture.empty())
+            std::cout << "[C++] capture: " << captureMs << " ms submitting, " << flushMs << " ms final flush\n";
+    }
+
+    Engine_::set_present_listener({});
+    live.reset();
+
     Engine_::shutdown();
     return 0;
 }
@@ -17,7 +17,7 @@
 --   3           = triangle gallery layer
 --   4           = textured quads layer
 --   5           = 3D cube gallery layer
---   6           = pixel lab layer (set_pixel/get_pixel)
+--   6           = pixel lab layer (native pixel kernel + get_pixel probes)
 --   B           = bloom on/off
 --   T           = tone map on/off
 --   F           = present filter linear on/off
@@ -26,6 +26,7 @@
 --   R           = regenerate procedural baked textures
 --   SPACE       = pause / resume time
 --   S           = save current frame PNG
+--   C           = record each frame into a command buffer (gfx.commands) on/off
 --
 -- Notes:
 -- * This scene avoids assuming text rendering exists. "HUD" is visual only + console logs.
@@ -137,6 +138,8 @@ return function(ctx)
     state.bloom_threshold = state.bloom_threshold or 0.72
     state.bloom_intensity = state.bloom_intensity or 1.35
 
+    state.recordCommands = state.recordCommands or false
+
     state.toneOn = (state.toneOn == nil) and true or state.toneOn
     state.tone_exposure = state.tone_exposure or 1.15
     state.tone_gamma = state.tone_gamma or 2.2
@@ -148,7 +151,7 @@ return function(ctx)
     -- Pixel lab config (small region to keep per-pixel calls reasonable)
     state.pixel_lab = state.pixel_lab or {
       x = 24, y = 24, w = 160, h = 96,
-      step = 1,          -- set_pixel spacing; keep 1 for crispness
+      step = 1,          -- 1 = whole panel (pixel kernel, else one bulk write); >1 = sparse set_pixel
       update_every = 2,  -- update every N frames
     }
 
@@ -466,6 +469,16 @@ return function(ctx)
       bake_procedural_textures(state.texture_seed)
     end
 
+    -- Command buffer recording
+    if key_pressed_safe(Engine.KEY_C) then
+      if gfx.commands.available() then
+        state.recordCommands = not state.recordCommands
+        log_toggle("Record commands", state.recordCommands)
+      else
+        cpp_log("Command buffers are not available.")
+      end
+    end
+
     -- Save frame
     if key_pressed_safe(Engine.KEY_S) then
       gfx.frame.save_png(true)
@@ -652,6 +665,36 @@ return function(ctx)
     gfx.blend_alpha()
   end
 
+  -- The plasma of draw_pixel_lab as a pixel kernel: compiled once, evaluated in C++.
+  -- Same math as field() below (palette_neon inlined, rounded like C()).
+  local PLASMA_KERNEL = [[
+    wave = sin((u * 7.0 + t * 0.8) * tau) * 0.35
+         + sin((v * 5.0 - t * 1.1) * tau) * 0.30
+         + sin(((u + v) * 6.0 + t * 0.5) * tau) * 0.20
+         + (hash(x + seed * 13, y + seed * 29) - 0.5) * 0.15
+    n = fract(0.5 + 0.5 * wave + t * 0.03)
+    edge = smooth01(1.0 - abs(v * 2.0 - 1.0))
+    r = clamp(round((0.5 + 0.5 * sin(tau * (n + 0.00))) * 255) * (0.65 + edge * 0.5), 0, 255)
+    g = clamp(round((0.5 + 0.5 * sin(tau * (n + 0.33))) * 255) * (0.60 + edge * 0.6), 0, 255)
+    b = clamp(round((0.5 + 0.5 * sin(tau * (n + 0.67))) * 255) * (0.80 + edge * 0.4), 0, 255)
+  ]]
+
+  local plasma_kernel, plasma_kernel_failed = nil, false
+
+  local function get_plasma_kernel()
+    if plasma_kernel == nil and not plasma_kernel_failed then
+      local err = "gfx.kernel not available"
+      if gfx.kernel then
+        plasma_kernel, err = gfx.kernel.compile(PLASMA_KERNEL, { seed = 0 })
+      end
+      if plasma_kernel == nil then
+        plasma_kernel_failed = true
+        cpp_log("pixel lab: plasma stays in Lua (" .. tostring(err) .. ")")
+      end
+    end
+    return plasma_kernel
+  end
+
   local function draw_pixel_lab(W, H, t)
     if not state.showPixelLab then return end
 
@@ -664,29 +707,49 @@ return function(ctx)
     gfx.draw.rect(px - 4, py - 4, pw + 8, ph + 8, C(8, 10, 16, 220), true)
     draw_rect_outline(px - 4, py - 4, pw + 8, ph + 8, C(255, 255, 255, 70), 1)
 
+    -- Plasma-ish field color at panel pixel (x, y)
+    local function field(x, y)
+      local u = (pw > 1) and (x / (pw - 1)) or 0.0
+      local v = (ph > 1) and (y / (ph - 1)) or 0.0
+
+      local wave =
+          math.sin((u * 7.0 + t * 0.8) * TAU) * 0.35 +
+          math.sin((v * 5.0 - t * 1.1) * TAU) * 0.30 +
+          math.sin(((u + v) * 6.0 + t * 0.5) * TAU) * 0.20 +
+          (hash21(x + state.texture_seed * 13, y + state.texture_seed * 29) - 0.5) * 0.15
+
+      local n = 0.5 + 0.5 * wave
+      local p = palette_neon(fract(n + t * 0.03))
+      local edge = smooth01(1.0 - math.abs(v * 2.0 - 1.0))
+      p.r = clamp(p.r * (0.65 + edge * 0.5), 0, 255)
+      p.g = clamp(p.g * (0.60 + edge * 0.6), 0, 255)
+      p.b = clamp(p.b * (0.80 + edge * 0.4), 0, 255)
+      p.a = 255
+      return p
+    end
+
     -- update the pixel field only every N frames (performance-friendly)
     if (state.counter % update_every) == 0 then
-      for y = 0, ph - 1, step do
-        for x = 0, pw - 1, step do
-          local u = (pw > 1) and (x / (pw - 1)) or 0.0
-          local v = (ph > 1) and (y / (ph - 1)) or 0.0
-
-          -- Plasma-ish field
-          local wave =
-              math.sin((u * 7.0 + t * 0.8) * TAU) * 0.35 +
-              math.sin((v * 5.0 - t * 1.1) * TAU) * 0.30 +
-              math.sin(((u + v) * 6.0 + t * 0.5) * TAU) * 0.20 +
-              (hash21(x + state.texture_seed * 13, y + state.texture_seed * 29) - 0.5) * 0.15
-
-          local n = 0.5 + 0.5 * wave
-          local p = palette_neon(fract(n + t * 0.03))
-          local edge = smooth01(1.0 - math.abs(v * 2.0 - 1.0))
-          p.r = clamp(p.r * (0.65 + edge * 0.5), 0, 255)
-          p.g = clamp(p.g * (0.60 + edge * 0.6), 0, 255)
-          p.b = clamp(p.b * (0.80 + edge * 0.4), 0, 255)
-          p.a = 255
-
-          gfx.set_pixel(px + x, py + y, p)
+      local kernel = (step == 1) and get_plasma_kernel() or nil
+      if kernel then
+        kernel:set("seed", state.texture_seed)
+        gfx.kernel.run(kernel, px, py, pw, ph, t)
+      elseif step == 1 then
+        -- whole panel as one RGBA string, written in a single call
+        local bytes, n = {}, 0
+        for y = 0, ph - 1 do
+          for x = 0, pw - 1 do
+            local p = field(x, y)
+            n = n + 1
+            bytes[n] = gfx.pixels.rgba(p.r, p.g, p.b, p.a)
+          end
+        end
+        gfx.pixels.write(px, py, pw, ph, table.concat(bytes))
+      else
+        for y = 0, ph - 1, step do
+          for x = 0, pw - 1, step do
+            gfx.set_pixel(px + x, py + y, field(x, y))
+          end
         end
       end
     end
@@ -755,6 +818,12 @@ return function(ctx)
       { x =  0.80, y = -0.95, z = -0.40, s = 0.50, tex = texA, speed = 2.10 },
     }
 
+    -- Scratch Engine.Mat4s reused for every cube (nil without native matrices).
+    local VP  = gfx.mat4.new and gfx.mat4.new()
+    local mvp = VP and gfx.mat4.new()
+    local tmp = VP and gfx.mat4.new()
+    if VP ~= nil then VP:set_mul(P, V) end
+
     for i = 1, #cubes do
       local c = cubes[i]
       local tt = t * c.speed + i * 0.73
@@ -762,21 +831,31 @@ return function(ctx)
       -- We only have translate + rotate matrices in exposed API. If you later expose scale,
       -- this becomes even nicer. For now, different "sizes" can be faked by different z/y layout
       -- and the baked textures already create nice variation.
-      local T  = gfx.mat4.translate(gfx.v3(
-        c.x + math.sin(tt * 0.7) * 0.15,
-        c.y + math.cos(tt * 0.9) * 0.10,
-        c.z + math.sin(tt * 1.1) * 0.10
-      ))
-      local Rx = gfx.mat4.rotate_x(tt * 0.7)
-      local Ry = gfx.mat4.rotate_y(tt * 1.1)
-      local Rz = gfx.mat4.rotate_z(tt * 0.4)
+      local px = c.x + math.sin(tt * 0.7) * 0.15
+      local py = c.y + math.cos(tt * 0.9) * 0.10
+      local pz = c.z + math.sin(tt * 1.1) * 0.10
+
+      if mvp ~= nil then
+        -- MVP = P * V * T * Rz * Ry * Rx, built in place (no per-cube matrices).
+        mvp:set_rotate_x(tt * 0.7)
+        mvp:premul(tmp:set_rotate_y(tt * 1.1))
+        mvp:premul(tmp:set_rotate_z(tt * 0.4))
+        mvp:premul(tmp:set_translate(px, py, pz))
+        mvp:premul(VP)
+        gfx.mesh.draw_named("cube", mvp, c.tex, true)
+      else
+        local T  = gfx.mat4.translate(gfx.v3(px, py, pz))
+        local Rx = gfx.mat4.rotate_x(tt * 0.7)
+        local Ry = gfx.mat4.rotate_y(tt * 1.1)
+        local Rz = gfx.mat4.rotate_z(tt * 0.4)
 
-      local Rxy = gfx.mat4.mul(Ry, Rx)
-      local R   = gfx.mat4.mul(Rz, Rxy)
-      local M   = gfx.mat4.mul(T, R)
-      local MVP = gfx.mat4.mul(P, gfx.mat4.mul(V, M))
+        local Rxy = gfx.mat4.mul(Ry, Rx)
+        local R   = gfx.mat4.mul(Rz, Rxy)
+        local M   = gfx.mat4.mul(T, R)
+        local MVP = gfx.mat4.mul(P, gfx.mat4.mul(V, M))
 
-      gfx.mesh.draw_named("cube", MVP, c.tex, true)
+        gfx.mesh.draw_named("cube", MVP, c.tex, true)
+      end
     end
 
     -- Add a 2D "orbit ring" overlay to tie 2D+3D layers together
@@ -849,6 +928,13 @@ return function(ctx)
     state.t = state.t + dt -- raw wall-ish time accumulator (kept even when paused if you want)
     local t = state.paused and state.sim_t or state.sim_t
 
+    -- Recording: the frame below is appended to a native buffer and runs at submit
+    -- (the pixel lab's get_pixel probes run what is pending first).
+    local recording = state.recordCommands and gfx.commands.available()
+    if recording then
+      gfx.commands.begin()
+    end
+
     -- Begin frame
     local W, H = gfx.frame.begin(C(0, 0, 0, 255))
 
@@ -875,6 +961,10 @@ return function(ctx)
     draw_visual_hud(W, H, t)
 
     gfx.frame["end"](true)
+
+    if recording then
+      gfx.commands.submit()
+    end
   end
 
   ---------------------------------------------------------------------------
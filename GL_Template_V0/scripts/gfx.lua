@@ -2,9 +2,19 @@
 -- Extended safe wrapper layer over LuaEngine_ command bridge.
 -- Keeps current API compatible and adds input / PP / texture / mesh / matrix helpers.
 
-return function(cmd)
+return function(cmd, op_codes, command_buffer_type, direct, kernel_type, mat4_type)
     local gfx = {}
 
+    -- Integer opcodes skip the bridge's name lookup; without them ops stay strings.
+    local OP = op_codes or setmetatable({}, { __index = function(_, name) return name end })
+
+    -- Native command buffer the draw wrappers append to while recording (see gfx.commands).
+    local rec = nil
+
+    -- Flat-argument bindings (Engine.Direct): hot draw calls skip the command table and
+    -- the nested color / vec2 tables. Without them everything goes through cmd.
+    local D = direct
+
     print("gfx init (extended)")
 
     -- ============================================================
@@ -47,12 +57,21 @@ return function(cmd)
         return v
     end
 
+    -- Engine.Mat4 userdata or a 16-number table (the bridge checks the shape).
+    local function expect_mat4(v, name, level)
+        if type(v) ~= "table" and type(v) ~= "userdata" then
+            error((name or "value") .. " must be a Mat4 or a table", level or 2)
+        end
+        return v
+    end
+
     local function iround(v, name, level)
         v = expect_number(v, name, (level or 2) + 1)
         return math.floor(v + 0.5)
     end
 
-    local function safe_color(color, level)
+    -- Validated components without building a table (for the command buffer).
+    local function safe_color_parts(color, level)
         expect_table(color, "color", (level or 2) + 1)
 
         local r = (color.r == nil) and 255 or expect_number(color.r, "color.r", (level or 2) + 1)
@@ -65,27 +84,48 @@ return function(cmd)
         b = clamp_0_255(math.floor(b + 0.5))
         a = clamp_0_255(math.floor(a + 0.5))
 
+        return r, g, b, a
+    end
+
+    local function safe_color(color, level)
+        local r, g, b, a = safe_color_parts(color, (level or 2) + 1)
         return { r = r, g = g, b = b, a = a }
     end
 
-    local function safe_vec2(v, name, level)
+    local function safe_vec2_parts(v, name, level)
         expect_table(v, name or "vec2", (level or 2) + 1)
         local x = expect_number(v.x, (name or "vec2") .. ".x", (level or 2) + 1)
         local y = expect_number(v.y, (name or "vec2") .. ".y", (level or 2) + 1)
+        return x, y
+    end
+
+    local function safe_vec2(v, name, level)
+        local x, y = safe_vec2_parts(v, name, (level or 2) + 1)
         return { x = x, y = y }
     end
 
-    local function safe_vec3(v, name, level)
-        expect_table(v, name or "vec3", (level or 2) + 1)
+    -- Accepts a {x, y, z} table or an Engine.Vec3.
+    local function safe_vec3_parts(v, name, level)
+        if type(v) ~= "userdata" then expect_table(v, name or "vec3", (level or 2) + 1) end
         local x = expect_number(v.x, (name or "vec3") .. ".x", (level or 2) + 1)
         local y = expect_number(v.y, (name or "vec3") .. ".y", (level or 2) + 1)
         local z = expect_number(v.z, (name or "vec3") .. ".z", (level or 2) + 1)
+        return x, y, z
+    end
+
+    local function safe_vec3(v, name, level)
+        local x, y, z = safe_vec3_parts(v, name, (level or 2) + 1)
         return { x = x, y = y, z = z }
     end
 
+    -- Run what has been recorded so far (queries that read the framebuffer need it).
+    local function flush_recorded()
+        if rec ~= nil then rec:submit() end
+    end
+
     local function make_cmd(op, ...)
         expect_string(op, "op", 3)
-        local t = { op }
+        local t = { OP[op] or op }
         local n = select("#", ...)
         for i = 1, n do
             t[#t + 1] = select(i, ...)
@@ -98,8 +138,11 @@ return function(cmd)
     -- ============================================================
 
     -- Raw passthrough with varargs: gfx.raw("draw_line", x0,y0,x1,y1,color,thickness)
+    -- Not recordable: runs what is pending first so it keeps its place in the frame.
     function gfx.raw(op, ...)
-        return cmd(make_cmd(op, ...))
+        local t = make_cmd(op, ...)
+        flush_recorded()
+        return cmd(t)
     end
 
     -- Alias some people like:
@@ -131,20 +174,20 @@ return function(cmd)
     -- ============================================================
 
     function gfx.poll_events()
-        return cmd({"poll_events"})
+        return cmd({OP.poll_events})
     end
 
     function gfx.key_pressed(keycode)
         keycode = expect_number(keycode, "keycode", 2)
-        return cmd({"key_pressed", keycode})
+        return cmd({OP.key_pressed, keycode})
     end
 
     function gfx.mouse_x()
-        return cmd({"mouse_x"})
+        return cmd({OP.mouse_x})
     end
 
     function gfx.mouse_y()
-        return cmd({"mouse_y"})
+        return cmd({OP.mouse_y})
     end
 
     function gfx.mouse_pos()
@@ -156,19 +199,19 @@ return function(cmd)
     end
 
     function gfx.mouse_prev_x()
-        return cmd({"mouse_prev_x"})
+        return cmd({OP.mouse_prev_x})
     end
 
     function gfx.mouse_prev_y()
-        return cmd({"mouse_prev_y"})
+        return cmd({OP.mouse_prev_y})
     end
 
     function gfx.mouse_dx()
-        return cmd({"mouse_dx"})
+        return cmd({OP.mouse_dx})
     end
 
     function gfx.mouse_dy()
-        return cmd({"mouse_dy"})
+        return cmd({OP.mouse_dy})
     end
 
     function gfx.mouse_delta()
@@ -176,30 +219,30 @@ return function(cmd)
     end
 
     function gfx.mouse_moved()
-        return cmd({"mouse_moved"})
+        return cmd({OP.mouse_moved})
     end
 
     function gfx.mouse_down(button)
         button = expect_number(button, "button", 2)
-        return cmd({"mouse_down", button})
+        return cmd({OP.mouse_down, button})
     end
 
     function gfx.mouse_pressed(button)
         button = expect_number(button, "button", 2)
-        return cmd({"mouse_pressed", button})
+        return cmd({OP.mouse_pressed, button})
     end
 
     function gfx.mouse_released(button)
         button = expect_number(button, "button", 2)
-        return cmd({"mouse_released", button})
+        return cmd({OP.mouse_released, button})
     end
 
     function gfx.mouse_scroll_x()
-        return cmd({"mouse_scroll_x"})
+        return cmd({OP.mouse_scroll_x})
     end
 
     function gfx.mouse_scroll_y()
-        return cmd({"mouse_scroll_y"})
+        return cmd({OP.mouse_scroll_y})
     end
 
     function gfx.mouse_scroll()
@@ -207,35 +250,35 @@ return function(cmd)
     end
 
     function gfx.mouse_scrolled()
-        return cmd({"mouse_scrolled"})
+        return cmd({OP.mouse_scrolled})
     end
 
     function gfx.mouse_in_window()
-        return cmd({"mouse_in_window"})
+        return cmd({OP.mouse_in_window})
     end
 
     function gfx.mouse_entered()
-        return cmd({"mouse_entered"})
+        return cmd({OP.mouse_entered})
     end
 
     function gfx.mouse_left()
-        return cmd({"mouse_left"})
+        return cmd({OP.mouse_left})
     end
 
     function gfx.mouse_fb_x()
-        return cmd({"mouse_fb_x"})
+        return cmd({OP.mouse_fb_x})
     end
 
     function gfx.mouse_fb_y()
-        return cmd({"mouse_fb_y"})
+        return cmd({OP.mouse_fb_y})
     end
 
     function gfx.mouse_fb_ix()
-        return cmd({"mouse_fb_ix"})
+        return cmd({OP.mouse_fb_ix})
     end
 
     function gfx.mouse_fb_iy()
-        return cmd({"mouse_fb_iy"})
+        return cmd({OP.mouse_fb_iy})
     end
 
     function gfx.mouse_fb_pos()
@@ -356,42 +399,42 @@ return function(cmd)
 
     function gfx.set_cursor_visible(visible)
         visible = expect_bool(visible, "visible", 2)
-        return cmd({"set_cursor_visible", visible})
+        return cmd({OP.set_cursor_visible, visible})
     end
 
     function gfx.cursor_visible()
-        return cmd({"cursor_visible"})
+        return cmd({OP.cursor_visible})
     end
 
     function gfx.set_cursor_captured(captured)
         captured = expect_bool(captured, "captured", 2)
-        return cmd({"set_cursor_captured", captured})
+        return cmd({OP.set_cursor_captured, captured})
     end
 
     function gfx.cursor_captured()
-        return cmd({"cursor_captured"})
+        return cmd({OP.cursor_captured})
     end
 
     function gfx.request_close()
-        return cmd({"request_close"})
+        return cmd({OP.request_close})
     end
 
     function gfx.fb_width()
-        return cmd({"fb_width"})
+        return cmd({OP.fb_width})
     end
 
     function gfx.fb_height()
-        return cmd({"fb_height"})
+        return cmd({OP.fb_height})
     end
 
     function gfx.fb_size()
-        local W = cmd({"fb_width"})
-        local H = cmd({"fb_height"})
+        local W = cmd({OP.fb_width})
+        local H = cmd({OP.fb_height})
         return W, H
     end
 
     function gfx.time_seconds()
-        return cmd({"time_seconds"})
+        return cmd({OP.time_seconds})
     end
 
     -- ============================================================
@@ -399,36 +442,66 @@ return function(cmd)
     -- ============================================================
 
     function gfx.clear(color)
-        cmd({"clear_color", safe_color(color, 2)})
+        if rec ~= nil then
+            rec:clear_color(safe_color_parts(color, 2))
+        elseif D ~= nil then
+            D.clear_color(safe_color_parts(color, 2))
+        else
+            cmd({OP.clear_color, safe_color(color, 2)})
+        end
     end
 
     function gfx.clear_depth(z)
         z = expect_number(z, "z", 2)
-        cmd({"clear_depth", z})
+        if rec ~= nil then
+            rec:clear_depth(z)
+            return
+        end
+        cmd({OP.clear_depth, z})
     end
 
     function gfx.set_blend_mode(mode)
         mode = expect_string(mode, "mode", 2)
-        cmd({"set_blend_mode", mode})
+        if rec ~= nil then
+            rec:set_blend_mode(mode)
+            return
+        end
+        cmd({OP.set_blend_mode, mode})
     end
 
     function gfx.blend_alpha()
-        cmd({"set_blend_mode", "Alpha"})
+        if rec ~= nil then
+            rec:set_blend_mode("Alpha")
+            return
+        end
+        cmd({OP.set_blend_mode, "Alpha"})
     end
 
     function gfx.blend_additive()
-        cmd({"set_blend_mode", "Additive"})
+        if rec ~= nil then
+            rec:set_blend_mode("Additive")
+            return
+        end
+        cmd({OP.set_blend_mode, "Additive"})
     end
 
     function gfx.set_present_filter_linear(enabled)
         enabled = expect_bool(enabled, "enabled", 2)
-        cmd({"set_present_filter_linear", enabled})
+        if rec ~= nil then
+            rec:set_present_filter_linear(enabled)
+            return
+        end
+        cmd({OP.set_present_filter_linear, enabled})
     end
 
     function gfx.present(vsync)
         if vsync == nil then vsync = true end
         vsync = expect_bool(vsync, "vsync", 2)
-        cmd({"flush_to_screen", vsync})
+        if rec ~= nil then
+            rec:flush_to_screen(vsync)
+            return
+        end
+        cmd({OP.flush_to_screen, vsync})
     end
 
     function gfx.begin_frame(clearColor)
@@ -444,13 +517,41 @@ return function(cmd)
     end
 
     function gfx.next_frame()
-        return cmd({"next_frame"})
+        if rec ~= nil then
+            rec:next_frame()
+            return
+        end
+        return cmd({OP.next_frame})
+    end
+
+    -- Directory, "name.png" / "name.fpng" / "name.qoi" hint, or a stream:
+    -- "out.y4m" / "out.rgba" appends every saved frame to one file ("-.y4m" = stdout).
+    function gfx.set_capture_path(filepath)
+        filepath = expect_string(filepath, "filepath", 2)
+        if rec ~= nil then
+            rec:set_capture_filepath(filepath)
+            return
+        end
+        return cmd({OP.set_capture_filepath, filepath})
+    end
+
+    function gfx.set_capture_fps(fps)
+        fps = expect_number(fps, "fps", 2)
+        if rec ~= nil then
+            rec:set_capture_fps(math.floor(fps))
+            return
+        end
+        return cmd({OP.set_capture_fps, math.floor(fps)})
     end
 
     function gfx.save_frame_png(include_alpha)
         if include_alpha == nil then include_alpha = true end
         include_alpha = expect_bool(include_alpha, "include_alpha", 2)
-        return cmd({"save_frame_png", include_alpha})
+        if rec ~= nil then
+            rec:save_frame_png(include_alpha)
+            return
+        end
+        return cmd({OP.save_frame_png, include_alpha})
     end
 
     -- ============================================================
@@ -458,7 +559,7 @@ return function(cmd)
     -- ============================================================
 
     function gfx.line(x0, y0, x1, y1, color, thickness)
-        local c = safe_color(color, 2)
+        local r, g, b, a = safe_color_parts(color, 2)
 
         local ix0 = iround(x0, "x0", 2)
         local iy0 = iround(y0, "y0", 2)
@@ -468,11 +569,17 @@ return function(cmd)
         thickness = (thickness == nil) and 2 or expect_number(thickness, "thickness", 2)
         thickness = math.max(1, iround(thickness, "thickness", 2))
 
-        cmd({"draw_line", ix0, iy0, ix1, iy1, c, thickness})
+        if rec ~= nil then
+            rec:draw_line(ix0, iy0, ix1, iy1, r, g, b, a, thickness)
+        elseif D ~= nil then
+            D.draw_line(ix0, iy0, ix1, iy1, r, g, b, a, thickness)
+        else
+            cmd({OP.draw_line, ix0, iy0, ix1, iy1, { r = r, g = g, b = b, a = a }, thickness})
+        end
     end
 
     function gfx.rect(x, y, w, h, color, filled, thickness)
-        local c = safe_color(color, 2)
+        local r, g, b, a = safe_color_parts(color, 2)
 
         local ix = iround(x, "x", 2)
         local iy = iround(y, "y", 2)
@@ -483,36 +590,61 @@ return function(cmd)
         filled = expect_bool(filled, "filled", 2)
 
         if filled then
-            cmd({"draw_rect", ix, iy, iw, ih, c, true})
+            thickness = 1
         else
             thickness = (thickness == nil) and 1 or expect_number(thickness, "thickness", 2)
             thickness = math.max(1, iround(thickness, "thickness", 2))
-            cmd({"draw_rect", ix, iy, iw, ih, c, false, thickness})
+        end
+
+        if rec ~= nil then
+            rec:draw_rect(ix, iy, iw, ih, r, g, b, a, filled, thickness)
+        elseif D ~= nil then
+            D.draw_rect(ix, iy, iw, ih, r, g, b, a, filled, thickness)
+        else
+            cmd({OP.draw_rect, ix, iy, iw, ih, { r = r, g = g, b = b, a = a }, filled, thickness})
         end
     end
 
-    function gfx.circle(cx, cy, r, color, filled, thickness)
-        local c = safe_color(color, 2)
+    function gfx.circle(cx, cy, radius, color, filled, thickness)
+        local r, g, b, a = safe_color_parts(color, 2)
 
         local icx = iround(cx, "cx", 2)
         local icy = iround(cy, "cy", 2)
-        local ir  = math.max(0, iround(r, "r", 2))
+        local ir  = math.max(0, iround(radius, "r", 2))
 
         if filled == nil then filled = true end
         filled = expect_bool(filled, "filled", 2)
 
         if filled then
-            cmd({"draw_circle", icx, icy, ir, c, true})
+            thickness = 1
         else
             thickness = (thickness == nil) and 1 or expect_number(thickness, "thickness", 2)
             thickness = math.max(1, iround(thickness, "thickness", 2))
-            cmd({"draw_circle", icx, icy, ir, c, false, thickness})
+        end
+
+        if rec ~= nil then
+            rec:draw_circle(icx, icy, ir, r, g, b, a, filled, thickness)
+        elseif D ~= nil then
+            D.draw_circle(icx, icy, ir, r, g, b, a, filled, thickness)
+        else
+            cmd({OP.draw_circle, icx, icy, ir, { r = r, g = g, b = b, a = a }, filled, thickness})
         end
     end
 
     function gfx.tri_filled(v0, v1, v2, color)
+        if rec ~= nil or D ~= nil then
+            local x0, y0 = safe_vec2_parts(v0, "v0", 2)
+            local x1, y1 = safe_vec2_parts(v1, "v1", 2)
+            local x2, y2 = safe_vec2_parts(v2, "v2", 2)
+            if rec ~= nil then
+                rec:draw_triangle_filled(x0, y0, x1, y1, x2, y2, safe_color_parts(color, 2))
+            else
+                D.draw_triangle_filled(x0, y0, x1, y1, x2, y2, safe_color_parts(color, 2))
+            end
+            return
+        end
         cmd({
-            "draw_triangle_filled",
+            OP.draw_triangle_filled,
             safe_vec2(v0, "v0", 2),
             safe_vec2(v1, "v1", 2),
             safe_vec2(v2, "v2", 2),
@@ -521,8 +653,22 @@ return function(cmd)
     end
 
     function gfx.tri_grad(v0, c0, v1, c1, v2, c2)
+        if rec ~= nil or D ~= nil then
+            local x0, y0 = safe_vec2_parts(v0, "v0", 2)
+            local r0, g0, b0, a0 = safe_color_parts(c0, 2)
+            local x1, y1 = safe_vec2_parts(v1, "v1", 2)
+            local r1, g1, b1, a1 = safe_color_parts(c1, 2)
+            local x2, y2 = safe_vec2_parts(v2, "v2", 2)
+            local r2, g2, b2, a2 = safe_color_parts(c2, 2)
+            if rec ~= nil then
+                rec:draw_triangle_filled_grad(x0, y0, r0, g0, b0, a0, x1, y1, r1, g1, b1, a1, x2, y2, r2, g2, b2, a2)
+            else
+                D.draw_triangle_filled_grad(x0, y0, r0, g0, b0, a0, x1, y1, r1, g1, b1, a1, x2, y2, r2, g2, b2, a2)
+            end
+            return
+        end
         cmd({
-            "draw_triangle_filled_grad",
+            OP.draw_triangle_filled_grad,
             safe_vec2(v0, "v0", 2), safe_color(c0, 2),
             safe_vec2(v1, "v1", 2), safe_color(c1, 2),
             safe_vec2(v2, "v2", 2), safe_color(c2, 2)
@@ -533,8 +679,25 @@ return function(cmd)
         tex_name = expect_string(tex_name, "tex_name", 2)
         if tint == nil then tint = gfx.color(255, 255, 255, 255) end
 
+        if rec ~= nil or D ~= nil then
+            local x0, y0 = safe_vec2_parts(v0, "v0", 2)
+            local u0, w0 = safe_vec2_parts(uv0, "uv0", 2)
+            local x1, y1 = safe_vec2_parts(v1, "v1", 2)
+            local u1, w1 = safe_vec2_parts(uv1, "uv1", 2)
+            local x2, y2 = safe_vec2_parts(v2, "v2", 2)
+            local u2, w2 = safe_vec2_parts(uv2, "uv2", 2)
+            if rec ~= nil then
+                rec:draw_triangle_textured_named(x0, y0, u0, w0, x1, y1, u1, w1, x2, y2, u2, w2,
+                    tex_name, safe_color_parts(tint, 2))
+            else
+                D.draw_triangle_textured_named(x0, y0, u0, w0, x1, y1, u1, w1, x2, y2, u2, w2,
+                    tex_name, safe_color_parts(tint, 2))
+            end
+            return
+        end
+
         cmd({
-            "draw_triangle_textured_named",
+            OP.draw_triangle_textured_named,
             safe_vec2(v0, "v0", 2), safe_vec2(uv0, "uv0", 2),
             safe_vec2(v1, "v1", 2), safe_vec2(uv1, "uv1", 2),
             safe_vec2(v2, "v2", 2), safe_vec2(uv2, "uv2", 2),
@@ -554,14 +717,46 @@ return function(cmd)
         blur_passes = (blur_passes == nil) and 4 or expect_number(blur_passes, "blur_passes", 2)
         radius = (radius == nil) and 6.0 or expect_number(radius, "radius", 2)
 
-        cmd({"pp_set_bloom", enabled, threshold, intensity, blur_passes, radius})
+        if rec ~= nil then
+            rec:pp_set_bloom(enabled, threshold, intensity, blur_passes, radius)
+            return
+        end
+        cmd({OP.pp_set_bloom, enabled, threshold, intensity, blur_passes, radius})
     end
 
     function gfx.pp_set_tone(enabled, exposure, gamma)
         enabled = expect_bool(enabled, "enabled", 2)
         exposure = expect_number(exposure, "exposure", 2)
         gamma = expect_number(gamma, "gamma", 2)
-        cmd({"pp_set_tone", enabled, exposure, gamma})
+        if rec ~= nil then
+            rec:pp_set_tone(enabled, exposure, gamma)
+            return
+        end
+        cmd({OP.pp_set_tone, enabled, exposure, gamma})
+    end
+
+    -- lut_path: .cube file, or a graded HALD / strip identity image. Returns false if it failed to load.
+    -- interp: "tetrahedral" (default) or "trilinear".
+    function gfx.pp_set_grade(enabled, lut_path, strength, interp)
+        enabled = expect_bool(enabled, "enabled", 2)
+        lut_path = (lut_path == nil) and "" or expect_string(lut_path, "lut_path", 2)
+        strength = (strength == nil) and 1.0 or expect_number(strength, "strength", 2)
+        interp = (interp == nil) and "tetrahedral" or expect_string(interp, "interp", 2)
+        flush_recorded()
+        return cmd({OP.pp_set_grade, enabled, lut_path, strength, interp})
+    end
+
+    -- FXAA-style edge anti-aliasing on the final image.
+    function gfx.pp_set_aa(enabled, edge_threshold, edge_threshold_min, subpixel)
+        enabled = expect_bool(enabled, "enabled", 2)
+        edge_threshold = (edge_threshold == nil) and 0.125 or expect_number(edge_threshold, "edge_threshold", 2)
+        edge_threshold_min = (edge_threshold_min == nil) and 0.0312 or expect_number(edge_threshold_min, "edge_threshold_min", 2)
+        subpixel = (subpixel == nil) and 0.75 or expect_number(subpixel, "subpixel", 2)
+        if rec ~= nil then
+            rec:pp_set_aa(enabled, edge_threshold, edge_threshold_min, subpixel)
+            return
+        end
+        cmd({OP.pp_set_aa, enabled, edge_threshold, edge_threshold_min, subpixel})
     end
 
     -- ============================================================
@@ -570,7 +765,7 @@ return function(cmd)
 
     function gfx.tex_exists(name)
         name = expect_string(name, "name", 2)
-        return cmd({"tex_exists", name})
+        return cmd({OP.tex_exists, name})
     end
 
     function gfx.tex_make_checker(name, w, h, cell)
@@ -578,67 +773,88 @@ return function(cmd)
         w = math.max(1, iround(w, "w", 2))
         h = math.max(1, iround(h, "h", 2))
         cell = math.max(1, iround(cell, "cell", 2))
-        return cmd({"tex_make_checker", name, w, h, cell})
+        flush_recorded()
+        return cmd({OP.tex_make_checker, name, w, h, cell})
     end
 
     function gfx.tex_from_framebuffer(name)
         name = expect_string(name, "name", 2)
-        return cmd({"tex_from_framebuffer", name})
+        flush_recorded()
+        return cmd({OP.tex_from_framebuffer, name})
     end
 
     function gfx.mesh_exists(name)
         name = expect_string(name, "name", 2)
-        return cmd({"mesh_exists", name})
+        return cmd({OP.mesh_exists, name})
     end
 
     function gfx.mesh_make_cube(name, size)
         name = expect_string(name, "name", 2)
         size = expect_number(size, "size", 2)
-        return cmd({"mesh_make_cube", name, size})
+        flush_recorded()
+        return cmd({OP.mesh_make_cube, name, size})
     end
 
     function gfx.draw_mesh_named(mesh_name, mvp, tex_name, depth_test)
         mesh_name = expect_string(mesh_name, "mesh_name", 2)
-        expect_table(mvp, "mvp", 2) -- matrix shape validated by engine/bridge
+        expect_mat4(mvp, "mvp", 2) -- matrix shape validated by engine/bridge
         tex_name = expect_string(tex_name, "tex_name", 2)
         if depth_test == nil then depth_test = true end
         depth_test = expect_bool(depth_test, "depth_test", 2)
 
-        return cmd({"draw_mesh_named", mesh_name, mvp, tex_name, depth_test})
+        if rec ~= nil then
+            rec:draw_mesh_named(mesh_name, mvp, tex_name, depth_test)
+            return
+        end
+        return cmd({OP.draw_mesh_named, mesh_name, mvp, tex_name, depth_test})
     end
 
     -- ============================================================
     -- Matrix / camera wrappers (3D)
     -- ============================================================
 
+    -- With Engine.Direct the results are Engine.Mat4 userdata instead of 16-slot
+    -- tables; both kinds are accepted wherever a matrix is expected.
+
     function gfx.mat4_mul(a, b)
-        expect_table(a, "a", 2)
-        expect_table(b, "b", 2)
-        return cmd({"mat4_mul", a, b})
+        expect_mat4(a, "a", 2)
+        expect_mat4(b, "b", 2)
+        if D ~= nil then return D.mat4_mul(a, b) end
+        return cmd({OP.mat4_mul, a, b})
     end
 
     function gfx.mat4_translate(v3)
-        return cmd({"mat4_translate", safe_vec3(v3, "v3", 2)})
+        if D ~= nil then return D.mat4_translate(safe_vec3_parts(v3, "v3", 2)) end
+        return cmd({OP.mat4_translate, safe_vec3(v3, "v3", 2)})
     end
 
     function gfx.mat4_rotate_x(rad)
         rad = expect_number(rad, "rad", 2)
-        return cmd({"mat4_rotate_x", rad})
+        if D ~= nil then return D.mat4_rotate_x(rad) end
+        return cmd({OP.mat4_rotate_x, rad})
     end
 
     function gfx.mat4_rotate_y(rad)
         rad = expect_number(rad, "rad", 2)
-        return cmd({"mat4_rotate_y", rad})
+        if D ~= nil then return D.mat4_rotate_y(rad) end
+        return cmd({OP.mat4_rotate_y, rad})
     end
 
     function gfx.mat4_rotate_z(rad)
         rad = expect_number(rad, "rad", 2)
-        return cmd({"mat4_rotate_z", rad})
+        if D ~= nil then return D.mat4_rotate_z(rad) end
+        return cmd({OP.mat4_rotate_z, rad})
     end
 
     function gfx.mat4_look_at(eye, target, up)
+        if D ~= nil then
+            local ex, ey, ez = safe_vec3_parts(eye, "eye", 2)
+            local tx, ty, tz = safe_vec3_parts(target, "target", 2)
+            local ux, uy, uz = safe_vec3_parts(up, "up", 2)
+            return D.mat4_look_at(ex, ey, ez, tx, ty, tz, ux, uy, uz)
+        end
         return cmd({
-            "mat4_look_at",
+            OP.mat4_look_at,
             safe_vec3(eye, "eye", 2),
             safe_vec3(target, "target", 2),
             safe_vec3(up, "up", 2)
@@ -650,36 +866,175 @@ return function(cmd)
         aspect   = expect_number(aspect, "aspect", 2)
         znear    = expect_number(znear, "znear", 2)
         zfar     = expect_number(zfar, "zfar", 2)
-        return cmd({"mat4_perspective", fovy_rad, aspect, znear, zfar})
+        if D ~= nil then return D.mat4_perspective(fovy_rad, aspect, znear, zfar) end
+        return cmd({OP.mat4_perspective, fovy_rad, aspect, znear, zfar})
+    end
+
+    -- Scratch matrix for in-place chains (m:set_rotate_y(r):premul(v):premul(p)), so a
+    -- per-object MVP allocates nothing. nil when Engine.Mat4 is not available.
+    function gfx.mat4_new(values)
+        if mat4_type == nil then return nil end
+        if values ~= nil then expect_table(values, "values", 2) end
+        return mat4_type.new(values)
     end
 
     -- Single-pixel write (validated wrapper)
     function gfx.set_pixel(x, y, color)
         local ix = iround(x, "x", 2)
         local iy = iround(y, "y", 2)
-        local c  = safe_color(color, 2)
-        cmd({"set_pixel", ix, iy, c})
+        if rec ~= nil then
+            rec:set_pixel(ix, iy, safe_color_parts(color, 2))
+        elseif D ~= nil then
+            D.set_pixel(ix, iy, safe_color_parts(color, 2))
+        else
+            cmd({OP.set_pixel, ix, iy, safe_color(color, 2)})
+        end
     end
 
     -- Single-pixel read (returns {r,g,b,a})
     function gfx.get_pixel(x, y)
         local ix = iround(x, "x", 2)
         local iy = iround(y, "y", 2)
-        return cmd({"get_pixel", ix, iy})
+        flush_recorded()
+        if D ~= nil then
+            local r, g, b, a = D.get_pixel(ix, iy)
+            return { r = r, g = g, b = b, a = a }
+        end
+        return cmd({OP.get_pixel, ix, iy})
     end
 
     -- Nice short aliases (optional)
     gfx.pset = gfx.set_pixel
     gfx.pget = gfx.get_pixel
 
+    -- ============================================================
+    -- Bulk pixels (one call per rectangle instead of one per pixel)
+    -- ============================================================
+
+    local function bulk_fn(name)
+        local f = D and D[name]
+        if f == nil then
+            error("gfx." .. name .. " needs Engine.Direct", 3)
+        end
+        return f
+    end
+
+    -- One pixel as a 4-byte RGBA string (rounded and clamped like set_pixel).
+    function gfx.rgba_bytes(r, g, b, a)
+        return string.char(
+            clamp_0_255(math.floor(expect_number(r, "r", 2) + 0.5)),
+            clamp_0_255(math.floor(expect_number(g, "g", 2) + 0.5)),
+            clamp_0_255(math.floor(expect_number(b, "b", 2) + 0.5)),
+            clamp_0_255(math.floor((a == nil and 255 or expect_number(a, "a", 2)) + 0.5)))
+    end
+
+    -- rgba: w*h*4 bytes (string, or u8 / u32 Engine.TypedArray), rows top to bottom.
+    -- Blends and clips like set_pixel.
+    function gfx.write_pixels(x, y, w, h, rgba)
+        local ix, iy = iround(x, "x", 2), iround(y, "y", 2)
+        local iw, ih = iround(w, "w", 2), iround(h, "h", 2)
+        if type(rgba) ~= "string" and type(rgba) ~= "userdata" then
+            error("rgba must be a string or a TypedArray", 2)
+        end
+        local f = bulk_fn("write_pixels")
+        flush_recorded()
+        f(ix, iy, iw, ih, rgba)
+    end
+
+    -- Returns w*h*4 RGBA bytes (pixels outside the framebuffer read as 0), or fills and
+    -- returns `out` (u8 / u32 TypedArray) when given.
+    function gfx.read_pixels(x, y, w, h, out)
+        local ix, iy = iround(x, "x", 2), iround(y, "y", 2)
+        local iw, ih = iround(w, "w", 2), iround(h, "h", 2)
+        local f = bulk_fn("read_pixels")
+        flush_recorded()
+        return f(ix, iy, iw, ih, out)
+    end
+
+    -- values: w*h numbers in [0..1] (row-major; table or TypedArray), each picks the
+    -- nearest palette entry. palette: list of colors, or RGBA bytes (string / TypedArray).
+    function gfx.write_pixels_palette(x, y, w, h, values, palette)
+        local ix, iy = iround(x, "x", 2), iround(y, "y", 2)
+        local iw, ih = iround(w, "w", 2), iround(h, "h", 2)
+        if type(values) ~= "userdata" then expect_table(values, "values", 2) end
+        if type(palette) ~= "string" and type(palette) ~= "userdata" then expect_table(palette, "palette", 2) end
+        local f = bulk_fn("write_pixels_palette")
+        flush_recorded()
+        f(ix, iy, iw, ih, values, palette)
+    end
+
+    -- ============================================================
+    -- Pixel kernels (per-pixel expressions evaluated natively, Engine.Kernel)
+    -- ============================================================
+
+    -- Compile once and keep the kernel; the source syntax is described in PixelKernel.h.
+    -- params: { name = number } readable in the expression, changed with k:set(name, v).
+    -- Returns the kernel, or nil and an error message.
+    function gfx.compile_kernel(src, params)
+        src = expect_string(src, "src", 2)
+        if params ~= nil then expect_table(params, "params", 2) end
+        if kernel_type == nil then
+            return nil, "pixel kernels are not available (no Engine.Kernel)"
+        end
+        return kernel_type.compile(src, params)
+    end
+
+    -- Evaluates k over the rectangle (x, y inside it start at 0) and writes the result
+    -- like gfx.write_pixels.
+    function gfx.run_kernel(k, x, y, w, h, t)
+        if type(k) ~= "userdata" then error("kernel expected", 2) end
+        local ix, iy = iround(x, "x", 2), iround(y, "y", 2)
+        local iw, ih = iround(w, "w", 2), iround(h, "h", 2)
+        flush_recorded()
+        k:run(ix, iy, iw, ih, t == nil and 0 or expect_number(t, "t", 2))
+    end
+
     function gfx.key_down(keycode)
         keycode = expect_number(keycode, "keycode", 2)
-        return cmd({"key_down", keycode})
+        return cmd({OP.key_down, keycode})
     end
 
     function gfx.key_released(keycode)
         keycode = expect_number(keycode, "keycode", 2)
-        return cmd({"key_released", keycode})
+        return cmd({OP.key_released, keycode})
+    end
+
+    -- ============================================================
+    -- Command buffer
+    -- ============================================================
+
+    -- Between commands_begin() and commands_submit() the draw / frame / pp wrappers
+    -- append to a native buffer (flat args, no per-call tables) instead of crossing the
+    -- bridge; submit runs the whole frame in one C++ call, in recorded order.
+    -- Ops with a result (get_pixel, tex_from_framebuffer, pp_set_grade, tex/mesh creation,
+    -- gfx.raw) run what is pending first, so they still happen in call order.
+    local default_buffer = nil
+
+    function gfx.commands_begin(buf)
+        if buf == nil then
+            if command_buffer_type == nil then
+                error("command buffers are not available (no Engine.CommandBuffer)", 2)
+            end
+            default_buffer = default_buffer or command_buffer_type.new()
+            buf = default_buffer
+        end
+        buf:clear()
+        rec = buf
+        return buf
+    end
+
+    function gfx.commands_submit()
+        local buf = rec
+        rec = nil
+        if buf ~= nil then buf:submit() end
+    end
+
+    function gfx.commands_recording()
+        return rec ~= nil
+    end
+
+    function gfx.commands_available()
+        return command_buffer_type ~= nil
     end
 
     -- ============================================================
@@ -749,12 +1104,26 @@ return function(cmd)
         present = gfx.present,
         next = gfx.next_frame,
         save_png = gfx.save_frame_png,
+        capture_path = gfx.set_capture_path,
+        capture_fps = gfx.set_capture_fps,
         fb_size = gfx.fb_size,
         fb_width = gfx.fb_width,
         fb_height = gfx.fb_height,
         set_present_filter_linear = gfx.set_present_filter_linear,
     }
 
+    gfx.pixels = {
+        write = gfx.write_pixels,
+        read = gfx.read_pixels,
+        write_palette = gfx.write_pixels_palette,
+        rgba = gfx.rgba_bytes,
+    }
+
+    gfx.kernel = {
+        compile = gfx.compile_kernel,
+        run = gfx.run_kernel,
+    }
+
     gfx.draw = {
         line = gfx.line,
         rect = gfx.rect,
@@ -767,6 +1136,8 @@ return function(cmd)
     gfx.pp = {
         set_bloom = gfx.pp_set_bloom,
         set_tone = gfx.pp_set_tone,
+        set_grade = gfx.pp_set_grade,
+        set_aa = gfx.pp_set_aa,
     }
 
     gfx.tex = {
@@ -782,6 +1153,7 @@ return function(cmd)
     }
 
     gfx.mat4 = {
+        new = gfx.mat4_new,
         mul = gfx.mat4_mul,
         translate = gfx.mat4_translate,
         rotate_x = gfx.mat4_rotate_x,
@@ -795,6 +1167,13 @@ return function(cmd)
         seconds = gfx.time_seconds,
     }
 
+    gfx.commands = {
+        begin = gfx.commands_begin,
+        submit = gfx.commands_submit,
+        recording = gfx.commands_recording,
+        available = gfx.commands_available,
+    }
+
     -- Small debug function
     function gfx.run()
         print("gfx.run")
@@ -1,8 +1,12 @@
 -- scripts/main_lua_example_v1_4_generating.lua
 --
 -- Generates Sandbox.h (C++ header) that implements:
---   - EngineLuaBridge_::dispatch (Lua -> C++)
---   - a list of inline std::function callbacks (C++ sets these)
+--   - EngineLuaBridge_::dispatch (Lua -> C++): one handler per op behind an opcode jump
+--     table; op names still work through a perfect hash computed here
+--   - integer opcodes (enum Op, and make_opcode_table() for Lua's Engine.Op)
+--   - direct bindings (Engine.Direct): one function per op taking flat args, no tables
+--   - CommandBuffer: void ops recorded with flat args into a word stream, run in one call
+--   - a list of inline thread_local std::function callbacks (C++ sets these, per thread)
 --   - bind_engine_defaults() that binds callbacks to Engine_::* where possible
 --
 -- NOTE: ops marked no_default=true are NOT auto-bound (they need custom C++ state),
@@ -127,6 +131,7 @@ local OPS = {
 
   -- --- capture ---
   { name="set_capture_filepath", callback_name="cb_set_capture_filepath", ret=nil, args={ {"string","filepath"} } },
+  { name="set_capture_fps",      callback_name="cb_set_capture_fps",      ret=nil, args={ {"int","fps"} } },
   { name="set_frame_index",      callback_name="cb_set_frame_index",      ret=nil, args={ {"u64","idx"} } },
   { name="frame_index",          callback_name="cb_frame_index",          ret="u64", args={} },
   { name="next_frame",           callback_name="cb_next_frame",           ret=nil, args={} },
@@ -236,6 +241,23 @@ local OPS = {
     }
   },
 
+  -- 3D LUT grade (.cube or HALD/strip image; C++ loads and caches by path)
+  { name="pp_set_grade", callback_name="cb_pp_set_grade", ret="bool", no_default=true, args={
+      {"bool","enabled",{def="true"}},
+      {"string","lut_path",{def="std::string{}"}},
+      {"float","strength",{def="1.0f"}},
+      {"string","interp",{def="std::string{\"tetrahedral\"}"}},
+    }
+  },
+
+  { name="pp_set_aa", callback_name="cb_pp_set_aa", ret=nil, no_default=true, args={
+      {"bool","enabled",{def="true"}},
+      {"float","edge_threshold",{def="0.125f"}},
+      {"float","edge_threshold_min",{def="0.0312f"}},
+      {"float","subpixel",{def="0.75f"}},
+    }
+  },
+
   { name="pp_reset", callback_name="cb_pp_reset", ret=nil, no_default=true, args={} },
 }
 
@@ -320,7 +342,12 @@ local function emit_prelude(b, ns)
 #include <functional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
 
 ]=])
@@ -335,19 +362,9 @@ local function emit_helpers_cpp(b)
   b:block([=[
 // -------------------------
 // Decode helpers (Lua -> C++)
-// All commands are Lua arrays: arr[1] = op string, arr[2..] = args
+// All commands are Lua arrays: arr[1] = opcode or op name, arr[2..] = args
 // -------------------------
 
-inline std::string get_op1(const sol::table& arr)
-{
-    sol::object o = arr[1];
-    if (!o.valid() || o.is<sol::lua_nil_t>())
-        throw std::runtime_error("Command array missing op at index 1");
-    if (!o.is<std::string>())
-        throw std::runtime_error("Command op at index 1 must be a string");
-    return o.as<std::string>();
-}
-
 inline int clamp_int(int v, int lo, int hi)
 {
     return std::max(lo, std::min(hi, v));
@@ -507,6 +524,7 @@ inline Engine_::Vec3 get_vec3(const sol::table& arr, int idx, Engine_::Vec3 def,
         if (required) throw std::runtime_error("Missing Vec3 arg at index " + std::to_string(idx));
         return def;
     }
+    if (o.is<Engine_::Vec3>()) return o.as<Engine_::Vec3>(); // Engine.Vec3
     if (!o.is<sol::table>())
         throw std::runtime_error("Expected Vec3 table at index " + std::to_string(idx));
     sol::table t = o.as<sol::table>();
@@ -542,6 +560,7 @@ inline Engine_::Mat4 get_mat4(const sol::table& arr, int idx, Engine_::Mat4 def,
         if (required) throw std::runtime_error("Missing Mat4 arg at index " + std::to_string(idx));
         return def;
     }
+    if (o.is<Engine_::Mat4>()) return o.as<Engine_::Mat4>(); // Engine.Mat4
     if (!o.is<sol::table>())
         throw std::runtime_error("Expected Mat4 table at index " + std::to_string(idx));
     sol::table t = o.as<sol::table>();
@@ -591,6 +610,15 @@ inline Engine_::Color get_color(const sol::table& arr, int idx, Engine_::Color d
     return c;
 }
 
+inline Engine_::BlendMode blend_mode_from_string(const std::string& s)
+{
+    if (s == "Overwrite") return Engine_::BlendMode::Overwrite;
+    if (s == "Alpha") return Engine_::BlendMode::Alpha;
+    if (s == "Additive") return Engine_::BlendMode::Additive;
+    if (s == "Multiply") return Engine_::BlendMode::Multiply;
+    throw std::runtime_error("Unknown BlendMode string: " + s);
+}
+
 inline Engine_::BlendMode get_blend_mode(const sol::table& arr, int idx, Engine_::BlendMode def, bool required)
 {
     sol::object o = arr[idx];
@@ -602,12 +630,7 @@ inline Engine_::BlendMode get_blend_mode(const sol::table& arr, int idx, Engine_
         return (Engine_::BlendMode)o.as<int>();
     }
     if (o.is<std::string>()) {
-        const std::string s = o.as<std::string>();
-        if (s == "Overwrite") return Engine_::BlendMode::Overwrite;
-        if (s == "Alpha") return Engine_::BlendMode::Alpha;
-        if (s == "Additive") return Engine_::BlendMode::Additive;
-        if (s == "Multiply") return Engine_::BlendMode::Multiply;
-        throw std::runtime_error("Unknown BlendMode string: " + s);
+        return blend_mode_from_string(o.as<std::string>());
     }
     throw std::runtime_error("Expected BlendMode (string or int) at index " + std::to_string(idx));
 }
@@ -623,6 +646,58 @@ inline const char* blend_mode_to_cstr(Engine_::BlendMode m)
     }
 }
 
+// -------------------------
+// Flat argument helpers (components passed as plain Lua values, no tables)
+// -------------------------
+inline Engine_::Color make_color(double r, double g, double b, double a)
+{
+    Engine_::Color c;
+    c.r = (uint8_t)clamp_int((int)r, 0, 255);
+    c.g = (uint8_t)clamp_int((int)g, 0, 255);
+    c.b = (uint8_t)clamp_int((int)b, 0, 255);
+    c.a = (uint8_t)clamp_int((int)a, 0, 255);
+    return c;
+}
+
+inline Engine_::Mat4 table_to_mat4(const sol::table& t)
+{
+    Engine_::Mat4 m;
+    for (int i = 0; i < 16; ++i) {
+        sol::object oi = t[i + 1];
+        if (obj_is_nil(oi)) throw std::runtime_error("Mat4 missing element " + std::to_string(i + 1));
+        m.m[i] = (float)obj_to_number(oi, "Mat4[i]");
+    }
+    return m;
+}
+
+// Engine.Mat4 userdata (used as is) or a 16-number table.
+inline Engine_::Mat4 mat4_from_object(const sol::object& o)
+{
+    if (o.is<Engine_::Mat4>()) return o.as<Engine_::Mat4>();
+    if (o.is<sol::table>()) return table_to_mat4(o.as<sol::table>());
+    throw std::runtime_error("Expected Mat4 (Engine.Mat4 or table)");
+}
+
+// Engine.Vec3 userdata or a {x, y, z} / {1, 2, 3} table.
+inline Engine_::Vec3 vec3_from_object(const sol::object& o)
+{
+    if (o.is<Engine_::Vec3>()) return o.as<Engine_::Vec3>();
+    if (!o.is<sol::table>()) throw std::runtime_error("Expected Vec3 (Engine.Vec3 or table)");
+    const sol::table t = o.as<sol::table>();
+    Engine_::Vec3 v;
+    v.x = get_field_float_named_or_index(t, "x", 1, 0.0f, true, "Vec3.x");
+    v.y = get_field_float_named_or_index(t, "y", 2, 0.0f, true, "Vec3.y");
+    v.z = get_field_float_named_or_index(t, "z", 3, 0.0f, true, "Vec3.z");
+    return v;
+}
+
+inline Engine_::BlendMode blend_mode_from_object(const sol::object& o)
+{
+    if (o.is<int>()) return (Engine_::BlendMode)o.as<int>();
+    if (o.is<std::string>()) return blend_mode_from_string(o.as<std::string>());
+    throw std::runtime_error("Expected BlendMode (string or int)");
+}
+
 // -------------------------
 // Return helpers (C++ -> Lua)
 // -------------------------
@@ -676,6 +751,7 @@ end
 local function emit_callback_decls(b, ops)
   b:ln("// -------------------------")
   b:ln("// Global callbacks (set these from C++).")
+  b:ln("// Thread-local: each thread that runs a Lua state binds its own set.")
   b:ln("// If a callback is not set, dispatch() will throw.")
   b:ln("// -------------------------")
   b:ln("")
@@ -693,7 +769,7 @@ local function emit_callback_decls(b, ops)
     end
     local args_sig = table.concat(arg_parts, ", ")
 
-    b:ln(("inline std::function<%s(%s)> %s;"):format(ret_ty, args_sig, op.callback_name))
+    b:ln(("inline thread_local std::function<%s(%s)> %s;"):format(ret_ty, args_sig, op.callback_name))
   end
   b:ln("")
 end
@@ -732,91 +808,682 @@ local function emit_bind_defaults(b, ops)
   b:ln("")
 end
 
+-- ------------------------------------------------------------
+-- Opcodes + perfect hash (op name -> opcode)
+-- ------------------------------------------------------------
+
+local FNV_PRIME = 16777619
+local FNV_BASIS = 2166136261
+
+-- 32-bit FNV-1a with a caller-chosen basis; must match op_hash() in the emitted header.
+local function fnv1a(s, basis)
+  local h = basis
+  for i = 1, #s do
+    h = ((h ~ s:byte(i)) * FNV_PRIME) & 0xFFFFFFFF
+  end
+  return h
+end
+
+local function opcode_const(op)
+  return "OP_" .. op.name:upper()
+end
+
+-- Hash and displace: names land in buckets by fnv1a(name, FNV_BASIS); every bucket
+-- (largest first) gets the first basis that puts all of its names in free slots.
+local function build_perfect_hash(ops)
+  local bits = 1
+  while (1 << bits) < #ops do bits = bits + 1 end
+
+  while true do
+    local size = 1 << bits
+    local mask = size - 1
+    local buckets = {}
+    for i = 1, size do buckets[i] = { index = i - 1, names = {} } end
+    for code, op in ipairs(ops) do
+      local bk = buckets[(fnv1a(op.name, FNV_BASIS) & mask) + 1]
+      bk.names[#bk.names + 1] = { name = op.name, code = code }
+    end
+    table.sort(buckets, function(a, c)
+      if #a.names ~= #c.names then return #a.names > #c.names end
+      return a.index < c.index
+    end)
+
+    local disp, slots = {}, {}
+    for i = 0, mask do disp[i] = 1; slots[i] = 0 end
+
+    local ok = true
+    for _, bk in ipairs(buckets) do
+      if #bk.names > 0 then
+        local found = false
+        for d = 1, 100000 do
+          local taken, fits = {}, true
+          for _, e in ipairs(bk.names) do
+            local slot = fnv1a(e.name, d) & mask
+            if slots[slot] ~= 0 or taken[slot] then fits = false break end
+            taken[slot] = e.code
+          end
+          if fits then
+            disp[bk.index] = d
+            for slot, code in pairs(taken) do slots[slot] = code end
+            found = true
+            break
+          end
+        end
+        if not found then ok = false break end
+      end
+    end
+
+    if ok then return { bits = bits, disp = disp, slots = slots } end
+    bits = bits + 1
+  end
+end
+
+local function emit_number_rows(b, values, first, last, per_row)
+  local row = {}
+  for i = first, last do
+    row[#row + 1] = tostring(values[i])
+    if #row == per_row or i == last then
+      b:iln(table.concat(row, ", ") .. ",")
+      row = {}
+    end
+  end
+end
+
+local function emit_opcodes(b, ops)
+  b:ln("// -------------------------")
+  b:ln("// Opcodes. arr[1] is one of these (Engine.Op.<name> in Lua) or the op name.")
+  b:ln("// Values follow the op list; new ops go at the end so scripts keep working.")
+  b:ln("// -------------------------")
+  b:ln("")
+  b:ln("enum Op : int")
+  b:ln("{")
+  b:tab()
+  for code, op in ipairs(ops) do
+    b:iln(("%s = %d,"):format(opcode_const(op), code))
+  end
+  b:untab()
+  b:ln("};")
+  b:ln("")
+  b:ln(("inline constexpr int OP_COUNT = %d; // opcode 0 is unused"):format(#ops + 1))
+  b:ln("")
+  b:ln("inline constexpr const char* k_op_names[OP_COUNT] =")
+  b:ln("{")
+  b:tab()
+  b:iln('"",')
+  for _, op in ipairs(ops) do
+    b:iln(cpp_q(op.name) .. ",")
+  end
+  b:untab()
+  b:ln("};")
+  b:ln("")
+
+  local ph = build_perfect_hash(ops)
+  local size = 1 << ph.bits
+  b:ln("// Perfect hash over the op names (built by the generator): two FNV-1a passes")
+  b:ln("// and one string compare, whatever the op.")
+  b:ln(("inline constexpr int k_op_hash_bits = %d;"):format(ph.bits))
+  b:ln(("inline constexpr uint32_t k_op_hash_disp[%d] ="):format(size))
+  b:ln("{")
+  b:tab()
+  emit_number_rows(b, ph.disp, 0, size - 1, 16)
+  b:untab()
+  b:ln("};")
+  b:ln(("inline constexpr uint16_t k_op_hash_slots[%d] ="):format(size))
+  b:ln("{")
+  b:tab()
+  emit_number_rows(b, ph.slots, 0, size - 1, 16)
+  b:untab()
+  b:ln("};")
+  b:ln("")
+  b:block(([=[
+inline uint32_t op_hash(std::string_view s, uint32_t basis)
+{
+    uint32_t h = basis;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= %du;
+    }
+    return h;
+}
+
+// 0 if `name` is not an op.
+inline int op_from_name(std::string_view name)
+{
+    constexpr uint32_t mask = (1u << k_op_hash_bits) - 1u;
+    const uint32_t basis = k_op_hash_disp[op_hash(name, %uu) & mask];
+    const int op = k_op_hash_slots[op_hash(name, basis) & mask];
+    return (op != 0 && name == k_op_names[op]) ? op : 0;
+}
+
+inline int get_opcode(const sol::table& arr)
+{
+    sol::object o = arr[1];
+    switch (o.get_type()) {
+    case sol::type::number: {
+        const int op = o.as<int>();
+        if (op <= 0 || op >= OP_COUNT)
+            throw std::runtime_error("Unknown opcode: " + std::to_string(op));
+        return op;
+    }
+    case sol::type::string: {
+        const std::string_view name = o.as<std::string_view>();
+        const int op = op_from_name(name);
+        if (op == 0)
+            throw std::runtime_error("Unknown op: " + std::string(name));
+        return op;
+    }
+    case sol::type::lua_nil:
+    case sol::type::none:
+        throw std::runtime_error("Command array missing op at index 1");
+    default:
+        throw std::runtime_error("Command op at index 1 must be an opcode or a string");
+    }
+}
+
+// { op_name = opcode, ... } for Lua (Engine.Op).
+inline sol::table make_opcode_table(sol::state_view lua)
+{
+    sol::table t = lua.create_table(0, OP_COUNT - 1);
+    for (int op = 1; op < OP_COUNT; ++op)
+        t[k_op_names[op]] = op;
+    return t;
+}
+]=]):format(FNV_PRIME, FNV_BASIS))
+  b:ln("")
+end
+
+local function emit_op_handler(b, op)
+  b:ln(("inline sol::variadic_results op_%s([[maybe_unused]] sol::state_view lua, [[maybe_unused]] const sol::table& arr)"):format(op.name))
+  b:ln("{")
+  b:tab()
+  b:iln("sol::variadic_results out;")
+
+  local idx = 2
+  local arg_names = {}
+  for _, a in ipairs(op.args or {}) do
+    local ty, name, opts = a[1], a[2], a[3]
+    opts = opts or {}
+    local def = opts.def or default_cpp(ty)
+    local required
+    if opts.required ~= nil then
+      required = opts.required and "true" or "false"
+    else
+      required = (opts.def == nil) and "true" or "false"
+    end
+
+    local decl_ty = cpp_type(ty)
+    local fn = decode_fn_name(ty)
+    b:iln(("const %s %s = %s(arr, %d, %s, %s);"):format(decl_ty, name, fn, idx, def, required))
+    arg_names[#arg_names+1] = name
+    idx = idx + 1
+  end
+
+  b:iln(("if (!%s) throw std::runtime_error(%s);"):format(op.callback_name, cpp_q("Callback not set for op: " .. op.name)))
+
+  local call_args = table.concat(arg_names, ", ")
+  local ret = op.ret
+
+  if ret == nil or ret == "void" then
+    b:iln(("%s(%s);"):format(op.callback_name, call_args))
+  else
+    b:iln(("auto r = %s(%s);"):format(op.callback_name, call_args))
+
+    local kind = ret_push_kind(ret)
+    if kind == "color_table" then
+      b:iln("out.push_back(sol::make_object(lua, color_to_table(lua, r)));")
+    elseif kind == "vec_table" then
+      if ret == "Vec2" then
+        b:iln("out.push_back(sol::make_object(lua, vec2_to_table(lua, r)));")
+      elseif ret == "Vec3" then
+        b:iln("out.push_back(sol::make_object(lua, vec3_to_table(lua, r)));")
+      else
+        b:iln("out.push_back(sol::make_object(lua, vec4_to_table(lua, r)));")
+      end
+    elseif kind == "mat4_table" then
+      b:iln("out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));")
+    elseif kind == "blend_string" then
+      b:iln("out.push_back(sol::make_object(lua, std::string(blend_mode_to_cstr(r))));")
+    else
+      b:iln("out.push_back(sol::make_object(lua, r));")
+    end
+  end
+
+  b:iln("return out;")
+  b:untab()
+  b:ln("}")
+  b:ln("")
+end
+
 local function emit_dispatch(b, ops)
+  b:ln("// -------------------------")
+  b:ln("// Op handlers (decode args from the command array, call the callback)")
+  b:ln("// -------------------------")
+  b:ln("")
+  for _, op in ipairs(ops) do
+    emit_op_handler(b, op)
+  end
+
+  b:ln("using OpHandler = sol::variadic_results (*)(sol::state_view, const sol::table&);")
+  b:ln("")
+  b:ln("inline constexpr OpHandler k_op_handlers[OP_COUNT] =")
+  b:ln("{")
+  b:tab()
+  b:iln("nullptr,")
+  for _, op in ipairs(ops) do
+    b:iln(("&op_%s,"):format(op.name))
+  end
+  b:untab()
+  b:ln("};")
+  b:ln("")
+
   b:ln("// Execute a single command array immediately.")
   b:ln("// Returns 0 values for void ops, or 1+ values for query ops.")
   b:ln("inline sol::variadic_results dispatch(sol::this_state ts, const sol::table& arr)")
   b:ln("{")
   b:tab()
-  b:iln("sol::state_view lua(ts);")
-  b:iln("sol::variadic_results out;")
-  b:iln("const std::string op = get_op1(arr);")
-  b:iln("")
+  b:iln("return k_op_handlers[get_opcode(arr)](sol::state_view(ts), arr);")
+  b:untab()
+  b:ln("}")
+  b:ln("")
+end
 
-  for i, op in ipairs(ops) do
-    local prefix = (i == 1) and "if" or "else if"
-    b:iln(("%s (op == %s)"):format(prefix, cpp_q(op.name)))
-    b:iln("{")
-    b:tab()
+-- ------------------------------------------------------------
+-- Flat (table-free) arguments: Color -> r,g,b,a; VecN -> x,y(,z,w); numbers as
+-- double. Args with a default (and a Color's alpha) become sol::optional.
+-- Returns the C++ parameter list and, per op arg, { ty, name, expr } where expr
+-- rebuilds the typed value from the flat parameters.
+-- ------------------------------------------------------------
 
-    local idx = 2
-    local arg_names = {}
-    for _, a in ipairs(op.args or {}) do
-      local ty, name, opts = a[1], a[2], a[3]
-      opts = opts or {}
-      local def = opts.def or default_cpp(ty)
-      local required
-      if opts.required ~= nil then
-        required = opts.required and "true" or "false"
+local VEC_FIELDS = { Vec2 = { "x", "y" }, Vec3 = { "x", "y", "z" }, Vec4 = { "x", "y", "z", "w" } }
+
+local function flat_args(op)
+  local params, values = {}, {}
+  for _, a in ipairs(op.args or {}) do
+    local ty, name, opts = a[1], a[2], a[3] or {}
+    local def = opts.def
+    local expr
+
+    if ty == "int" or ty == "float" or ty == "u64" then
+      local ct = cpp_type(ty)
+      if def then
+        params[#params+1] = "sol::optional<double> " .. name
+        expr = ("%s ? (%s)*%s : %s"):format(name, ct, name, def)
       else
-        required = (opts.def == nil) and "true" or "false"
+        params[#params+1] = "double " .. name
+        expr = ("(%s)%s"):format(ct, name)
       end
-
-      local decl_ty = cpp_type(ty)
-      local fn = decode_fn_name(ty)
-      b:iln(("const %s %s = %s(arr, %d, %s, %s);"):format(decl_ty, name, fn, idx, def, required))
-      arg_names[#arg_names+1] = name
-      idx = idx + 1
+    elseif ty == "bool" then
+      if def then
+        params[#params+1] = "sol::optional<bool> " .. name
+        expr = ("%s.value_or(%s)"):format(name, def)
+      else
+        params[#params+1] = "bool " .. name
+        expr = name
+      end
+    elseif ty == "string" then
+      if def then
+        params[#params+1] = "sol::optional<std::string> " .. name
+        expr = ("%s ? *%s : %s"):format(name, name, def)
+      else
+        params[#params+1] = "const std::string& " .. name
+        expr = name
+      end
+    elseif ty == "Color" then
+      local r, g, bl, al = name .. "_r", name .. "_g", name .. "_b", name .. "_a"
+      if def then
+        for _, c in ipairs({ r, g, bl, al }) do params[#params+1] = "sol::optional<double> " .. c end
+        expr = ("%s ? make_color(*%s, %s.value_or(0.0), %s.value_or(0.0), %s.value_or(255.0)) : %s"):format(r, r, g, bl, al, def)
+      else
+        for _, c in ipairs({ r, g, bl }) do params[#params+1] = "double " .. c end
+        params[#params+1] = "sol::optional<double> " .. al
+        expr = ("make_color(%s, %s, %s, %s.value_or(255.0))"):format(r, g, bl, al)
+      end
+    elseif VEC_FIELDS[ty] then
+      if def then error("flat_args: defaulted " .. ty .. " not supported (" .. op.name .. ")") end
+      local parts = {}
+      for _, f in ipairs(VEC_FIELDS[ty]) do
+        params[#params+1] = "double " .. name .. "_" .. f
+        parts[#parts+1] = "(float)" .. name .. "_" .. f
+      end
+      expr = ("%s{%s}"):format(cpp_type(ty), table.concat(parts, ", "))
+    elseif ty == "Mat4" then
+      if def then error("flat_args: defaulted Mat4 not supported (" .. op.name .. ")") end
+      params[#params+1] = "const sol::object& " .. name
+      expr = ("mat4_from_object(%s)"):format(name)
+    elseif ty == "BlendMode" then
+      if def then error("flat_args: defaulted BlendMode not supported (" .. op.name .. ")") end
+      params[#params+1] = "const sol::object& " .. name
+      expr = ("blend_mode_from_object(%s)"):format(name)
+    else
+      error("flat_args: unknown type " .. tostring(ty))
     end
 
-    b:iln(("if (!%s) throw std::runtime_error(%s);"):format(op.callback_name, cpp_q("Callback not set for op: " .. op.name)))
+    values[#values+1] = { ty = ty, name = name, expr = expr }
+  end
+  return table.concat(params, ", "), values
+end
 
-    local call_args = table.concat(arg_names, ", ")
-    local ret = op.ret
+local function is_void(op)
+  return op.ret == nil or op.ret == "void"
+end
 
-    if ret == nil or ret == "void" then
-      b:iln(("%s(%s);"):format(op.callback_name, call_args))
-      b:iln("return out;")
-    else
-      b:iln(("auto r = %s(%s);"):format(op.callback_name, call_args))
-
-      local kind = ret_push_kind(ret)
-      if kind == "plain" then
-        b:iln("out.push_back(sol::make_object(lua, r));")
-      elseif kind == "color_table" then
-        b:iln("out.push_back(sol::make_object(lua, color_to_table(lua, r)));")
-      elseif kind == "vec_table" then
-        if ret == "Vec2" then
-          b:iln("out.push_back(sol::make_object(lua, vec2_to_table(lua, r)));")
-        elseif ret == "Vec3" then
-          b:iln("out.push_back(sol::make_object(lua, vec3_to_table(lua, r)));")
-        else
-          b:iln("out.push_back(sol::make_object(lua, vec4_to_table(lua, r)));")
-        end
-      elseif kind == "mat4_table" then
-        b:iln("out.push_back(sol::make_object(lua, mat4_to_table(lua, r)));")
-      elseif kind == "blend_string" then
-        b:iln("out.push_back(sol::make_object(lua, std::string(blend_mode_to_cstr(r))));")
-      else
-        b:iln("out.push_back(sol::make_object(lua, r));")
-      end
+local function read_fn_name(ty)
+  if ty == "u64" then return "read_u64" end
+  if ty == "string" then return "read_string" end
+  if ty == "BlendMode" then return "read_blend_mode" end
+  return "read_" .. ty:lower()
+end
+
+-- ------------------------------------------------------------
+-- Direct bindings: one plain Lua function per op with the same flat args as the
+-- command buffer, calling the callback straight away (no command table, no
+-- nested Color/Vec tables). Color results come back as r, g, b, a; Mat4 results
+-- as Engine.Mat4 userdata, and Mat4 args take Engine.Mat4 or a 16-number table.
+-- ------------------------------------------------------------
 
-      b:iln("return out;")
+local function emit_direct(b, ops)
+  b:ln("// -------------------------")
+  b:ln("// Direct bindings (Engine.Direct in Lua): flat args, no tables per call.")
+  b:ln("//   Engine.Direct.draw_line(x0, y0, x1, y1, r, g, b, a, thickness)")
+  b:ln("//   local r, g, b, a = Engine.Direct.get_pixel(x, y)")
+  b:ln("// Optional args follow the op list defaults; a Color's alpha defaults to 255.")
+  b:ln("// Mat4 results are Engine.Mat4 userdata (the host registers that usertype).")
+  b:ln("// -------------------------")
+  b:ln("")
+  for _, op in ipairs(ops) do
+    local params, values = flat_args(op)
+    local exprs = {}
+    for _, v in ipairs(values) do exprs[#exprs+1] = v.expr end
+    local call = ("%s(%s)"):format(op.callback_name, table.concat(exprs, ", "))
+
+    local ret = op.ret
+    local ret_ty
+    if is_void(op) then
+      ret_ty = "void"
+    elseif ret == "Color" then
+      ret_ty = "std::tuple<int, int, int, int>"
+    elseif ret == "Mat4" then
+      ret_ty = "Engine_::Mat4" -- Engine.Mat4 userdata, not a 16-slot table
+    elseif ret == "BlendMode" then
+      ret_ty = "const char*"
+    elseif ret == "Vec2" or ret == "Vec3" or ret == "Vec4" then
+      error("emit_direct: " .. ret .. " results not supported (" .. op.name .. ")")
+    else
+      ret_ty = cpp_type(ret)
     end
 
+    b:ln(("inline %s direct_%s(%s)"):format(ret_ty, op.name, params))
+    b:ln("{")
+    b:tab()
+    b:iln(("if (!%s) throw std::runtime_error(%s);"):format(op.callback_name, cpp_q("Callback not set for op: " .. op.name)))
+    if is_void(op) then
+      b:iln(call .. ";")
+    elseif ret == "Color" then
+      b:iln(("const Engine_::Color c = %s;"):format(call))
+      b:iln("return { c.r, c.g, c.b, c.a };")
+    elseif ret == "BlendMode" then
+      b:iln(("return blend_mode_to_cstr(%s);"):format(call))
+    else
+      b:iln(("return %s;"):format(call))
+    end
     b:untab()
-    b:iln("}")
-    b:iln("")
+    b:ln("}")
+    b:ln("")
   end
 
-  b:iln("else")
-  b:iln("{")
+  b:ln("inline sol::table make_direct_table(sol::state_view lua)")
+  b:ln("{")
   b:tab()
-  b:iln('throw std::runtime_error(std::string("Unknown op: ") + op);')
+  b:iln(("sol::table t = lua.create_table(0, %d);"):format(#ops))
+  for _, op in ipairs(ops) do
+    b:iln(("t.set_function(%s, &direct_%s);"):format(cpp_q(op.name), op.name))
+  end
+  b:iln("return t;")
   b:untab()
-  b:iln("}")
+  b:ln("}")
+  b:ln("")
+end
 
-  b:iln("return out;")
+-- ------------------------------------------------------------
+-- Command buffer (record void ops from Lua, execute them in one call)
+-- ------------------------------------------------------------
+
+local function emit_command_buffer(b, ops)
+  b:block([=[
+// -------------------------
+// CommandBuffer: void ops recorded from Lua into a flat word stream and executed
+// by one C++ call. Each command is a header word (opcode | payload words << 16)
+// followed by its arguments: int/float/bool/BlendMode one word, u64 two, Color
+// packed RGBA in one word, VecN/Mat4 as float words, strings as an index into the
+// buffer's string table. Recording methods take flat args (see the op list):
+//   buf:draw_line(x0, y0, x1, y1, r, g, b, a, thickness)
+// execute() replays the commands in recorded order through the same callbacks as
+// dispatch(); nothing is reordered, since blending makes draw order visible.
+// -------------------------
+class CommandBuffer
+{
+public:
+    void clear()
+    {
+        words_.clear();
+        strings_.clear();
+        string_ids_.clear();
+        count_ = 0;
+    }
+
+    size_t count() const { return count_; }
+    size_t size_bytes() const { return words_.size() * sizeof(uint32_t); }
+    void reserve_words(size_t n) { words_.reserve(n); }
+
+    void execute() const;
+
+    // execute() then clear(); the buffer keeps its capacity for the next frame.
+    void submit()
+    {
+        execute();
+        clear();
+    }
+]=])
+
+  b:tab()
+  for _, op in ipairs(ops) do
+    if is_void(op) then
+      local params, values = flat_args(op)
+      b:ln("")
+      b:iln(("void %s(%s)"):format(op.name, params))
+      b:iln("{")
+      b:tab()
+      b:iln(("const size_t at = begin(OP_%s);"):format(op.name:upper()))
+      for _, v in ipairs(values) do
+        b:iln(("put(%s);"):format(v.expr))
+      end
+      b:iln("finish(at);")
+      b:untab()
+      b:iln("}")
+    end
+  end
+  b:untab()
+
+  b:block([=[
+
+private:
+    class Reader
+    {
+    public:
+        Reader(const CommandBuffer& buf, const uint32_t* p) : buf_(buf), p_(p) {}
+
+        int read_int() { return (int)*p_++; }
+        bool read_bool() { return *p_++ != 0; }
+        float read_float()
+        {
+            float v;
+            std::memcpy(&v, p_++, sizeof(v));
+            return v;
+        }
+        uint64_t read_u64()
+        {
+            const uint64_t lo = *p_++;
+            const uint64_t hi = *p_++;
+            return lo | (hi << 32);
+        }
+        const std::string& read_string() { return buf_.strings_[*p_++]; }
+        Engine_::Color read_color()
+        {
+            const uint32_t w = *p_++;
+            return Engine_::Color{ (uint8_t)w, (uint8_t)(w >> 8), (uint8_t)(w >> 16), (uint8_t)(w >> 24) };
+        }
+        Engine_::Vec2 read_vec2()
+        {
+            Engine_::Vec2 v;
+            v.x = read_float();
+            v.y = read_float();
+            return v;
+        }
+        Engine_::Vec3 read_vec3()
+        {
+            Engine_::Vec3 v;
+            v.x = read_float();
+            v.y = read_float();
+            v.z = read_float();
+            return v;
+        }
+        Engine_::Vec4 read_vec4()
+        {
+            Engine_::Vec4 v;
+            v.x = read_float();
+            v.y = read_float();
+            v.z = read_float();
+            v.w = read_float();
+            return v;
+        }
+        Engine_::Mat4 read_mat4()
+        {
+            Engine_::Mat4 m;
+            std::memcpy(m.m, p_, sizeof(m.m));
+            p_ += 16;
+            return m;
+        }
+        Engine_::BlendMode read_blend_mode() { return (Engine_::BlendMode)read_int(); }
+
+    private:
+        const CommandBuffer& buf_;
+        const uint32_t* p_;
+    };
+
+    size_t begin(int op)
+    {
+        words_.push_back((uint32_t)op);
+        return words_.size() - 1;
+    }
+
+    void finish(size_t at)
+    {
+        words_[at] |= (uint32_t)(words_.size() - at - 1) << 16;
+        ++count_;
+    }
+
+    void put(int v) { words_.push_back((uint32_t)v); }
+    void put(bool v) { words_.push_back(v ? 1u : 0u); }
+    void put(float v)
+    {
+        uint32_t w;
+        std::memcpy(&w, &v, sizeof(w));
+        words_.push_back(w);
+    }
+    void put(uint64_t v)
+    {
+        words_.push_back((uint32_t)v);
+        words_.push_back((uint32_t)(v >> 32));
+    }
+    void put(const std::string& s)
+    {
+        auto it = string_ids_.find(s);
+        if (it == string_ids_.end()) {
+            it = string_ids_.emplace(s, (uint32_t)strings_.size()).first;
+            strings_.push_back(s);
+        }
+        words_.push_back(it->second);
+    }
+    void put(Engine_::Color c)
+    {
+        words_.push_back((uint32_t)c.r | ((uint32_t)c.g << 8) | ((uint32_t)c.b << 16) | ((uint32_t)c.a << 24));
+    }
+    void put(const Engine_::Vec2& v) { put(v.x); put(v.y); }
+    void put(const Engine_::Vec3& v) { put(v.x); put(v.y); put(v.z); }
+    void put(const Engine_::Vec4& v) { put(v.x); put(v.y); put(v.z); put(v.w); }
+    void put(const Engine_::Mat4& m)
+    {
+        const size_t at = words_.size();
+        words_.resize(at + 16);
+        std::memcpy(words_.data() + at, m.m, sizeof(m.m));
+    }
+    void put(Engine_::BlendMode m) { put((int)m); }
+
+    std::vector<uint32_t> words_;
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, uint32_t> string_ids_;
+    size_t count_ = 0;
+};
+
+inline void CommandBuffer::execute() const
+{
+    const uint32_t* p = words_.data();
+    const uint32_t* const end = p + words_.size();
+    while (p < end) {
+        const uint32_t header = *p;
+        const uint32_t* const next = p + 1 + (header >> 16);
+        Reader rd(*this, p + 1);
+        switch ((int)(header & 0xFFFFu)) {
+]=])
+
+  b.indent = "        "
+  for _, op in ipairs(ops) do
+    if is_void(op) then
+      local names = {}
+      b:iln(("case OP_%s: {"):format(op.name:upper()))
+      b:tab()
+      for _, a in ipairs(op.args or {}) do
+        local ty, name = a[1], a[2]
+        local decl = (ty == "string") and "const std::string&" or ("const " .. cpp_type(ty))
+        b:iln(("%s %s = rd.%s();"):format(decl, name, read_fn_name(ty)))
+        names[#names+1] = name
+      end
+      b:iln(("if (!%s) throw std::runtime_error(%s);"):format(op.callback_name, cpp_q("Callback not set for op: " .. op.name)))
+      b:iln(("%s(%s);"):format(op.callback_name, table.concat(names, ", ")))
+      b:iln("break;")
+      b:untab()
+      b:iln("}")
+    end
+  end
+  b.indent = ""
+
+  b:block([=[
+        default:
+            throw std::runtime_error("CommandBuffer: bad opcode " + std::to_string(header & 0xFFFFu));
+        }
+        p = next;
+    }
+}
+
+// Engine.CommandBuffer in Lua: CommandBuffer.new(), then buf:<op>(flat args...),
+// buf:submit() / execute() / clear() / count() / size_bytes().
+inline void register_command_buffer(sol::table owner, const char* type_name = "CommandBuffer")
+{
+    sol::usertype<CommandBuffer> ut = owner.new_usertype<CommandBuffer>(type_name,
+        sol::constructors<CommandBuffer()>());
+    ut["clear"] = &CommandBuffer::clear;
+    ut["count"] = &CommandBuffer::count;
+    ut["size_bytes"] = &CommandBuffer::size_bytes;
+    ut["reserve_words"] = &CommandBuffer::reserve_words;
+    ut["execute"] = &CommandBuffer::execute;
+    ut["submit"] = &CommandBuffer::submit;
+]=])
+  b:tab()
+  for _, op in ipairs(ops) do
+    if is_void(op) then
+      b:iln(("ut[%s] = &CommandBuffer::%s;"):format(cpp_q(op.name), op.name))
+    end
+  end
   b:untab()
   b:ln("}")
   b:ln("")
@@ -825,6 +1492,7 @@ end
 local function emit_register(b, ns)
   b:ln("// Convenience: register a single function into Lua.")
   b:ln("// Example: EngineLuaBridge_::register_into(lua, \"LuaEngine_\"); then in Lua: LuaEngine_({\"get_pixel\", 10, 20})")
+  b:ln("// (or, skipping the name lookup, LuaEngine_({Op.get_pixel, 10, 20}) with Op = make_opcode_table(lua))")
   b:ln("inline void register_into(sol::state_view lua, const char* fn_name = \"LuaEngine_\")")
   b:ln("{")
   b:tab()
@@ -869,7 +1537,10 @@ function U.generate(out_path)
   emit_helpers_cpp(b)
   emit_callback_decls(b, OPS)
   emit_bind_defaults(b, OPS)
+  emit_opcodes(b, OPS)
   emit_dispatch(b, OPS)
+  emit_direct(b, OPS)
+  emit_command_buffer(b, OPS)
   emit_register(b, ns)
   emit_epilogue(b)
 
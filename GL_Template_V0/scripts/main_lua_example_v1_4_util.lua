@@ -75,7 +75,7 @@ return function(ctx)
       error(U.GFX_MODULE .. ".lua must return function(cmd) -> gfx", 2)
     end
 
-    local gfx = make_gfx(cmd)
+    local gfx = make_gfx(cmd, Engine.Op, Engine.CommandBuffer, Engine.Direct, Engine.Kernel, Engine.Mat4)
     if type(gfx) ~= "table" then
       error(U.GFX_MODULE .. " factory must return gfx table", 2)
     end